@@ -84,3 +84,72 @@ WVTEST_MAIN("Adler32 Test")
 
     WVPASSEQ(adler32str, "11e60398");
 }
+
+
+WVTEST_MAIN("CRC32C Test")
+{
+    WvCrc32cDigest crc32c;
+    WvDynBuf inbuf, crc32cbuf;
+    inbuf.put("123456789", 9);
+    crc32c.encode(inbuf, crc32cbuf);
+    crc32c.finish(crc32cbuf);
+    WVPASSEQ(crc32c.digestsize(), 4);
+    WVPASSEQ(WvHexEncoder().strflushbuf(crc32cbuf, true), "e3069283");
+
+    // and the same thing in pieces
+    crc32c.reset();
+    inbuf.put("1234", 4);
+    crc32c.encode(inbuf, crc32cbuf);
+    inbuf.put("56789", 5);
+    crc32c.encode(inbuf, crc32cbuf);
+    crc32c.finish(crc32cbuf);
+    WVPASSEQ(WvHexEncoder().strflushbuf(crc32cbuf, true), "e3069283");
+}
+
+
+static WvString digest_of(WvDigest &d, WvBuf &data)
+{
+    WvDynBuf out;
+    d.reset();
+    WvConstInPlaceBuf in(data.peek(0, data.used()), data.used());
+    d.flush(in, out);
+    d.finish(out);
+    return WvHexEncoder().strflushbuf(out, true);
+}
+
+
+WVTEST_MAIN("multiple digests at once")
+{
+    // big enough to go through in several pieces
+    WvDynBuf data;
+    for (int n = 0; n < 10000; n++)
+	data.putstr(WvString("line %s of some data\n", n));
+
+    WvMD5Digest md5;
+    WvSHA1Digest sha1;
+    WvCrc32Digest crc32;
+    WvString want("%s%s%s", digest_of(md5, data), digest_of(sha1, data),
+		  digest_of(crc32, data));
+
+    WvMultiDigest multi;
+    multi.add(new WvMD5Digest);
+    multi.add(new WvSHA1Digest);
+    multi.add(new WvCrc32Digest);
+    WVPASSEQ(multi.digestsize(), 16 + 20 + 4);
+    WVPASSEQ(digest_of(multi, data), want);
+
+    // after a reset, it starts over
+    WVPASSEQ(digest_of(multi, data), want);
+
+    // and it doesn't matter how the data comes in
+    WvDynBuf out;
+    multi.reset();
+    while (data.used())
+    {
+	size_t len = data.used() < 1000 ? data.used() : 1000;
+	WvConstInPlaceBuf piece(data.get(len), len);
+	multi.encode(piece, out);
+    }
+    multi.finish(out);
+    WVPASSEQ(WvHexEncoder().strflushbuf(out, true), want);
+}
@@ -1,6 +1,8 @@
 /* FIXME: horribly incomplete */
 #include "wvtest.h"
 #include "wvrsa.h"
+#include "wvistreamlist.h"
+#include "wvworkpool.h"
 
 WVTEST_MAIN("extremely basic test")
 {
@@ -141,3 +143,71 @@ WVTEST_MAIN("rsagen")
     WVPASSEQ(rsa_pub.encode(WvRSAKey::RsaPubHex), 
 	     rsa_pub2.encode(WvRSAKey::RsaPubHex));
 }
+
+
+static void got_decrypted(WvDynBuf *where, bool *ok, bool *done,
+			  WvBuf &out, bool _ok)
+{
+    where->merge(out);
+    *ok = _ok;
+    *done = true;
+}
+
+
+static void gotkey(WvRSAKey **where, WvRSAKey *key)
+{
+    *where = key;
+}
+
+
+WVTEST_MAIN("rsagen in the background")
+{
+    WvWorkPool pool(2);
+    WvIStreamList l;
+    l.append(&pool, false, "pool");
+
+    // while big keys are being made, the main loop keeps going
+    WvRSAKey *keys[2] = { NULL, NULL };
+    WvRSAKey::generate_async(2048, wv::bind(gotkey, &keys[0], _1), &pool);
+    WvRSAKey::generate_async(2048, wv::bind(gotkey, &keys[1], _1), &pool);
+
+    time_t slowest = 0;
+    WvTime start = wvtime(), last = start;
+    while ((!keys[0] || !keys[1]) && msecdiff(wvtime(), start) < 60000)
+    {
+	l.runonce(10);
+	WvTime now = wvtime();
+	if (msecdiff(now, last) > slowest)
+	    slowest = msecdiff(now, last);
+	last = now;
+    }
+    printf("keys took %ld ms; the slowest loop took %ld ms\n",
+	   (long)msecdiff(wvtime(), start), (long)slowest);
+    WVPASS(slowest < 100);
+
+    WVPASS(keys[0] && keys[0]->isok());
+    WVPASS(keys[1] && keys[1]->isok());
+    if (keys[0] && keys[1])
+	WVPASS(keys[0]->encode(WvRSAKey::RsaHex)
+	       != keys[1]->encode(WvRSAKey::RsaHex));
+
+    // and the keys work, through a private key operation in the
+    // background too
+    WvDynBuf in, out;
+    in.putstr("a secret");
+    WvRSAEncoder enc(WvRSAEncoder::Encrypt, *keys[0]);
+    enc.flush(in, out);
+    bool ok = false, done = false;
+    WvDynBuf decrypted;
+    WvRSAEncoder::encode_async(WvRSAEncoder::Decrypt, *keys[0], out,
+			       wv::bind(got_decrypted, &decrypted, &ok, &done,
+					_1, _2), &pool);
+    WVPASSEQ(out.used(), 0);
+    while (!done && msecdiff(wvtime(), start) < 60000)
+	l.runonce(10);
+    WVPASS(ok);
+    WVPASSEQ(decrypted.getstr(), "a secret");
+
+    delete keys[0];
+    delete keys[1];
+}
@@ -4,6 +4,7 @@
 #include "wvtest.h"
 #include "wvx509.h"
 #include "wvx509mgr.h"
+#include "wvworkpool.h"
 #include "wvautoconf.h"
 
 // default keylen for where we're not using pre-existing certs
@@ -389,6 +390,69 @@ WVTEST_MAIN("certreq / signreq / signcert")
 }
 
 
+WVTEST_MAIN("signreqs / validate_certs")
+{
+    WvRSAKey rsakey(DEFAULT_KEYLEN);
+    WvDynBuf reqs;
+    for (int n = 0; n < 10; n++)
+	reqs.putstr(WvX509Mgr::certreq(
+			WvString("cn=test%s.signed.com,dc=signed,dc=com", n),
+			rsakey));
+
+    WvX509Mgr cacert("CN=test.foo.com,DC=foo,DC=com", DEFAULT_KEYLEN, true);
+    WvWorkPool pool(3);
+    WvDynBuf certs;
+    WVPASSEQ(cacert.signreqs(reqs, certs, &pool), 10);
+    WVPASSEQ(reqs.used(), 0);
+
+    // the first one is what signreq() would have made
+    WvDynBuf der;
+    der.put(certs.peek(0, certs.used()), certs.used());
+    WvX509 cert;
+    cert.decode(WvX509::CertDER, der);
+    WVPASS(cert.isok());
+    WVPASS(strstr(cert.get_subject(), "test0.signed.com"));
+    WVPASS(cert.validate(&cacert));
+    WVPASSEQ(cert.get_aki(), cacert.get_ski());
+
+    der.put(certs.peek(0, certs.used()), certs.used());
+    bool valid[12];
+    WVPASSEQ(cacert.validate_certs(der, valid, 12, &pool), 10);
+    WVPASSEQ(der.used(), 0);
+    WVPASS(valid[0]);
+    WVPASS(valid[9]);
+    WVFAIL(valid[10]);
+
+    // but they weren't signed by some other CA
+    WvX509Mgr otherca("CN=test.bar.com,DC=bar,DC=com", DEFAULT_KEYLEN, true);
+    der.put(certs.peek(0, certs.used()), certs.used());
+    WVPASSEQ(otherca.validate_certs(der, NULL, 0, &pool), 0);
+
+    // a broken signature fails just that one, and garbage fails everything
+    // from there on
+    size_t len = certs.used();
+    unsigned char *broken = new unsigned char[len];
+    memcpy(broken, certs.get(len), len);
+    broken[len - 1] ^= 1;
+    der.put(broken, len);
+    der.putstr("garbage");
+    der.put(broken, 10);
+    WVPASSEQ(cacert.validate_certs(der, valid, 12, &pool), 9);
+    WVPASS(valid[8]);
+    WVFAIL(valid[9]);
+    WVFAIL(valid[10]);
+    delete[] broken;
+
+    // a certificate that isn't allowed to sign doesn't
+    WvX509Mgr notca("CN=test.baz.com,DC=baz,DC=com", DEFAULT_KEYLEN, false);
+    reqs.putstr(WvX509Mgr::certreq("cn=test.signed.com,dc=signed,dc=com",
+				   rsakey));
+    WVPASSEQ(notca.signreqs(reqs, certs, &pool), 0);
+    WVPASSEQ(reqs.used(), 0);
+    WVPASSEQ(certs.used(), 0);
+}
+
+
 WVTEST_MAIN("certificate policies")
 {
     WvX509 t509;
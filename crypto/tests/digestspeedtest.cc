@@ -0,0 +1,108 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast the checksum and digest encoders go, and how much
+ * faster it is to do several digests of the same data in one pass with
+ * WvMultiDigest than one after the other.
+ *
+ *     digestspeedtest [megabytes [runs]]
+ */
+#include "wvcrc.h"
+#include "wvdigest.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <zlib.h>
+
+
+static void report(const char *what, size_t bytes, int runs, WvTime start)
+{
+    double secs = msecdiff(wvtime(), start) / 1000.0;
+    printf("%-28s %8.2f GB/sec\n", what,
+           (double)bytes * runs / secs / (1024 * 1024 * 1024));
+}
+
+
+// the way WvCrc32Digest used to do it
+static void run_zlib(const unsigned char *data, size_t len, int runs)
+{
+    uLong crc = 0;
+    WvTime start = wvtime();
+    for (int n = 0; n < runs; n++)
+        crc = crc32(crc, data, len);
+    report("zlib crc32()", len, runs, start);
+}
+
+
+static void run(const char *what, WvDigest &d, const unsigned char *data,
+                size_t len, int runs)
+{
+    WvDynBuf out;
+    WvTime start = wvtime();
+    for (int n = 0; n < runs; n++)
+    {
+        WvConstInPlaceBuf in(data, len);
+        d.reset();
+        d.flush(in, out);
+        d.finish(out);
+    }
+    report(what, len, runs, start);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t megs = argc > 1 ? atoi(argv[1]) : 64;
+    int runs = argc > 2 ? atoi(argv[2]) : 10;
+    size_t len = megs * 1024 * 1024;
+    unsigned char *data = new unsigned char[len];
+    for (size_t i = 0; i < len; i++)
+        data[i] = i * 31 + (i >> 12);
+    printf("%lu MB, %d times, using %s\n", (unsigned long)megs, runs,
+           wvcrc_impl());
+
+    run_zlib(data, len, runs);
+    {
+        WvCrc32Digest d;
+        run("WvCrc32Digest", d, data, len, runs);
+    }
+    {
+        WvCrc32cDigest d;
+        run("WvCrc32cDigest", d, data, len, runs);
+    }
+    {
+        WvAdler32Digest d;
+        run("WvAdler32Digest", d, data, len, runs);
+    }
+
+    // MD5, SHA-1 and CRC32, one after the other and then all at once
+    WvMD5Digest md5;
+    WvSHA1Digest sha1;
+    WvCrc32Digest crc;
+    {
+        WvDynBuf out;
+        WvTime start = wvtime();
+        for (int n = 0; n < runs; n++)
+        {
+            WvDigest *ds[3] = { &md5, &sha1, &crc };
+            for (int k = 0; k < 3; k++)
+            {
+                WvConstInPlaceBuf in(data, len);
+                ds[k]->reset();
+                ds[k]->flush(in, out);
+                ds[k]->finish(out);
+            }
+        }
+        report("md5, sha1, crc32 separately", len, runs, start);
+    }
+    {
+        WvMultiDigest multi;
+        multi.add(new WvMD5Digest);
+        multi.add(new WvSHA1Digest);
+        multi.add(new WvCrc32Digest);
+        run("md5+sha1+crc32 WvMultiDigest", multi, data, len, runs);
+    }
+
+    delete[] data;
+    return 0;
+}
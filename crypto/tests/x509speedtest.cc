@@ -0,0 +1,87 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how many certificate requests a CA can sign, and how many
+ * certificates it can check, per second: one at a time with signreq() and
+ * validate(), and in batches with signreqs() and validate_certs().  All
+ * the keys are made up on the spot.
+ *
+ *     x509speedtest [certificates [bits]]
+ */
+#include "wvx509mgr.h"
+#include "wvworkpool.h"
+#include "wvtimeutils.h"
+#include "wvlogrcv.h"
+#include <stdio.h>
+
+
+static void report(const char *what, size_t n, WvTime start)
+{
+    double secs = msecdiff(wvtime(), start) / 1000.0;
+    printf("%-36s %8.0f certs/sec\n", what, n / secs);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t ncerts = argc > 1 ? atoi(argv[1]) : 1000;
+    int bits = argc > 2 ? atoi(argv[2]) : 2048;
+    WvLogConsole log(2, WvLog::Warning);
+
+    printf("Making a CA and %lu requests, with %d-bit keys...\n",
+           (unsigned long)ncerts, bits);
+    WvX509Mgr ca("cn=Speed Test CA,dc=example,dc=com", bits, true);
+
+    // new keys are slow to make, so the requests share a few of them
+    WvRSAKey *keys[4];
+    for (int k = 0; k < 4; k++)
+        keys[k] = new WvRSAKey(bits);
+    WvStringList reqs;
+    WvDynBuf reqbuf;
+    for (size_t n = 0; n < ncerts; n++)
+    {
+        WvString req = WvX509::certreq(
+            WvString("cn=host%s.example.com,dc=example,dc=com", n),
+            *keys[n % 4]);
+        reqs.append(req);
+        reqbuf.putstr(req);
+    }
+
+    WvWorkPool pool;
+    printf("%d threads in the pool.\n", pool.threadcount());
+
+    WvStringList pems;
+    WvTime start = wvtime();
+    WvStringList::Iter i(reqs);
+    for (i.rewind(); i.next(); )
+        pems.append(ca.signreq(*i));
+    report("signreq(), one at a time", ncerts, start);
+
+    WvDynBuf certs;
+    start = wvtime();
+    size_t nsigned = ca.signreqs(reqbuf, certs, &pool);
+    report("signreqs(), all at once", nsigned, start);
+
+    size_t nvalid = 0;
+    start = wvtime();
+    WvStringList::Iter j(pems);
+    for (j.rewind(); j.next(); )
+    {
+        WvX509 cert;
+        cert.decode(WvX509::CertPEM, *j);
+        if (cert.validate(&ca))
+            nvalid++;
+    }
+    report("decode() and validate(), one at a time", ncerts, start);
+    printf("(%lu valid)\n", (unsigned long)nvalid);
+
+    start = wvtime();
+    nvalid = ca.validate_certs(certs, NULL, 0, &pool);
+    report("validate_certs(), all at once", nsigned, start);
+    printf("(%lu valid)\n", (unsigned long)nvalid);
+
+    for (int k = 0; k < 4; k++)
+        delete keys[k];
+    return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * The slow parts of WvRSAKey, WvRSAEncoder, WvX509Mgr and WvDiffieHellman,
+ * done on a WvWorkPool's threads instead of in the main loop.
+ *
+ * The jobs themselves only ever call OpenSSL, on objects nobody else is
+ * using until they're done; all the WvStrings, logging and callbacks
+ * happen back in the main loop.
+ */
+#include "wvrsa.h"
+#include "wvx509mgr.h"
+#include "wvdiffiehellman.h"
+#include "wvworkpool.h"
+#include <openssl/rsa.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+static WvWorkPool &getpool(WvWorkPool *pool)
+{
+    return pool ? *pool : WvWorkPool::global();
+}
+
+
+/***** WvRSAKey *****/
+
+static void rsa_generate(int bits, struct rsa_st **result)
+{
+    *result = RSA_generate_key(bits, 0x10001, NULL, NULL);
+}
+
+
+static void rsa_generated(struct rsa_st **result,
+                          const WvRSAKey::KeyCallback &cb)
+{
+    struct rsa_st *rsa = *result;
+    delete result;
+    cb(new WvRSAKey(rsa, true));
+}
+
+
+void WvRSAKey::generate_async(int bits, const KeyCallback &cb,
+                              WvWorkPool *pool)
+{
+    struct rsa_st **result = new struct rsa_st *;
+    *result = NULL;
+    getpool(pool).submit(wv::bind(rsa_generate, bits, result),
+                         wv::bind(rsa_generated, result, cb));
+}
+
+
+/***** WvRSAEncoder *****/
+
+namespace {
+struct RSAJob
+{
+    WvRSAEncoder *encoder;
+    WvDynBuf in, out;
+    bool ok;
+};
+}
+
+
+static void rsa_encode(RSAJob *j)
+{
+    j->ok = j->encoder->flush(j->in, j->out);
+}
+
+
+static void rsa_encoded(RSAJob *j, const WvRSAEncoder::DoneCallback &cb)
+{
+    delete j->encoder;
+    cb(j->out, j->ok);
+    delete j;
+}
+
+
+void WvRSAEncoder::encode_async(Mode mode, const WvRSAKey &key, WvBuf &in,
+                                const DoneCallback &cb, WvWorkPool *pool)
+{
+    RSAJob *j = new RSAJob;
+    j->encoder = new WvRSAEncoder(mode, key);
+    j->in.merge(in);
+    j->ok = false;
+    getpool(pool).submit(wv::bind(rsa_encode, j),
+                         wv::bind(rsa_encoded, j, cb));
+}
+
+
+/***** WvX509Mgr *****/
+
+// for when there's nothing to do, but the callback should still come later
+static void nothing()
+{
+}
+
+
+void WvX509Mgr::sign_job(X509 *cert, X509_CRL *crl, EVP_PKEY *certkey)
+{
+    if (crl)
+        sign_crl(crl, certkey);
+    else
+        sign_cert(cert, certkey);
+}
+
+
+static void signed_done(EVP_PKEY *certkey, const WvX509Mgr::SignCallback &cb)
+{
+    EVP_PKEY_free(certkey);
+    cb(true);
+}
+
+
+void WvX509Mgr::signcert_async(WvX509 &unsignedcert, const SignCallback &cb,
+                               WvWorkPool *pool) const
+{
+    EVP_PKEY *certkey = certsigner(unsignedcert);
+    if (!certkey)
+        getpool(pool).submit(nothing, wv::bind(cb, false));
+    else
+        getpool(pool).submit(wv::bind(&WvX509Mgr::sign_job,
+                                      unsignedcert.get_cert(),
+                                      (X509_CRL *)NULL, certkey),
+                             wv::bind(signed_done, certkey, cb));
+}
+
+
+void WvX509Mgr::signcrl_async(WvCRL &crl, const SignCallback &cb,
+                              WvWorkPool *pool) const
+{
+    EVP_PKEY *certkey = crlsigner(crl);
+    if (!certkey)
+        getpool(pool).submit(nothing, wv::bind(cb, false));
+    else
+        getpool(pool).submit(wv::bind(&WvX509Mgr::sign_job, (X509 *)NULL,
+                                      crl.getcrl(), certkey),
+                             wv::bind(signed_done, certkey, cb));
+}
+
+
+static void req_signed(WvX509 *newcert, EVP_PKEY *certkey,
+                       const WvX509Mgr::CertCallback &cb)
+{
+    if (certkey)
+        EVP_PKEY_free(certkey);
+    WvString pem(newcert->encode(WvX509::CertPEM));
+    delete newcert;
+    cb(pem);
+}
+
+
+void WvX509Mgr::signreq_async(WvStringParm pkcs10req, const CertCallback &cb,
+                              WvWorkPool *pool) const
+{
+    debug("Signing a certificate request with: %s\n", get_subject());
+    WvX509 *newcert = NULL;
+    if (!isok())
+        debug(WvLog::Warning, "Asked to sign certificate request, but not ok! "
+              "Aborting.\n");
+    else
+        newcert = certfromreq(pkcs10req);
+    if (!newcert)
+    {
+        getpool(pool).submit(nothing, wv::bind(cb, WvString::null));
+        return;
+    }
+
+    // like signreq(), you get the certificate even if it can't be signed
+    EVP_PKEY *certkey = certsigner(*newcert);
+    if (!certkey)
+        getpool(pool).submit(nothing,
+                             wv::bind(req_signed, newcert, certkey, cb));
+    else
+        getpool(pool).submit(wv::bind(&WvX509Mgr::sign_job,
+                                      newcert->get_cert(),
+                                      (X509_CRL *)NULL, certkey),
+                             wv::bind(req_signed, newcert, certkey, cb));
+}
+
+
+static void mgr_signed(WvX509Mgr *mgr, const WvX509Mgr::MgrCallback &cb)
+{
+    cb(mgr);
+}
+
+
+void WvX509Mgr::key_generated(WvStringParm dname, bool ca,
+                              struct rsa_st **result, const MgrCallback &cb,
+                              WvWorkPool *pool)
+{
+    WvX509Mgr *mgr = new WvX509Mgr;
+    mgr->debug("Creating new certificate+key pair for %s.\n", dname);
+    mgr->rsa = new WvRSAKey(*result, true);
+    delete result;
+
+    if (!mgr->rsa->isok())
+    {
+        cb(mgr);
+        return;
+    }
+    mgr->create_selfissued(dname, ca);
+    mgr->debug("Ok - Parameters set... now signing certificate.\n");
+    mgr->signcert_async(*mgr, wv::bind(mgr_signed, mgr, cb), pool);
+}
+
+
+void WvX509Mgr::create_async(WvStringParm _dname, int bits, bool ca,
+                             const MgrCallback &cb, WvWorkPool *pool)
+{
+    struct rsa_st **result = new struct rsa_st *;
+    *result = NULL;
+    getpool(pool).submit(wv::bind(rsa_generate, bits, result),
+                         wv::bind(&WvX509Mgr::key_generated, WvString(_dname),
+                                  ca, result, cb, pool));
+}
+
+
+/***** WvDiffieHellman *****/
+
+void WvDiffieHellman::setup_job(const unsigned char *key, int keylen,
+                                BN_ULONG generator, struct dh_st **info,
+                                int *problems)
+{
+    *info = setup(key, keylen, generator, *problems);
+}
+
+
+void WvDiffieHellman::created(unsigned char *key, BN_ULONG generator,
+                              struct dh_st **info, int *problems,
+                              const DHCallback &cb)
+{
+    WvDiffieHellman *dh = new WvDiffieHellman(*info, generator, *problems);
+    deletev key;
+    delete info;
+    delete problems;
+    cb(dh);
+}
+
+
+void WvDiffieHellman::create_async(const unsigned char *_key, int _keylen,
+                                   BN_ULONG _generator, const DHCallback &cb,
+                                   WvWorkPool *pool)
+{
+    unsigned char *key = new unsigned char[_keylen];
+    memcpy(key, _key, _keylen);
+    struct dh_st **info = new struct dh_st *;
+    int *problems = new int;
+    getpool(pool).submit(wv::bind(&WvDiffieHellman::setup_job, key, _keylen,
+                                  _generator, info, problems),
+                         wv::bind(&WvDiffieHellman::created, key, _generator,
+                                  info, problems, cb));
+}
@@ -38,7 +38,25 @@ WvDiffieHellman::WvDiffieHellman(const unsigned char *_key, int _keylen,
     generator(_generator), log("Diffie-Hellman", WvLog::Debug)
 {
     int problems;
-    int check;
+    info = setup(_key, _keylen, generator, problems);
+    report(problems);
+}
+
+
+WvDiffieHellman::WvDiffieHellman(struct dh_st *_info, BN_ULONG _generator,
+				 int problems) :
+    info(_info), generator(_generator), log("Diffie-Hellman", WvLog::Debug)
+{
+    report(problems);
+}
+
+
+// Everything slow about getting started, without any logging, so that it
+// can happen on another thread.
+struct dh_st *WvDiffieHellman::setup(const unsigned char *_key, int _keylen,
+				     BN_ULONG generator, int &problems)
+{
+    struct dh_st *info;
     {
 	info = DH_new();
 	info->p = BN_bin2bn(_key, _keylen, NULL);
@@ -56,8 +74,16 @@ WvDiffieHellman::WvDiffieHellman(const unsigned char *_key, int _keylen,
 //  	info->g->flags = 0;
     }
 
-    check = BN_mod_word(info->p, 24);
+    problems = 0;
     DH_check(info, &problems);
+    DH_generate_key(info);
+    return info;
+}
+
+
+void WvDiffieHellman::report(int problems)
+{
+    int check = BN_mod_word(info->p, 24);
     if (problems & DH_CHECK_P_NOT_PRIME)
  	log(WvLog::Error, "Using a composite number for authentication.\n");
     if (problems & DH_CHECK_P_NOT_SAFE_PRIME)
@@ -67,7 +93,6 @@ WvDiffieHellman::WvDiffieHellman(const unsigned char *_key, int _keylen,
 	    BN_bn2hex(info->g), check);
     if (problems & DH_UNABLE_TO_CHECK_GENERATOR)
 	log(WvLog::Notice, "Using a strange argument for diffie-hellman.\n");
-    DH_generate_key(info);
 }
 
 int WvDiffieHellman::pub_key_len()
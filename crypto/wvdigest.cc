@@ -5,6 +5,7 @@
  * MD5, SHA-1 and HMAC digest abstractions.
  */
 #include "wvdigest.h"
+#include "wvcrc.h"
 #include "wvserialize.h"
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
@@ -16,7 +17,7 @@
 WvEVPMDDigest::WvEVPMDDigest(const env_md_st *_evpmd) :
     evpmd(_evpmd), active(false)
 {
-    evpctx = new EVP_MD_CTX;
+    evpctx = EVP_MD_CTX_create();
     _reset();
 }
 
@@ -24,7 +25,7 @@ WvEVPMDDigest::WvEVPMDDigest(const env_md_st *_evpmd) :
 WvEVPMDDigest::~WvEVPMDDigest()
 {
     cleanup();
-    delete evpctx;
+    EVP_MD_CTX_destroy(evpctx);
 }
 
 
@@ -46,7 +47,7 @@ bool WvEVPMDDigest::_finish(WvBuf &outbuf)
     assert(active);
     unsigned char digest[EVP_MAX_MD_SIZE];
     unsigned int size; // size_t is not an unsigned int on many 64 bit systems
-    EVP_DigestFinal(evpctx, digest, & size);
+    EVP_DigestFinal_ex(evpctx, digest, & size);
     active = false;
     outbuf.put(digest, size);
     return true;
@@ -59,8 +60,9 @@ bool WvEVPMDDigest::_reset()
     
     // the typecast is necessary for API compatibility with different
     // versions of openssl.  None of them *actually* change the contents of
-    // the pointer.
-    EVP_DigestInit(evpctx, (env_md_st *)evpmd);
+    // the pointer.  Unlike EVP_DigestInit(), this reuses the context's
+    // memory from last time, if it's the same digest.
+    EVP_DigestInit_ex(evpctx, (env_md_st *)evpmd, NULL);
     active = true;
     return true;
 }
@@ -68,13 +70,9 @@ bool WvEVPMDDigest::_reset()
 
 void WvEVPMDDigest::cleanup()
 {
-    if (active)
-    {
-        // discard digest
-        unsigned char digest[EVP_MAX_MD_SIZE];
-        EVP_DigestFinal(evpctx, digest, NULL);
-        active = false;
-    }
+    // nothing to discard: EVP_DigestInit_ex() starts over anyway, and
+    // EVP_MD_CTX_destroy() frees whatever's left
+    active = false;
 }
 
 size_t WvEVPMDDigest::digestsize() const
@@ -179,7 +177,7 @@ bool WvCrc32Digest::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
 {
     size_t len;
     while ((len = inbuf.optgettable()) != 0)
-        crc = crc32(crc, inbuf.get(len), len);
+        crc = wvcrc32(crc, inbuf.get(len), len);
     return true;
 }
 
@@ -193,7 +191,7 @@ bool WvCrc32Digest::_finish(WvBuf &outbuf)
 
 bool WvCrc32Digest::_reset()
 {
-    crc = crc32(0, NULL, 0);
+    crc = 0;
     return true;
 }
 
@@ -204,6 +202,41 @@ size_t WvCrc32Digest::digestsize() const
 }
 
 
+WvCrc32cDigest::WvCrc32cDigest()
+{
+    _reset();
+}
+
+
+bool WvCrc32cDigest::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    size_t len;
+    while ((len = inbuf.optgettable()) != 0)
+        crc = wvcrc32c(crc, inbuf.get(len), len);
+    return true;
+}
+
+
+bool WvCrc32cDigest::_finish(WvBuf &outbuf)
+{
+    wv_serialize(outbuf, crc);
+    return true;
+}
+
+
+bool WvCrc32cDigest::_reset()
+{
+    crc = 0;
+    return true;
+}
+
+
+size_t WvCrc32cDigest::digestsize() const
+{
+    return sizeof(crc);
+}
+
+
 WvAdler32Digest::WvAdler32Digest()
 {
     _reset();
@@ -237,3 +270,74 @@ size_t WvAdler32Digest::digestsize() const
 {
     return sizeof(crc);
 }
+
+
+/***** WvMultiDigest *****/
+
+// how much of the input each digest gets at a time: small enough to stay
+// in the cache until the last one is done with it
+#define MULTI_CHUNK 16384
+
+WvMultiDigest::WvMultiDigest()
+{
+}
+
+
+void WvMultiDigest::add(WvDigest *digest)
+{
+    digests.append(digest, true);
+}
+
+
+bool WvMultiDigest::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    bool success = true;
+    size_t len;
+    while ((len = inbuf.optgettable()) != 0)
+    {
+        if (len > MULTI_CHUNK)
+            len = MULTI_CHUNK;
+        const unsigned char *data = inbuf.get(len);
+
+        WvDigestList::Iter i(digests);
+        for (i.rewind(); i.next(); )
+        {
+            WvConstInPlaceBuf piece(data, len);
+            if (!i->encode(piece, outbuf, flush))
+                success = false;
+        }
+    }
+    return success;
+}
+
+
+bool WvMultiDigest::_finish(WvBuf &outbuf)
+{
+    bool success = true;
+    WvDigestList::Iter i(digests);
+    for (i.rewind(); i.next(); )
+        if (!i->finish(outbuf))
+            success = false;
+    return success;
+}
+
+
+bool WvMultiDigest::_reset()
+{
+    bool success = true;
+    WvDigestList::Iter i(digests);
+    for (i.rewind(); i.next(); )
+        if (!i->reset())
+            success = false;
+    return success;
+}
+
+
+size_t WvMultiDigest::digestsize() const
+{
+    size_t total = 0;
+    WvDigestList::Iter i(digests);
+    for (i.rewind(); i.next(); )
+        total += i->digestsize();
+    return total;
+}
@@ -0,0 +1,231 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Signing and checking certificates by the thousand: WvX509Mgr::signreqs()
+ * and WvX509::validate_certs().  See wvx509mgr.h and wvx509.h.
+ *
+ * The batch is cut into one piece per thread of a WvWorkPool.  Like in
+ * wvasynccrypto.cc, the jobs only ever call OpenSSL, but each also gets
+ * its own copy of the key: an RSA key caches things (blinding factors,
+ * Montgomery contexts) that older OpenSSLs only update safely from
+ * several threads if the program has set up locking callbacks, which we
+ * don't.
+ */
+#include "wvx509mgr.h"
+#include "wvworkpool.h"
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <openssl/err.h>
+#include <vector>
+
+static WvWorkPool &getpool(WvWorkPool *pool)
+{
+    return pool ? *pool : WvWorkPool::global();
+}
+
+
+// how many pieces to cut 'n' things into
+static size_t npieces(WvWorkPool &pool, size_t n)
+{
+    size_t pieces = pool.threadcount();
+    return pieces < n ? pieces : n;
+}
+
+
+/***** WvX509Mgr::signreqs() *****/
+
+void WvX509Mgr::sign_certs(X509 **certs, size_t ncerts, EVP_PKEY *certkey)
+{
+    for (size_t n = 0; n < ncerts; n++)
+        sign_cert(certs[n], certkey);
+}
+
+
+size_t WvX509Mgr::signreqs(WvBuf &pkcs10reqs, WvBuf &certs,
+                           WvWorkPool *_pool) const
+{
+    debug("Signing certificate requests with: %s\n", get_subject());
+    size_t len = pkcs10reqs.used();
+    const unsigned char *pem = pkcs10reqs.get(len);
+    if (!isok())
+    {
+        debug(WvLog::Warning, "Asked to sign certificate requests, but not "
+              "ok! Aborting.\n");
+        return 0;
+    }
+
+    // one BIO for the lot, instead of a WvString and a BIO for each
+    BIO *membuf = BIO_new_mem_buf((void *)pem, len);
+    std::vector<WvX509 *> newcerts;
+    X509_REQ *certreq;
+    while ((certreq = PEM_read_bio_X509_REQ(membuf, NULL, NULL, NULL)))
+    {
+        newcerts.push_back(certfromreq(certreq));
+        X509_REQ_free(certreq);
+    }
+    BIO_free(membuf);
+    ERR_clear_error(); // it always stops with an error, even at the end
+
+    size_t nsigned = 0;
+    EVP_PKEY *certkey = newcerts.empty() ? NULL : certsigner(*newcerts[0]);
+    if (certkey)
+    {
+        EVP_PKEY_free(certkey);
+
+        WvWorkPool &pool = getpool(_pool);
+        size_t n = newcerts.size(), pieces = npieces(pool, n);
+        std::vector<X509 *> x509s(n);
+        for (size_t i = 0; i < n; i++)
+            x509s[i] = newcerts[i]->get_cert();
+
+        std::vector<EVP_PKEY *> keys(pieces);
+        std::vector<WvWorkPool::Job> jobs(pieces);
+        for (size_t p = 0; p < pieces; p++)
+        {
+            size_t first = n * p / pieces, last = n * (p + 1) / pieces;
+            keys[p] = EVP_PKEY_new();
+            EVP_PKEY_assign_RSA(keys[p], RSAPrivateKey_dup(rsa->rsa));
+            jobs[p] = wv::bind(&WvX509Mgr::sign_certs, &x509s[first],
+                               last - first, keys[p]);
+        }
+        pool.run(&jobs[0], pieces);
+
+        for (size_t p = 0; p < pieces; p++)
+            EVP_PKEY_free(keys[p]);
+
+        // straight into 'certs', without a BIO or a WvString in between
+        for (size_t i = 0; i < n; i++)
+        {
+            int derlen = i2d_X509(x509s[i], NULL);
+            if (derlen <= 0)
+                continue;
+            unsigned char *der = certs.alloc(derlen);
+            i2d_X509(x509s[i], &der);
+            nsigned++;
+        }
+    }
+
+    for (size_t i = 0; i < newcerts.size(); i++)
+        delete newcerts[i];
+
+    debug("Signed %s of %s certificate requests.\n", nsigned,
+          newcerts.size());
+    return nsigned;
+}
+
+
+/***** WvX509::validate_certs() *****/
+
+namespace {
+struct CertCheck
+{
+    const unsigned char *der;
+    long len;
+    bool ok;
+};
+}
+
+
+static void check_certs(X509 *cacert, EVP_PKEY *cakey, CertCheck *checks,
+                        size_t nchecks)
+{
+    for (size_t n = 0; n < nchecks; n++)
+    {
+        const unsigned char *der = checks[n].der;
+        X509 *cert = d2i_X509(NULL, &der, checks[n].len);
+
+        // the same as validate(), signedbyca() and issuedbyca()
+        checks[n].ok = cert
+            && X509_cmp_current_time(X509_get_notAfter(cert)) >= 0
+            && X509_cmp_current_time(X509_get_notBefore(cert)) <= 0
+            && X509_verify(cert, cakey) > 0
+            && X509_check_issued(cacert, cert) == X509_V_OK;
+
+        if (cert)
+            X509_free(cert);
+    }
+    ERR_clear_error();
+}
+
+
+size_t WvX509::validate_certs(WvBuf &certs, bool *valid, size_t max,
+                              WvWorkPool *_pool) const
+{
+    size_t len = certs.used();
+    const unsigned char *der = certs.get(len), *end = der + len;
+    for (size_t n = 0; valid && n < max; n++)
+        valid[n] = false;
+
+    EVP_PKEY *cakey = cert ? X509_get_pubkey(cert) : NULL;
+    if (!cakey)
+    {
+        debug(WvLog::Warning, "Tried to validate certificates against CA, "
+              "but CA certificate is blank!\n");
+        return 0;
+    }
+
+    // Only split them up here; decoding them is part of the work.
+    std::vector<CertCheck> checks;
+    while (der < end)
+    {
+        const unsigned char *content = der;
+        long contentlen;
+        int tag, xclass;
+        if (ASN1_get_object(&content, &contentlen, &tag, &xclass, end - der)
+                != V_ASN1_CONSTRUCTED || tag != V_ASN1_SEQUENCE)
+        {
+            debug("Certificate %s isn't DER; stopping there.\n",
+                  checks.size());
+            ERR_clear_error();
+            break;
+        }
+        CertCheck check;
+        check.der = der;
+        check.len = content + contentlen - der;
+        check.ok = false;
+        checks.push_back(check);
+        der = content + contentlen;
+    }
+
+    // X509_check_issued() caches the CA's extensions the first time;
+    // get that over with before there are threads.
+    X509_check_purpose(cert, -1, 0);
+
+    unsigned char *keyder = NULL;
+    int keylen = i2d_PUBKEY(cakey, &keyder);
+    EVP_PKEY_free(cakey);
+
+    WvWorkPool &pool = getpool(_pool);
+    size_t n = checks.size(), pieces = npieces(pool, n);
+    std::vector<EVP_PKEY *> keys(pieces);
+    std::vector<WvWorkPool::Job> jobs(pieces);
+    for (size_t p = 0; p < pieces; p++)
+    {
+        size_t first = n * p / pieces, last = n * (p + 1) / pieces;
+        const unsigned char *k = keyder;
+        keys[p] = d2i_PUBKEY(NULL, &k, keylen);
+        jobs[p] = wv::bind(check_certs, cert, keys[p], &checks[first],
+                           last - first);
+    }
+    if (pieces)
+        pool.run(&jobs[0], pieces);
+    OPENSSL_free(keyder);
+
+    size_t nvalid = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (checks[i].ok)
+            nvalid++;
+        if (valid && i < max)
+            valid[i] = checks[i].ok;
+    }
+    for (size_t p = 0; p < pieces; p++)
+        EVP_PKEY_free(keys[p]);
+
+    debug("%s of %s certificates were valid for CA %s.\n", nvalid, n,
+          get_subject());
+    return nvalid;
+}
@@ -3,6 +3,7 @@
 #include "wvx509mgr.h"
 #include "wvautoconf.h"
 
+#include <openssl/bn.h>
 #include <openssl/pem.h>
 #include <openssl/x509v3.h>
 #include <openssl/err.h>
@@ -274,80 +275,111 @@ WvString WvX509Mgr::signreq(WvStringParm pkcs10req) const
         return false;
     }
 
-    // Break this next part out into a de-pemify section, since that is what
-    // this part up until the FIXME: is about.
-    WvString pkcs10(pkcs10req);
-    
+    WvX509 *newcert = certfromreq(pkcs10req);
+    if (!newcert)
+	return WvString::null;
+
+    signcert(*newcert);
+    WvString pem(newcert->encode(WvX509::CertPEM));
+    delete newcert;
+    return pem;
+}
+
+
+// Makes the (unsigned) certificate that signreq() would sign.
+WvX509 *WvX509Mgr::certfromreq(WvStringParm pkcs10req) const
+{
     BIO *membuf = BIO_new(BIO_s_mem());
     BIO_write(membuf, pkcs10req, pkcs10req.len());
 
     X509_REQ *certreq = PEM_read_bio_X509_REQ(membuf, NULL, NULL, NULL);
     BIO_free_all(membuf);
 
-    if (certreq)
+    if (!certreq)
     {
-	WvX509 newcert(X509_new());
+	debug("Can't decode Certificate Request\n");
+	return NULL;
+    }
 
-	newcert.set_subject(X509_REQ_get_subject_name(certreq));
-	newcert.set_version();
-	
-	// Set the Serial Number for the certificate
-	srand(time(NULL));
-	int serial = rand();
-	newcert.set_serial(serial);
-	
-	newcert.set_lifetime(60*60*24*3650);
+    WvX509 *newcert = certfromreq(certreq);
+    X509_REQ_free(certreq);
+    return newcert;
+}
+
+
+WvX509 *WvX509Mgr::certfromreq(X509_REQ *certreq) const
+{
+    WvX509 *newcertp = new WvX509(X509_new());
+    WvX509 &newcert = *newcertp;
+
+    newcert.set_subject(X509_REQ_get_subject_name(certreq));
+    newcert.set_version();
+
+    // The serial has to be unique for each certificate we issue, even
+    // when thousands get signed in the same second, so it's 63 random
+    // bits from OpenSSL's generator (not rand(), which we'd have to seed
+    // from the clock, and which belongs to the rest of the program).
+    BIGNUM *bn = BN_new();
+    if (bn && BN_rand(bn, 63, -1, 0))
+        BN_to_ASN1_INTEGER(bn, X509_get_serialNumber(newcert.get_cert()));
+    else
+        debug(WvLog::Warning, "Can't make a random serial number!\n");
+    BN_free(bn);
+    newcert.set_lifetime(60*60*24*3650);
 	
-	// The public key of the new cert should be the same as that from 
-	// the request.
-	EVP_PKEY *pk = X509_REQ_get_pubkey(certreq);
-	X509_set_pubkey(newcert.get_cert(), pk);
-	EVP_PKEY_free(pk);
+    // The public key of the new cert should be the same as that from 
+    // the request.
+    EVP_PKEY *pk = X509_REQ_get_pubkey(certreq);
+    X509_set_pubkey(newcert.get_cert(), pk);
+    EVP_PKEY_free(pk);
 
-        // every good cert needs an ski+aki
-        newcert.set_ski();
-        newcert.set_aki(*this);
+    // every good cert needs an ski+aki
+    newcert.set_ski();
+    newcert.set_aki(*this);
 
-	// The Issuer name is the subject name of the current cert
-	newcert.set_issuer(*this); 
+    // The Issuer name is the subject name of the current cert
+    newcert.set_issuer(*this); 
 	
-	X509_EXTENSION *ex = NULL;
-	// Set the RFC2459-mandated keyUsage field to critical, and restrict
-	// the usage of this cert to digital signature and key encipherment.
-	newcert.set_key_usage("critical, digitalSignature, keyEncipherment");
+    X509_EXTENSION *ex = NULL;
+    // Set the RFC2459-mandated keyUsage field to critical, and restrict
+    // the usage of this cert to digital signature and key encipherment.
+    newcert.set_key_usage("critical, digitalSignature, keyEncipherment");
     
-	// This could cause Netscape to barf because if we set
-	// basicConstraints to critical, we break RFC2459 compliance. Why
-	// they chose to enforce that bit, and not the rest is beyond me...
-	// but oh well...
-	ex = X509V3_EXT_conf_nid(NULL, NULL, NID_basic_constraints,
-				 (char*)"CA:FALSE");
+    // This could cause Netscape to barf because if we set
+    // basicConstraints to critical, we break RFC2459 compliance. Why
+    // they chose to enforce that bit, and not the rest is beyond me...
+    // but oh well...
+    ex = X509V3_EXT_conf_nid(NULL, NULL, NID_basic_constraints,
+			     (char*)"CA:FALSE");
 	
-	X509_add_ext(newcert.get_cert(), ex, -1);
-	X509_EXTENSION_free(ex);
+    X509_add_ext(newcert.get_cert(), ex, -1);
+    X509_EXTENSION_free(ex);
 
-	newcert.set_ext_key_usage("critical, TLS Web Client Authentication");
+    newcert.set_ext_key_usage("critical, TLS Web Client Authentication");
 
-	signcert(newcert);
-	
-	X509_REQ_free(certreq);
-	return WvString(newcert.encode(WvX509::CertPEM));
-    }
-    else
-    {
-	debug("Can't decode Certificate Request\n");
-	return WvString::null;
-    }
+    return newcertp;
 }
 
 
 bool WvX509Mgr::signcert(WvX509 &unsignedcert) const
+{
+    EVP_PKEY *certkey = certsigner(unsignedcert);
+    if (!certkey)
+	return false;
+
+    sign_cert(unsignedcert.get_cert(), certkey);
+    EVP_PKEY_free(certkey);
+    return true;
+}
+
+
+EVP_PKEY *WvX509Mgr::certsigner(const WvX509 &unsignedcert) const
 {
     if (!isok())
     {
         debug(WvLog::Warning, "Asked to sign certificate, but not ok! "
               "Aborting.\n");
-        return false;
+        return NULL;
     }
 
     if (cert == unsignedcert.cert)
@@ -359,49 +391,62 @@ bool WvX509Mgr::signcert(WvX509 &unsignedcert) const
     {
         debug("This certificate is not a CA, and is thus not allowed to sign "
               "certificates!\n");
-        return false;
+        return NULL;
     }
 #endif
     else if (!((cert->ex_flags & EXFLAG_KUSAGE) && 
                (cert->ex_kusage & KU_KEY_CERT_SIGN)))
     {
 	debug("This Certificate is not allowed to sign certificates!\n");
-	return false;
+	return NULL;
     }
     
     debug("Ok, now sign the new cert with the current RSA key.\n");
     EVP_PKEY *certkey = EVP_PKEY_new();
     bool cakeyok = EVP_PKEY_set1_RSA(certkey, rsa->rsa);
-    if (cakeyok)
-    {	
-	X509_sign(unsignedcert.get_cert(), certkey, EVP_sha1());
-    }
-    else
+    if (!cakeyok)
     {
 	debug("No keys??\n");
 	EVP_PKEY_free(certkey);
-	return false;
+	return NULL;
     }
     
+    return certkey;
+}
+
+
+void WvX509Mgr::sign_cert(X509 *cert, EVP_PKEY *certkey)
+{
+    X509_sign(cert, certkey, EVP_sha1());
+}
+
+
+bool WvX509Mgr::signcrl(WvCRL &crl) const
+{
+    EVP_PKEY *certkey = crlsigner(crl);
+    if (!certkey)
+	return false;
+
+    sign_crl(crl.getcrl(), certkey);
     EVP_PKEY_free(certkey);
     return true;
 }
 
 
-bool WvX509Mgr::signcrl(WvCRL &crl) const
+EVP_PKEY *WvX509Mgr::crlsigner(WvCRL &crl) const
 {
     if (!isok() || !crl.isok())
     {
         debug(WvLog::Warning, "Asked to sign CRL, but certificate or CRL (or "
               "both) not ok! Aborting.\n");
-        return false;
+        return NULL;
     }
 #ifdef HAVE_OPENSSL_POLICY_MAPPING
     else if (!X509_check_ca(cert))
     {
         debug("This certificate is not a CA, and is thus not allowed to sign "
               "CRLs!\n");
-        return false;
+        return NULL;
     }
     else if (!((cert->ex_flags & EXFLAG_KUSAGE) && 
 	  (cert->ex_kusage & KU_CRL_SIGN)))
@@ -409,36 +454,37 @@ bool WvX509Mgr::signcrl(WvCRL &crl) const
 	debug("Certificate not allowed to sign CRLs! (%s %s)\n", 
               (cert->ex_flags & EXFLAG_KUSAGE),
 	      (cert->ex_kusage & KU_CRL_SIGN));
-	return false;
+	return NULL;
     }
 #endif
     
     EVP_PKEY *certkey = EVP_PKEY_new();
     bool cakeyok = EVP_PKEY_set1_RSA(certkey, rsa->rsa);
-    if (cakeyok)
-    {
-	ASN1_TIME *tmptm = ASN1_TIME_new();
-	// Set the LastUpdate time to now.
-	X509_gmtime_adj(tmptm, 0);
-	X509_CRL_set_lastUpdate(crl.getcrl(), tmptm);
-	// CRL's are valid for 30 days
-	X509_gmtime_adj(tmptm, (long)60*60*24*30);
-	X509_CRL_set_nextUpdate(crl.getcrl(), tmptm);
-	ASN1_TIME_free(tmptm);
-	
-	// OK - now sign it...
-	X509_CRL_sign(crl.getcrl(), certkey, EVP_sha1());
-    }
-    else
+    if (!cakeyok)
     {
 	debug(WvLog::Warning, "Asked to sign CRL, but no RSA key associated "
               "with certificate. Aborting.\n");
 	EVP_PKEY_free(certkey);
-	return false;
+	return NULL;
     }
-    EVP_PKEY_free(certkey);
 
-    return true;
+    return certkey;
+}
+
+
+void WvX509Mgr::sign_crl(X509_CRL *crl, EVP_PKEY *certkey)
+{
+    ASN1_TIME *tmptm = ASN1_TIME_new();
+    // Set the LastUpdate time to now.
+    X509_gmtime_adj(tmptm, 0);
+    X509_CRL_set_lastUpdate(crl, tmptm);
+    // CRL's are valid for 30 days
+    X509_gmtime_adj(tmptm, (long)60*60*24*30);
+    X509_CRL_set_nextUpdate(crl, tmptm);
+    ASN1_TIME_free(tmptm);
+	
+    // OK - now sign it...
+    X509_CRL_sign(crl, certkey, EVP_sha1());
 }
 
 
@@ -10,6 +10,7 @@
 #include "unitempgen.h"
 #include "uniconftree.h"
 #include "wvlog.h"
+#include "wvtimeutils.h"
 
 /**
  * A UniConf generator that adds a cache layer on top of another generator
@@ -19,6 +20,16 @@
  * that a read-only uniconfclient, when cached, will never actively contact
  * the uniconfdaemon.
  *
+ * In lazy mode, it loads nothing up front.  The first time you ask about
+ * a key, it asks the inner generator for the key's parent's children
+ * (all of them, since you'll probably want the key's siblings next), and
+ * answers questions about them from memory after that; prefetch() loads
+ * a whole subtree at once.  If 'maxkeys' is nonzero, it forgets the
+ * least recently used sets of children to stay under that many keys.
+ * It also doesn't pump the inner generator's notifications on every
+ * get(), only when it might have missed some: after a change has gone
+ * through it, or once the main loop has run since the last time.
+ *
  * **WARNING**
  * The cache *will* go out of date if used with a uniconfclient/daemon without
  * running a select loop.
@@ -34,15 +45,55 @@ protected:
     void deltacallback(const UniConfKey &key, WvStringParm value);
 
 public:
-    UniCacheGen(IUniConfGen *_inner);
+    UniCacheGen(IUniConfGen *_inner, bool _lazy = false, size_t maxkeys = 0);
     virtual ~UniCacheGen();
 
     /***** Overridden members *****/
     virtual bool isok();
     virtual bool refresh();
     virtual void commit();
+    virtual void prefetch(const UniConfKey &key, bool recursive);
     virtual void set(const UniConfKey &key, WvStringParm value);
+    virtual void setv(const UniConfPairList &pairs);
+    virtual void flush_buffers();
     virtual WvString get(const UniConfKey &key);
+    virtual bool haschildren(const UniConfKey &key);
+    virtual Iter *iterator(const UniConfKey &key);
+
+private:
+    /** What lazy mode knows about one key. */
+    class LazyNode : public UniConfTree<LazyNode>
+    {
+    public:
+        WvString value;
+        bool known;     // 'value' is right (ie. our parent is loaded)
+        bool loaded;    // we have all of our children
+        LazyNode *prev, *next; // in the LRU list, while loaded
+
+        LazyNode(LazyNode *parent, const UniConfKey &key) :
+            UniConfTree<LazyNode>(parent, key),
+            known(false), loaded(false), prev(NULL), next(NULL)
+            { }
+    };
+
+    LazyNode *lazy;                 // NULL unless in lazy mode
+    LazyNode *lru_head, *lru_tail;  // most and least recently loaded/used
+    size_t lazy_max, lazy_count;
+    unsigned writes, pumped_writes; // writes we've passed to 'inner'
+    WvTime pumped_at;
+
+    void pump();
+    LazyNode *lazynode(const UniConfKey &key);
+    LazyNode *loadchildren(const UniConfKey &key);
+    void loadsubtree(const UniConfKey &key);
+    void use(LazyNode *node);
+    void unlist(LazyNode *node);
+    void discount(LazyNode *node);
+    void forget(LazyNode *node);
+    void unload(LazyNode *node);
+    void prune(LazyNode *node);
+    void trim(LazyNode *keep);
+    void lazydelta(const UniConfKey &key, WvStringParm value);
 };
 
 #endif // __UNICACHEGEN_H
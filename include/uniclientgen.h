@@ -14,6 +14,74 @@
 #include "uniclientconn.h"
 #include "uniconfkey.h"
 
+class UniClientGen;
+DeclareWvList(UniClientGen);
+
+/**
+ * A connection to a UniConfDaemon, shared by any number of UniClientGens.
+ *
+ * The protocol has no request ids, but the daemon answers requests in
+ * the order it gets them, so each reply goes to the generator at the head
+ * of the queue of requests still waiting for one.  SET, SETV and REMOVE
+ * don't get answers, so they don't wait in the queue; but a daemon that
+ * doesn't know a command answers it with FAIL, which would go to the
+ * wrong generator, so UniClientGen::setv() sends SETs instead of SETV.
+ * Notifications go to every generator whose key prefix contains the
+ * changed key.
+ *
+ * A UniClientMux deletes itself when the last generator using it goes
+ * away.
+ */
+class UniClientMux
+{
+    friend class UniClientGen;
+
+    struct Pending
+    {
+        UniClientGen *gen; // NULL if the generator has gone away
+    };
+    DeclareWvList(Pending);
+
+    UniClientConn *conn;
+    WvString id;
+    UniClientMux *next_shared;  /*!< next in the list of shared connections */
+    WvLog log;
+    int version;                /*!< version number of the protocol */
+    UniClientGenList gens;      /*!< generators using this connection */
+    PendingList pending;        /*!< requests waiting for replies */
+
+    ~UniClientMux();
+
+    void attach(UniClientGen *gen);
+    void detach(UniClientGen *gen);
+    void writecmd(UniClientGen *gen, UniClientConn::Command cmd,
+                  WvStringParm payload = WvString::null);
+    void conncallback();
+    void notify(const UniConfKey &key, WvStringParm value);
+
+public:
+    /**
+     * Creates a connection to a daemon over 'stream'.  If 'id' is given,
+     * find(id) will return this connection for as long as it's alive.
+     */
+    UniClientMux(IWvStream *stream, WvStringParm dst,
+                 WvStringParm id = WvString::null);
+
+    /**
+     * Returns the working connection registered under 'id' (for example,
+     * "unix:/tmp/uniconfsocket"), or NULL if there isn't one.
+     */
+    static UniClientMux *find(WvStringParm id);
+
+    bool isok() const
+        { return conn && conn->isok(); }
+
+    /** Returns the number of generators using this connection. */
+    int count() const
+        { return gens.count(); }
+};
+
+
 /**
  * Communicates with a UniConfDaemon to fetch and store keys and
  * values.
@@ -23,11 +91,19 @@
  * Alternately, use the moniker prefix "tcp:" followed by the
  * hostname, a colon, and the port of a machine that serves
  * UniConfDaemon requests over TCP.
- * 
+ *
+ * Generators created from these monikers share one connection per
+ * server.  The address may be followed by a key prefix, in which case
+ * the generator sees only that subtree of the daemon's tree, as if it
+ * were the root; eg. "unix:/tmp/uniconfsocket users/apenwarr".
  */
 class UniClientGen : public UniConfGen
 {
+    friend class UniClientMux;
+
+    UniClientMux *mux;
     UniClientConn *conn;
+    UniConfKey prefix;
 
     WvLog log;
 
@@ -41,8 +117,6 @@ class UniClientGen : public UniConfGen
 
     time_t timeout; // command timeout in ms
 
-    int version; /*!< version number of the protocol */
-
 public:
     /**
      * Creates a generator which can communicate with a daemon using
@@ -51,6 +125,13 @@ public:
      */
     UniClientGen(IWvStream *stream, WvStringParm dst = WvString::null);
 
+    /**
+     * Creates a generator for the subtree 'prefix' of the daemon's tree,
+     * using the existing connection 'mux'.
+     */
+    UniClientGen(UniClientMux *mux,
+                 const UniConfKey &prefix = UniConfKey::EMPTY);
+
     virtual ~UniClientGen();
 
     time_t set_timeout(time_t _timeout);
@@ -71,8 +152,10 @@ public:
 
 protected:
     virtual Iter *do_iterator(const UniConfKey &key, bool recursive);
-    void conncallback();
     bool do_select();
+
+    /** Returns 'key' as the daemon knows it, with our prefix on it. */
+    UniConfKey wirekey(const UniConfKey &key) const;
 };
 
 
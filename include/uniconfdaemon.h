@@ -12,12 +12,15 @@
 #include "uniconf.h"
 #include "wvaddr.h"
 
+class UniConfReadPool;
+
 class UniConfDaemon : public WvIStreamList
 {
     UniConf cfg;
     WvLog log, debug;
     bool authenticate;
     IUniConfGen *permgen;
+    UniConfReadPool *readpool;
 
 public:
     /**
@@ -30,6 +33,14 @@ public:
     virtual void close();
 
     void accept(WvStream *stream);
+
+    /**
+     * Answer get, subtree and haschildren requests using 'nthreads' worker
+     * threads reading from a snapshot of the tree (see UniConfReadPool),
+     * instead of in the main loop.  Call this once, before listen().
+     * Connections that need authentication still use the main loop.
+     */
+    void setthreads(int nthreads);
     
     /**
      * Start listening on a socket described by the given WvListener
@@ -37,6 +48,9 @@ public:
      */
     void listen(WvStringParm lmoniker);
 
+    /** Returns the number of clients connected right now. */
+    int connections();
+
 private:
     void listencallback(IWvStream *s);
 };
@@ -9,6 +9,7 @@
 
 #include "uniconf.h"
 #include "uniclientconn.h"
+#include "uniconfreadpool.h"
 #include "unipermgen.h"
 #include "wvlog.h"
 #include "wvhashtable.h"
@@ -21,11 +22,20 @@ class UniConfDaemon;
 /**
  * Retains all state and behavior related to a single UniConf daemon
  * connection.
+ *
+ * If given a UniConfReadPool, get, subtree and haschildren requests are
+ * handed off to it.  Anything else we send while any of those are still
+ * being answered waits its turn, so the client gets everything in order.
+ * Once more than MAX_OUTBUF bytes are waiting for a slow client, we stop
+ * taking replies from the pool until it catches up.
  */
 class UniConfDaemonConn : public UniClientConn 
 {
 public:
-    UniConfDaemonConn(WvStream *s, const UniConf &root);
+    enum { MAX_OUTBUF = 65536 }; // bytes the socket may buffer for a reply
+
+    UniConfDaemonConn(WvStream *s, const UniConf &root,
+                      UniConfReadPool *_pool = NULL);
     virtual ~UniConfDaemonConn();
 
     virtual void close();
@@ -34,6 +44,22 @@ public:
 
 protected:
     UniConf root;
+    UniConfReadPool *pool;
+
+    struct Pending
+    {
+        UniConfReadPool::Reply *reply; // or NULL if it's just 'buf'
+        WvDynBuf buf;
+    };
+    DeclareWvList(Pending);
+    PendingList pending;
+    bool quit_when_flushed;
+
+    virtual size_t uwrite(const void *buf, size_t len);
+    void submit(UniClientConn::Command cmd, const UniConfKey &key,
+                bool recursive = false);
+    bool send(WvBuf &buf);
+    void flush_pending();
 
     virtual void do_invalid(WvStringParm c);
     virtual void do_malformed(UniClientConn::Command);
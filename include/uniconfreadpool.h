@@ -0,0 +1,132 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * A pool of threads that answer read-only UniConf daemon requests.
+ */
+#ifndef __UNICONFREADPOOL_H
+#define __UNICONFREADPOOL_H
+
+#include "uniconf.h"
+#include "uniclientconn.h"
+#include "unisnapshotgen.h"
+#include "wvbuf.h"
+#include "wvloopback.h"
+#include <pthread.h>
+
+/**
+ * Answers get, subtree and haschildren requests for a UniConfDaemon from
+ * a published UniSnapshotGen snapshot, using a pool of worker threads,
+ * so that one client's huge subtree doesn't hold up everyone else.
+ * Everything that changes the tree still happens in the main loop.
+ *
+ * Each request is answered from a snapshot no matter what happens to the
+ * tree afterwards.  Building a snapshot means copying the whole tree, so
+ * a request made after the tree has changed waits for the next one,
+ * which is published at most once every PUBLISH_MSEC for everybody
+ * waiting by then.  Call writing() before changing the tree, so that
+ * nothing already submitted sees the change; then each request sees
+ * exactly the changes that came before it.  While stale(), it's cheaper
+ * to answer a get or haschildren from the tree yourself.
+ *
+ * The worker formats the reply into chunks as it goes.  Whenever there's
+ * more of it, the pool's stream() wakes up the main loop, which calls the
+ * callback given to submit(); that should take() whatever is there and
+ * send it.  A worker never gets more than MAX_BUFFERED bytes ahead of
+ * take(), so a big subtree is streamed out instead of being built up in
+ * memory all at once.
+ *
+ * Except for the workers themselves, everything here belongs to the main
+ * loop's thread.
+ */
+class UniConfReadPool
+{
+public:
+    struct Reply;
+    typedef wv::function<void()> ReadyCallback;
+
+    enum {
+        CHUNK_SIZE = 16384,   // bytes formatted before waking the main loop
+        MAX_BUFFERED = 262144, // bytes a worker may get ahead of take()
+        PUBLISH_MSEC = 50     // least time between two snapshots
+    };
+
+    UniConfReadPool(const UniConf &cfg, int nthreads);
+    ~UniConfReadPool();
+
+    /**
+     * The stream that wakes up the main loop when there's more of a reply
+     * to send.  Add it to your WvIStreamList; the pool still owns it.
+     */
+    WvStream *stream()
+        { return wakeup; }
+
+    /**
+     * Queues a REQ_GET, REQ_SUBTREE or REQ_HASCHILDREN request.
+     * 'ready' is called from stream()'s callback whenever there's more of
+     * the reply to take().
+     */
+    Reply *submit(UniClientConn::Command cmd, const UniConfKey &key,
+                  bool recursive, const ReadyCallback &ready);
+
+    /**
+     * Moves as much of the reply as is ready into 'out'.  Returns true,
+     * and frees the reply, once all of it has been taken.
+     */
+    bool take(Reply *r, WvBuf &out);
+
+    /**
+     * Lets go of a reply you don't want the rest of.  The worker stops
+     * working on it as soon as it notices.
+     */
+    void cancel(Reply *r);
+
+    /**
+     * Publishes a snapshot for the requests still waiting for one, if
+     * any.  Call it before changing the tree.
+     */
+    void writing();
+
+    /**
+     * Returns true if the tree has changed since the last snapshot, so
+     * that a request submitted now would have to wait for the next one.
+     */
+    bool stale() const
+        { return held || snapgen->stale(); }
+
+    /** Returns the number of requests answered so far. */
+    unsigned long answered() const
+        { return nanswered; }
+
+    /** Returns the number of snapshots published so far. */
+    unsigned long published() const
+        { return npublished; }
+
+private:
+    UniSnapshotGen *snapgen;
+    WvLoopback *wakeup;
+
+    int nthreads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work;      // there's something in 'jobs', or quitting
+    pthread_cond_t drained;   // take() or cancel() made room in a reply
+    bool quitting;
+    Reply *jobs, **jobs_tail; // waiting for a worker
+    Reply *ready, **ready_tail; // waiting for the main loop
+    Reply *held, **held_tail; // waiting for a snapshot; main loop only
+    WvTime last_publish;
+    unsigned long nanswered, npublished;
+
+    static void *worker(void *_pool);
+    void answer(Reply *r);
+    bool emit(Reply *r, WvDynBuf &chunk, bool finished);
+    void push_ready(Reply *r);
+    void queue(Reply *r);
+    void publish();
+    void schedule();
+    void wakeup_cb();
+    void destroy(Reply *r);
+};
+
+#endif // __UNICONFREADPOOL_H
@@ -126,6 +126,14 @@ public:
      */
     void del_setbool(const UniConfKey &key, bool *flag, bool recurse = true);
 
+    /**
+     * Turns on (or off) caching of lookups at the root, in front of all
+     * the mounted generators.  See UniMountGen::setcache() for when this
+     * is safe.
+     */
+    void setcache(bool enable = true, size_t maxkeys = 10000)
+        { mounts.setcache(enable, maxkeys); }
+
 private:
     /**
      * Checks a branch of the watch tree for notification candidates.
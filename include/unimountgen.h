@@ -8,6 +8,7 @@
 #define __UNIMOUNTGEN_H
 
 #include "uniconfgen.h"
+#include "uniconftree.h"
 #include "wvmoniker.h"
 #include "wvstringlist.h"
 #include "wvtr1.h"
@@ -92,6 +93,25 @@ public:
 
     /** Determines if a key is a mountpoint. */
     virtual bool ismountpoint(const UniConfKey &key);
+
+    /**
+     * Turns the lookup cache on or off.
+     *
+     * While it's on, the results of get(), exists() and haschildren() are
+     * remembered, so asking again doesn't go through the whole stack of
+     * generators mounted there.  A key is forgotten (along with what we
+     * know about its parents and children) as soon as any mounted
+     * generator sends a notification for it, or it's set() through us.
+     * Mounting, unmounting and refresh() forget everything, and so does
+     * remembering more than "maxkeys" keys.
+     *
+     * This is only safe if every mounted generator sends notifications for
+     * all of its changes as they happen, which is why it's off by default.
+     * Generators that only notice changes when you call get() (like the
+     * filesystem generator, or a remote one that's not being pumped by a
+     * main loop) will look stale.
+     */
+    void setcache(bool enable, size_t maxkeys = 10000);
     
     /***** Overridden members *****/
     
@@ -102,11 +122,43 @@ public:
     virtual void setv(const UniConfPairList &pairs);
     virtual void commit();
     virtual bool refresh();
+    virtual void prefetch(const UniConfKey &key, bool recursive);
     virtual void flush_buffers() { }
     virtual Iter *iterator(const UniConfKey &key);
     virtual Iter *recursiveiterator(const UniConfKey &key);
 
 private:
+    /** What the lookup cache knows about one key. */
+    class CacheNode : public UniConfTree<CacheNode>
+    {
+    public:
+        WvString value;
+        bool value_known;
+        signed char exists, children; // -1 if unknown
+        size_t size; // this node and everything under it
+
+        CacheNode(CacheNode *parent, const UniConfKey &key) :
+            UniConfTree<CacheNode>(parent, key),
+            value_known(false), exists(-1), children(-1), size(1)
+            { }
+
+        void forget()
+            { value_known = false; exists = children = -1; }
+    };
+
+    CacheNode *cache;
+    size_t cache_max, cache_count;
+    unsigned cache_generation; // bumped whenever anything is forgotten
+
+    bool cacheable(const UniConfKey &key) const;
+    CacheNode *cachenode(const UniConfKey &key);
+    void invalidate(const UniConfKey &key);
+    void flushcache();
+
+    WvString _get(const UniConfKey &key);
+    bool _exists(const UniConfKey &key);
+    bool _haschildren(const UniConfKey &key);
+
     /** Find the active generator for a given key. */
     UniGenMount *findmount(const UniConfKey &key);
     /** Find a unique active generator a given key, will return NULL if
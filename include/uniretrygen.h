@@ -12,6 +12,9 @@
 #include "wvtimeutils.h"
 #include "wvlog.h"
 
+class UniTempGen;
+class WvStream;
+
 /**
  * A UniConfGen that reconnects to an inner generator specified by
  * a moniker whenever the inner generator is no longer OK.  It will
@@ -37,6 +40,18 @@
  * UniRetryGen can be used in combination with UniReplicateGen to create
  * a connection to a UniConf daemon that is robust against network
  * failures through a moniker such as replicate:{retry:tcp:192.168.0.1 tmp:}
+ *
+ * If 'serve_stale' is true (or the moniker ends with "stale", as in
+ * retry:{tcp:192.168.0.1 5000 stale}), it keeps a copy of everything in
+ * the inner generator, and answers from that while it's disconnected
+ * instead of saying nothing exists.  It also never reconnects while
+ * you're waiting for an answer: the main loop does it in the background,
+ * first after about the retry timeout, then backing off exponentially (up
+ * to a minute, or the retry timeout if that's longer), with some
+ * randomness so that all the clients of a restarted daemon don't come
+ * back at the same moment.  After reconnecting, it reads the whole tree
+ * again, a little at a time from the main loop, but only changes (and
+ * notifies about) the keys that are different.
  */
 class UniRetryGen : public UniFilterGen
 {
@@ -54,15 +69,27 @@ private:
 
     time_t retry_interval_ms;
     WvTime next_reconnect_attempt;
+
+    UniTempGen *snapshot;   // what the inner generator had, if serve_stale
+    WvStream *retrystream;  // wakes up the main loop to reconnect
+    UniConfKeyList todo;    // sections we still have to resync
+    time_t backoff_ms;
+    unsigned short jitter_state[3]; // for nrand48()
+    bool resyncing;
     
     void maybe_disconnect();
     void maybe_reconnect();
+    void schedule_retry();
+    void retry();
+    void resync();
+    void snapshotcallback(const UniConfKey &key, WvStringParm value);
 
 public:
 
     UniRetryGen(WvStringParm _moniker,
             ReconnectCallback _reconect_callback = ReconnectCallback(),
-            time_t _retry_internal_ms = 5000);
+            time_t _retry_internal_ms = 5000, bool serve_stale = false);
+    virtual ~UniRetryGen();
 
     /***** Overridden methods *****/
 
@@ -77,6 +104,9 @@ public:
     virtual bool isok();
     virtual Iter *iterator(const UniConfKey &key);
     virtual Iter *recursiveiterator(const UniConfKey &key);
+
+protected:
+    virtual void gencallback(const UniConfKey &key, WvStringParm value);
 };
 
 #endif //__UNIRETRYGEN_H
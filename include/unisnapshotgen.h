@@ -0,0 +1,193 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * A UniConf generator that publishes read-only snapshots of its inner
+ * generator for use by other threads.
+ */
+#ifndef __UNISNAPSHOTGEN_H
+#define __UNISNAPSHOTGEN_H
+
+#include "unifiltergen.h"
+#include <pthread.h>
+
+/**
+ * An immutable, flattened copy of a UniConf tree.
+ *
+ * Nothing in here touches a WvString or a UniConfKey after construction,
+ * since their reference counts aren't thread safe, so any number of
+ * threads can read the same snapshot at once.  Keys are passed as plain
+ * strings and are interpreted the way UniConfKey would: case
+ * insensitive, with leading, trailing and doubled slashes ignored.
+ *
+ * The entries are stored sorted in depth-first order, so every subtree
+ * is a contiguous range and lookups are a binary search.
+ *
+ * You don't create these yourself; get one from UniSnapshotGen::Reader.
+ */
+class UniConfSnapshot
+{
+    friend class UniSnapshotGen;
+
+public:
+    struct Entry
+    {
+        const char *key;   // full key, in canonical form
+        const char *name;  // last segment of key
+        const char *value; // never NULL
+        unsigned end;      // index just past the last of our descendants
+    };
+
+private:
+    Entry *entries;
+    unsigned nentries;
+    char *strings;
+
+    UniConfSnapshot(IUniConfGen *gen);
+
+    int find(const char *key) const;
+
+public:
+    ~UniConfSnapshot();
+
+    /** Returns the number of keys in the snapshot, including the root. */
+    unsigned count() const
+        { return nentries; }
+
+    /** Returns the value of 'key', or NULL if it doesn't exist. */
+    const char *get(const char *key) const;
+
+    bool exists(const char *key) const
+        { return get(key) != NULL; }
+
+    bool haschildren(const char *key) const;
+
+    /**
+     * Iterates over the children of a key, or over all its descendants
+     * if 'recursive' is true, in depth-first order.
+     */
+    class Iter
+    {
+        const UniConfSnapshot &snap;
+        int top;
+        unsigned cur;
+        bool recursive;
+
+    public:
+        Iter(const UniConfSnapshot &_snap, const char *key,
+             bool _recursive = false);
+
+        void rewind();
+        bool next();
+
+        /** The full key of the current entry. */
+        const char *key() const
+            { return snap.entries[cur].key; }
+
+        /** The last segment of key(). */
+        const char *name() const
+            { return snap.entries[cur].name; }
+
+        const char *value() const
+            { return snap.entries[cur].value; }
+    };
+};
+
+
+/**
+ * A filter generator that publishes an immutable UniConfSnapshot of its
+ * inner generator, which worker threads can read without any locking.
+ *
+ * The generator itself, like any other, must only be used from the thread
+ * that owns it.  Changes made through it, or notified by the inner
+ * generator, mark the snapshot as stale; a new one is built and
+ * published, replacing the old one, on the next commit() or refresh(),
+ * or whenever you call publish() yourself.
+ *
+ * Old snapshots are freed using epoch-based reclamation: each reading
+ * thread has a Reader, which announces the current epoch when it
+ * acquire()s a snapshot and clears it on release().  A replaced snapshot
+ * is deleted (on the owning thread) once no Reader could still be
+ * looking at it.  Don't hold onto a snapshot for long, or nothing can be
+ * reclaimed.
+ *
+ * For example, in each worker thread:
+ *
+ *   UniSnapshotGen::Reader reader(*gen);
+ *   ...
+ *   const UniConfSnapshot *snap = reader.acquire();
+ *   const char *port = snap->get("server/port");
+ *   ...
+ *   reader.release(); // 'port' is now invalid
+ */
+class UniSnapshotGen : public UniFilterGen
+{
+public:
+    class Reader
+    {
+        friend class UniSnapshotGen;
+
+        UniSnapshotGen &gen;
+        Reader *next;
+        volatile unsigned long active; // announced epoch, or 0 if idle
+        const UniConfSnapshot *snap;
+
+    public:
+        /**
+         * Registers a reader.  May be called from any thread, as long as
+         * the generator outlives the Reader.
+         */
+        Reader(UniSnapshotGen &_gen);
+        ~Reader();
+
+        /**
+         * Returns the latest published snapshot, which stays valid until
+         * release().  Calling acquire() again before release() returns
+         * the same snapshot.
+         */
+        const UniConfSnapshot *acquire();
+
+        /** Lets go of the snapshot returned by acquire(). */
+        void release();
+    };
+
+    UniSnapshotGen(IUniConfGen *inner);
+    virtual ~UniSnapshotGen();
+
+    /**
+     * Builds and publishes a new snapshot if anything has changed since
+     * the last one, and frees old snapshots that no Reader is using.
+     */
+    void publish();
+
+    /** Returns true if the tree has changed since the last publish(). */
+    bool stale() const
+        { return dirty; }
+
+    /***** Overridden members *****/
+    virtual void commit();
+    virtual bool refresh();
+
+protected:
+    virtual void gencallback(const UniConfKey &key, WvStringParm value);
+
+private:
+    struct Retired
+    {
+        UniConfSnapshot *snap;
+        unsigned long epoch; // freeable once all readers are past this
+    };
+    DeclareWvList(Retired);
+
+    UniConfSnapshot *volatile current;
+    volatile unsigned long epoch;
+    bool dirty;
+    RetiredList retired;
+
+    pthread_mutex_t readers_lock;
+    Reader *readers;
+
+    void reclaim();
+};
+
+#endif // __UNISNAPSHOTGEN_H
@@ -8,6 +8,7 @@
 #define __WVBACKSLASH_H
 
 #include "wvencoder.h"
+#include "wvstringmask.h"
 
 /**
  * An encoder that performs C-style backslash escaping of strings.
@@ -22,6 +23,7 @@
 class WvBackslashEncoder : public WvEncoder
 {
     WvString nasties;
+    WvStringMask dirty; // everything that needs a backslash
 
 public:
     /**
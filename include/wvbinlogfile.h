@@ -0,0 +1,128 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A "Log Receiver" that logs messages to memory-mapped files in a compact
+ * binary format, instead of formatting them as text.
+ */
+#ifndef __WVBINLOGFILE_H
+#define __WVBINLOGFILE_H
+
+#include "wvlogrcv.h"
+#include "wvtimeutils.h"
+#include <stdint.h>
+
+#define WVBINLOG_MAGIC   "WvBinLog" // exactly 8 bytes, no nul
+#define WVBINLOG_VERSION 1
+
+/** The start of every binary log file. */
+struct WvBinLogHeader
+{
+    char magic[8];     // WVBINLOG_MAGIC
+    uint32_t version;  // WVBINLOG_VERSION
+    uint32_t size;     // of this header; the first record follows it
+};
+
+/**
+ * One entry in a binary log file.  'len' bytes of text follow it: the
+ * message for a Message record, or the name of the source for a Source
+ * record.  Each record is padded out to a multiple of 4 bytes.
+ *
+ * Every Message refers to a Source record earlier in the same file, so
+ * each file can be decoded on its own.  A record's 'size' is written
+ * last, so a zero there marks the end of the log even if the program
+ * died halfway through writing the record.
+ *
+ * Numbers are in the byte order of the machine that wrote them.
+ */
+struct WvBinLogRecord
+{
+    enum Type { Source = 1, Message = 2 };
+
+    uint32_t size;     // of the whole record, padding included
+    uint16_t source;   // which Source record (or which one this is)
+    uint8_t type;      // a Type
+    uint8_t level;     // a WvLog::LogLevel
+    uint32_t sec, usec; // when it was logged
+    uint32_t len;      // of the text
+};
+
+
+/**
+ * Logs every message to a series of files named <filename>.000000,
+ * <filename>.000001, and so on, each of which is created at 'filesize'
+ * bytes and mmap()ed, so logging a message is just copying it there.
+ * Once one fills up, it's trimmed to the size actually used and logging
+ * moves on to the next; only the newest 'keep' files are kept around
+ * (0 keeps them all).  If the next file can't be created, the messages
+ * are dropped and it tries again a second later.
+ *
+ * Nothing gets formatted on the way in: timestamps stay binary and the
+ * source names are only written once per file.  Use decode(), or the
+ * wvlogdecode program, to turn the files back into the usual text.
+ */
+class WvBinLogFile : public WvLogRcv
+{
+public:
+    WvBinLogFile(WvStringParm _filename,
+		 WvLog::LogLevel _max_level = WvLog::NUM_LOGLEVELS,
+		 size_t _filesize = 16*1024*1024, int _keep = 8);
+    virtual ~WvBinLogFile();
+
+    virtual void log(WvStringParm source, int loglevel,
+		     const char *_buf, size_t len);
+
+    /**
+     * False if we couldn't create or map a file to log to; current_file()
+     * is then the last one that worked.
+     */
+    bool isok() const
+        { return map != NULL; }
+
+    /** The name of the file we're logging to now. */
+    WvString current_file() const
+        { return filename_for(num); }
+
+    /**
+     * Feeds every message in the binary log file 'filename' to 'rcv', with
+     * the time it was originally logged.  Returns false if the file isn't
+     * a binary log or is damaged; whatever could be read before the
+     * damage has been passed to 'rcv' anyway.
+     */
+    static bool decode(WvStringParm filename, WvLogRcv &rcv);
+
+protected:
+    virtual void _mid_line(const char *str, size_t len)
+        { } // log() does all the work
+
+private:
+    struct SourceId
+    {
+	WvString name;
+	unsigned id;
+	SourceId(WvStringParm _name, unsigned _id) : name(_name), id(_id)
+	    { }
+    };
+    DeclareWvScatterDict(SourceId, WvString, name);
+
+    WvString filename;
+    size_t filesize;
+    int keep, num, fd;
+    char *map;
+    size_t used;
+    bool finishing;        // in finish_file(): don't log to ourselves
+    WvTime retry_at;       // wvmonotime() to try again after failing
+
+    SourceIdDict sources;  // the ones with a record in the current file
+    WvString lookup_name;  // the source we looked up last time...
+    unsigned lookup_id;    // ...and its id
+
+    WvString filename_for(int n) const;
+    void next_file();
+    void finish_file();
+    void add(WvBinLogRecord::Type type, unsigned source, int level,
+	     const WvTime &when, const char *str, size_t len);
+    unsigned source_id(WvStringParm source, const WvTime &when);
+};
+
+#endif // __WVBINLOGFILE_H
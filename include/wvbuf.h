@@ -134,13 +134,45 @@ public:
     size_t notmatch(const char *chlist)
         { return notmatch(chlist, strlen(chlist)); }
 
+    /*** Small gets and puts that usually don't need the store ***/
+
+    /*
+     * These work through the cursors in WvBufBaseCommonImpl, so they're
+     * just a pointer increment (or a memcpy()) until they reach the end of
+     * what the store handed us last time.
+     */
+    const unsigned char *get(size_t count)
+    {
+        if (count <= size_t(rend - rcur))
+        {
+            const unsigned char *data = rcur;
+            rcur += count;
+            return data;
+        }
+        return slowget(count);
+    }
+    unsigned char get()
+        { return *get(1); }
+
     /*** Overload put() and move() to accept void pointers ***/
     
     void put(unsigned char value)
-        { WvBufBaseCommonImpl<unsigned char>::put(value); }
+    {
+        if (wcur != wend)
+            *wcur++ = value;
+        else
+            slowput(&value, 1);
+    }
     void put(const void *data, size_t count)
-        { WvBufBaseCommonImpl<unsigned char>::put(
-            (const unsigned char*)data, count); }
+    {
+        if (count && count <= size_t(wend - wcur))
+        {
+            memcpy(wcur, data, count);
+            wcur += count;
+        }
+        else
+            slowput(data, count);
+    }
     void move(void *data, size_t count)
         { WvBufBaseCommonImpl<unsigned char>::move(
             (unsigned char*)data, count); }
@@ -151,6 +183,10 @@ public:
 private:
     // moved here to avoid ambiguities between the match variants
     size_t _match(const void *bytelist, size_t numbytes, bool reverse);
+
+    // for when the cursors have run out
+    const unsigned char *slowget(size_t count);
+    void slowput(const void *data, size_t count);
 };
 
 
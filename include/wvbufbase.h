@@ -40,10 +40,40 @@ protected:
     typedef WvBufBase<T> Buffer;
 
     WvBufStore *store;
-    
+
+    /*
+     * Cursors for the inline fast paths in WvBuf (getch(), putch(), and
+     * small get()s and put()s), so they don't have to call into the store
+     * for every byte.  At most one of them is open at a time.
+     *
+     * The bytes from rcur to rend were gotten from the store but nobody
+     * has read them yet, and the space from wcur to wend was alloc()ed
+     * from it but hasn't been written.  sync() gives both back, and
+     * everything else calls it before touching the store.
+     */
+    mutable const unsigned char *rcur, *rend;
+    mutable unsigned char *wcur, *wend;
+
+    /** Gives the store back whatever the cursors have been holding. */
+    void sync() const
+    {
+        if (rcur != rend)
+            store->unget(rend - rcur);
+        if (wcur != wend)
+            store->unalloc(wend - wcur);
+        dropcursors();
+    }
+
+    /** Forgets the cursors, for when the store is about to be emptied. */
+    void dropcursors() const
+    {
+        rcur = rend = NULL;
+        wcur = wend = NULL;
+    }
+
     // discourage copying
     explicit WvBufBaseCommonImpl(
-        const WvBufBaseCommonImpl &other) { }
+        const WvBufBaseCommonImpl &other) { dropcursors(); }
 
 protected:
     /**
@@ -55,7 +85,7 @@ protected:
      * "store" is the low-level storage object
      */
     explicit WvBufBaseCommonImpl(WvBufStore *store) :
-        store(store) { }
+        store(store) { dropcursors(); }
 
 public:
     /** Destroys the buffer. */
@@ -63,11 +93,15 @@ public:
 
     /**
      * Returns a pointer to the underlying storage class object.
+     * 
+     * Don't use the buffer itself again until you're done with the store
+     * (or with a WvBufCursor or WvBufView made from it).
      *
      * Returns: the low-level storage class object pointer, non-null
      */
     WvBufStore *getstore()
     {
+        sync();
         return store;
     }
 
@@ -91,7 +125,8 @@ public:
      */
     size_t used() const
     {
-        return store->used() / sizeof(Elem);
+        return (store->used() + (rend - rcur) - (wend - wcur))
+            / sizeof(Elem);
     }
 
     /**
@@ -116,6 +151,7 @@ public:
 	if (count > used())
 	    return NULL;
 
+        sync();
         return static_cast<const T*>(
             store->get(count * sizeof(Elem)));
     }
@@ -135,7 +171,14 @@ public:
      */
     void skip(size_t count)
     {
-        store->skip(count * sizeof(Elem));
+        count *= sizeof(Elem);
+        if (count <= size_t(rend - rcur))
+        {
+            rcur += count;
+            return;
+        }
+        sync();
+        store->skip(count);
     }
 
     /**
@@ -153,6 +196,9 @@ public:
      */
     size_t optgettable() const
     {
+        if (rcur != rend)
+            return (rend - rcur) / sizeof(Elem);
+        sync();
         size_t avail = store->optgettable();
         size_t elems = avail / sizeof(Elem);
         if (elems != 0) return elems;
@@ -176,6 +222,7 @@ public:
      */
     void unget(size_t count)
     {
+        sync();
         store->unget(count * sizeof(Elem));
     }
 
@@ -187,6 +234,7 @@ public:
      */
     size_t ungettable() const
     {
+        sync();
         return store->ungettable() / sizeof(Elem);
     }
 
@@ -224,17 +272,20 @@ public:
      */
     const T *peek(int offset, size_t count)
     {
+        sync();
         return static_cast<const T*>(store->peek(
             offset * sizeof(Elem), count * sizeof(Elem)));
     }
 
     size_t peekable(int offset)
     {
+        sync();
         return store->peekable(offset * sizeof(Elem)) / sizeof(Elem);
     }
 
     size_t optpeekable(int offset)
     {
+        sync();
         offset *= sizeof(Elem);
         size_t avail = store->optpeekable(offset);
         size_t elems = avail / sizeof(Elem);
@@ -256,6 +307,7 @@ public:
      */
     void zap()
     {
+        dropcursors();
         store->zap();
     }
 
@@ -308,6 +360,7 @@ public:
      */
     void move(T *buf, size_t count)
     {
+        sync();
         store->move(buf, count * sizeof(Elem));
     }
     
@@ -329,6 +382,7 @@ public:
      */
     void copy(T *buf, int offset, size_t count)
     {
+        sync();
         store->copy(buf, offset * sizeof(Elem), count * sizeof(Elem));
     }
     
@@ -352,7 +406,7 @@ public:
      */
     size_t free() const
     {
-        return store->free() / sizeof(Elem);
+        return (store->free() + (wend - wcur)) / sizeof(Elem);
     }
     
     /**
@@ -378,6 +432,7 @@ public:
      */
     T *alloc(size_t count)
     {
+        sync();
         return static_cast<T*>(store->alloc(count * sizeof(Elem)));
     }
     
@@ -396,6 +451,9 @@ public:
      */
     size_t optallocable() const
     {
+        if (wcur != wend)
+            return (wend - wcur) / sizeof(Elem);
+        sync();
         size_t avail = store->optallocable();
         size_t elems = avail / sizeof(Elem);
         if (elems != 0) return elems;
@@ -420,6 +478,7 @@ public:
      */
     void unalloc(size_t count)
     {
+        sync();
         return store->unalloc(count * sizeof(Elem));
     }
 
@@ -442,6 +501,7 @@ public:
      */
     size_t unallocable() const
     {
+        sync();
         return store->unallocable() / sizeof(Elem);
     }
     
@@ -460,6 +520,7 @@ public:
      */
     T *mutablepeek(int offset, size_t count)
     {
+        sync();
         return static_cast<T*>(store->mutablepeek(
             offset * sizeof(Elem), count * sizeof(Elem)));
     }
@@ -482,6 +543,7 @@ public:
      */
     void put(const T *data, size_t count)
     {
+        sync();
         store->put(data, count * sizeof(Elem));
     }
 
@@ -503,6 +565,7 @@ public:
      */
     void poke(const T *data, int offset, size_t count)
     {
+        sync();
         store->poke(data, offset * sizeof(Elem), count * sizeof(Elem));
     }
 
@@ -518,6 +581,7 @@ public:
      */
     void put(T &value)
     {
+        sync();
         store->fastput(& value, sizeof(Elem));
     }
 
@@ -557,6 +621,8 @@ public:
      */
     void merge(Buffer &inbuf, size_t count)
     {
+        sync();
+        inbuf.sync();
         store->merge(*inbuf.store, count * sizeof(Elem));
     }
 
@@ -651,6 +717,7 @@ public:
      */
     T *ptr() const
     {
+        this->sync();
         return static_cast<T*>(mystore.ptr());
     }
 
@@ -698,6 +765,7 @@ public:
     void reset(T *_data, size_t _avail, size_t _size,
         bool _autofree = false)
     {
+        this->dropcursors();
         mystore.reset(_data, _avail * sizeof(Elem),
             _size * sizeof(Elem), _autofree);
     }
@@ -710,6 +778,7 @@ public:
      */
     void setavail(size_t _avail)
     {
+        this->sync();
         mystore.setavail(_avail * sizeof(Elem));
     }
 };
@@ -762,6 +831,7 @@ public:
      */
     const T *ptr() const
     {
+        this->sync();
         return static_cast<const T*>(mystore.ptr());
     }
 
@@ -776,6 +846,7 @@ public:
      */
     void reset(const T *_data, size_t _avail)
     {
+        this->dropcursors();
         mystore.reset(_data, _avail * sizeof(Elem));
     }
 
@@ -787,6 +858,7 @@ public:
      */
     void setavail(size_t _avail)
     {
+        this->sync();
         mystore.setavail(_avail * sizeof(Elem));
     }
 };
@@ -862,6 +934,7 @@ public:
      */
     T *ptr() const
     {
+        this->sync();
         return static_cast<T*>(mystore.ptr());
     }
 
@@ -910,6 +983,7 @@ public:
     void reset(T *_data, size_t _avail, size_t _size,
         bool _autofree = false)
     {
+        this->dropcursors();
         mystore.reset(_data, _avail * sizeof(Elem),
             _size * sizeof(Elem), _autofree);
     }
@@ -923,6 +997,7 @@ public:
      */
     void setavail(size_t _avail)
     {
+        this->sync();
         mystore.setavail(_avail * sizeof(Elem));
     }
 
@@ -937,6 +1012,7 @@ public:
      */
     void normalize()
     {
+        this->sync();
         mystore.normalize();
     }
 };
@@ -1063,6 +1139,10 @@ public:
     template<typename S>
     WvBufViewBase(WvBufBase<S> &_buf) :
         WvBufBase<T>(_buf.getstore()) { }
+
+    /** Hands back anything we've read or written but not yet synced. */
+    virtual ~WvBufViewBase()
+        { this->sync(); }
 };
 
 #endif // __WVBUFFERBASE_H
@@ -0,0 +1,36 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * CRC32 and CRC32C, using the CPU's instructions for them when it has
+ * some.
+ */
+#ifndef __WVCRC_H
+#define __WVCRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Updates 'crc' (which should start at 0) with the CRC32 of 'len' bytes
+ * at 'buf'.  This is the same CRC32 as zlib's crc32() (and Ethernet's,
+ * and gzip's), and gives the same answers, but uses carry-less multiply
+ * (PCLMULQDQ) on x86, or the CRC32 instructions on ARMv8, if the CPU
+ * it's running on has them.
+ */
+uint32_t wvcrc32(uint32_t crc, const void *buf, size_t len);
+
+/**
+ * Like wvcrc32(), but for CRC32C (the Castagnoli polynomial, as used by
+ * iSCSI, SCTP, ext4 and btrfs), which SSE 4.2 and ARMv8 have
+ * instructions for.
+ */
+uint32_t wvcrc32c(uint32_t crc, const void *buf, size_t len);
+
+/**
+ * Returns a description of how wvcrc32() and wvcrc32c() are doing it on
+ * this CPU, like "pclmul, sse4.2" or "table, table".
+ */
+const char *wvcrc_impl();
+
+#endif // __WVCRC_H
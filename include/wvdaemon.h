@@ -12,6 +12,7 @@
 #include "wvstring.h"
 #include "wvargs.h"
 #include "wvlog.h"
+#include "wvtimeutils.h"
 
 class WvDaemon;
 
@@ -34,6 +35,8 @@ command line options:
 -s|--syslog: write log entries to the syslog() facility
 --no-syslog: do not write log entries to the syslog() facility
 -V|--version: print the program name and version number and exit immediately
+--handoff-restart: on SIGHUP, start a new copy of the program and hand it the
+  listening sockets, instead of restarting in the same process (see below)
 
 These default arguments can be changed or appended to through the public member
 WvDaemon::args of type WvArgs.
@@ -56,6 +59,18 @@ WvDaemon::stop_callback: Called when the daemon is exiting or right before
 restarting due to SIGHUP
 WvDaemon::unload_callback: Called right before the daemon exits
 
+When WvDaemon::handoff_restart is set, restarting instead runs a new copy of
+the program, with the same arguments, and passes it the daemon's open
+WvTCPListener and WvUnixListener sockets; a listener the new copy creates
+for the same address takes over the old socket instead of binding its own,
+so no connection gets refused in between.  The old copy keeps going as usual
+until the new one has started; then it stops listening, and keeps running
+until is_drained() says its remaining connections are gone, or
+drain_timeout runs out, and exits.  If the new copy doesn't start within
+handoff_timeout, the daemon restarts the usual way.
+WvDaemon::handoff_callback is called just before the new copy is started,
+for saving anything it should load.
+
 Sample usage:
 
 @code
@@ -106,6 +121,12 @@ class WvDaemon
         WvLog log;
         WvLog::LogLevel log_level;
         bool syslog;
+        //! Whether to restart by handing off to a new process; defaults
+        //! to false, or true with --handoff-restart
+        bool handoff_restart;
+        //! How long (in milliseconds) a new process gets to start up,
+        //! and how long the old one keeps serving the connections it had
+        time_t handoff_timeout, drain_timeout;
     
     public:
 
@@ -115,6 +136,7 @@ class WvDaemon
         WvDaemonCallback run_callback;
         WvDaemonCallback stop_callback;
         WvDaemonCallback unload_callback;
+        WvDaemonCallback handoff_callback;
         
     protected:
 
@@ -124,11 +146,33 @@ class WvDaemon
         virtual void do_stop();
         virtual void do_unload();
 
+        /**
+         * Whether a daemon that's draining after a handoff has nothing
+         * left to do.  The default never is, so the old process stays for
+         * all of drain_timeout.
+         */
+        virtual bool is_drained()
+            { return false; }
+
     private:
         volatile bool _want_to_die;
         volatile bool _want_to_restart;
 	volatile int _exit_status;
 
+        char **_argv;
+        const char *_argv0;
+        int handoff_fd;       // to the process we're taking over from
+        int handoff_pid;      // ...and its pid
+        int successor_fd;     // to the process taking over from us
+        int successor_pid;    // ...and its pid
+        bool _draining, _handed_off;
+        WvTime drain_deadline;
+
+        bool start_handoff();
+        int successor_ready();
+        void receive_handoff();
+        void finish_handoff();
+
     	void init(WvStringParm _name,
 		  WvStringParm _version,
 		  WvDaemonCallback _start_callback,
@@ -207,6 +251,19 @@ class WvDaemon
             return !_want_to_die && !_want_to_restart;
         }
 
+        //! Whether a new process is taking over our listeners, and we're
+        //! only finishing up with the connections we already had
+        bool draining() const
+        {
+            return _draining;
+        }
+
+        //! Once draining, stop listening when the new process is up, and
+        //! exit if is_drained() or drain_timeout is up.  A run_callback
+        //! that doesn't return while should_run() should call this at
+        //! least every 100ms or so.
+        void check_drained();
+
         //! Remaining args
         const WvStringList &extra_args() const
         {
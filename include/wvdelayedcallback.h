@@ -18,62 +18,96 @@
  *   2. All parameter types must be copy-constructible value types
  * 
  * Example: setcallback(wv::delayed(mycallback));
- * 
- * FIXME: Because operator() makes a copy of the inner callback and thaw()
- * destroys the copy, nesting WvDelayedCallback doesn't work as you might
- * expect.  That is, don't do: wv::delayed(wv::delayed(mycallback)).
- * It creates a copy of the inner WvDelayedCallback, but that copy
- * gets frozen, then destroyed before it has a chance to thaw!  Anyway,
- * it's a stupid thing to do anyway, so don't.
+ *
+ * The call is queued with WvIStreamList::globallist.runsoon(), so a
+ * delayed callback that's never called costs nothing at all.  If it's
+ * called more than once before the loop gets to it, only the last call
+ * happens.  Each copy has its own pending call, though, since callbacks
+ * get copied around freely and two owners of the same one would each
+ * expect theirs to happen.  The call still happens if the callback is
+ * gone by then.
  */
 template<class Functor>
 class WvDelayedCallback
 {
 private:
-    Functor func;
-    WvStream *stream;
-    wv::function<void()> frozen;
+    struct Pending
+    {
+        Functor func;
+        wv::function<void()> call; // the call to make, or empty
+        int refs;
+
+        Pending(const Functor &_func) : func(_func), refs(1)
+            { }
+    };
+    Pending *p;
+
+    static void unref(Pending *p)
+    {
+        if (!--p->refs)
+            delete p;
+    }
+
+    static void run(Pending *p)
+    {
+        wv::function<void()> call;
+        call.swap(p->call);
+        if (call)
+            call();
+        unref(p);
+    }
+
+    void schedule(const wv::function<void()> &call)
+    {
+        if (!p->call)
+        {
+            p->refs++;
+            WvIStreamList::globallist.runsoon(wv::bind(&run, p));
+        }
+        p->call = call;
+    }
 
 public:
-  WvDelayedCallback(const Functor& _func):
-      func(_func), stream(new WvStream), frozen(0)
+    WvDelayedCallback(const Functor& _func):
+        p(new Pending(_func))
     {
-        WvIStreamList::globallist.append(stream, true, "WvDelayedCallback");
     }
     WvDelayedCallback(const WvDelayedCallback &other):
-	func(other.func), stream(new WvStream), frozen(0)
+        p(new Pending(other.p->func))
     {
-        WvIStreamList::globallist.append(stream, true, "WvDelayedCallback");
     }
     ~WvDelayedCallback()
     {
-        stream->close();
+        unref(p);
+    }
+    WvDelayedCallback &operator= (const WvDelayedCallback &other)
+    {
+        Pending *old = p;
+        p = new Pending(other.p->func);
+        unref(old);
+        return *this;
     }
     void operator()()
     {
-        stream->setcallback(func);
-        stream->alarm(0);
+        schedule(p->func);
     }
     template<typename P1>
     void operator()(P1 &p1)
     {
-	stream->setcallback(wv::bind(func, p1));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1));
     }
     template<typename P1,
 	     typename P2>
     void operator()(P1 &p1, P2 &p2)
     {
-	stream->setcallback(wv::bind(func, p1, p2));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1, p2));
     }
     template<typename P1,
 	     typename P2,
 	     typename P3>
     void operator()(P1 &p1, P2 &p2, P3 &p3)
     {
-	stream->setcallback(wv::bind(func, p1, p2, p3));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1, p2, p3));
     }
     template<typename P1,
 	     typename P2,
@@ -81,8 +115,7 @@ public:
 	     typename P4>
     void operator()(P1 &p1, P2 &p2, P3 &p3, P4 &p4)
     {
-	stream->setcallback(wv::bind(func, p1, p2, p3, p4));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1, p2, p3, p4));
     }
     template<typename P1,
 	     typename P2,
@@ -91,8 +124,7 @@ public:
 	     typename P5>
     void operator()(P1 &p1, P2 &p2, P3 &p3, P4 &p4, P5 &p5)
     {
-	stream->setcallback(wv::bind(func, p1, p2, p3, p4, p5));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1, p2, p3, p4, p5));
     }
     template<typename P1,
 	     typename P2,
@@ -102,8 +134,7 @@ public:
 	     typename P6>
     void operator()(P1 &p1, P2 &p2, P3 &p3, P4 &p4, P5 &p5, P6 &p6)
     {
-	stream->setcallback(wv::bind(func, p1, p2, p3, p4, p5, p6));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1, p2, p3, p4, p5, p6));
     }
     template<typename P1,
 	     typename P2,
@@ -114,8 +145,7 @@ public:
 	     typename P7>
     void operator()(P1 &p1, P2 &p2, P3 &p3, P4 &p4, P5 &p5, P6 &p6, P7 &p7)
     {
-	stream->setcallback(wv::bind(func, p1, p2, p3, p4, p5, p6, p7));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1, p2, p3, p4, p5, p6, p7));
     }
     template<typename P1,
 	     typename P2,
@@ -128,8 +158,7 @@ public:
     void operator()(P1 &p1, P2 &p2, P3 &p3, P4 &p4, P5 &p5, P6 &p6, P7 &p7,
 		    P8 &p8)
     {
-	stream->setcallback(wv::bind(func, p1, p2, p3, p4, p5, p6, p7, p8));
-        stream->alarm(0);
+	schedule(wv::bind(p->func, p1, p2, p3, p4, p5, p6, p7, p8));
     }
 };
 
@@ -13,6 +13,8 @@
 #include "wvstream.h"
 #include "wvlog.h"
 
+class WvWorkPool;
+
 class WvDiffieHellman
 {
 public:
@@ -20,6 +22,18 @@ public:
 		    BN_ULONG _generator);
     ~WvDiffieHellman() { DH_free(info); }
 
+    typedef wv::function<void(WvDiffieHellman *)> DHCallback;
+
+    /**
+     * Like the constructor, but it checks the prime and generates the key
+     * on one of the threads of 'pool' (or of WvWorkPool::global(), if
+     * it's NULL), and passes the new WvDiffieHellman, which is yours to
+     * delete, to 'cb' in the main loop.  '_key' is copied right away.
+     */
+    static void create_async(const unsigned char *_key, int _keylen,
+			     BN_ULONG _generator, const DHCallback &cb,
+			     WvWorkPool *pool = NULL);
+
     void get_created_secret(WvBuf &outbuf, size_t len);
     int get_public_value(WvBuf &outbuf, int len);
 
@@ -33,6 +47,19 @@ protected:
 private:
 
     WvLog log;
+
+    WvDiffieHellman(struct dh_st *_info, BN_ULONG _generator, int problems);
+    static struct dh_st *setup(const unsigned char *_key, int _keylen,
+			       BN_ULONG generator, int &problems);
+    void report(int problems);
+
+    // the create_async() pieces; see wvasynccrypto.cc
+    static void setup_job(const unsigned char *key, int keylen,
+			  BN_ULONG generator, struct dh_st **info,
+			  int *problems);
+    static void created(unsigned char *key, BN_ULONG generator,
+			struct dh_st **info, int *problems,
+			const DHCallback &cb);
 };
 
 #endif /* __WVDIFFIEHELLMAN_H */
@@ -8,6 +8,7 @@
 #define __WVDIGEST_H
 
 #include "wvencoder.h"
+#include "wvlinklist.h"
 #include <stdint.h>
 
 struct env_md_st;
@@ -133,7 +134,8 @@ private:
 
 
 /**
- * CRC32 checksum
+ * CRC32 checksum (the same one as zlib's crc32()), using the CPU's
+ * instructions for it if it has some; see wvcrc32().
  * Digest length of 4 bytes.
  */
 class WvCrc32Digest : public WvDigest
@@ -152,6 +154,28 @@ public:
 };
 
 
+/**
+ * CRC32C checksum (the Castagnoli polynomial, as used by iSCSI, SCTP and
+ * ext4), using the CPU's instructions for it if it has some; see
+ * wvcrc32c().
+ * Digest length of 4 bytes.
+ */
+class WvCrc32cDigest : public WvDigest
+{
+    uint32_t crc;
+
+public:
+    WvCrc32cDigest();
+    virtual ~WvCrc32cDigest() { }
+
+    virtual size_t digestsize() const;
+    virtual bool _encode(WvBuf &inbuf, WvBuf &outbuf,
+                         bool flush); // consumes input
+    virtual bool _finish(WvBuf &outbuf); // outputs digest
+    virtual bool _reset(); // supported: resets digest value
+};
+
+
 /**
  * Adler32 checksum
  * Digest length of 4 bytes.
@@ -171,4 +195,35 @@ public:
     virtual bool _reset(); // supported: resets digest value
 };
 
+
+DeclareWvList(WvDigest);
+
+/**
+ * Several digests of the same data at once (say, an MD5, a SHA-1 and a
+ * CRC32 of a file), going through the data only once: each piece of it
+ * is given to every digest in turn while it's still in the CPU's cache.
+ *
+ * finish() outputs each of the digests one after the other, in the order
+ * they were added, so digestsize() is the total of theirs.
+ */
+class WvMultiDigest : public WvDigest
+{
+    WvDigestList digests;
+
+public:
+    WvMultiDigest();
+    virtual ~WvMultiDigest() { }
+
+    /** Adds a digest to compute, which the WvMultiDigest then owns. */
+    void add(WvDigest *digest);
+
+    virtual size_t digestsize() const;
+
+protected:
+    virtual bool _encode(WvBuf &inbuf, WvBuf &outbuf,
+                         bool flush); // consumes input
+    virtual bool _finish(WvBuf &outbuf); // outputs digests
+    virtual bool _reset(); // supported: resets digest values
+};
+
 #endif // __WVDIGEST_H
@@ -0,0 +1,161 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2004 Net Integration Technologies, Inc.
+ *
+ * Regular expressions that are matched in time proportional to the length
+ * of the input, however nasty the pattern, and without copying the input.
+ */
+#ifndef __WVFASTREGEX_H
+#define __WVFASTREGEX_H
+
+#include "wvregex.h"
+#include "wvbuf.h"
+#include "wvstringlist.h"
+
+class WvFastRegexProg;
+
+/*!
+@brief WvFastRegex -- Regular expressions that never backtrack.
+
+Takes the same patterns and flags as WvRegex (POSIX extended or basic
+syntax, ICASE, NEWLINE), but instead of handing them to regexec() it
+compiles them into an automaton, and turns that into a DFA one state at a
+time as the input needs it.  Once warmed up, it's one table lookup per
+byte, and no pattern (not even "(a|aa)*b") can make it take longer than
+that.
+
+The input doesn't need to be a nul-terminated string: you can match a
+span of memory, or the whole of a WvBuf without getting it all in one
+piece.
+
+What it can't do is what a DFA can't do: there are no registers (parens
+only group), and no back-references.  For those, use WvRegex.
+
+Compiled patterns are kept in a cache shared by the whole program, so
+making a WvFastRegex for a pattern that some other one already uses
+costs nothing.  Like the rest of WvStreams, none of this is thread-safe.
+!*/
+class WvFastRegex : public WvErrorBase
+{
+    WvFastRegexProg *prog;
+
+public:
+    //!
+    //! Construct an empty regex object.  Matches will always fail until set()
+    //! is called with a valid regex.
+    //!
+    WvFastRegex() : prog(NULL) {}
+    //!
+    //! Construct a regex object, compiling the given regex (or getting it
+    //! from the cache).  cflags are WvRegex::CFlags.
+    //!
+    WvFastRegex(WvStringParm regex, int cflags = WvRegex::default_cflags)
+        : prog(NULL)
+        { set(regex, cflags); }
+    WvFastRegex(const WvFastRegex &other);
+    ~WvFastRegex();
+
+    WvFastRegex &operator= (const WvFastRegex &other);
+
+    //!
+    //! Replace the current regex to match with a new one.
+    //!
+    bool set(WvStringParm regex, int cflags = WvRegex::default_cflags);
+
+    //!
+    //! True if the regex matches anywhere in 'len' bytes at 'buf'.  eflags
+    //! are WvRegex::EFlags.
+    //!
+    bool match_span(const void *buf, size_t len,
+                    int eflags = WvRegex::default_eflags) const;
+    bool match(WvStringParm string,
+               int eflags = WvRegex::default_eflags) const
+        { return match_span(string.cstr(), string.len(), eflags); }
+    //!
+    //! True if the regex matches anywhere in what's in 'buf', which is
+    //! left as it was.
+    //!
+    bool match(WvBuf &buf, int eflags = WvRegex::default_eflags) const;
+
+    //!
+    //! Find the leftmost-longest match in 'len' bytes at 'buf', the way
+    //! regexec() does.  match_end is the index of the byte after the match.
+    //!
+    bool continuable_match_span(const void *buf, size_t len,
+                                size_t &match_start, size_t &match_end,
+                                int eflags = WvRegex::default_eflags) const;
+    //!
+    //! The same as WvRegex::continuable_match(), except for the registers.
+    //!
+    bool continuable_match(WvStringParm string,
+                           int &match_start, int &match_end) const
+        { return continuable_match(string, WvRegex::default_eflags,
+                                   match_start, match_end); }
+    bool continuable_match(WvStringParm string, int eflags,
+                           int &match_start, int &match_end) const;
+
+    //!
+    //! The number of compiled patterns in the cache.
+    //!
+    static size_t cached();
+};
+
+
+/*!
+@brief WvFastRegexSet -- Many patterns matched in one pass.
+
+All the patterns are compiled into one automaton, so matching a line
+against a hundred patterns costs about the same as against one, and you
+find out which of them matched.
+
+\code
+WvFastRegexSet filters;
+filters.add("^kernel: .*error");
+filters.add("sshd\\[[0-9]+\\]: Failed");
+bool which[2];
+if (filters.match(line, which))
+    ...
+\endcode
+!*/
+class WvFastRegexSet : public WvErrorBase
+{
+    int cflags;
+    WvStringList patterns;
+    WvFastRegexProg *prog;
+
+    bool compile();
+
+public:
+    //!
+    //! cflags (WvRegex::CFlags) apply to all of the patterns.
+    //!
+    WvFastRegexSet(int _cflags = WvRegex::default_cflags);
+    ~WvFastRegexSet();
+
+    //!
+    //! Add a pattern, and return its number (counting from 0), or -1 if
+    //! it doesn't compile.
+    //!
+    int add(WvStringParm regex);
+
+    //!
+    //! The number of patterns added.
+    //!
+    size_t count() const
+        { return patterns.count(); }
+
+    //!
+    //! Match all of the patterns at once against 'len' bytes at 'buf', and
+    //! return how many of them matched somewhere.  If 'matched' isn't
+    //! NULL, matched[n] is set to whether pattern n did.
+    //!
+    int match_span(const void *buf, size_t len, bool *matched = NULL,
+                   int eflags = WvRegex::default_eflags);
+    int match(WvStringParm string, bool *matched = NULL,
+              int eflags = WvRegex::default_eflags)
+        { return match_span(string.cstr(), string.len(), matched, eflags); }
+    int match(WvBuf &buf, bool *matched = NULL,
+              int eflags = WvRegex::default_eflags);
+};
+
+#endif // __WVFASTREGEX_H
@@ -9,6 +9,9 @@
 
 #include "wvfdstream.h"
 #include <fcntl.h>
+#ifndef _WIN32
+#include "wvmmapbuf.h"
+#endif
 
 #ifdef _WIN32
 #define O_NONBLOCK 0
@@ -36,14 +39,36 @@ public:
 
     /** Create a WvFile given options like ::open() */
     WvFile(WvStringParm filename, int mode, int create_mode = 0666);
+    virtual ~WvFile();
+
     bool open(WvStringParm filename, int mode, int create_mode = 0666);
     bool open(int _rwfd);
     
     bool readable, writable;
 
+#ifndef _WIN32
+    /**
+     * Maps the rest of a regular file that's open for reading into
+     * memory, and returns it as a read-only buffer, so a parser can scan
+     * it without the stream reading (and copying) it a bit at a time.
+     * Whatever the stream already read ahead into its input buffer is in
+     * there too; the stream's own reads carry on after the end of it.
+     *
+     * The buffer belongs to the WvFile, and lasts until the WvFile is
+     * destroyed or mapped() is called again.  Returns NULL if the file
+     * can't be mapped, eg. if it's a pipe or a device.
+     */
+    WvMmapBuf *mapped(size_t window = WVMMAPBUF_WINDOW);
+#endif
+
     virtual void pre_select(SelectInfo &si);
     virtual bool post_select(SelectInfo &si);
 
+private:
+#ifndef _WIN32
+    WvMmapBuf *mapbuf;
+#endif
+
 public:
     const char *wstype() const { return "WvFile"; }
 };
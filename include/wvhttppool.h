@@ -127,14 +127,17 @@ public:
     public:
 	WvIPPortAddr remaddr;
 	WvString username;
+	unsigned hash; // worked out once, since we look these up a lot
 
 	Target(const WvIPPortAddr &_remaddr, WvStringParm _username)
-	    : remaddr(_remaddr), username(_username) {}
+	    : remaddr(_remaddr), username(_username),
+	      hash(_remaddr.WvHash() * 31 + ::WvHash(_username)) {}
 
 	~Target() {}
 
 	bool operator== (const Target &n2) const
-        { return (username == n2.username && remaddr == n2.remaddr); }
+        { return (hash == n2.hash && username == n2.username
+		  && remaddr == n2.remaddr); }
     };
     Target target;
     static int max_requests;
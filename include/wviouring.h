@@ -0,0 +1,97 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A thin wrapper around a Linux io_uring.
+ */
+#ifndef __WVIOURING_H
+#define __WVIOURING_H
+
+#include "wverror.h"
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * A submission and completion queue shared with the kernel, for doing
+ * reads and writes without waiting for them.
+ *
+ * Each read() or write() queues a request, tagged with a number of your
+ * choosing; submit() hands everything queued to the kernel, and
+ * complete() tells you, by tag, which requests are done and how they
+ * went.  The ring's fd is readable (to select()) whenever there are
+ * completions waiting.
+ *
+ * If the kernel doesn't support io_uring (or won't let us use it),
+ * isok() is false and the caller should do its I/O some other way.
+ */
+class WvIoUring : public WvErrorBase
+{
+public:
+    /** Makes a ring that can have 'entries' requests queued at once. */
+    WvIoUring(unsigned entries);
+    ~WvIoUring();
+
+    /** Readable whenever complete() has something for you. */
+    int getfd() const
+        { return fd; }
+
+    /**
+     * Registers buffers with the kernel, which saves it from mapping them
+     * for each request; pass the index of one as 'bufindex' to read() or
+     * write() to use it.  Returns false if that's not allowed, in which
+     * case the buffers still work, just without the index.
+     */
+    bool register_buffers(const struct iovec *iov, unsigned count);
+
+    /**
+     * True if read() and write() will actually work.  Kernels before 5.6
+     * set up a ring happily, but only know how to read and write through
+     * registered buffers, and fail anything else with EINVAL.
+     */
+    bool canrw() const
+        { return isok() && (plainrw || registered); }
+
+    /**
+     * Queues a read of 'len' bytes at 'offset' in 'fd' into 'buf', or a
+     * write from 'buf' there.  'buf' must stay put until the request is
+     * complete.  Returns false if the queue is full.
+     */
+    bool read(int fd, void *buf, size_t len, off_t offset,
+              uint64_t tag, int bufindex = -1);
+    bool write(int fd, const void *buf, size_t len, off_t offset,
+               uint64_t tag, int bufindex = -1);
+
+    /**
+     * Hands the queued requests to the kernel.  If 'wait' is true, also
+     * waits until at least one request is complete.
+     */
+    bool submit(bool wait = false);
+
+    /**
+     * Gets the next completed request, if there is one: its tag and the
+     * result of the read() or write() (or -errno).
+     */
+    bool complete(uint64_t &tag, int &result);
+
+private:
+    int fd;
+    void *sqring, *cqring;
+    size_t sqringsize, cqringsize;
+    struct io_uring_sqe *sqes;
+    size_t sqessize;
+    unsigned *sqhead, *sqtail, *sqmask, *sqentries, *sqarray;
+    unsigned *cqhead, *cqtail, *cqmask;
+    struct io_uring_cqe *cqes;
+    unsigned queued;
+    bool registered;
+    bool plainrw;           // IORING_OP_READ and IORING_OP_WRITE work
+
+    bool queue(int opcode, int fd, const void *buf, size_t len, off_t offset,
+               uint64_t tag, int bufindex);
+};
+
+#endif // __WVIOURING_H
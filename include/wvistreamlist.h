@@ -44,6 +44,20 @@ public:
 	WvIStreamListBase::prepend(data, autofree, id);
     }
 
+    /**
+     * Calls 'cb' once, the next time this list runs its callbacks, after
+     * the streams that were ready.  Callbacks run in the order they were
+     * queued; any queued while the queue is being run wait for the next
+     * pass.  Unlike a stream with an alarm(0), this costs nothing but a
+     * copy of the callback, and nothing for the rest of the loop to look
+     * at.
+     */
+    void runsoon(const IWvStreamCallback &cb);
+
+    /** Returns the number of callbacks waiting for runsoon(). */
+    size_t runsoon_count() const
+        { return nsoon; }
+
 public: 
     bool auto_prune; // remove !isok() streams from the list automatically?
     static WvIStreamList globallist;
@@ -63,6 +77,13 @@ private:
     bool in_select;
     bool dead_stream;
 
+    struct Soon;
+    Soon *soon, **soon_tail; // waiting for runsoon()
+    Soon *soon_spare;        // already allocated, to be reused
+    size_t nsoon;
+    void run_soon();
+    void zap_soon();
+
 #ifndef _WIN32
     static void onfork(pid_t p);
 #endif
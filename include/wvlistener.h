@@ -21,9 +21,53 @@ public:
     IWvListenerCallback acceptor;
     IWvListenerWrapper wrapper;
     
+    /**
+     * The name another process would know this listener by, like
+     * "tcp:0.0.0.0:4111" or "unix:/tmp/sock", if it's one that can be
+     * handed over with send_handoff(); empty otherwise.
+     */
+    WvString handoff_name;
+    
+    /**
+     * True once another process has its own copy of our socket (see
+     * close_handed_off()), so closing ours mustn't take anything away
+     * from it, like a unix socket's name in the filesystem.
+     */
+    bool handed_off;
+    
     WvListener(IWvStream *_cloned);
     virtual ~WvListener();
     
+    /**
+     * Sends a copy of every open listener that has a handoff_name down
+     * the unix socket 'sock' (one SOCK_SEQPACKET message each, with the
+     * fd attached), then an empty message to say that's all.  Returns
+     * how many were sent, or -1 on error.
+     */
+    static int send_handoff(int sock);
+    
+    /**
+     * Reads what send_handoff() sent on 'sock', and keeps the fds around
+     * for take_inherited().  Returns how many it got, or -1 on error.
+     */
+    static int receive_handoff(int sock);
+    
+    /**
+     * Marks every open listener with a handoff_name as handed_off and
+     * closes it, once somebody else has taken over.  Returns how many.
+     */
+    static int close_handed_off();
+    
+    /**
+     * Returns the socket received for listener 'name', which the caller
+     * now owns, or -1 if there isn't one.  Listeners that support
+     * handoff call this instead of opening a new socket.
+     */
+    static int take_inherited(WvStringParm name);
+    
+    /** Closes the received sockets that nobody took.  Returns how many. */
+    static int close_inherited();
+    
     virtual void addwrap(IWvListenerWrapper _wrapper);
     
     virtual IWvListenerCallback onaccept(IWvListenerCallback _cb);
@@ -98,6 +142,22 @@ public:
     virtual void outbuf_limit(size_t size)
         { }
     virtual WvString getattr(WvStringParm name) const;
+    
+protected:
+    /**
+     * Called by listeners that support handoff once their socket is
+     * listening, with the name that a new process's listener for the same
+     * address will ask take_inherited() for.
+     */
+    void set_handoff_name(WvStringParm name);
+    
+    /**
+     * Returns the socket received for 'name' if there is one (see
+     * take_inherited()), or else a new SOCK_STREAM socket in 'domain'.
+     * Whichever it was, it's already listening if is_listening().
+     */
+    static int inherited_socket(WvStringParm name, int domain);
+    static bool is_listening(int fd);
 };
 
 /**
@@ -27,8 +27,14 @@ protected:
     virtual void _make_prefix(time_t now_sec); 
     virtual void _mid_line(const char *str, size_t len);
     virtual void _end_line();
+    virtual void _flush_lines(const char *str, size_t len);
 
     int fsync_count;
+
+private:
+    // the timestamp for the second we last made a prefix in
+    time_t stamp_time;
+    char stamp[30];
 };
 
 
@@ -47,6 +53,7 @@ public:
 private:
     virtual void _make_prefix(time_t now_sec); 
     int keep_for, last_day;
+    time_t last_checked; // when we last checked if it's time to rotate
     WvString filename;
     bool allow_append;
 
@@ -51,6 +51,12 @@ protected:
     /** Set the Prefix and Prefix Length (size_t prelen) */
     virtual void _make_prefix(time_t now);
     
+    /**
+     * Whether we want a message from 'source' at 'loglevel', going by
+     * level() and set_custom_levels().
+     */
+    bool is_wanted(WvStringParm source, WvLog::LogLevel loglevel);
+    
     /** Start a new log line (print prefix) */
     virtual void _begin_line();
     
@@ -64,25 +70,57 @@ protected:
      */
     virtual void _mid_line(const char *str, size_t len) = 0;
     
+    /**
+     * Receivers that just write their text somewhere (like WvLogConsole)
+     * can collect it with buffer_line() instead of writing every little
+     * piece.  Whatever's been collected is handed to _flush_lines() in one
+     * go at the end of each log() or end_line() call, or whenever
+     * flush_lines() is called.
+     */
+    void buffer_line(const char *str, size_t len)
+    {
+	if (linebuf_used + len > linebuf_size)
+	    grow_linebuf(len);
+	memcpy(linebuf + linebuf_used, str, len);
+	linebuf_used += len;
+    }
+    void flush_lines();
+    virtual void _flush_lines(const char *str, size_t len)
+        { }
+    
 private:
+    char *linebuf;
+    size_t linebuf_used, linebuf_size;
+    bool flushing;
+    
+    void grow_linebuf(size_t len);
     void begin_line()
         { if (!at_newline) return; _begin_line(); at_newline = false; }
     void mid_line(const char *str, size_t len)
         { _mid_line(str, len); 
 	    if (len>0 && str[len-1] == '\n') at_newline = true; }
+    void finish_line()
+        { if (at_newline) return;
+	    _mid_line("\n", 1); _end_line(); at_newline = true; };
     
 public:
     virtual void log(WvStringParm source, int loglevel,
 		     const char *_buf, size_t len);
     
+    /**
+     * Like log(), but for a message that was logged at time 'when' instead
+     * of now, like one read back from a WvBinLogFile.
+     */
+    void log_at(time_t when, WvStringParm source, int loglevel,
+		const char *_buf, size_t len);
+    
     static const char *loglevels[WvLog::NUM_LOGLEVELS];
     
     WvLogRcv(WvLog::LogLevel _max_level = WvLog::NUM_LOGLEVELS);
     virtual ~WvLogRcv();
     
     void end_line()
-        { if (at_newline) return;
-	    _mid_line("\n", 1); _end_line(); at_newline = true; };
+        { finish_line(); flush_lines(); }
     
     WvLog::LogLevel level() const
         { return max_level; }
@@ -112,6 +150,7 @@ class WvLogConsole : public WvFDStream, public WvLogRcv
         virtual ~WvLogConsole();
     protected:
         virtual void _mid_line(const char *str, size_t len);
+        virtual void _flush_lines(const char *str, size_t len);
 };
 
 #endif // __WVLOGRCV_H
@@ -0,0 +1,116 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A read-only buffer of a file's contents, mapped into memory instead of
+ * read into it.
+ */
+#ifndef __WVMMAPBUF_H
+#define __WVMMAPBUF_H
+
+#include "wvbuf.h"
+#include <sys/types.h>
+
+/**
+ * How much of a file a WvMmapBuf maps at once, unless asked otherwise.
+ * A 32-bit process can't spare much of its address space.
+ */
+#define WVMMAPBUF_WINDOW \
+    (sizeof(void *) > 4 ? (size_t)1024*1024*1024 : (size_t)64*1024*1024)
+
+
+/**
+ * The WvMmapBuf storage class.
+ *
+ * Maps part of the file (a "window") at a time, and maps a new one when
+ * a get() or peek() goes outside the current window.  Only the
+ * bytes asked for in a single get() or peek() have to fit in one window,
+ * so the window is made bigger if a caller asks for more than that.
+ */
+class WvMmapBufStore : public WvReadOnlyBufferStoreMixin<WvBufStore>
+{
+protected:
+    int fd;
+    off_t start;         // where the buffer starts in the file
+    size_t size;         // how many bytes of the file it has
+    size_t readidx;      // relative to start
+    size_t window;       // how much to map at once
+    bool ok;
+
+    const unsigned char *map; // the current window, or NULL
+    off_t mapoff;        // where it starts in the file; page aligned
+    size_t maplen;
+
+    /**
+     * Returns a pointer to 'count' bytes starting 'idx' bytes into the
+     * buffer, mapping a new window if the current one doesn't cover them.
+     * Returns NULL if the mapping fails.
+     */
+    const unsigned char *mapped(size_t idx, size_t count);
+    void unmap();
+
+public:
+    /**
+     * Makes a buffer of 'size' bytes of the file open on 'fd', starting
+     * at 'start', or all the rest of it if 'size' is (size_t)-1.  Closes
+     * 'fd' when it's done with it.
+     */
+    WvMmapBufStore(int _granularity, int _fd, off_t _start, size_t _size,
+                   size_t _window);
+    virtual ~WvMmapBufStore();
+
+    /** False if the file couldn't be mapped. */
+    bool isok() const
+        { return ok; }
+
+    /*** Overridden Members ***/
+    virtual size_t used() const;
+    virtual size_t optgettable() const;
+    virtual const void *get(size_t count);
+    virtual void unget(size_t count);
+    virtual size_t ungettable() const;
+    virtual size_t optpeekable(int offset) const;
+    virtual const void *peek(int offset, size_t count);
+    virtual void zap();
+};
+
+
+/**
+ * A read-only buffer of a file's contents that maps the file into memory
+ * instead of reading it, so a parser can scan it without copying it
+ * first.
+ *
+ * optgettable() is how much can be had without mapping another window;
+ * anything that works through the buffer in optgettable() sized pieces
+ * never needs more than a window's worth of address space, however big
+ * the file is.  Pointers from get() and peek() are only good until the
+ * next get() or peek(), as usual.
+ *
+ * The file mustn't be truncated while it's mapped: touching the part
+ * that's gone gets you a SIGBUS.
+ */
+class WvMmapBuf : public WvBufBase<unsigned char>
+{
+protected:
+    WvMmapBufStore mystore;
+
+public:
+    /**
+     * A buffer of 'size' bytes of the file on 'fd' (or all of the rest,
+     * if 'size' is (size_t)-1) from 'start' on.  Takes over 'fd'.
+     */
+    WvMmapBuf(int fd, off_t start, size_t size,
+              size_t window = WVMMAPBUF_WINDOW);
+
+    /** A buffer of all of 'filename'. */
+    explicit WvMmapBuf(WvStringParm filename,
+                       size_t window = WVMMAPBUF_WINDOW);
+
+    virtual ~WvMmapBuf() { }
+
+    /** False if the file couldn't be opened or mapped. */
+    bool isok() const
+        { return mystore.isok(); }
+};
+
+#endif // __WVMMAPBUF_H
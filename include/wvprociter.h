@@ -11,6 +11,7 @@
 
 #include "wvdiriter.h"
 #include "wvstringlist.h"
+#include "wvhashtable.h"
 
 struct WvProcEnt
 {
@@ -37,6 +38,93 @@ public:
     WvIterStuff(const WvProcEnt);
 };
 
+
+/** One process in a WvProcTable. */
+struct WvProcTableEnt : public WvProcEnt
+{
+    WvString name;                 // basename of argv[0]
+    ino_t dirino;                  // identify the /proc/pid directory,
+    time_t dirctime;               //   which changes when pid is reused
+    unsigned generation;           // last refresh() that saw this process
+};
+
+DeclareWvList(WvProcTableEnt);
+DeclareWvDict(WvProcTableEnt, pid_t, pid);
+
+/** All the processes in a WvProcTable that share one name. */
+struct WvProcTableName
+{
+    WvString name;
+    WvProcTableEntList procs;
+
+    WvProcTableName(WvStringParm _name) : name(_name) { }
+};
+
+DeclareWvDict(WvProcTableName, WvString, name);
+
+
+/**
+ * A snapshot of the process table, indexed by pid and by name (the
+ * basename of argv[0], which is what wvkillall() matches against).
+ *
+ * Unlike WvProcIter, which reparses every process on every pass,
+ * refresh() only does an fstatat() on the /proc/pid directory of
+ * processes it already knows about, which is enough to tell a
+ * still-running process from a new one that reused its pid.  Only new
+ * processes get their exe and cmdline read, using openat() relative to
+ * a single open /proc directory.
+ */
+class WvProcTable
+{
+    int procfd;
+    unsigned generation;
+    WvProcTableEntDict bypid;
+    WvProcTableNameDict byname;
+
+    void read_proc(int pidfd, WvProcTableEnt &ent);
+    void add_name(WvProcTableEnt *ent);
+    void del_name(WvProcTableEnt *ent);
+    void del(WvProcTableEnt *ent);
+
+public:
+    /**
+     * Opens /proc and reads the current process table.  Call refresh()
+     * later to bring it up to date.
+     */
+    WvProcTable();
+    ~WvProcTable();
+
+    bool isok() const
+        { return procfd >= 0; }
+
+    /**
+     * Rescans /proc, adding new processes and forgetting the ones that
+     * have exited.  Returns the number of processes whose details had to
+     * be (re)read.
+     */
+    size_t refresh();
+
+    size_t count() const
+        { return bypid.count(); }
+
+    /** Returns the process with the given pid, or NULL. */
+    const WvProcTableEnt *find(pid_t pid) const
+        { return bypid[pid]; }
+
+    /**
+     * Returns the list of processes named 'name', or NULL if there are
+     * none.
+     */
+    const WvProcTableEntList *find_name(WvStringParm name) const;
+
+    class Iter : public WvProcTableEntDict::Iter
+    {
+    public:
+        Iter(WvProcTable &t) : WvProcTableEntDict::Iter(t.bypid)
+            { }
+    };
+};
+
 bool wvkillall(WvStringParm basename, int sig); 
 
 #endif
@@ -33,6 +33,54 @@ public:
     
     DeclareWvList(Token);
 
+    /**
+     * A word found by tokview(): 'len' bytes, starting 'off' bytes into
+     * the line.  tokview() puts a NUL after each word, so the line plus
+     * 'off' is also a C string; see tokview_str().
+     */
+    struct TokenView
+    {
+	size_t off, len;
+    };
+
+    /**
+     * The most words tokview() will split a line into.  If there are more,
+     * the last TokenView is the whole rest of the line, like
+     * token_remaining().
+     */
+    enum { MAX_TOKVIEWS = 32 };
+
+    /**
+     * A tokanal() lookup table, hashed once up front so that finding a
+     * word in it doesn't mean comparing against every entry.  'lookup' is
+     * NULL-terminated, like tokanal()'s, and has to stay around as long
+     * as the TokenTable does.
+     */
+    class TokenTable
+    {
+    public:
+	TokenTable(const char **_lookup, bool _case_sensitive = false);
+	~TokenTable();
+
+	/** Like tokanal(): the index of the word in 'lookup', or -1. */
+	int find(const char *word, size_t len) const;
+	int find(const char *word) const
+	    { return find(word, strlen(word)); }
+
+    private:
+	const char **lookup;
+	bool case_sensitive;
+	size_t *lengths;
+	int *slots;	// index into lookup + 1, or 0 if empty
+	unsigned mask;
+
+	unsigned hash(const char *word, size_t len) const;
+
+	// it owns 'lengths' and 'slots', so it can't be copied
+	TokenTable(const TokenTable &);
+	TokenTable &operator= (const TokenTable &);
+    };
+
     WvDynBuf tokbuf;
     bool log_enable;
 
@@ -49,10 +97,30 @@ public:
     virtual TokenList *tokenize();
     size_t list_to_array(TokenList *tl, Token **array);
     Token *tokline(const char *line);
+
+    /**
+     * Splits 'line' (from getline(), say) into words in place: it doesn't
+     * copy or allocate anything, but it does overwrite the whitespace
+     * after each word with a NUL.  The words are left in tokviews[], and
+     * the number of them is returned (and left in ntokviews).  Like
+     * tokline(), it logs the line, and 'line' may be NULL.
+     */
+    size_t tokview(char *line);
+    TokenView tokviews[MAX_TOKVIEWS];
+    size_t ntokviews;
+
+    /** The n'th word found by the last tokview(), as a C string. */
+    const char *tokview_str(size_t n) const
+        { return tokviewline + tokviews[n].off; }
     
     /** Convert token strings to enum values */
     int tokanal(const Token &t, const char **lookup,
 		bool case_sensitive = false);
+    int tokanal(const Token &t, const TokenTable &table)
+        { return table.find(t.data, t.length); }
+    /** Like tokanal(), for the n'th word found by the last tokview(). */
+    int tokanal(size_t n, const TokenTable &table)
+        { return table.find(tokview_str(n), tokviews[n].len); }
     
     // finite state machine
     int state;
@@ -64,6 +132,9 @@ public:
     
 protected:
     WvLog *logp;
+    char *tokviewline;
+
+    void log_read(const char *line);
     
 public:
     const char *wstype() const { return "WvProtoStream"; }
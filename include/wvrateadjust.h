@@ -15,6 +15,9 @@
  * You can also use this as a slightly (not terribly) inefficient rate
  * *estimator* for the input stream.
  * 
+ * Or, if you already know both rates exactly, it can just convert from
+ * one to the other without looking at the clock at all.
+ * 
  * NOTE: Time is of the essence of this encoder.
  */ 
 #ifndef __WVRATEADJUST_H
@@ -29,7 +32,8 @@ public:
     WvRateAdjust *match_rate;
  
     int sampsize, irate_n, irate_d, orate_n, orate_d;
-    WvTime epoch; // the time when sampling started
+    WvTime epoch; // the time when sampling started, by wvmonotime()
+    bool fixed;   // irate_n/irate_d is exact, so don't estimate it
     
     // the token bucket holds the "remainder" of our fake integer division
     // operation.  With this, we can make sure we always average out to
@@ -44,6 +48,15 @@ public:
     WvRateAdjust(int _sampsize, int _irate_base, int _orate);
     WvRateAdjust(int _sampsize, int _irate_base, WvRateAdjust *_match_rate);
     
+    /**
+     * Converts from exactly _irate_n/_irate_d samples per second to
+     * _orate_n/_orate_d, for when both are known: say 44100 to 48000, or
+     * 8000 to 16001/2.  The clock doesn't come into it, so it's the same
+     * whether the data arrives in real time or all at once.
+     */
+    WvRateAdjust(int _sampsize, int _irate_n, int _irate_d,
+                 int _orate_n, int _orate_d);
+    
     int getirate()
         { return irate_n / irate_d; }
     int getorate()
@@ -13,6 +13,7 @@
 #include "wvlog.h"
 
 struct rsa_st;
+class WvWorkPool;
 
 /**
  * An RSA public key or public/private key pair that can be used for
@@ -46,6 +47,17 @@ public:
      * Create a new RSA key of bits strength.
      */
     WvRSAKey(int bits);
+
+    typedef wv::function<void(WvRSAKey *)> KeyCallback;
+
+    /**
+     * Like WvRSAKey(bits), but it generates the key on one of the threads
+     * of 'pool' (or of WvWorkPool::global(), if it's NULL), and then
+     * passes it to 'cb' in the main loop.  The new key is yours to
+     * delete.
+     */
+    static void generate_async(int bits, const KeyCallback &cb,
+                               WvWorkPool *pool = NULL);
     
     virtual ~WvRSAKey();
     
@@ -101,6 +113,19 @@ public:
     WvRSAEncoder(Mode mode, const WvRSAKey &key);
     virtual ~WvRSAEncoder();
 
+    typedef wv::function<void(WvBuf &, bool)> DoneCallback;
+
+    /**
+     * Encodes (and flushes) everything in 'in' with a new WvRSAEncoder on
+     * one of the threads of 'pool' (or of WvWorkPool::global(), if it's
+     * NULL), and then passes the output, and whether it worked, to 'cb'
+     * in the main loop.  The data is taken out of 'in', and 'key' copied,
+     * right away.  The private key modes are the slow ones, and so the
+     * ones worth doing this for.
+     */
+    static void encode_async(Mode mode, const WvRSAKey &key, WvBuf &in,
+                             const DoneCallback &cb, WvWorkPool *pool = NULL);
+
 protected:
     virtual bool _encode(WvBuf &in, WvBuf &out, bool flush);
     virtual bool _reset(); // supported
@@ -0,0 +1,36 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A "Log Receiver" that keeps recent messages in a WvShmLogRing.
+ */
+#ifndef __WVSHMLOG_H
+#define __WVSHMLOG_H
+
+#include "wvlogrcv.h"
+#include "wvshmlogring.h"
+
+/**
+ * WvLogRcv that keeps the last 'nslots' messages in a WvShmLogRing, where
+ * wvcrash (or the shmlogdump program, if you give a filename) can find
+ * them after a crash.  Unlike WvLogBuffer, it doesn't allocate anything
+ * per message; the messages aren't even split into lines.
+ */
+class WvShmLog : public WvLogRcv
+{
+public:
+    WvShmLog(size_t nslots = 1024, size_t slotsize = 256,
+	     const char *filename = NULL,
+	     WvLog::LogLevel _max_level = WvLog::NUM_LOGLEVELS);
+
+    WvShmLogRing ring;
+
+    virtual void log(WvStringParm source, int loglevel,
+		     const char *_buf, size_t len);
+
+protected:
+    virtual void _mid_line(const char *str, size_t len)
+        { } // log() does all the work
+};
+
+#endif // __WVSHMLOG_H
@@ -0,0 +1,108 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A fixed-size ring of recent log messages in shared memory.
+ */
+#ifndef __WVSHMLOGRING_H
+#define __WVSHMLOGRING_H
+
+#include "wverror.h"
+#include "wvtimeutils.h"
+#include <stdint.h>
+
+#define WVSHMLOGRING_MAGIC   "WvLogRng" // exactly 8 bytes, no nul
+#define WVSHMLOGRING_VERSION 1
+
+/** The start of the mapping; the slots follow it. */
+struct WvShmLogRingHeader
+{
+    char magic[8];        // WVSHMLOGRING_MAGIC
+    uint32_t version;     // WVSHMLOGRING_VERSION
+    uint32_t size;        // of this header
+    uint32_t nslots;      // a power of two
+    uint32_t slotsize;    // of each slot, WvShmLogRingSlot included
+    uint64_t next;        // the sequence number of the next message
+};
+
+/**
+ * One message: 'srclen' bytes of source name followed by 'len' bytes of
+ * text, cut short if they didn't fit in the slot.
+ *
+ * 'seq' is the message's sequence number plus one once the slot is
+ * completely written, and zero while it's being written, so a reader
+ * can tell (by checking it before and after copying the slot) whether
+ * what it copied is all one message.
+ */
+struct WvShmLogRingSlot
+{
+    uint64_t seq;
+    uint32_t sec, usec;   // when it was logged
+    uint8_t level;        // a WvLog::LogLevel
+    uint8_t srclen;
+    uint16_t len;
+};
+
+
+/**
+ * Keeps the last 'nslots' log messages in a shared mapping, and can dump
+ * them from inside the wvcrash signal handler or, if the ring is in a
+ * file, from another process after this one has died.
+ *
+ * Adding a message costs the same no matter how full the ring is, and
+ * takes no locks: writers (in any number of threads, or processes that
+ * share the mapping) each claim a slot with one atomic increment.
+ * Messages that don't fit in a slot are cut short.
+ *
+ * Without a filename, the ring is in anonymous shared memory like a
+ * WvShmZone, which survives fork() but not the process.
+ *
+ * wvcrash dumps every ring that exists when the program crashes.
+ */
+class WvShmLogRing : public WvErrorBase
+{
+public:
+    WvShmLogRing(size_t _nslots = 1024, size_t _slotsize = 256,
+		 const char *filename = NULL);
+    ~WvShmLogRing();
+
+    /** Adds a message, overwriting the oldest one if the ring is full. */
+    void append(const WvTime &when, int level,
+		const char *source, size_t srclen,
+		const char *msg, size_t len);
+
+    /** The number of messages ever added, including overwritten ones. */
+    uint64_t count() const
+        { return hdr ? hdr->next : 0; }
+
+    /**
+     * Writes out the messages still in the ring, oldest first, one per
+     * line.  Only uses system calls and the stack, so it's safe to call
+     * from a signal handler.
+     */
+    void dump(int fd) const;
+
+    /**
+     * Dumps the ring left in 'filename' by a (possibly dead) process.
+     * Returns false if it isn't a ring.
+     */
+    static bool dump(const char *filename, int fd);
+
+    /** Dumps every ring in this process.  For wvcrash. */
+    static void dump_all(int fd);
+
+    /** True if there are any rings in this process. */
+    static bool any()
+        { return first_ring != NULL; }
+
+private:
+    WvShmLogRingHeader *hdr;
+    size_t mapsize;
+    WvShmLogRing *next_ring;
+
+    static WvShmLogRing *first_ring;
+
+    static void dump(const WvShmLogRingHeader *hdr, int fd);
+};
+
+#endif // __WVSHMLOGRING_H
@@ -44,6 +44,10 @@ protected:
     virtual void do_run();
     virtual void do_stop();
 
+    //! Drained once the globallist has nothing but the streams we added
+    //! ourselves, ie. the connections they made are all gone.
+    virtual bool is_drained();
+
 private:
 
     void restart_close_cb(IWvStream *s, const char *id);
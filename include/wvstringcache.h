@@ -7,7 +7,7 @@
 #ifndef __WVSTRINGCACHE_H
 #define __WVSTRINGCACHE_H
 
-#include "wvstringtable.h"
+#include "wvstring.h"
 
 /**
  * A cache table of WvString objects.  If you think you might be reusing
@@ -21,19 +21,23 @@
  * content) in its place.  The string will be saved in the cache table for
  * next time.
  * 
- * Every once and a while, you should call clean() to remove any strings from
- * the table that are no longer referenced elsewhere.  This is especially
- * important after deleting a large data structure, because you won't actually
- * free up the memory used by those strings until clean() is called.
+ * The strings live inline in big arena pages, indexed by an open-addressed
+ * hash table, and each one is only a WvStringBuf header longer than its
+ * contents.  Strings that aren't referenced anywhere else any more are
+ * freed a few at a time during get(), so nothing ever walks the whole table
+ * at once: even growing the index is spread out over the following calls.
+ * A page is freed when the last string in it goes.  You can still call
+ * clean() to free everything unused right away, for example after
+ * deleting a large data structure.
  * 
  * All WvStringCaches in the app are shared, to optimize the benefits of
  * the cache.
  */
 class WvStringCache
 {
-    static WvStringTable *t;
+    struct Pool;
+    static Pool *pool;
     static int refcount;
-    static size_t clean_threshold;
     
 public:
     WvStringCache();
@@ -44,6 +48,12 @@ public:
     
     /** Remove any now-unused strings from the cache. */
     void clean();
+
+    /** Returns the number of strings in the cache, used or not. */
+    static size_t count();
+
+    /** Returns the number of bytes the cache has allocated. */
+    static size_t memused();
 };
 
 
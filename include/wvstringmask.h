@@ -50,9 +50,44 @@ public:
      */
     void set(WvStringParm s, bool value);
 
+    /**
+     * Return the first of the characters from 'p' up to 'end' that's in
+     * the mask, or 'end' if there aren't any.  Where it can, it looks at
+     * 16 of them at a time, so it's the thing to use for skipping over
+     * long runs of characters that don't need any special treatment.
+     */
+    const char *find(const char *p, const char *end) const
+    {
+	// the first few one at a time, since that's often as far as it gets
+	for (int n = 0; n < 4 && p < end; n++, p++)
+	    if (_set[(unsigned char)*p])
+		return p;
+	return p < end ? find_more(p, end) : end;
+    }
+
+    /**
+     * Return how many of the characters from 'p' up to 'end' are in the
+     * mask, looking at 16 at a time like find().
+     */
+    size_t count(const char *p, const char *end) const;
+
 private:
     bool _set[256];
     char _first;
+
+    // What find() skips 16 at a time: up to four ranges of characters
+    // that aren't in the mask, from lo[n] to lo[n]+width[n], and whether
+    // that's all of them.  Every set() or zap() works it out again right
+    // away, so that find() and count() never change anything and a
+    // static mask can be shared between threads.
+    enum { MAX_RANGES = 4 };
+    unsigned char lo[MAX_RANGES], width[MAX_RANGES];
+    int nranges, nset;
+    bool all_ranges;
+
+    struct Ranges;
+    void find_ranges();
+    const char *find_more(const char *p, const char *end) const;
 };
 
 #endif // __WVSTRINGMASK_H
@@ -175,6 +175,21 @@ WvString intl_date(time_t _when = -1);
 /** Return the local date and time (in format of ISO 8601) out of _when */
 WvString intl_datetime(time_t _when = -1);
 
+/**
+ * The same dates and times as above, but written into 'buf', which is
+ * 'size' bytes long, instead of a new WvString.  They return the length,
+ * or, if it doesn't fit, 0 (like strftime()).  Each one remembers the
+ * last second it was asked for, so doing it again in the same second is
+ * just a copy; and localtime() is only called when daylight saving time
+ * starts or ends, or once a day.
+ */
+size_t rfc822_date(time_t _when, char *buf, size_t size);
+size_t rfc1123_date(time_t _when, char *buf, size_t size);
+size_t local_date(time_t _when, char *buf, size_t size);
+size_t intl_time(time_t _when, char *buf, size_t size);
+size_t intl_date(time_t _when, char *buf, size_t size);
+size_t intl_datetime(time_t _when, char *buf, size_t size);
+
 time_t intl_gmtoff(time_t t);
 
 #ifndef _WIN32
@@ -69,6 +69,13 @@ extern const WvStringMask WVTCL_SPLITCHARS;
 WvString wvtcl_escape(WvStringParm s,
 		      const WvStringMask &nasties = WVTCL_NASTY_SPACES);
 
+/**
+ * Like wvtcl_escape(), but appends the escaped string to 'out'.  This
+ * doesn't create any WvStrings, so it's safe to use from any thread.
+ */
+void wvtcl_escape(WvBuf &out, const char *s,
+		  const WvStringMask &nasties = WVTCL_NASTY_SPACES);
+
 
 /**
  * tcl-unescape a string.  This is generally the reverse of wvtcl_escape,
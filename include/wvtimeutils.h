@@ -44,6 +44,13 @@ time_t msecdiff(const WvTime &a, const WvTime &b);
 /** Returns the current time of day. */
 WvTime wvtime();
 
+/**
+ * Returns the time from a clock that never jumps, even when the time of
+ * day gets set, where there is one.  It doesn't count from any particular
+ * time: it's only good for measuring intervals.
+ */
+WvTime wvmonotime();
+
 /** Adds the specified number of milliseconds to a time value. */
 WvTime msecadd(const WvTime &a, time_t msec);
 
@@ -0,0 +1,92 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A WvFile that reads and writes through io_uring.
+ */
+#ifndef __WVURINGFILE_H
+#define __WVURINGFILE_H
+
+#include "wvfile.h"
+#include "wviouring.h"
+
+/**
+ * A WvFile that doesn't make the main loop wait for the disk.
+ *
+ * select() always says a regular file is ready, so a plain WvFile reads
+ * and writes it with blocking system calls, and while the disk is busy,
+ * nothing else happens.  WvUringFile keeps a few reads ahead of you and a
+ * few writes behind you in flight through an io_uring instead: it's
+ * readable once a read has come back, and writable as long as it has a
+ * free buffer to copy a write into.  The ring's fd is in the select() set
+ * while anything's in flight, so completions wake up the main loop like
+ * any other event.
+ *
+ * It has 'nbufs' buffers of 'bufsize' bytes each, registered with the
+ * kernel; half are for reading and half for writing.  Reads come from the
+ * file's offset when it was opened onwards, and writes go to where it
+ * was then (or to the end, with O_APPEND).
+ *
+ * If io_uring isn't available (or is too old to read and write files), or
+ * the file isn't a regular file, it acts just like a WvFile.
+ */
+class WvUringFile : public WvFile
+{
+public:
+    WvUringFile(WvStringParm filename, int mode, int create_mode = 0666,
+                size_t _bufsize = 65536, int _nbufs = 8);
+    virtual ~WvUringFile();
+
+    /** True if it's really using io_uring, not acting like a WvFile. */
+    bool usinguring() const
+        { return ring != NULL; }
+
+    virtual void close();
+    virtual void pre_select(SelectInfo &si);
+    virtual bool post_select(SelectInfo &si);
+
+protected:
+    virtual size_t uread(void *buf, size_t count);
+    virtual size_t uwrite(const void *buf, size_t count);
+    virtual bool flush_internal(time_t msec_timeout);
+
+private:
+    enum BufState { Free, InFlight, Done };
+    struct Buf
+    {
+        unsigned char *data;
+        BufState state;
+        off_t offset;       // where in the file it's from (or going)
+        size_t len;         // how much it holds
+        size_t done;        // how much has been read out (or written)
+        bool stale;         // a read ahead of where the file turned out
+                            // to end, to be thrown away when it's done
+    };
+
+    WvIoUring *ring;
+    unsigned char *mem;
+    size_t bufsize;
+    int nbufs, nread;       // buffers [0, nread) are for reading
+    Buf *bufs;
+    int inflight;
+
+    off_t roff;             // where the next read ahead starts
+    off_t rnext;            // where the next byte read out comes from
+    bool rshort;            // a read came back short; wait for rnext to
+                            // catch up before reading further
+    bool reof;
+    off_t woff;             // where the next write goes
+    bool append;
+
+    void setup();
+    void teardown();
+    void start_reads();
+    void start_write(int n);
+    bool reap();
+    Buf *nextread() const;
+    bool readready() const
+        { return nextread() != NULL; }
+    bool writeready() const;
+};
+
+#endif // __WVURINGFILE_H
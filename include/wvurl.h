@@ -16,6 +16,35 @@ class WvIPPortAddr;
 class WvUrl
 {
 public:
+    /**
+     * The parts of a URL, each pointing into the string it was parsed
+     * from.  Nothing is copied, so this is only good for as long as that
+     * string is, and none of the parts are nul-terminated.
+     */
+    struct Parts
+    {
+        struct Part
+        {
+            const char *str;
+            size_t len;
+        };
+        
+        Part proto, user, password, host, file;
+        int port;
+    };
+    
+    /**
+     * Splits up 'url' exactly like the constructor does, but without
+     * allocating anything or looking up the host.  Returns NULL if it
+     * worked, or else the reason it didn't.
+     */
+    static const char *parse(const char *url, Parts &parts);
+    
+    /**
+     * Parses 'url'.  The last few URLs parsed are remembered, so making
+     * a WvUrl from the same string again doesn't need to parse it, or
+     * allocate anything except the address once it's resolved.
+     */
     WvUrl(WvStringParm url);
     WvUrl(const WvUrl &url);
     ~WvUrl();
@@ -24,7 +53,13 @@ public:
         { return port != 0 && (resolving || addr != NULL); }
     WvStringParm errstr() const
         { return err; }
-    bool resolve(); // dns-resolve the hostname (returns true if done)
+    
+    /**
+     * dns-resolve the hostname (returns true if done).  Once it's done,
+     * calling it again is cheap, and so is resolving a hostname that's
+     * already a numeric address.
+     */
+    bool resolve();
 
     operator WvString () const;
     
@@ -50,6 +85,7 @@ public:
         { return password; }
 
 protected:
+    // all of these but err share a single buffer
     WvString proto, hostname, user, password;
     int port;
     bool resolving;
@@ -0,0 +1,89 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A pool of threads for work that would otherwise hold up the main loop.
+ */
+#ifndef __WVWORKPOOL_H
+#define __WVWORKPOOL_H
+
+#include "wvfdstream.h"
+#include <pthread.h>
+
+/**
+ * Runs slow, self-contained jobs (like generating an RSA key) on a few
+ * worker threads, and then calls a callback for each one back in the
+ * main loop, so nothing else has to wait for them.
+ *
+ * The pool is itself a stream, on an eventfd that the workers poke when
+ * a job is done: put it in your WvIStreamList, and its execute() calls
+ * the 'done' callbacks of all the finished jobs, in the order they
+ * finished.  global() is one that's already in the globallist.
+ *
+ * A job runs on another thread, so it mustn't touch anything the main
+ * loop might be using at the same time.  That includes creating or
+ * copying WvStrings (even the null one), whose reference counts aren't
+ * thread safe, and logging through a WvLog.  Do that sort of thing in the
+ * 'done' callback instead.
+ *
+ * Deleting the pool waits for the jobs that have already started, but
+ * throws away the ones that haven't, and doesn't call anybody's 'done'
+ * callback.
+ */
+class WvWorkPool : public WvFdStream
+{
+public:
+    typedef wv::function<void()> Job;
+    typedef wv::function<void()> DoneCallback;
+
+    /** With 'nthreads' <= 0, there's one thread per CPU. */
+    WvWorkPool(int nthreads = 0);
+    virtual ~WvWorkPool();
+
+    /**
+     * Runs 'job' on a worker thread as soon as one's free, and then
+     * 'done' in the main loop.
+     */
+    void submit(const Job &job, const DoneCallback &done = DoneCallback());
+
+    /**
+     * Runs all 'njobs' of 'jobs' on the worker threads, and returns once
+     * they've all finished.  Nothing happens in the main loop about them
+     * afterwards, and they don't count in pending().  Don't call it from
+     * a job, or it may wait forever for a worker that's busy waiting.
+     */
+    void run(const Job *jobs, size_t njobs);
+
+    /** Returns the number of jobs whose 'done' hasn't been called yet. */
+    size_t pending() const
+        { return npending; }
+
+    /** Returns the number of worker threads. */
+    int threadcount() const
+        { return nthreads; }
+
+    /** A pool that's shared by everyone, and already in the globallist. */
+    static WvWorkPool &global();
+
+    virtual void execute();
+
+private:
+    struct Task;
+
+    int nthreads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work;        // there's something in 'todo', or quitting
+    pthread_cond_t finished;    // the last of a run() is done
+    bool quitting;
+    Task *todo, **todo_tail;    // waiting for a worker
+    Task *done, **done_tail;    // waiting for the main loop
+    size_t npending;
+
+    static void *worker(void *_pool);
+
+public:
+    const char *wstype() const { return "WvWorkPool"; }
+};
+
+#endif // __WVWORKPOOL_H
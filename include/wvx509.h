@@ -26,6 +26,8 @@ typedef struct X509_name_st X509_NAME;
 struct asn1_string_st;
 typedef struct asn1_string_st ASN1_TIME;
 
+class WvWorkPool;
+
 
 // workaround for the fact that OpenSSL initialization stuff must be called
 // only once.
@@ -126,6 +128,23 @@ public:
      */
     bool issuedbyca(WvX509 &cacert) const;
 
+    /**
+     * Check a batch of certificates, in DER format one after another in
+     * 'certs' (like WvX509Mgr::signreqs() makes them), against this CA
+     * certificate, the way their validate(this) would.  This
+     * certificate's key is only decoded once, and the checking is spread
+     * over the threads of 'pool' (or of WvWorkPool::global(), if it's
+     * NULL), but it doesn't return until it's all done.
+     *
+     * Everything in 'certs' gets used up.  If 'valid' isn't NULL,
+     * valid[n] says whether certificate n passed, for up to 'max' of
+     * them; anything that isn't a certificate fails, along with
+     * everything after it.  Returns the number of certificates that
+     * passed.
+     */
+    size_t validate_certs(WvBuf &certs, bool *valid = NULL, size_t max = 0,
+			  WvWorkPool *pool = NULL) const;
+
     /**
      * Verify that the contents of data were signed
      * by the certificate currently in cert. This only
@@ -11,6 +11,10 @@
 #include "wvx509.h"
 #include "wvcrl.h"
 
+struct evp_pkey_st;
+struct X509_req_st;
+class WvWorkPool;
+
 class WvX509Mgr : public WvX509
 {
   public:
@@ -53,6 +57,17 @@ class WvX509Mgr : public WvX509
      */
     WvX509Mgr(const WvX509Mgr &mgr);
 
+    typedef wv::function<void(WvX509Mgr *)> MgrCallback;
+
+    /**
+     * Like the constructor above, but it generates the key and signs the
+     * certificate on one of the threads of 'pool' (or of
+     * WvWorkPool::global(), if it's NULL), and then passes the new
+     * WvX509Mgr, which is yours to delete, to 'cb' in the main loop.
+     */
+    static void create_async(WvStringParm _dname, int bits, bool ca,
+			     const MgrCallback &cb, WvWorkPool *pool = NULL);
+
   protected:
     /**
      * Given the Distinguished Name dname and an already generated keypair in 
@@ -116,6 +131,39 @@ public:
      */
     bool signcrl(WvCRL &unsignedcrl) const;
 
+    typedef wv::function<void(bool)> SignCallback;
+    typedef wv::function<void(WvStringParm)> CertCallback;
+
+    /**
+     * Like signreq(), signcert() and signcrl(), but the signing itself
+     * happens on one of the threads of 'pool' (or of WvWorkPool::global(),
+     * if it's NULL), and 'cb' gets the result in the main loop instead.
+     * This WvX509Mgr, and the certificate or CRL being signed, have to
+     * stay around (and alone) until then.
+     */
+    void signreq_async(WvStringParm pkcs10req, const CertCallback &cb,
+		       WvWorkPool *pool = NULL) const;
+    void signcert_async(WvX509 &unsignedcert, const SignCallback &cb,
+			WvWorkPool *pool = NULL) const;
+    void signcrl_async(WvCRL &unsignedcrl, const SignCallback &cb,
+		       WvWorkPool *pool = NULL) const;
+
+    /**
+     * Sign a whole batch of PKCS#10 requests at once: 'pkcs10reqs' has
+     * them in PEM format, one after another (as you'd get by cat'ing the
+     * files together), and for each one, signreq() would have made, the
+     * new certificate is added to 'certs' in DER format.  Everything
+     * that's in 'pkcs10reqs' gets used up, but it stops at the first
+     * thing that isn't a request.
+     *
+     * The checks are only done once, and the signing is spread over the
+     * threads of 'pool' (or of WvWorkPool::global(), if it's NULL), but
+     * it doesn't return until it's all done.  Returns the number of
+     * certificates made.
+     */
+    size_t signreqs(WvBuf &pkcs10reqs, WvBuf &certs,
+		    WvWorkPool *pool = NULL) const;
+
     /**
      * Test to make sure that a certificate and a keypair go together.
      * You can call it if you want to test a certificate yourself. 
@@ -172,5 +220,26 @@ public:
     mutable WvRSAKey *rsa;
 
     mutable WvLog debug;
+
+    // The checks (and logging) before signing, which return the key to
+    // sign with, or NULL if it's not allowed; and the signing itself,
+    // which is safe to do on another thread.
+    struct evp_pkey_st *certsigner(const WvX509 &unsignedcert) const;
+    struct evp_pkey_st *crlsigner(WvCRL &crl) const;
+    WvX509 *certfromreq(WvStringParm pkcs10req) const;
+    WvX509 *certfromreq(struct X509_req_st *certreq) const;
+    static void sign_cert(X509 *cert, struct evp_pkey_st *certkey);
+    static void sign_crl(X509_CRL *crl, struct evp_pkey_st *certkey);
+
+    // a piece of signreqs(); see wvx509batch.cc
+    static void sign_certs(X509 **certs, size_t ncerts,
+			   struct evp_pkey_st *certkey);
+
+    // the *_async() pieces; see wvasynccrypto.cc
+    static void sign_job(X509 *cert, X509_CRL *crl,
+			 struct evp_pkey_st *certkey);
+    static void key_generated(WvStringParm dname, bool ca,
+			      struct rsa_st **result, const MgrCallback &cb,
+			      WvWorkPool *pool);
 };
 #endif
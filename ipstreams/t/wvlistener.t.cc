@@ -3,6 +3,10 @@
 #include "wvtcp.h"
 #include "wvtcplistener.h"
 #include "wvistreamlist.h"
+#include "wvunixsocket.h"
+#include "wvunixlistener.h"
+#include <sys/socket.h>
+#include <poll.h>
 
 class XListener : public WvListener
 {
@@ -54,3 +58,65 @@ WVTEST_MAIN("wvlistener")
     }
 }
 
+
+static bool readable(int fd)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, 1000) == 1;
+}
+
+
+WVTEST_MAIN("listener handoff")
+{
+    WvIPPortAddr config("127.0.0.1", 0);
+    WvString uds("/tmp/wvtest.wvlistener.%s", getpid());
+    WvTCPListener *old = new WvTCPListener(config);
+    WvUnixListener *oldunix = new WvUnixListener(uds, 0600);
+    WVPASS(old->isok());
+    WVPASS(oldunix->isok());
+    WvIPPortAddr port(*old->src());
+    
+    // somebody connects while we hand off; nobody's accepted it yet
+    WvTCPConn early(port);
+    
+    int sv[2];
+    WVPASS(!socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv));
+    WVPASSEQ(WvListener::send_handoff(sv[0]), 2);
+    WVPASSEQ(WvListener::receive_handoff(sv[1]), 2);
+    close(sv[0]);
+    close(sv[1]);
+    
+    WVPASSEQ(WvListener::close_handed_off(), 2);
+    WVPASS(old->handed_off);
+    WVPASS(!old->isok());
+    delete old;
+    delete oldunix;
+    
+    // listeners for the same addresses take over the sockets we were
+    // handed, and get the same port even though we asked for any
+    WvTCPListener *tcp = new WvTCPListener(config);
+    WvUnixListener *ulist = new WvUnixListener(uds, 0600);
+    WVPASS(tcp->isok());
+    WVPASS(ulist->isok());
+    WVPASSEQ(WvString(*tcp->src()), WvString(port));
+    WVPASSEQ(WvListener::close_inherited(), 0);
+    
+    // the connection that was waiting is still there
+    WVPASS(readable(tcp->getfd()));
+    IWvStream *s = tcp->accept();
+    WVPASS(s);
+    WVRELEASE(s);
+    
+    // and the socket file is too
+    WvUnixConn conn(uds);
+    WVPASS(conn.isok());
+    WVPASS(readable(ulist->getfd()));
+    s = ulist->accept();
+    WVPASS(s);
+    WVRELEASE(s);
+    
+    delete tcp;
+    delete ulist;
+}
@@ -385,9 +385,24 @@ void WvIPAddr::string_init(const char string[])
     for (int count=0; count < 4 && nptr; count++)
     {
 	iptr = nptr;
-	nptr = strchr(iptr, '.');
+	
+	// the usual case is a few digits and then a dot (or the end, or
+	// whatever comes after the last number), which we can do without
+	// strtol() or strchr().  Anything else gets the old treatment.
+	long val = 0;
+	for (nptr = iptr; *nptr >= '0' && *nptr <= '9' && nptr - iptr < 9;
+	     nptr++)
+	    val = val * 10 + (*nptr - '0');
+	if (nptr == iptr || (*nptr != '.' && *nptr && count < 3))
+	{
+	    val = strtol(iptr, NULL, 10);
+	    nptr = strchr(iptr, '.');
+	}
+	else if (*nptr != '.')
+	    nptr = NULL;
+	
 	if (nptr) nptr++;
-	*cptr++ = strtol(iptr, NULL, 10);
+	*cptr++ = val;
 	if (!nptr) break;
     }
 }
@@ -668,32 +683,38 @@ WvIPPortAddr::WvIPPortAddr(const WvIPAddr &_ipaddr, uint16_t _port)
 }
 
 
-static bool all_digits(const char *s)
-{
-    for (; *s; s++)
-	if (!isdigit((unsigned char)*s))
-	    return false;
-    return true;
-}
-
-
 // If no port is specified (after a ':' or a space or a tab) it defaults to 0.
 void WvIPPortAddr::string_init(const char string[]) 
 {
+    // find the separators and check for all digits in a single pass
+    const char *colon = NULL, *space = NULL, *tab = NULL;
+    bool digits = true;
+    for (const char *sptr = string; *sptr; sptr++)
+    {
+	if (*sptr >= '0' && *sptr <= '9')
+	    continue;
+	digits = false;
+	if (*sptr == ':')
+	{
+	    colon = sptr;
+	    break; // nothing else matters after the first colon
+	}
+	else if (*sptr == ' ' && !space)
+	    space = sptr;
+	else if (*sptr == '\t' && !tab)
+	    tab = sptr;
+    }
+    
     // special case for an all-numeric string: it must be just a port,
     // with default address 0.0.0.0.
-    if (all_digits(string))
+    if (digits)
     {
 	*this = WvIPAddr();
 	port = atoi(string);
 	return;
     }
     
-    const char *cptr = strchr(string, ':');
-    if (!cptr)
-	cptr = strchr(string, ' ');
-    if (!cptr)
-	cptr = strchr(string, '\t');
+    const char *cptr = colon ? colon : space ? space : tab;
 
     // avoid calling getservbyname() if we can avoid it, since it's really
     // slow and people like to create WvIPPortAddr objects really often.
@@ -9,6 +9,12 @@
 #include "wvistreamlist.h"
 #include "wvaddr.h"
 #include "wvmoniker.h"
+#include "wvlinklist.h"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 UUID_MAP_BEGIN(WvListener)
   UUID_MAP_ENTRY(IObject)
@@ -29,21 +35,255 @@ IWvListener *IWvListener::create(WvString moniker, IObject *obj)
 }
 
 
+DeclareWvList(WvListener);
+
+// the listeners that could be handed to another process.  Never deleted,
+// since listeners in the globallist can outlive any static of ours.
+static WvListenerList &handoff_listeners()
+{
+    static WvListenerList *list = new WvListenerList;
+    return *list;
+}
+
+
+struct WvInheritedFd
+{
+    WvString name;
+    int fd;
+    
+    WvInheritedFd(WvStringParm _name, int _fd)
+	: name(_name), fd(_fd)
+        { }
+};
+
+DeclareWvList(WvInheritedFd);
+
+// the sockets received from another process, until a listener takes them
+static WvInheritedFdList &inherited_fds()
+{
+    static WvInheritedFdList *list = new WvInheritedFdList;
+    return *list;
+}
+
+
 WvListener::WvListener(IWvStream *_cloned)
 {
     cloned = _cloned;
     wrapper = 0;
+    handed_off = false;
 }
     
 
 WvListener::~WvListener()
 {
+    if (!!handoff_name)
+	handoff_listeners().unlink(this);
     if (cloned)
 	WVRELEASE(cloned);
     WvIStreamList::globallist.unlink(this);
 }
 
 
+void WvListener::set_handoff_name(WvStringParm name)
+{
+    if (!handoff_name)
+	handoff_listeners().append(this, false);
+    handoff_name = name;
+}
+
+
+int WvListener::take_inherited(WvStringParm name)
+{
+    WvInheritedFdList::Iter i(inherited_fds());
+    for (i.rewind(); i.next(); )
+    {
+	if (i->name == name)
+	{
+	    int fd = i->fd;
+	    i.xunlink();
+	    return fd;
+	}
+    }
+    return -1;
+}
+
+
+int WvListener::inherited_socket(WvStringParm name, int domain)
+{
+    int fd = take_inherited(name);
+    return fd >= 0 ? fd : socket(domain, SOCK_STREAM, 0);
+}
+
+
+bool WvListener::is_listening(int fd)
+{
+    int listening = 0;
+    socklen_t len = sizeof(listening);
+    return fd >= 0
+	&& !getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len)
+	&& listening;
+}
+
+
+int WvListener::close_inherited()
+{
+    int count = 0;
+    WvInheritedFdList::Iter i(inherited_fds());
+    for (i.rewind(); i.next(); )
+    {
+	::close(i->fd);
+	i.xunlink();
+	count++;
+    }
+    return count;
+}
+
+
+int WvListener::close_handed_off()
+{
+    int count = 0;
+    WvListenerList::Iter i(handoff_listeners());
+    for (i.rewind(); i.next(); )
+    {
+	if (i->isok())
+	{
+	    i->handed_off = true;
+	    i->close();
+	    count++;
+	}
+    }
+    return count;
+}
+
+
+#ifndef _WIN32
+
+#ifdef MSG_CMSG_CLOEXEC
+# define RECV_FLAGS MSG_CMSG_CLOEXEC
+#else
+# define RECV_FLAGS 0
+#endif
+
+static bool send_fd(int sock, const char *name, int fd)
+{
+    struct iovec iov;
+    iov.iov_base = (void *)name;
+    iov.iov_len = strlen(name);
+    
+    union {
+	struct cmsghdr hdr;
+	char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd >= 0)
+    {
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    
+    ssize_t len;
+    do
+	len = sendmsg(sock, &msg, 0);
+    while (len < 0 && errno == EINTR);
+    return len == (ssize_t)iov.iov_len;
+}
+
+
+int WvListener::send_handoff(int sock)
+{
+    int count = 0;
+    WvListenerList::Iter i(handoff_listeners());
+    for (i.rewind(); i.next(); )
+    {
+	if (!i->isok())
+	    continue;
+	if (!send_fd(sock, i->handoff_name, i->getfd()))
+	    return -1;
+	count++;
+    }
+    
+    // a message with no fd means that's all of them
+    if (!send_fd(sock, "end", -1))
+	return -1;
+    return count;
+}
+
+
+int WvListener::receive_handoff(int sock)
+{
+    int count = 0;
+    for (;;)
+    {
+	char name[1024];
+	struct iovec iov;
+	iov.iov_base = name;
+	iov.iov_len = sizeof(name) - 1;
+	
+	union {
+	    struct cmsghdr hdr;
+	    char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+	
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+	
+	ssize_t len;
+	do
+	    len = recvmsg(sock, &msg, RECV_FLAGS);
+	while (len < 0 && errno == EINTR);
+	if (len < 0)
+	    return -1;
+	
+	int fd = -1;
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET
+	    && cmsg->cmsg_type == SCM_RIGHTS)
+	    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+	
+	name[len] = 0;
+	if (fd < 0)
+	{
+	    // the end marker, or the other end went away
+	    return !strcmp(name, "end") ? count : -1;
+	}
+	
+#ifndef MSG_CMSG_CLOEXEC
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+	inherited_fds().append(new WvInheritedFd(name, fd), true);
+	count++;
+    }
+}
+
+#else // _WIN32
+
+int WvListener::send_handoff(int sock)
+{
+    return -1;
+}
+
+
+int WvListener::receive_handoff(int sock)
+{
+    return -1;
+}
+
+#endif // _WIN32
+
+
 static IWvStream *wrapper_runner(IWvListenerWrapper wrapper,
 				 IWvStream *s)
 {
@@ -398,7 +398,8 @@ size_t WvTCPConn::uwrite(const void *buf, size_t count)
 
 
 WvTCPListener::WvTCPListener(const WvIPPortAddr &_listenport)
-	: WvListener(new WvFdStream(socket(PF_INET, SOCK_STREAM, 0)))
+	: WvListener(new WvFdStream(inherited_socket(
+			 WvString("tcp:%s", _listenport), PF_INET)))
 {
     WvFdStream *fds = (WvFdStream *)cloned;
     listenport = _listenport;
@@ -406,16 +407,22 @@ WvTCPListener::WvTCPListener(const WvIPPortAddr &_listenport)
     
     int x = 1;
 
+    // if the process we're taking over from was listening here, we got
+    // its socket, so nobody gets "connection refused" in between
+    bool inherited = is_listening(getfd());
+
     fds->set_close_on_exec(true);
     fds->set_nonblock(true);
     if (getfd() < 0
-	|| setsockopt(getfd(), SOL_SOCKET, SO_REUSEADDR, &x, sizeof(x))
-	|| bind(getfd(), sa, listenport.sockaddr_len())
-	|| listen(getfd(), 5))
+	|| (!inherited
+	    && (setsockopt(getfd(), SOL_SOCKET, SO_REUSEADDR, &x, sizeof(x))
+		|| bind(getfd(), sa, listenport.sockaddr_len())
+		|| listen(getfd(), 5))))
     {
 	seterr(errno);
 	return;
     }
+    set_handoff_name(WvString("tcp:%s", _listenport));
     
     if (listenport.port == 0) // auto-select a port number
     {
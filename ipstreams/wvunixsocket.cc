@@ -144,13 +144,15 @@ const WvUnixAddr *WvUnixConn::src() const
 
 
 WvUnixListener::WvUnixListener(const WvUnixAddr &_addr, int create_mode)
-	: WvListener(new WvFdStream(socket(PF_UNIX, SOCK_STREAM, 0))),
+	: WvListener(new WvFdStream(inherited_socket(
+			 WvString("unix:%s", _addr), PF_UNIX))),
           addr(_addr)
 {
     WvFdStream *fds = (WvFdStream *)cloned;
     
     mode_t oldmask;
     bound_okay = false;
+    WvString name("unix:%s", addr);
     
     if (getfd() < 0)
     {
@@ -161,6 +163,15 @@ WvUnixListener::WvUnixListener(const WvUnixAddr &_addr, int create_mode)
     fds->set_close_on_exec(true);
     fds->set_nonblock(true);
 
+    // if the process we're taking over from was listening here, we got
+    // its socket, so nobody gets "connection refused" in between
+    if (is_listening(getfd()))
+    {
+	bound_okay = true;
+	set_handoff_name(name);
+	return;
+    }
+
     sockaddr *sa = addr.sockaddr();
     size_t salen = addr.sockaddr_len();
     
@@ -181,7 +192,10 @@ WvUnixListener::WvUnixListener(const WvUnixAddr &_addr, int create_mode)
 	if (bind(getfd(), sa, salen) || listen(getfd(), 50))
 	    seterr(errno);
 	else
+	{
 	    bound_okay = true;
+	    set_handoff_name(name);
+	}
 
         umask(oldmask);
     }
@@ -201,7 +215,8 @@ void WvUnixListener::close()
     // delete the socket _before_ closing it.  Unix will keep
     // existing connections around anyway (if any), but if it's idle, then
     // we never have an existing not-in-use socket inode.
-    if (bound_okay)
+    // (Unless another process is still listening on it, of course.)
+    if (bound_okay && !handed_off)
     {
 	WvString filename(addr);
 	::unlink(filename);
@@ -9,6 +9,9 @@
  */ 
 #include "wvurl.h"
 #include "strutils.h"
+#include <ctype.h>
+
+#define URL_CACHE_SIZE 32
 
 // A static list of the default ports for each protocol.
 struct DefaultPort
@@ -31,16 +34,24 @@ static DefaultPort portmap[] = {
     { NULL, 0 }
 };
 
-// Look up the protocol and return the default port.
-static int get_default_port(WvString proto)
+// Find the protocol at the start of the given string.
+static DefaultPort *find_proto(const char *proto, size_t len)
 {
-    DefaultPort *p = portmap;
+    DefaultPort *p;
     for (p = portmap; p->proto != NULL; p++)
     {
-        if (strncmp(p->proto, proto, strlen(p->proto)) == 0)
-            return p->port;
+        size_t plen = strlen(p->proto);
+        if (plen <= len && strncmp(p->proto, proto, plen) == 0)
+            return p;
     }
-    return -1;
+    return NULL;
+}
+
+// Look up the protocol and return the default port.
+static int get_default_port(WvString proto)
+{
+    DefaultPort *p = find_proto(proto, proto.len());
+    return p ? p->port : -1;
 }
 
 // Look up the protocol and decide whether it uses slashes (http) or not (sip)
@@ -48,96 +59,208 @@ static int get_default_port(WvString proto)
 // these: 'hierarchical' vs. 'opaque'.
 static bool protocol_uses_slashes(WvString proto)
 {
-    DefaultPort *p = portmap;
-    for (p = portmap; p->proto != NULL; p++)
-    {
-        if (strncmp(p->proto, proto, strlen(p->proto)) == 0)
-            return p->uses_slashes;
-    }
-    return false;
+    DefaultPort *p = find_proto(proto, proto.len());
+    return p ? p->uses_slashes : false;
 }
 
+
+static void setpart(WvUrl::Parts::Part &part, const char *start,
+                    const char *end)
+{
+    part.str = start;
+    part.len = end - start;
+}
+
+
 // Split up the URL into a hostname, a port, and the rest of it.
-WvUrl::WvUrl(WvStringParm url) : err("No error")
+const char *WvUrl::parse(const char *url, Parts &parts)
 {
-    WvString work(url);
-    char *cptr, *wptr = work.edit();
-    
-    port = 0; // error condition by default
-    addr = NULL;
-    resolving = true;
-    
-    // deal with extra whitespace.
-    wptr = trim_string(wptr);
-    cptr = wptr + strcspn(wptr, " \t\r\n");
-    *cptr = 0;
+    // deal with extra whitespace: none at the start or the end, and stop
+    // at any in the middle.
+    const char *start = url ? url : "";
+    while (isspace((unsigned char)*start))
+        start++;
+    const char *end = start + strcspn(start, " \t\r\n");
+    if (!*end)
+    {
+        while (end > start && isspace((unsigned char)end[-1]))
+            end--;
+    }
 
     // if it's not one of these easy prefixes, give up.  Our URL parser is
     // pretty dumb.
-    if (get_default_port(wptr) < 0)
-    {
-	err = "WvUrl cannot handle the given protocol.";
-	return;
-    }
+    DefaultPort *p = find_proto(start, end - start);
+    if (!p)
+        return "WvUrl cannot handle the given protocol.";
 
-    cptr = strchr(wptr, ':');
+    const char *cptr = (const char *)memchr(start, ':', end - start);
     if (!cptr)
-    {
-        err = "No colon after the protocol.";
-        return;
-    }
-    *cptr = 0;
-    proto = wptr;
+        return "No colon after the protocol.";
+    setpart(parts.proto, start, cptr);
 
-    bool use_slashes = protocol_uses_slashes(proto);
-    wptr = cptr + (use_slashes ? 3 : 1);
+    const char *wptr = cptr + 1;
+    if (p->uses_slashes)
+        wptr = end - wptr > 2 ? wptr + 2 : end;
 
-    cptr = strchr(wptr, '@');
+    cptr = (const char *)memchr(wptr, '@', end - wptr);
     if (!cptr) // no user given
     {
-        user = "";
-	password = "";
+        setpart(parts.user, wptr, wptr);
+        setpart(parts.password, wptr, wptr);
     }
     else
     {
-        *cptr = 0;
-	char *cptr2 = strchr(wptr, ':');
-	if (cptr2 && (*(cptr2+1) != 0))
-	{
-	    *cptr2 = 0;
-	    password = cptr2 + 1;
-	}
-	else
-	    password = ""; 
-        user = wptr;
+        const char *cptr2 = (const char *)memchr(wptr, ':', cptr - wptr);
+        if (cptr2 && cptr2 + 1 != cptr)
+        {
+            setpart(parts.user, wptr, cptr2);
+            setpart(parts.password, cptr2 + 1, cptr);
+        }
+        else
+        {
+            setpart(parts.user, wptr, cptr);
+            setpart(parts.password, cptr, cptr);
+        }
         wptr = cptr + 1;
     }
-    
-    cptr = strchr(wptr, '/');
-    if (!cptr) // no path given
-	file = use_slashes ? "/" : "";
-    else
+
+    const char *hostend = (const char *)memchr(wptr, '/', end - wptr);
+    if (!hostend) // no path given
     {
-	file = cptr;
-	*cptr = 0;
+        parts.file.str = p->uses_slashes ? "/" : "";
+        parts.file.len = p->uses_slashes ? 1 : 0;
+        hostend = end;
     }
-    
-    cptr = strchr(wptr, ':');
+    else
+        setpart(parts.file, hostend, end);
+
+    cptr = (const char *)memchr(wptr, ':', hostend - wptr);
     if (!cptr)
-	port = get_default_port(proto);
+    {
+        parts.port = p->port;
+        cptr = hostend;
+    }
     else
+        parts.port = atoi(cptr + 1); // stops at the '/' or the end
+
+    setpart(parts.host, wptr, cptr);
+    return NULL;
+}
+
+
+// A WvString that starts partway into another one's buffer, so that all
+// the strings in a WvUrl can share one.
+class WvUrlPart : public WvString
+{
+public:
+    WvUrlPart()
+        { }
+    WvUrlPart(const WvUrlPart &whole, size_t offset)
     {
-	port = atoi(cptr+1);
-	*cptr = 0;
+        unlink();
+        link(whole.buf, whole.str + offset);
     }
+};
 
-    hostname = wptr;
+
+// The last few URLs we parsed, so parsing the same ones over and over (as
+// WvHttpPool does, for every request to the same server) is cheap.
+struct WvUrlCacheEntry
+{
+    WvString url;       // exactly as it was given to us
+    unsigned hash;
+    WvUrlPart parts;    // proto, user, password, host and file, each
+                        // followed by a nul
+    size_t user, password, host, file; // where each starts in 'parts'
+    int port;
+    unsigned long used; // for throwing out the least recently used one
+};
+
+static WvUrlCacheEntry url_cache[URL_CACHE_SIZE];
+static unsigned long url_cache_clock;
+
+static const WvString no_error("No error");
+
+
+static WvUrlCacheEntry *url_cache_find(WvStringParm url, unsigned hash)
+{
+    for (int i = 0; i < URL_CACHE_SIZE; i++)
+    {
+        WvUrlCacheEntry &e = url_cache[i];
+        if (e.hash == hash && !e.url.isnull() && !strcmp(e.url, url))
+            return &e;
+    }
+    return NULL;
+}
+
+
+static size_t addpart(char *&cptr, const char *start,
+                      const WvUrl::Parts::Part &part)
+{
+    size_t offset = cptr - start;
+    memcpy(cptr, part.str, part.len);
+    cptr += part.len;
+    *cptr++ = 0;
+    return offset;
+}
+
+
+static WvUrlCacheEntry *url_cache_add(WvStringParm url, unsigned hash,
+                                      const WvUrl::Parts &p)
+{
+    WvUrlCacheEntry *e = &url_cache[0];
+    for (int i = 1; i < URL_CACHE_SIZE; i++)
+        if (url_cache[i].used < e->used)
+            e = &url_cache[i];
+
+    e->url = url;
+    e->hash = hash;
+    e->parts.setsize(p.proto.len + p.user.len + p.password.len + p.host.len
+                     + p.file.len + 5);
+    char *start = e->parts.edit(), *cptr = start;
+    addpart(cptr, start, p.proto);
+    e->user = addpart(cptr, start, p.user);
+    e->password = addpart(cptr, start, p.password);
+    e->host = addpart(cptr, start, p.host);
+    e->file = addpart(cptr, start, p.file);
+    e->port = p.port;
+    return e;
+}
+
+
+WvUrl::WvUrl(WvStringParm url) : err(no_error)
+{
+    port = 0; // error condition by default
+    addr = NULL;
+    resolving = true;
+
+    unsigned hash = WvHash(url);
+    WvUrlCacheEntry *e = url.isnull() ? NULL : url_cache_find(url, hash);
+    if (!e)
+    {
+        Parts p;
+        const char *error = parse(url, p);
+        if (error)
+        {
+            err = error;
+            return;
+        }
+        e = url_cache_add(url, hash, p);
+    }
+    e->used = ++url_cache_clock;
+
+    proto = e->parts;
+    user = WvUrlPart(e->parts, e->user);
+    password = WvUrlPart(e->parts, e->password);
+    hostname = WvUrlPart(e->parts, e->host);
+    file = WvUrlPart(e->parts, e->file);
+    port = e->port;
 
     resolve();
 }
 
 
-WvUrl::WvUrl(const WvUrl &url) : err("No error")
+WvUrl::WvUrl(const WvUrl &url) : err(no_error)
 {
     addr = NULL;
     resolving = true;
@@ -159,11 +282,43 @@ WvUrl::~WvUrl()
 }
 
 
+// True if it's a dotted quad, which doesn't need a DNS lookup.
+static bool is_ipaddr(const char *host)
+{
+    if (!host)
+        return false;
+    for (int count = 0; count < 4; count++)
+    {
+        int val = 0, digits = 0;
+        for (; *host >= '0' && *host <= '9'; host++)
+        {
+            val = val * 10 + (*host - '0');
+            if (++digits > 3)
+                return false;
+        }
+        if (!digits || val > 255 || *host != (count < 3 ? '.' : 0))
+            return false;
+        host++;
+    }
+    return true;
+}
+
+
 bool WvUrl::resolve()
 {
     const WvIPAddr *ip;
     int numaddrs;
     
+    if (addr)
+        return true; // already done
+
+    if (is_ipaddr(hostname))
+    {
+        resolving = false;
+        addr = new WvIPPortAddr(WvIPAddr(hostname), port);
+        return true;
+    }
+
     numaddrs = dns.findaddr(0, hostname, &ip);
     if (!numaddrs) // error condition
     {
@@ -179,7 +334,6 @@ bool WvUrl::resolve()
     else // got at least one address
     {
 	resolving = false;
-	if (addr) delete addr;
 	addr = new WvIPPortAddr(*ip, port);
 	return true;
     }
@@ -0,0 +1,108 @@
+#include "wvtest.h"
+#include "wvuringfile.h"
+#include "wvfileutils.h"
+
+// The n'th line of the test file
+static WvString line(int n)
+{
+    return WvString("line %s of the file, padded out a little bit\n", n);
+}
+
+
+WVTEST_MAIN("uring file write and read")
+{
+    WvString filename = wvtmpfilename("wvuringfile-test");
+    const int nlines = 5000;
+
+    {
+	// small buffers, so it has to juggle a lot of them
+	WvUringFile f(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666, 4096, 4);
+	WVPASS(f.isok());
+	for (int n = 0; n < nlines; n++)
+	    f.print(line(n));
+    }
+
+    WvString expect("");
+    for (int n = 0; n < nlines; n++)
+	expect.append(line(n));
+    {
+	FILE *fp = fopen(filename, "r");
+	WvString got;
+	got.setsize(expect.len() + 100);
+	size_t len = fread(got.edit(), 1, expect.len() + 100, fp);
+	got.edit()[len] = 0;
+	fclose(fp);
+	WVPASSEQ(len, expect.len());
+	WVPASS(got == expect);
+    }
+
+    {
+	WvUringFile f(filename, O_RDONLY, 0666, 4096, 4);
+	WVPASS(f.isok());
+	int n = 0, bad = 0;
+	while (f.isok())
+	{
+	    char *s = f.blocking_getline(1000);
+	    if (!s)
+		continue;
+	    if (WvString("%s\n", s) != line(n))
+		bad++;
+	    n++;
+	}
+	WVPASSEQ(n, nlines);
+	WVPASSEQ(bad, 0);
+    }
+
+    // reading it all through the main loop, the way autoforward would
+    {
+	WvUringFile f(filename, O_RDONLY, 0666, 4096, 4);
+	WvDynBuf all;
+	while (f.isok())
+	{
+	    if (!f.select(1000, true, false))
+		continue;
+	    char buf[3000];
+	    all.put(buf, f.read(buf, sizeof(buf)));
+	}
+	WVPASSEQ(all.used(), expect.len());
+	WVPASS(all.getstr() == expect);
+    }
+
+    unlink(filename);
+}
+
+
+WVTEST_MAIN("uring file append")
+{
+    WvString filename = wvtmpfilename("wvuringfile-test");
+    {
+	WvUringFile f(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666, 4096, 4);
+	f.print("first\n");
+    }
+    for (int n = 0; n < 3; n++)
+    {
+	WvUringFile f(filename, O_WRONLY | O_APPEND, 0666, 4096, 4);
+	for (int i = 0; i < 100; i++)
+	    f.print("%s.%s\n", n, i);
+    }
+
+    WvUringFile f(filename, O_RDONLY);
+    WVPASSEQ(f.blocking_getline(1000), "first");
+    WVPASSEQ(f.blocking_getline(1000), "0.0");
+    for (int i = 0; i < 298; i++)
+	f.blocking_getline(1000);
+    WVPASSEQ(f.blocking_getline(1000), "2.99");
+    WVPASSEQ(f.blocking_getline(1000), NULL);
+    unlink(filename);
+}
+
+
+WVTEST_MAIN("uring file that isn't a file")
+{
+    // not a regular file, so it's just a WvFile
+    WvUringFile f("/dev/null", O_RDWR);
+    WVPASS(f.isok());
+    WVFAIL(f.usinguring());
+    f.print("nothing\n");
+    WVPASS(f.isok());
+}
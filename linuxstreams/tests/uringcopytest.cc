@@ -0,0 +1,123 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast one main loop can send several files down several
+ * sockets at once, reading them through WvFile and through WvUringFile.
+ *
+ *     uringcopytest [files [megabytes-each [warm]]]
+ *
+ * The files are dropped from the page cache before each run (unless you
+ * say "warm"), so the reads have to wait for the disk; that's when a
+ * WvFile holds up everything else in the loop.
+ */
+#include "wvuringfile.h"
+#include "wvistreamlist.h"
+#include "wvfileutils.h"
+#include "wvtimeutils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+static size_t received;
+
+
+static void forward(WvStream &in, WvStream &out)
+{
+    char buf[65536];
+    size_t len = in.read(buf, sizeof(buf));
+    if (len)
+        out.write(buf, len);
+    if (!in.isok())
+        out.flush_then_close(10000);
+}
+
+
+static void drain(WvStream &s)
+{
+    char buf[65536];
+    received += s.read(buf, sizeof(buf));
+}
+
+
+static void uncache(const WvStringList &names)
+{
+    WvStringList::Iter i(names);
+    for (i.rewind(); i.next(); )
+    {
+        int fd = open(*i, O_RDONLY);
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+
+static void run(const char *what, bool uring, const WvStringList &names,
+                size_t total, bool warm)
+{
+    if (!warm)
+        uncache(names);
+
+    WvIStreamList l;
+    WvStringList::Iter i(names);
+    for (i.rewind(); i.next(); )
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        WvFdStream *sender = new WvFdStream(fds[0]);
+        WvFdStream *receiver = new WvFdStream(fds[1]);
+        WvStream *file = uring
+            ? (WvStream *)new WvUringFile(*i, O_RDONLY, 0666, 65536, 8)
+            : (WvStream *)new WvFile(*i, O_RDONLY);
+        file->read_requires_writable = sender;
+        file->setcallback(wv::bind(forward, wv::ref(*file), wv::ref(*sender)));
+        receiver->setcallback(wv::bind(drain, wv::ref(*receiver)));
+        l.append(file, true, "file");
+        l.append(sender, true, "sender");
+        l.append(receiver, true, "receiver");
+    }
+
+    received = 0;
+    WvTime start = wvtime();
+    while (received < total)
+        l.runonce(1000);
+    double secs = msecdiff(wvtime(), start) / 1000.0;
+    printf("%-12s %8.1f MB/sec\n", what, total / secs / 1024 / 1024);
+}
+
+
+int main(int argc, char **argv)
+{
+    int nfiles = argc > 1 ? atoi(argv[1]) : 8;
+    size_t megs = argc > 2 ? atoi(argv[2]) : 64;
+    bool warm = argc > 3 && !strcmp(argv[3], "warm");
+
+    WvStringList names;
+    char block[65536];
+    memset(block, 'x', sizeof(block));
+    for (int n = 0; n < nfiles; n++)
+    {
+        WvString name(wvtmpfilename("uringcopytest"));
+        FILE *f = fopen(name, "w");
+        for (size_t k = 0; k < megs * 16; k++)
+            fwrite(block, sizeof(block), 1, f);
+        fclose(f);
+        names.append(name);
+    }
+    size_t total = nfiles * megs * 1024 * 1024;
+    printf("%d files of %lu MB, %s\n", nfiles, (unsigned long)megs,
+           warm ? "in the page cache" : "not in the page cache");
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        run("WvFile", false, names, total, warm);
+        run("WvUringFile", true, names, total, warm);
+    }
+
+    WvStringList::Iter i(names);
+    for (i.rewind(); i.next(); )
+        unlink(*i);
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A thin wrapper around a Linux io_uring.  See wviouring.h.
+ *
+ * There's no liburing here, just the system calls: the kernel shares two
+ * rings with us, one of requests (which we fill and it empties) and one of
+ * completions (which it fills and we empty), and each side only ever
+ * moves its own end of each ring.
+ */
+#include "wviouring.h"
+#include "wvautoconf.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+
+#define PTR(base, off) ((unsigned *)((char *)(base) + (off)))
+
+
+WvIoUring::WvIoUring(unsigned entries)
+{
+    sqring = cqring = MAP_FAILED;
+    sqringsize = cqringsize = sqessize = 0;
+    sqes = (struct io_uring_sqe *)MAP_FAILED;
+    queued = 0;
+    registered = plainrw = false;
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0)
+    {
+        seterr(errno);
+        return;
+    }
+
+    sqringsize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqringsize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    sqessize = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    // newer kernels put both rings in one mapping
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (cqringsize > sqringsize)
+            sqringsize = cqringsize;
+        cqringsize = 0;
+    }
+    sqring = mmap(NULL, sqringsize, PROT_READ|PROT_WRITE,
+                  MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (cqringsize)
+        cqring = mmap(NULL, cqringsize, PROT_READ|PROT_WRITE,
+                      MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    else
+        cqring = sqring;
+    sqes = (struct io_uring_sqe *)mmap(NULL, sqessize, PROT_READ|PROT_WRITE,
+                                       MAP_SHARED|MAP_POPULATE, fd,
+                                       IORING_OFF_SQES);
+    if (sqring == MAP_FAILED || cqring == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        seterr(errno);
+        return;
+    }
+
+    sqhead = PTR(sqring, p.sq_off.head);
+    sqtail = PTR(sqring, p.sq_off.tail);
+    sqmask = PTR(sqring, p.sq_off.ring_mask);
+    sqentries = PTR(sqring, p.sq_off.ring_entries);
+    sqarray = PTR(sqring, p.sq_off.array);
+    cqhead = PTR(cqring, p.cq_off.head);
+    cqtail = PTR(cqring, p.cq_off.tail);
+    cqmask = PTR(cqring, p.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)((char *)cqring + p.cq_off.cqes);
+
+    // there's no probing before 5.6 either, so failing means they're not
+    // there
+    size_t probesize = sizeof(struct io_uring_probe)
+        + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, probesize);
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+                probe, 256) == 0)
+        plainrw = probe->last_op >= IORING_OP_WRITE
+            && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+            && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+}
+
+
+WvIoUring::~WvIoUring()
+{
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqessize);
+    if (cqring != MAP_FAILED && cqring != sqring)
+        munmap(cqring, cqringsize);
+    if (sqring != MAP_FAILED)
+        munmap(sqring, sqringsize);
+    if (fd >= 0)
+        close(fd);
+}
+
+
+bool WvIoUring::register_buffers(const struct iovec *iov, unsigned count)
+{
+    if (!isok())
+        return false;
+    registered = syscall(__NR_io_uring_register, fd,
+                         IORING_REGISTER_BUFFERS, iov, count) == 0;
+    return registered;
+}
+
+
+bool WvIoUring::queue(int opcode, int rwfd, const void *buf, size_t len,
+                      off_t offset, uint64_t tag, int bufindex)
+{
+    if (!isok())
+        return false;
+
+    unsigned tail = *sqtail;
+    if (tail - __atomic_load_n(sqhead, __ATOMIC_ACQUIRE) >= *sqentries)
+        return false;
+
+    unsigned idx = tail & *sqmask;
+    struct io_uring_sqe *sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = rwfd;
+    sqe->off = offset;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = len;
+    sqe->user_data = tag;
+    if (bufindex >= 0 && registered)
+    {
+        sqe->opcode = (opcode == IORING_OP_READ)
+            ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = bufindex;
+    }
+    sqarray[idx] = idx;
+
+    // the kernel mustn't see the new tail before the request it points to
+    __atomic_store_n(sqtail, tail + 1, __ATOMIC_RELEASE);
+    queued++;
+    return true;
+}
+
+
+bool WvIoUring::read(int rfd, void *buf, size_t len, off_t offset,
+                     uint64_t tag, int bufindex)
+{
+    return queue(IORING_OP_READ, rfd, buf, len, offset, tag, bufindex);
+}
+
+
+bool WvIoUring::write(int wfd, const void *buf, size_t len, off_t offset,
+                      uint64_t tag, int bufindex)
+{
+    return queue(IORING_OP_WRITE, wfd, buf, len, offset, tag, bufindex);
+}
+
+
+bool WvIoUring::submit(bool wait)
+{
+    if (!isok())
+        return false;
+    if (!queued && !wait)
+        return true;
+
+    int ret;
+    do
+    {
+        ret = syscall(__NR_io_uring_enter, fd, queued, wait ? 1 : 0,
+                      wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0)
+    {
+        if (errno == EAGAIN || errno == EBUSY)
+            return false; // try again once some have completed
+        seterr(errno);
+        return false;
+    }
+    queued -= ret < (int)queued ? ret : queued;
+    return true;
+}
+
+
+bool WvIoUring::complete(uint64_t &tag, int &result)
+{
+    if (!isok())
+        return false;
+
+    unsigned head = *cqhead;
+    if (head == __atomic_load_n(cqtail, __ATOMIC_ACQUIRE))
+        return false;
+
+    struct io_uring_cqe *cqe = &cqes[head & *cqmask];
+    tag = cqe->user_data;
+    result = cqe->res;
+
+    // now the kernel can reuse the slot
+    __atomic_store_n(cqhead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else // !HAVE_LINUX_IO_URING_H
+
+WvIoUring::WvIoUring(unsigned entries)
+{
+    fd = -1;
+    registered = plainrw = false;
+    seterr(ENOSYS);
+}
+
+
+WvIoUring::~WvIoUring()
+{
+}
+
+
+bool WvIoUring::register_buffers(const struct iovec *iov, unsigned count)
+{
+    return false;
+}
+
+
+bool WvIoUring::read(int rfd, void *buf, size_t len, off_t offset,
+                     uint64_t tag, int bufindex)
+{
+    return false;
+}
+
+
+bool WvIoUring::write(int wfd, const void *buf, size_t len, off_t offset,
+                      uint64_t tag, int bufindex)
+{
+    return false;
+}
+
+
+bool WvIoUring::submit(bool wait)
+{
+    return false;
+}
+
+
+bool WvIoUring::complete(uint64_t &tag, int &result)
+{
+    return false;
+}
+
+#endif // HAVE_LINUX_IO_URING_H
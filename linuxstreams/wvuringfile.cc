@@ -0,0 +1,433 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A WvFile that reads and writes through io_uring.  See wvuringfile.h.
+ */
+#include "wvuringfile.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+WvUringFile::WvUringFile(WvStringParm filename, int mode, int create_mode,
+                         size_t _bufsize, int _nbufs) :
+    WvFile(filename, mode, create_mode),
+    bufsize(_bufsize), nbufs(_nbufs)
+{
+    setup();
+}
+
+
+WvUringFile::~WvUringFile()
+{
+    close();
+}
+
+
+void WvUringFile::setup()
+{
+    ring = NULL;
+    mem = NULL;
+    bufs = NULL;
+    inflight = 0;
+    roff = rnext = woff = 0;
+    rshort = reof = append = false;
+
+    struct stat st;
+    int fd = getrfd();
+    if (!isok() || fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return; // offsets don't mean anything, so just be a WvFile
+
+    if (nbufs < 2)
+        nbufs = 2;
+    if (!bufsize)
+        bufsize = 65536;
+    nread = !readable ? 0 : !writable ? nbufs : nbufs / 2;
+
+    ring = new WvIoUring(nbufs);
+    void *p;
+    if (!ring->isok()
+        || posix_memalign(&p, getpagesize(), nbufs * bufsize) != 0)
+    {
+        delete ring;
+        ring = NULL;
+        return;
+    }
+
+    mem = (unsigned char *)p;
+    bufs = new Buf[nbufs];
+    struct iovec *iov = new struct iovec[nbufs];
+    for (int n = 0; n < nbufs; n++)
+    {
+        bufs[n].data = mem + n * bufsize;
+        bufs[n].state = Free;
+        bufs[n].offset = 0;
+        bufs[n].len = bufs[n].done = 0;
+        bufs[n].stale = false;
+        iov[n].iov_base = bufs[n].data;
+        iov[n].iov_len = bufsize;
+    }
+    ring->register_buffers(iov, nbufs);
+    delete[] iov;
+    if (!ring->canrw())
+    {
+        teardown(); // nothing's in flight yet
+        return;
+    }
+
+    roff = rnext = lseek(fd, 0, SEEK_CUR);
+    append = fcntl(fd, F_GETFL) & O_APPEND;
+    woff = append ? st.st_size : roff;
+}
+
+
+void WvUringFile::teardown()
+{
+    if (!ring)
+        return;
+
+    // the kernel might still be using the buffers
+    uint64_t tag;
+    int result;
+    while (inflight > 0 && ring->submit(true))
+        while (ring->complete(tag, result))
+            inflight--;
+
+    delete ring;
+    ring = NULL;
+    free(mem);
+    mem = NULL;
+    delete[] bufs;
+    bufs = NULL;
+}
+
+
+void WvUringFile::close()
+{
+    WvFile::close();
+    teardown();
+}
+
+
+void WvUringFile::start_reads()
+{
+    if (!ring || !readable || rshort || reof || getrfd() < 0)
+        return;
+
+    for (int n = 0; n < nread; n++)
+    {
+        Buf &b = bufs[n];
+        if (b.state != Free)
+            continue;
+        if (!ring->read(getrfd(), b.data, bufsize, roff, n, n))
+            break;
+        b.state = InFlight;
+        b.offset = roff;
+        b.len = b.done = 0;
+        b.stale = false;
+        roff += bufsize;
+        inflight++;
+    }
+}
+
+
+void WvUringFile::start_write(int n)
+{
+    Buf &b = bufs[n];
+    if (ring->write(getwfd(), b.data + b.done, b.len - b.done,
+                    b.offset + b.done, n, n))
+    {
+        b.state = InFlight;
+        inflight++;
+    }
+    else
+        b.state = Done; // written but not sent; reap() tries again
+}
+
+
+bool WvUringFile::reap()
+{
+    bool any = false;
+    uint64_t tag;
+    int result;
+    while (ring && ring->complete(tag, result))
+    {
+        any = true;
+        inflight--;
+        Buf &b = bufs[tag];
+        bool retry = result == -EINTR || result == -EAGAIN;
+
+        if ((int)tag < nread)
+        {
+            if (b.stale)
+                b.state = Free;
+            else if (retry)
+            {
+                b.state = Free;
+                if (ring->read(getrfd(), b.data, bufsize, b.offset, tag, tag))
+                {
+                    b.state = InFlight;
+                    inflight++;
+                }
+                else
+                    seterr(EAGAIN);
+            }
+            else if (result < 0)
+            {
+                b.state = Free;
+                seterr(-result);
+            }
+            else
+            {
+                b.state = Done;
+                b.len = result;
+                b.done = 0;
+                if ((size_t)result < bufsize)
+                {
+                    // the file ends here, at least for now, so anything
+                    // read from after here is wrong
+                    for (int n = 0; n < nread; n++)
+                    {
+                        if (bufs[n].offset <= b.offset)
+                            continue;
+                        if (bufs[n].state == InFlight)
+                            bufs[n].stale = true;
+                        else
+                            bufs[n].state = Free;
+                    }
+                    roff = b.offset + result;
+                    rshort = true;
+                }
+            }
+        }
+        else
+        {
+            if (result > 0)
+                b.done += result;
+            if (result < 0 && !retry)
+            {
+                b.state = Free;
+                seterr(-result);
+            }
+            else if (result == 0)
+            {
+                b.state = Free;
+                seterr(EIO);
+            }
+            else if (b.done < b.len)
+                start_write(tag);
+            else
+                b.state = Free;
+        }
+    }
+
+    // writes that didn't fit in the queue last time
+    for (int n = nread; ring && n < nbufs; n++)
+        if (bufs[n].state == Done)
+            start_write(n);
+    return any;
+}
+
+
+WvUringFile::Buf *WvUringFile::nextread() const
+{
+    for (int n = 0; n < nread; n++)
+    {
+        Buf &b = bufs[n];
+        if (b.state == Done && !b.stale && b.offset + (off_t)b.done == rnext)
+            return &b;
+    }
+    return NULL;
+}
+
+
+bool WvUringFile::writeready() const
+{
+    for (int n = nread; n < nbufs; n++)
+    {
+        if (bufs[n].state == Free)
+            continue;
+        if (append)
+            return false; // one at a time, or they might land out of order
+    }
+    for (int n = nread; n < nbufs; n++)
+        if (bufs[n].state == Free)
+            return true;
+    return false;
+}
+
+
+size_t WvUringFile::uread(void *buf, size_t count)
+{
+    if (!ring)
+        return WvFile::uread(buf, count);
+    assert(!count || buf);
+    if (!count || !buf || !isok())
+        return 0;
+
+    reap();
+    size_t total = 0;
+    Buf *b;
+    while (total < count && (b = nextread()) != NULL)
+    {
+        if (!b->len)
+        {
+            reof = true;
+            b->state = Free;
+            break;
+        }
+        size_t len = b->len - b->done;
+        if (len > count - total)
+            len = count - total;
+        memcpy((unsigned char *)buf + total, b->data + b->done, len);
+        b->done += len;
+        rnext += len;
+        total += len;
+        if (b->done == b->len)
+        {
+            b->state = Free;
+            if (b->len < bufsize)
+                rshort = false; // caught up; see if there's more now
+        }
+    }
+
+    start_reads();
+    ring->submit();
+
+    // a read that returns zero bytes signifies end-of-file (EOF).
+    if (!total && reof)
+        seterr(0);
+    return total;
+}
+
+
+size_t WvUringFile::uwrite(const void *buf, size_t count)
+{
+    if (!ring)
+        return WvFile::uwrite(buf, count);
+    assert(!count || buf);
+    if (!buf || !count || !isok())
+        return 0;
+
+    reap();
+    size_t total = 0;
+    for (int n = nread; n < nbufs && total < count && writeready(); n++)
+    {
+        Buf &b = bufs[n];
+        if (b.state != Free)
+            continue;
+        size_t len = count - total;
+        if (len > bufsize)
+            len = bufsize;
+        memcpy(b.data, (const unsigned char *)buf + total, len);
+        b.offset = woff;
+        b.len = len;
+        b.done = 0;
+        woff += len;
+        total += len;
+        start_write(n);
+    }
+    ring->submit();
+    return total;
+}
+
+
+bool WvUringFile::flush_internal(time_t msec_timeout)
+{
+    if (!ring)
+        return WvFile::flush_internal(msec_timeout);
+
+    // not flush_outbuf(), which can end up back here
+    WvTime stoptime = msecadd(wvtime(), msec_timeout);
+    for (;;)
+    {
+        reap();
+        while (outbuf.used() && writeready() && isok())
+        {
+            size_t attempt = outbuf.optgettable();
+            size_t real = uwrite(outbuf.get(attempt), attempt);
+            outbuf.unget(attempt - real);
+            if (!real)
+                break;
+        }
+
+        bool writing = outbuf.used();
+        for (int n = nread; n < nbufs; n++)
+            if (bufs[n].state != Free)
+                writing = true;
+        if (!writing || !isok())
+            return !writing;
+        if (!msec_timeout || (msec_timeout > 0 && stoptime < wvtime()))
+            return false;
+        if (!ring->submit(true)) // wait for something to finish
+            return false;
+    }
+}
+
+
+void WvUringFile::pre_select(SelectInfo &si)
+{
+    if (!ring)
+    {
+        WvFile::pre_select(si);
+        return;
+    }
+
+    // not WvFdStream's: select() always says the file itself is ready
+    WvStream::pre_select(si);
+
+    reap();
+    if (si.wants.readable && readable)
+    {
+        start_reads();
+        if (readready())
+            si.msec_timeout = 0;
+    }
+    if ((si.wants.writable || outbuf.used() || autoclose_time)
+        && writable && writeready())
+        si.msec_timeout = 0;
+    ring->submit();
+
+    if (inflight)
+    {
+        FD_SET(ring->getfd(), &si.read);
+        if (si.max_fd < ring->getfd())
+            si.max_fd = ring->getfd();
+    }
+}
+
+
+bool WvUringFile::post_select(SelectInfo &si)
+{
+    if (!ring)
+        return WvFile::post_select(si);
+
+    bool result = WvStream::post_select(si);
+    if (reap())
+        ring->submit();
+    bool val = (si.wants.readable && readable && readready())
+        || (si.wants.writable && writable && writeready());
+
+    // flush the output buffer if possible
+    if ((outbuf.used() || autoclose_time) && writable && writeready()
+        && should_flush())
+    {
+        flush_outbuf(0);
+
+        // flush_outbuf() might have closed the file!
+        if (!isok() || !ring)
+            return result;
+    }
+
+    if (val && si.wants.readable && read_requires_writable
+      && read_requires_writable->isok()
+      && !read_requires_writable->select(0, false, true))
+        return result;
+    if (val && si.wants.writable && write_requires_readable
+      && write_requires_readable->isok()
+      && !write_requires_readable->select(0, true, false))
+        return result;
+    return val || result;
+}
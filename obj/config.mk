@@ -0,0 +1,65 @@
+EXEEXT=
+CC=gcc
+CFLAGS=
+CPP=gcc -E
+CPPFLAGS=
+CXX=g++
+CXXCPP=g++ -E
+CXXFLAGS=
+INSTALL=/usr/bin/install -c
+INSTALL_DATA=${INSTALL} -m 644
+INSTALL_PROGRAM=${INSTALL}
+INSTALL_SCRIPT=${INSTALL}
+LDFLAGS=
+LN_S=ln -s
+LN=ln
+MOC=
+VALGRIND=
+WVPACKAGE_BUGREPORT=wvstreams-devel@googlegroups.com
+WVPACKAGE_NAME=WvStreams
+WVPACKAGE_STRING=WvStreams 4.6
+WVPACKAGE_TARNAME=wvstreams
+WVPACKAGE_VERSION=4.6
+COMPILER_STANDARD=posix
+SO_VERSION=4.6
+
+USE_WVSTREAMS_ARGP=0
+
+target=x86_64-unknown-linux-gnu
+OS=LINUX
+ARCH_SUBDIRS=linuxstreams
+LIBS=-lz -lreadline 
+LIBS_DBUS=
+LIBS_QT=
+LIBS_PAM=
+LIBS_TCL=
+
+prefix=/usr/local
+datarootdir=${prefix}/share
+datadir=${datarootdir}
+includedir=${prefix}/include
+infodir=${datarootdir}/info
+localstatedir=${prefix}/var
+mandir=${datarootdir}/man
+sharedstatedir=${prefix}/com
+sysconfdir=${prefix}/etc
+
+exec_prefix=${prefix}
+bindir=${exec_prefix}/bin
+libdir=${exec_prefix}/lib
+libexecdir=${exec_prefix}/libexec
+sbindir=${exec_prefix}/sbin
+
+enable_debug=
+enable_optimization=
+enable_resolver_fork=
+enable_warnings=
+enable_testgui=
+
+with_dbus=no
+with_openssl=
+with_pam=no
+with_tcl=no
+with_readline=
+with_qt=no
+with_zlib=
@@ -0,0 +1,268 @@
+#include "wvtest.h"
+#include "wvbinlogfile.h"
+#include "wvfileutils.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// Collects decoded messages as "source<level>: text" lines
+class TextLog : public WvLogRcv
+{
+public:
+    WvDynBuf out;
+
+    TextLog() : WvLogRcv(WvLog::NUM_LOGLEVELS)
+        { }
+    WvString text()
+        { end_line(); return out.getstr(); }
+
+protected:
+    virtual void _mid_line(const char *str, size_t len)
+        { out.put(str, len); }
+};
+
+
+static size_t filesize(WvStringParm name)
+{
+    struct stat st;
+    if (stat(name, &st) < 0)
+	return 0;
+    return st.st_size;
+}
+
+
+WVTEST_MAIN("binary log round trip")
+{
+    WvString base(wvtmpfilename("wvtest-binlog"));
+    WvString name;
+    {
+	WvBinLogFile rcv(base, WvLog::Info);
+	WVPASS(rcv.isok());
+	name = rcv.current_file();
+	WVPASSEQ(name, WvString("%s.000000", base));
+
+	WvLog alpha("alpha", WvLog::Info), beta("beta", WvLog::Notice);
+	WvLog quiet("alpha", WvLog::Debug);
+	alpha("one\n");
+	beta("two, ");
+	beta("still two\n");
+	quiet("not wanted\n");
+	alpha("three\nfour\n");
+	alpha.lvl(WvLog::Critical)("a %s\n", "crisis");
+
+	// it's mapped, so the file is there already
+	WvBinLogHeader hdr;
+	int fd = open(name, O_RDONLY);
+	WVPASS(fd >= 0);
+	WVPASSEQ(read(fd, &hdr, sizeof(hdr)), (ssize_t)sizeof(hdr));
+	close(fd);
+	WVPASS(!memcmp(hdr.magic, WVBINLOG_MAGIC, 8));
+	WVPASSEQ(hdr.version, (unsigned)WVBINLOG_VERSION);
+    }
+
+    // trimmed down to what was used once it's done
+    WVPASS(filesize(name) > sizeof(WvBinLogHeader));
+    WVPASS(filesize(name) < 4096);
+
+    TextLog text;
+    WVPASS(WvBinLogFile::decode(name, text));
+    WVPASSEQ(text.text(),
+	     "alpha<Info>: one\n"
+	     "beta<Notice>: two, still two\n"
+	     "alpha<Info>: three\n"
+	     "alpha<Info>: four\n"
+	     "alpha<Crit>: a crisis\n");
+
+    // a partly written record ends the log early, but what came before
+    // is still there
+    WvString damaged("%s.damaged", base);
+    {
+	int in = open(name, O_RDONLY), out = open(damaged, O_WRONLY|O_CREAT, 0644);
+	char buf[4096];
+	ssize_t len = read(in, buf, sizeof(buf));
+	WVPASS(len > 40);
+	WVPASSEQ(write(out, buf, len - 3), len - 3);
+	close(in);
+	close(out);
+    }
+    WVFAIL(WvBinLogFile::decode(damaged, text));
+    WVPASSEQ(text.text(),
+	     "alpha<Info>: one\n"
+	     "beta<Notice>: two, still two\n"
+	     "alpha<Info>: three\n"
+	     "alpha<Info>: four\n");
+    WVFAIL(WvBinLogFile::decode(base, text)); // not a binary log at all
+    WVFAIL(WvBinLogFile::decode("/nonexistent/binlog", text));
+
+    unlink(damaged);
+    unlink(name);
+    unlink(base);
+}
+
+
+WVTEST_MAIN("binary log rotation")
+{
+    WvString base(wvtmpfilename("wvtest-binlog"));
+    WvString last;
+    {
+	// 4096 bytes is the smallest file there is
+	WvBinLogFile rcv(base, WvLog::NUM_LOGLEVELS, 4096, 3);
+	WvLog log("rotator", WvLog::Info);
+	for (int n = 0; n < 500; n++)
+	    log("message number %s\n", n);
+	last = rcv.current_file();
+	WVPASS(last != WvString("%s.000000", base));
+
+	// an enormous message gets cut short instead of lost
+	WvString big;
+	big.setsize(10000);
+	memset(big.edit(), 'x', 9999);
+	big.edit()[9999] = 0;
+	log("%s\n", big);
+	last = rcv.current_file();
+    }
+    int lastnum = atoi(last.cstr() + base.len() + 1);
+    WVPASS(lastnum > 3);
+
+    // a new one carries on with the numbering
+    {
+	WvBinLogFile rcv(base, WvLog::NUM_LOGLEVELS, 4096, 0);
+	WVPASSEQ(atoi(rcv.current_file().cstr() + base.len() + 1),
+		 lastnum + 1);
+	unlink(rcv.current_file());
+    }
+
+    // only the newest three are left, and each one decodes on its own
+    for (int n = 0; n <= lastnum; n++)
+    {
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), "%06d", n);
+	WvString name("%s.%s", base, suffix);
+	if (n <= lastnum - 3)
+	{
+	    WVFAIL(access(name, F_OK) == 0);
+	    continue;
+	}
+	TextLog text;
+	WVPASS(WvBinLogFile::decode(name, text));
+	WvString s(text.text());
+	WVPASS(!strncmp(s, "rotator<Info>: ", 15));
+	if (n == lastnum - 1)
+	    WVPASS(strstr(s, "message number 499\n"));
+	if (n == lastnum)
+	    WVPASS(s.len() > 3000 && s.len() < 4096);
+	unlink(name);
+    }
+
+    unlink(base);
+}
+
+
+// The lowest free fd, which goes up if anybody leaks one
+static int nextfd()
+{
+    int fd = open("/dev/null", O_RDONLY);
+    close(fd);
+    return fd;
+}
+
+
+static WvString numbered(WvStringParm base, int n)
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "%06d", n);
+    return WvString("%s.%s", base, suffix);
+}
+
+
+WVTEST_MAIN("binary log can't open the next file")
+{
+    WvString base(wvtmpfilename("wvtest-binlog"));
+    {
+	WvBinLogFile rcv(base, WvLog::NUM_LOGLEVELS, 4096, 2);
+	WvLog log("stuck", WvLog::Info);
+	for (int n = 0; !rcv.current_file().endswith(".000002"); n++)
+	    log("message number %s\n", n);
+
+	// something is in the way of the next one
+	mkdir(numbered(base, 3), 0755);
+	while (rcv.isok())
+	    log("lost message\n");
+	int fd = nextfd();
+	for (int n = 0; n < 500; n++)
+	    log("lost message %s\n", n);
+	WVFAIL(rcv.isok());
+	WVPASSEQ(nextfd(), fd);
+
+	// which doesn't cost us the files we already had
+	WVPASSEQ(rcv.current_file(), numbered(base, 2));
+	WVPASS(access(numbered(base, 1), F_OK) == 0);
+	WVPASS(access(numbered(base, 2), F_OK) == 0);
+
+	// nor does it try again straight away...
+	rmdir(numbered(base, 3));
+	log("too soon\n");
+	WVFAIL(rcv.isok());
+
+	// ...but it does eventually
+	usleep(1100 * 1000);
+	log("back again\n");
+	WVPASS(rcv.isok());
+	WVPASSEQ(rcv.current_file(), numbered(base, 3));
+	WVFAIL(access(numbered(base, 1), F_OK) == 0);
+    }
+
+    TextLog text;
+    WVPASS(WvBinLogFile::decode(numbered(base, 3), text));
+    WVPASSEQ(text.text(), "stuck<Info>: back again\n");
+    unlink(numbered(base, 2));
+    unlink(numbered(base, 3));
+    unlink(base);
+}
+
+
+WVTEST_MAIN("binary log can't reserve or map the file")
+{
+    WvString base(wvtmpfilename("wvtest-binlog"));
+    int fd = nextfd();
+
+    // not allowed to make a file that big: the blocks can't be reserved
+    signal(SIGXFSZ, SIG_IGN);
+    struct rlimit old, lim;
+    getrlimit(RLIMIT_FSIZE, &old);
+    lim = old;
+    lim.rlim_cur = 8192;
+    WVPASS(setrlimit(RLIMIT_FSIZE, &lim) == 0);
+    {
+	WvBinLogFile rcv(base, WvLog::NUM_LOGLEVELS, 65536, 2);
+	WVFAIL(rcv.isok());
+    }
+    setrlimit(RLIMIT_FSIZE, &old);
+    signal(SIGXFSZ, SIG_DFL);
+    WVFAIL(access(numbered(base, 0), F_OK) == 0);
+    WVPASSEQ(nextfd(), fd);
+
+    // not enough address space left to map it
+    const size_t size = 16*1024*1024;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    unsigned long pages = 0;
+    if (statm)
+    {
+	WVPASS(fscanf(statm, "%lu", &pages) == 1);
+	fclose(statm);
+    }
+    getrlimit(RLIMIT_AS, &old);
+    lim = old;
+    lim.rlim_cur = pages * getpagesize() + size / 2;
+    WVPASS(setrlimit(RLIMIT_AS, &lim) == 0);
+    {
+	WvBinLogFile rcv(base, WvLog::NUM_LOGLEVELS, size, 2);
+	WVFAIL(rcv.isok());
+    }
+    setrlimit(RLIMIT_AS, &old);
+    WVFAIL(access(numbered(base, 0), F_OK) == 0);
+    WVPASSEQ(nextfd(), fd);
+
+    unlink(base);
+}
@@ -69,3 +69,46 @@ WVTEST_MAIN("no crlf mangling")
     
 //    unlink(filename);
 }
+
+
+#ifndef _WIN32
+WVTEST_MAIN("mapped")
+{
+    WvString filename = wvtmpfilename("wvfile-test");
+    {
+	WvFile f(filename, O_WRONLY | O_CREAT);
+	f.print("line1\nline2\nline3\n");
+	WVFAIL(f.mapped()); // not readable
+    }
+
+    {
+	WvFile f(filename, O_RDONLY);
+	WVPASSEQ(f.getline(), "line1");
+
+	// what getline() read ahead is in the buffer
+	WvMmapBuf *buf = f.mapped();
+	WVPASS(buf);
+	WVPASSEQ(buf->getstr(), "line2\nline3\n");
+
+	// and the stream carries on at the end of it
+	{
+	    WvFile append(filename, O_WRONLY | O_APPEND);
+	    append.print("line4\n");
+	}
+	WVPASSEQ(f.getline(), "line4");
+	WVPASSEQ(f.getline(), NULL);
+    }
+
+    {
+	WvFile f(filename, O_RDONLY);
+	char buf[6];
+	WVPASSEQ(f.read(buf, 6), 6);
+	WVPASSEQ(f.mapped()->getstr(), "line2\nline3\nline4\n");
+    }
+
+    unlink(filename);
+
+    WvFile pipe(open("/dev/null", O_RDONLY));
+    WVFAIL(pipe.mapped());
+}
+#endif
@@ -89,3 +89,36 @@ WVTEST_MAIN("spinning list 2")
     WVPASSEQ(scount, 0);
     WVPASSEQ(lcount, 0);
 }
+
+
+static void record(WvString *log, int n, WvIStreamList *l)
+{
+    log->append("%s ", n);
+    if (l && n < 3)
+        l->runsoon(wv::bind(record, log, n + 10, (WvIStreamList *)NULL));
+}
+
+
+WVTEST_MAIN("runsoon")
+{
+    WvString log("");
+    WvIStreamList l;
+    
+    // nothing to wait for, so this shouldn't sleep
+    WvTime start = wvtime();
+    l.runsoon(wv::bind(record, &log, 1, &l));
+    l.runsoon(wv::bind(record, &log, 2, &l));
+    l.runsoon(wv::bind(record, &log, 3, &l));
+    WVPASSEQ(l.runsoon_count(), 3);
+    l.runonce(5000);
+    WVPASS(msecdiff(wvtime(), start) < 1000);
+    WVPASSEQ(log, "1 2 3 ");
+    
+    // the ones queued while running wait for the next pass
+    WVPASSEQ(l.runsoon_count(), 2);
+    l.runonce(0);
+    WVPASSEQ(log, "1 2 3 11 12 ");
+    WVPASSEQ(l.runsoon_count(), 0);
+    l.runonce(0);
+    WVPASSEQ(log, "1 2 3 11 12 ");
+}
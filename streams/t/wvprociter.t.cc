@@ -46,3 +46,60 @@ WVTEST_MAIN("wvkillall")
 
     unlink(exe);
 }
+
+
+WVTEST_MAIN("WvProcTable")
+{
+    WvString exe("/tmp/wvproctable.%s", getpid());
+    unlink(exe);
+    symlink("/bin/sleep", exe);
+
+    WvProcTable t;
+    WVPASS(t.isok());
+    WVPASS(t.count() > 0);
+
+    const WvProcTableEnt *me = t.find(getpid());
+    if (WVPASS(me))
+    {
+        WVPASSEQ(me->pid, getpid());
+        WVPASS(!me->cmdline.isempty());
+    }
+    WVFAIL(t.find_name(getfilename(exe)));
+
+    // nothing new to read, except maybe some unrelated processes
+    size_t before = t.count();
+    WVPASS(t.refresh() < before);
+    WVPASS(t.find(getpid()) == me);
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        execl(exe, getfilename(exe), "600", NULL);
+        _exit(1);
+    }
+    else if (WVPASS(child > 0))
+    {
+        // wait for the child to exec
+        const WvProcTableEntList *procs = NULL;
+        for (int i = 0; i < 100 && !procs; ++i)
+        {
+            usleep(50*1000);
+            t.refresh();
+            procs = t.find_name(getfilename(exe));
+        }
+        if (WVPASS(procs))
+        {
+            WVPASSEQ(procs->count(), 1);
+            WVPASSEQ(procs->first()->pid, child);
+            WVPASSEQ(t.find(child)->name, getfilename(exe));
+        }
+
+        kill(child, 15);
+        waitpid(child, NULL, 0);
+        t.refresh();
+        WVFAIL(t.find(child));
+        WVFAIL(t.find_name(getfilename(exe)));
+    }
+
+    unlink(exe);
+}
@@ -0,0 +1,103 @@
+#include "wvtest.h"
+#include "wvprotostream.h"
+
+static const char *words[] = {
+    "user", "pass", "RETR", "Stor", "quit", NULL
+};
+
+
+WVTEST_MAIN("tokview")
+{
+    WvProtoStream p(NULL);
+    char line[] = "  RETR   some/file.txt\t 1234 \r\n";
+
+    WVPASSEQ(p.tokview(line), 3);
+    WVPASSEQ(p.ntokviews, 3);
+    WVPASSEQ(p.tokview_str(0), "RETR");
+    WVPASSEQ(p.tokviews[0].off, 2);
+    WVPASSEQ(p.tokviews[0].len, 4);
+    WVPASSEQ(p.tokview_str(1), "some/file.txt");
+    WVPASSEQ(p.tokviews[1].len, 13);
+    WVPASSEQ(p.tokview_str(2), "1234");
+    WVPASSEQ(p.tokviews[2].off, 24);
+
+    char blank[] = " \t\r\n";
+    WVPASSEQ(p.tokview(blank), 0);
+    WVPASSEQ(p.tokview(NULL), 0);
+    WVPASSEQ(p.ntokviews, 0);
+}
+
+
+WVTEST_MAIN("tokview with too many words")
+{
+    WvProtoStream p(NULL);
+    WvString s("");
+    for (int n = 0; n < WvProtoStream::MAX_TOKVIEWS + 5; n++)
+        s.append("w%s ", n);
+    char *line = s.edit();
+
+    WVPASSEQ(p.tokview(line), WvProtoStream::MAX_TOKVIEWS);
+    WVPASSEQ(p.tokview_str(0), "w0");
+    WVPASSEQ(p.tokview_str(WvProtoStream::MAX_TOKVIEWS - 2),
+             WvString("w%s", WvProtoStream::MAX_TOKVIEWS - 2));
+
+    // the last one is all the rest, trimmed
+    size_t last = WvProtoStream::MAX_TOKVIEWS - 1;
+    WvString rest("");
+    for (int n = last; n < WvProtoStream::MAX_TOKVIEWS + 5; n++)
+        rest.append(n == (int)last ? "w%s" : " w%s", n);
+    WVPASSEQ(p.tokview_str(last), rest);
+    WVPASSEQ(p.tokviews[last].len, rest.len());
+}
+
+
+WVTEST_MAIN("TokenTable agrees with tokanal")
+{
+    WvProtoStream p(NULL);
+    WvProtoStream::TokenTable nocase(words), exact(words, true);
+    const char *tests[] = {
+        "user", "USER", "Pass", "retr", "RETR", "stor", "Stor", "quit",
+        "use", "users", "", "RETRx", "quiT", "nothing", NULL
+    };
+
+    for (const char **i = tests; *i; i++)
+    {
+        WvProtoStream::Token t((const unsigned char *)*i, strlen(*i));
+        WVPASSEQ(p.tokanal(t, nocase), p.tokanal(t, words, false));
+        WVPASSEQ(p.tokanal(t, exact), p.tokanal(t, words, true));
+    }
+    WVPASSEQ(nocase.find("stor"), 3);
+    WVPASSEQ(exact.find("stor"), -1);
+
+    // only the first 4 bytes
+    WVPASSEQ(nocase.find("quitting", 4), 4);
+
+    char line[] = "pass secret";
+    p.tokview(line);
+    WVPASSEQ(p.tokanal(0, nocase), 1);
+    WVPASSEQ(p.tokanal(1, nocase), -1);
+}
+
+
+WVTEST_MAIN("TokenTable with duplicates and collisions")
+{
+    // lots of words, so some of them surely share a slot
+    WvString buf[200];
+    const char *many[202];
+    for (int n = 0; n < 200; n++)
+        many[n] = buf[n] = WvString("word%s", n);
+    many[200] = "word7"; // tokanal() would find the first one
+    many[201] = NULL;
+
+    WvProtoStream::TokenTable t(many);
+    int bad = 0;
+    for (int n = 0; n < 200; n++)
+        if (t.find(WvString("WORD%s", n)) != n)
+            bad++;
+    WVPASSEQ(bad, 0);
+    WVPASSEQ(t.find("word200"), -1);
+
+    const char *none[] = { NULL };
+    WvProtoStream::TokenTable empty(none);
+    WVPASSEQ(empty.find("word"), -1);
+}
@@ -0,0 +1,145 @@
+#include "wvtest.h"
+#include "wvworkpool.h"
+#include "wvistreamlist.h"
+#include "wvtimeutils.h"
+
+static void add(volatile int *where, int what)
+{
+    *where += what;
+}
+
+
+static void record(WvStringList *l, WvStringParm s)
+{
+    l->append(s);
+}
+
+
+WVTEST_MAIN("work pool")
+{
+    WvWorkPool pool(3);
+    WVPASS(pool.isok());
+    WvIStreamList l;
+    l.append(&pool, false, "pool");
+
+    volatile int results[10];
+    WvStringList finished;
+    for (int n = 0; n < 10; n++)
+    {
+	results[n] = 0;
+	pool.submit(wv::bind(add, &results[n], n),
+		    wv::bind(record, &finished, WvString(n)));
+    }
+    WVPASSEQ(pool.pending(), 10);
+
+    WvTime start = wvtime();
+    while (pool.pending() && msecdiff(wvtime(), start) < 5000)
+	l.runonce(100);
+    WVPASSEQ(pool.pending(), 0);
+    WVPASSEQ(finished.count(), 10);
+    int bad = 0;
+    for (int n = 0; n < 10; n++)
+	if (results[n] != n)
+	    bad++;
+    WVPASSEQ(bad, 0);
+
+    // a job without a 'done' still counts
+    pool.submit(wv::bind(add, &results[0], 1));
+    while (pool.pending() && msecdiff(wvtime(), start) < 5000)
+	l.runonce(100);
+    WVPASSEQ(pool.pending(), 0);
+    WVPASSEQ(results[0], 1);
+}
+
+
+static void spin(int msec)
+{
+    // not sleep(): something that really keeps a CPU busy
+    struct timeval start, now;
+    gettimeofday(&start, NULL);
+    do
+	gettimeofday(&now, NULL);
+    while (msecdiff(now, start) < msec);
+}
+
+
+static void count_done(int *n)
+{
+    (*n)++;
+}
+
+
+WVTEST_MAIN("work pool main loop latency")
+{
+    WvWorkPool pool(4);
+    WvIStreamList l;
+    l.append(&pool, false, "pool");
+    int ndone = 0;
+    for (int n = 0; n < 8; n++)
+	pool.submit(wv::bind(spin, 100), wv::bind(count_done, &ndone));
+
+    // the main loop keeps going while they work
+    time_t slowest = 0;
+    int loops = 0;
+    WvTime start = wvtime(), last = start;
+    while (ndone < 8 && msecdiff(wvtime(), start) < 10000)
+    {
+	l.runonce(10);
+	WvTime now = wvtime();
+	if (msecdiff(now, last) > slowest)
+	    slowest = msecdiff(now, last);
+	last = now;
+	loops++;
+    }
+    printf("%d loops, the slowest took %ld ms\n", loops, (long)slowest);
+    WVPASSEQ(ndone, 8);
+    WVPASS(slowest < 50);
+}
+
+
+WVTEST_MAIN("work pool deleted with work left")
+{
+    int ndone = 0;
+    {
+	WvWorkPool pool(1);
+	for (int n = 0; n < 5; n++)
+	    pool.submit(wv::bind(spin, 20), wv::bind(count_done, &ndone));
+    }
+    WVPASSEQ(ndone, 0);
+}
+
+
+WVTEST_MAIN("work pool run")
+{
+    WvWorkPool pool(3);
+    WVPASSEQ(pool.threadcount(), 3);
+    WvIStreamList l;
+    l.append(&pool, false, "pool");
+
+    volatile int results[10];
+    WvWorkPool::Job jobs[10];
+    for (int n = 0; n < 10; n++)
+    {
+	results[n] = 0;
+	jobs[n] = wv::bind(add, &results[n], n);
+    }
+    pool.run(jobs, 10);
+    int bad = 0;
+    for (int n = 0; n < 10; n++)
+	if (results[n] != n)
+	    bad++;
+    WVPASSEQ(bad, 0);
+    WVPASSEQ(pool.pending(), 0);
+
+    // submitted jobs still go through the main loop as usual
+    int ndone = 0;
+    pool.submit(wv::bind(spin, 50), wv::bind(count_done, &ndone));
+    pool.run(jobs + 1, 1);
+    WVPASSEQ(results[1], 2);
+    WvTime start = wvtime();
+    while (pool.pending() && msecdiff(wvtime(), start) < 5000)
+	l.runonce(100);
+    WVPASSEQ(ndone, 1);
+
+    pool.run(jobs, 0);
+}
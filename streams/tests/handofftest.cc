@@ -0,0 +1,226 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2005 Net Integration Technologies, Inc.
+ *
+ * Counts the connections refused while a WvStreamsDaemon restarts over and
+ * over under load, restarting in the same process and with
+ * --handoff-restart, and the longest a client had to keep retrying.  The daemon takes a while to start up, like one that
+ * has to load its configuration first.
+ *
+ *     handofftest [msec-per-run] [restarts] [startup-msec] [clients]
+ */
+#include "wvstreamsdaemon.h"
+#include "wvstreamclone.h"
+#include "wvtcplistener.h"
+#include "wvtimeutils.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+static int port;
+static int startup_msec;
+
+// The daemon: answers each line with its pid, then hangs up.
+
+static void reply(WvStream *s)
+{
+    if (s->getline(0))
+    {
+        s->print("%s\n", getpid());
+        s->close();
+    }
+}
+
+
+static void accepted(IWvStream *_conn)
+{
+    WvStream *conn = new WvStreamClone(_conn);
+    conn->setcallback(wv::bind(reply, conn));
+    WvIStreamList::globallist.append(conn, true, "handofftest conn");
+}
+
+
+static void startup(WvStreamsDaemon *daemon)
+{
+    wvdelay(startup_msec);
+    WvTCPListener *l = new WvTCPListener(WvIPPortAddr("127.0.0.1", port));
+    l->onaccept(accepted);
+    daemon->add_die_stream(l, true, "listener");
+}
+
+
+static int run_daemon(int argc, char **argv)
+{
+    WvStreamsDaemon daemon("handofftest", "1.0", WvDaemonCallback());
+    daemon.setcallback(wv::bind(startup, &daemon));
+    daemon.log_level = WvLog::Warning;
+    return daemon.run(argc, argv);
+}
+
+
+// The load: connections one after the other, as fast as they go.
+
+struct Counts
+{
+    unsigned long requests, refused, failed;
+    long longest; // msec from a failure to the next success
+};
+
+
+// Returns the daemon's pid, or 0 if refused, or -1 on any other failure.
+static int ask_pid()
+{
+    int fd = socket(PF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    // reset instead of leaving each one in TIME_WAIT, or we'd run out
+    // of local ports
+    struct linger lg = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    int ret = -1;
+    if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+        ret = errno == ECONNREFUSED ? 0 : -1;
+    else if (write(fd, "pid?\n", 5) == 5)
+    {
+        char buf[32];
+        ssize_t len = 0, n;
+        while (len < (ssize_t)sizeof(buf) - 1
+               && (n = read(fd, buf + len, sizeof(buf) - 1 - len)) > 0)
+            len += n;
+        buf[len] = 0;
+        if (len > 0 && buf[len - 1] == '\n')
+            ret = atoi(buf);
+    }
+    close(fd);
+    return ret;
+}
+
+
+static void load(int outfd, int msec)
+{
+    // like a client that retries right away, so every refusal counts
+    Counts c = { 0, 0, 0, 0 };
+    bool failing = false;
+    WvTime start = wvtime(), first_failure;
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        int pid = ask_pid();
+        if (pid > 0)
+        {
+            c.requests++;
+            if (failing && msecdiff(wvtime(), first_failure) > c.longest)
+                c.longest = msecdiff(wvtime(), first_failure);
+            failing = false;
+            continue;
+        }
+        if (pid == 0)
+            c.refused++;
+        else
+            c.failed++;
+        if (!failing)
+            first_failure = wvtime();
+        failing = true;
+        wvdelay(1);
+    }
+    write(outfd, &c, sizeof(c));
+}
+
+
+static void run(const char *self, bool handoff, int msec, int restarts,
+                int nclients)
+{
+    pid_t daemon = fork();
+    if (daemon == 0)
+    {
+        setenv("HANDOFFTEST_PORT", WvString(port), 1);
+        setenv("HANDOFFTEST_STARTUP", WvString(startup_msec), 1);
+        execl(self, self, "-q", handoff ? "--handoff-restart" : NULL,
+              (char *)NULL);
+        _exit(127);
+    }
+    while (ask_pid() <= 0)
+        wvdelay(10);
+
+    int fds[2];
+    pipe(fds);
+    for (int n = 0; n < nclients; n++)
+    {
+        if (fork() == 0)
+        {
+            load(fds[1], msec);
+            _exit(0);
+        }
+    }
+    close(fds[1]);
+
+    // restart evenly through the run, each time whichever process is
+    // answering now
+    for (int n = 0; n < restarts; n++)
+    {
+        wvdelay(msec / (restarts + 1));
+        int pid;
+        while ((pid = ask_pid()) <= 0)
+            wvdelay(1);
+        kill(pid, SIGHUP);
+    }
+
+    Counts total = { 0, 0, 0, 0 }, c;
+    while (read(fds[0], &c, sizeof(c)) == sizeof(c))
+    {
+        total.requests += c.requests;
+        total.refused += c.refused;
+        total.failed += c.failed;
+        if (c.longest > total.longest)
+            total.longest = c.longest;
+    }
+    close(fds[0]);
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+        ;
+
+    printf("%-20s %7lu requests, %5lu refused, %3lu reset, "
+           "longest outage %4ld ms\n",
+           handoff ? "--handoff-restart:" : "restart in-process:",
+           total.requests, total.refused, total.failed, total.longest);
+
+    // ...and stop whoever's left, once the last restart is over
+    WvTime settle = wvtime();
+    while (msecdiff(wvtime(), settle) < startup_msec + 500)
+        wvdelay(10);
+    int pid;
+    while ((pid = ask_pid()) != 0)
+    {
+        if (pid > 0)
+            kill(pid, SIGTERM);
+        wvdelay(100);
+    }
+    waitpid(daemon, NULL, 0);
+}
+
+
+int main(int argc, char **argv)
+{
+    if (getenv("HANDOFFTEST_PORT"))
+    {
+        port = atoi(getenv("HANDOFFTEST_PORT"));
+        startup_msec = atoi(getenv("HANDOFFTEST_STARTUP"));
+        return run_daemon(argc, argv);
+    }
+
+    int msec = argc > 1 ? atoi(argv[1]) : 3000;
+    int restarts = argc > 2 ? atoi(argv[2]) : 5;
+    startup_msec = argc > 3 ? atoi(argv[3]) : 100;
+    int nclients = argc > 4 ? atoi(argv[4]) : 4;
+    port = 20000 + getpid() % 20000;
+    signal(SIGPIPE, SIG_IGN);
+
+    run("/proc/self/exe", false, msec, restarts, nclients);
+    run("/proc/self/exe", true, msec, restarts, nclients);
+    return 0;
+}
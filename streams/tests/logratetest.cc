@@ -0,0 +1,144 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how many log lines per second WvLogConsole, WvLogFileBase and
+ * WvBinLogFile can write, next to a console that writes every piece of
+ * every line as soon as it gets it, the way they all used to; and how many
+ * bytes per line the two kinds of log file take up.
+ *
+ *     logratetest [msec-per-run] [file]
+ */
+#include "wvlogrcv.h"
+#include "wvlogfile.h"
+#include "wvbinlogfile.h"
+#include "wvtimeutils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+
+class UnbufferedLogConsole : public WvLogConsole
+{
+public:
+    UnbufferedLogConsole(int fd) : WvLogConsole(fd)
+        { }
+
+protected:
+    virtual void _mid_line(const char *str, size_t len)
+        { uwrite(str, len); }
+};
+
+
+static void run(const char *what, int msec)
+{
+    WvLog log("logratetest", WvLog::Info);
+    WvLog other("somebody else", WvLog::Info);
+    WvString text("A typical log message, with a number (%s) in it", 12345);
+    WvString tabs("Something\twith\ttabs and a \x01 in it");
+    WvString multi("several\nlines\nat\nonce");
+
+    struct { const char *name; int kind; } runs[] = {
+        { "one source", 0 },
+        { "two sources", 1 },
+        { "with escapes", 2 },
+        { "four lines per call", 3 },
+    };
+    for (unsigned r = 0; r < sizeof(runs) / sizeof(runs[0]); r++)
+    {
+        unsigned long lines = 0;
+        WvTime start = wvtime();
+        while (msecdiff(wvtime(), start) < msec)
+        {
+            for (int n = 0; n < 1000; n++)
+            {
+                switch (runs[r].kind)
+                {
+                case 0:
+                    log("%s\n", text);
+                    lines++;
+                    break;
+                case 1:
+                    ((n & 1) ? other : log)("%s\n", text);
+                    lines++;
+                    break;
+                case 2:
+                    log("%s\n", tabs);
+                    lines++;
+                    break;
+                case 3:
+                    log("%s\n", multi);
+                    lines += 4;
+                    break;
+                }
+            }
+        }
+        printf("%-22s %-20s %10.0f lines/sec\n", what, runs[r].name,
+               lines * 1000.0 / msecdiff(wvtime(), start));
+    }
+}
+
+
+static size_t filesize(WvStringParm name)
+{
+    struct stat st;
+    return stat(name, &st) < 0 ? 0 : st.st_size;
+}
+
+
+static void report_size(const char *what, WvStringParm name, int lines)
+{
+    printf("%-22s %-20s %10.1f bytes/line\n", what, "one source",
+           filesize(name) / (double)lines);
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 1000;
+    WvString filename(argc > 2 ? argv[2] : "/tmp/logratetest.log");
+
+    {
+        UnbufferedLogConsole rcv(open("/dev/null", O_WRONLY));
+        run("unbuffered console", msec);
+    }
+    {
+        WvLogConsole rcv(open("/dev/null", O_WRONLY));
+        run("WvLogConsole", msec);
+    }
+    {
+        WvLogFileBase rcv(filename, WvLog::Info);
+        run("WvLogFileBase", msec);
+    }
+    unlink(filename);
+    {
+        WvBinLogFile rcv(filename, WvLog::Info, 64*1024*1024, 1);
+        run("WvBinLogFile", msec);
+        unlink(rcv.current_file());
+    }
+
+    WvString text("A typical log message, with a number (%s) in it", 12345);
+    {
+        WvLogFileBase rcv(filename, WvLog::Info);
+        WvLog log("logratetest", WvLog::Info);
+        for (int n = 0; n < 10000; n++)
+            log("%s\n", text);
+        rcv.end_line();
+        report_size("WvLogFileBase", filename, 10000);
+    }
+    unlink(filename);
+    {
+        WvString name;
+        {
+            WvBinLogFile rcv(filename, WvLog::Info);
+            WvLog log("logratetest", WvLog::Info);
+            for (int n = 0; n < 10000; n++)
+                log("%s\n", text);
+            name = rcv.current_file();
+        }
+        // it's only trimmed to the size it really used once it's closed
+        report_size("WvBinLogFile", name, 10000);
+        unlink(name);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how long it takes to keep a log message around for later in a
+ * WvLogBuffer, next to a WvShmLog, and to a bare WvShmLogRing.
+ *
+ *     logringtest [msec-per-run] [messages-kept]
+ */
+#include "wvlogbuffer.h"
+#include "wvshmlog.h"
+#include <stdio.h>
+
+
+static void report(const char *what, unsigned long n, WvTime start)
+{
+    double ms = msecdiff(wvtime(), start);
+    printf("%-28s %10.0f msgs/sec %8.1f ns/msg\n", what, n * 1000.0 / ms,
+           ms * 1e6 / n);
+}
+
+
+static void run(const char *what, int msec)
+{
+    WvLog log("logringtest", WvLog::Info);
+    WvLog other("somebody else", WvLog::Debug);
+    WvString text("A typical log message, with a number (%s) in it\n", 12345);
+
+    unsigned long count = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+            ((n & 3) ? log : other).print(text);
+    }
+    report(what, count, start);
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 1000;
+    int kept = argc > 2 ? atoi(argv[2]) : 1024;
+
+    {
+        WvLogBuffer rcv(kept);
+        run("WvLogBuffer", msec);
+    }
+    {
+        WvShmLog rcv(kept);
+        run("WvShmLog", msec);
+    }
+    {
+        WvShmLogRing ring(kept);
+        const char *text = "A typical log message, with a number (12345) in it\n";
+        size_t len = strlen(text);
+        unsigned long count = 0;
+        WvTime start = wvtime();
+        while (msecdiff(wvtime(), start) < msec)
+        {
+            for (int n = 0; n < 1000; n++, count++)
+                ring.append(start, WvLog::Info, "logringtest", 11, text, len);
+        }
+        report("WvShmLogRing::append()", count, start);
+    }
+    return 0;
+}
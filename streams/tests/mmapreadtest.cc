@@ -0,0 +1,111 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Compares scanning a big file through WvFile::read() with scanning it
+ * through WvFile::mapped(), by counting the lines in it both ways.
+ *
+ *     mmapreadtest [megabytes [filename]]
+ *
+ * Without a filename, it makes a temporary file of that size (1024 MB by
+ * default) first.  Either way, the file is probably all in the page cache
+ * by the time it's read, so this measures copying, not the disk.
+ */
+#include "wvfile.h"
+#include "wvfileutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static size_t count_lines(const unsigned char *p, size_t len)
+{
+    size_t lines = 0;
+    const unsigned char *end = p + len;
+    while ((p = (const unsigned char *)memchr(p, '\n', end - p)) != NULL)
+    {
+        lines++;
+        p++;
+    }
+    return lines;
+}
+
+
+static void report(const char *what, off_t size, size_t lines, double start)
+{
+    double secs = now() - start;
+    printf("%-28s %10lu lines %8.0f MB/sec\n", what, (unsigned long)lines,
+           size / secs / 1024 / 1024);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t megs = argc > 1 ? atoi(argv[1]) : 1024;
+    WvString filename(argc > 2 ? argv[2] : "");
+    bool made = !filename;
+    if (made)
+    {
+        filename = wvtmpfilename("mmapreadtest");
+        FILE *f = fopen(filename, "w");
+        char line[100];
+        memset(line, 'x', sizeof(line) - 1);
+        line[sizeof(line) - 1] = '\n';
+        for (size_t n = 0; n < megs * 1024 * 1024 / sizeof(line); n++)
+            fwrite(line, sizeof(line), 1, f);
+        fclose(f);
+    }
+
+    struct stat st;
+    if (stat(filename, &st) < 0)
+    {
+        perror(filename);
+        return 1;
+    }
+    printf("%s: %lu MB\n", filename.cstr(),
+           (unsigned long)(st.st_size / 1024 / 1024));
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double start = now();
+        size_t lines = 0;
+        {
+            WvFile f(filename, O_RDONLY);
+            unsigned char buf[65536];
+            size_t len;
+            while ((len = f.read(buf, sizeof(buf))) > 0)
+                lines += count_lines(buf, len);
+        }
+        report("WvFile::read()", st.st_size, lines, start);
+
+        size_t windows[] = { WVMMAPBUF_WINDOW, 64*1024*1024 };
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++)
+        {
+            start = now();
+            lines = 0;
+            {
+                WvFile f(filename, O_RDONLY);
+                WvMmapBuf *buf = f.mapped(windows[w]);
+                while (buf && buf->used())
+                {
+                    size_t len = buf->optgettable();
+                    lines += count_lines(buf->get(len), len);
+                }
+            }
+            WvString what("WvFile::mapped(), %sMB", windows[w] >> 20);
+            report(what, st.st_size, lines, start);
+        }
+    }
+
+    if (made)
+        unlink(filename);
+    return 0;
+}
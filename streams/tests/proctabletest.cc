@@ -0,0 +1,89 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * WvProcIter vs. WvProcTable benchmark.  Optionally starts a lot of
+ * sleeping children first, so the process table is big enough to matter:
+ *
+ *     proctabletest [children] [passes]
+ */
+
+#include "wvprociter.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+static void report(const char *what, int passes, const WvTime &start,
+		   size_t procs)
+{
+    time_t ms = msecdiff(wvtime(), start);
+    printf("%-28s %6d passes, %6ld ms, %8.3f ms/pass (%u processes)\n",
+	   what, passes, (long)ms, (double)ms / passes, (unsigned)procs);
+}
+
+int main(int argc, char **argv)
+{
+    int nchildren = argc > 1 ? atoi(argv[1]) : 0;
+    int passes = argc > 2 ? atoi(argv[2]) : 20;
+    
+    pid_t *children = new pid_t[nchildren + 1];
+    for (int i = 0; i < nchildren; i++)
+    {
+	children[i] = fork();
+	if (children[i] == 0)
+	{
+	    pause();
+	    _exit(0);
+	}
+    }
+
+    WvTime start = wvtime();
+    size_t procs = 0;
+    for (int pass = 0; pass < passes; pass++)
+    {
+	WvProcIter i;
+	procs = 0;
+	for (i.rewind(); i.next(); )
+	    procs++;
+    }
+    report("WvProcIter full walk", passes, start, procs);
+
+    start = wvtime();
+    for (int pass = 0; pass < passes; pass++)
+    {
+	WvProcTable t;
+	procs = t.count();
+    }
+    report("WvProcTable from scratch", passes, start, procs);
+
+    WvProcTable t;
+    size_t reread = 0;
+    start = wvtime();
+    for (int pass = 0; pass < passes; pass++)
+	reread += t.refresh();
+    report("WvProcTable::refresh()", passes, start, t.count());
+    printf("  (%u processes reread during refreshes)\n", (unsigned)reread);
+
+    start = wvtime();
+    bool found = false;
+    for (int pass = 0; pass < passes; pass++)
+    {
+	t.refresh();
+	found = t.find_name("init") || t.find_name("systemd");
+    }
+    report("refresh() + find_name()", passes, start, t.count());
+    printf("  (init %sfound)\n", found ? "" : "not ");
+
+    for (int i = 0; i < nchildren; i++)
+    {
+	if (children[i] > 0)
+	{
+	    kill(children[i], SIGTERM);
+	    waitpid(children[i], NULL, 0);
+	}
+    }
+    delete[] children;
+    
+    return 0;
+}
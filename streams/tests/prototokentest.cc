@@ -0,0 +1,101 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how many FTP-style command lines a second WvProtoStream can
+ * split into words and look up the command of, the usual way (tokline(),
+ * tokenize() and tokanal()) and with tokview() and a TokenTable.
+ *
+ *     prototokentest [msec-per-run]
+ */
+#include "wvprotostream.h"
+#include <stdio.h>
+
+
+static const char *commands[] = {
+    "USER", "PASS", "ACCT", "CWD", "CDUP", "SMNT", "QUIT", "REIN", "PORT",
+    "PASV", "TYPE", "STRU", "MODE", "RETR", "STOR", "STOU", "APPE", "ALLO",
+    "REST", "RNFR", "RNTO", "ABOR", "DELE", "RMD", "MKD", "PWD", "LIST",
+    "NLST", "SITE", "SYST", "STAT", "HELP", "NOOP", NULL
+};
+
+static const char *lines[] = {
+    "USER anonymous\r\n",
+    "PASS someone@example.com\r\n",
+    "TYPE I\r\n",
+    "PORT 192,168,0,1,4,15\r\n",
+    "RETR pub/releases/wvstreams-4.6.1.tar.gz\r\n",
+    "stor incoming/upload.bin\r\n",
+    "LIST -la pub\r\n",
+    "NOOP\r\n",
+};
+#define NLINES (sizeof(lines) / sizeof(lines[0]))
+
+
+static void report(const char *what, unsigned long n, WvTime start,
+                   unsigned long found)
+{
+    double ms = msecdiff(wvtime(), start);
+    printf("%-24s %10.0f lines/sec %8.1f ns/line (%lu found)\n", what,
+           n * 1000.0 / ms, ms * 1e6 / n, found);
+}
+
+
+static void old_way(WvProtoStream &p, int msec)
+{
+    unsigned long count = 0, found = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            WvProtoStream::Token *t1 = p.tokline(lines[count % NLINES]);
+            if (p.tokanal(*t1, commands, false) >= 0)
+                found++;
+            WvProtoStream::Token *args;
+            found += p.list_to_array(p.tokenize(), &args);
+            delete[] args;
+            delete t1;
+        }
+    }
+    report("tokline/tokenize", count, start, found);
+}
+
+
+static void new_way(WvProtoStream &p, int msec)
+{
+    WvProtoStream::TokenTable table(commands);
+    char buf[NLINES][256];
+
+    unsigned long count = 0, found = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            // stands in for getline(), which hands over its own buffer
+            char *line = buf[count % NLINES];
+            strcpy(line, lines[count % NLINES]);
+
+            size_t words = p.tokview(line);
+            if (words && p.tokanal(0, table) >= 0)
+                found++;
+            found += words - 1;
+        }
+    }
+    report("tokview/TokenTable", count, start, found);
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 2000;
+    WvProtoStream p(NULL);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        old_way(p, msec);
+        new_way(p, msec);
+    }
+    return 0;
+}
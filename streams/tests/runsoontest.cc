@@ -0,0 +1,99 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures WvIStreamList::runsoon() and wv::delayed(), and what a lot of
+ * delayed callbacks that haven't been called yet cost the main loop,
+ * compared to the old way of giving each one its own alarm(0) stream.
+ *
+ *     runsoontest [pending-callbacks] [msec-per-run]
+ */
+#include "wvdelayedcallback.h"
+#include "wvistreamlist.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+
+static unsigned long count;
+
+static void bump()
+{
+    count++;
+}
+
+
+static void bumpn(int n)
+{
+    count += n;
+}
+
+
+static void report(const char *what, unsigned long n, WvTime start)
+{
+    printf("%-40s %12.0f/sec\n", what,
+           n * 1000.0 / msecdiff(wvtime(), start));
+}
+
+
+int main(int argc, char **argv)
+{
+    int npending = argc > 1 ? atoi(argv[1]) : 10000;
+    int msec = argc > 2 ? atoi(argv[2]) : 1000;
+    WvIStreamList &l = WvIStreamList::globallist;
+
+    // posting and draining, 1000 at a time
+    count = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++)
+            l.runsoon(bump);
+        l.runonce(0);
+    }
+    report("runsoon() posts", count, start);
+
+    // each with its own delayed callback, like one per connection
+    typedef wv::function<void(int)> IntCallback;
+    IntCallback *cbs = new IntCallback[1000];
+    for (int n = 0; n < 1000; n++)
+        cbs[n] = wv::delayed(bumpn);
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++)
+            cbs[n](1);
+        l.runonce(0);
+    }
+    report("wv::delayed() calls", count, start);
+    delete[] cbs;
+
+    // an idle loop with lots of delayed callbacks waiting to be called
+    IWvStreamCallback *idle = new IWvStreamCallback[npending];
+    for (int n = 0; n < npending; n++)
+        idle[n] = wv::delayed(IWvStreamCallback(bump));
+    unsigned long passes = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        l.runonce(0);
+        passes++;
+    }
+    report(WvString("loop passes, %s delayed callbacks", npending),
+           passes, start);
+    delete[] idle;
+
+    // ...and the same number of streams, which is what they used to be
+    for (int n = 0; n < npending; n++)
+        l.append(new WvStream, true, "idle delayed stream");
+    passes = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        l.runonce(0);
+        passes++;
+    }
+    report(WvString("loop passes, %s streams", npending), passes, start);
+    l.zap();
+
+    return 0;
+}
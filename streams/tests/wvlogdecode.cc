@@ -0,0 +1,52 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Prints the messages in WvBinLogFile logs as text, the way WvLogFile
+ * would have written them in the first place.  Give it the files in
+ * order (their names sort that way):
+ *
+ *     wvlogdecode [-l level] logname.000003 logname.000004 ...
+ */
+#include "wvargs.h"
+#include "wvbinlogfile.h"
+#include "wvlogfile.h"
+
+class StdoutLog : public WvLogFileBase
+{
+public:
+    StdoutLog(WvLog::LogLevel _max_level) : WvLogFileBase(_max_level)
+        { setfd(1); }
+};
+
+
+int main(int argc, char **argv)
+{
+    int level = WvLog::NUM_LOGLEVELS;
+    WvStringList files;
+
+    WvArgs args;
+    args.add_required_arg("file", true);
+    args.add_option('l', "level", "Only print messages up to this level",
+		    "level", level);
+    if (!args.process(argc, argv, &files) || files.count() < 1)
+    {
+	args.print_help(argc, argv);
+	return 1;
+    }
+
+    int ret = 0;
+    StdoutLog out((WvLog::LogLevel)level);
+    WvStringList::Iter i(files);
+    for (i.rewind(); i.next(); )
+    {
+	if (!WvBinLogFile::decode(*i, out))
+	{
+	    out.end_line();
+	    fprintf(stderr, "%s: not a binary log, or damaged\n", i->cstr());
+	    ret = 1;
+	}
+    }
+    out.end_line();
+    return ret;
+}
@@ -0,0 +1,303 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A "Log Receiver" that logs messages to memory-mapped files in a compact
+ * binary format.  See wvbinlogfile.h.
+ */
+#include "wvbinlogfile.h"
+#include "wvdiriter.h"
+#include "strutils.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define MAX_SOURCES 0xffff // ids have to fit in a uint16_t
+#define RETRY_MSEC 1000    // before trying again to start a new file
+
+static size_t recsize(size_t len)
+{
+    return (sizeof(WvBinLogRecord) + len + 3) & ~(size_t)3;
+}
+
+
+WvBinLogFile::WvBinLogFile(WvStringParm _filename, WvLog::LogLevel _max_level,
+			   size_t _filesize, int _keep)
+    : WvLogRcv(_max_level), filename(_filename), sources(32)
+{
+    filesize = _filesize & ~(size_t)3;
+    if (filesize < 4096)
+	filesize = 4096;
+    keep = _keep;
+    num = -1;
+    fd = -1;
+    map = NULL;
+    used = 0;
+    lookup_id = 0;
+    finishing = false;
+    retry_at = wvtime_zero;
+
+    // carry on from the newest file that's already there
+    WvString base("%s.", getfilename(filename));
+    size_t baselen = base.len();
+    WvDirIter i(getdirname(filename), false);
+    for (i.rewind(); i.next(); )
+    {
+	const char *name = i->name;
+	if (strncmp(name, base, baselen) || !name[baselen])
+	    continue;
+	const char *cptr;
+	for (cptr = name + baselen; *cptr >= '0' && *cptr <= '9'; cptr++)
+	    ;
+	if (!*cptr && atoi(name + baselen) > num)
+	    num = atoi(name + baselen);
+    }
+
+    next_file();
+}
+
+
+WvBinLogFile::~WvBinLogFile()
+{
+    finish_file();
+}
+
+
+WvString WvBinLogFile::filename_for(int n) const
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "%06d", n);
+    return WvString("%s.%s", filename, suffix);
+}
+
+
+// Trims the current file to the part we used, so it doesn't take up
+// 'filesize' on disk forever.
+void WvBinLogFile::finish_file()
+{
+    if (map)
+    {
+	munmap(map, filesize);
+	map = NULL;
+    }
+    if (fd >= 0)
+    {
+	int err = ftruncate(fd, used) < 0 ? errno : 0;
+	close(fd);
+	fd = -1;
+	if (err)
+	{
+	    // our own log() would just start another file in the middle of
+	    // this, so only the other receivers get to hear about it
+	    finishing = true;
+	    WvLog("Binary Log", WvLog::Warning)("Can't trim %s: %s\n",
+						 filename_for(num), strerror(err));
+	    finishing = false;
+	}
+    }
+    sources.zap();
+    lookup_name = WvString::null;
+}
+
+
+void WvBinLogFile::next_file()
+{
+    finish_file();
+    used = 0;
+
+    // nothing changes until the new file is ready, so failing over and
+    // over doesn't eat up the old ones
+    WvString name(filename_for(num + 1));
+    int newfd = ::open(name, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if (newfd < 0)
+    {
+	retry_at = msecadd(wvmonotime(), RETRY_MSEC);
+	return;
+    }
+    fcntl(newfd, F_SETFD, FD_CLOEXEC);
+
+    // allocate every block now: running out of disk while writing into
+    // the mapping would be a SIGBUS instead of an error.  The file starts
+    // out all zeroes, which is already an end marker.
+    void *p = MAP_FAILED;
+    if (posix_fallocate(newfd, 0, filesize) == 0)
+	p = mmap(NULL, filesize, PROT_READ|PROT_WRITE, MAP_SHARED, newfd, 0);
+    if (p == MAP_FAILED)
+    {
+	close(newfd);
+	::unlink(name);
+	retry_at = msecadd(wvmonotime(), RETRY_MSEC);
+	return;
+    }
+
+    num++;
+    fd = newfd;
+    map = (char *)p;
+    if (keep > 0)
+	::unlink(filename_for(num - keep));
+
+    WvBinLogHeader *hdr = (WvBinLogHeader *)map;
+    memcpy(hdr->magic, WVBINLOG_MAGIC, sizeof(hdr->magic));
+    hdr->version = WVBINLOG_VERSION;
+    hdr->size = sizeof(WvBinLogHeader);
+    used = sizeof(WvBinLogHeader);
+}
+
+
+// The caller has to make sure it fits.
+void WvBinLogFile::add(WvBinLogRecord::Type type, unsigned source, int level,
+		       const WvTime &when, const char *str, size_t len)
+{
+    WvBinLogRecord *rec = (WvBinLogRecord *)(map + used);
+    rec->source = source;
+    rec->type = type;
+    rec->level = level;
+    rec->sec = when.tv_sec;
+    rec->usec = when.tv_usec;
+    rec->len = len;
+    memcpy(rec + 1, str, len);
+
+    // only now does the record count, in case we die halfway through
+    size_t size = recsize(len);
+    __sync_synchronize();
+    rec->size = size;
+    used += size;
+}
+
+
+unsigned WvBinLogFile::source_id(WvStringParm source, const WvTime &when)
+{
+    // a WvLog passes the same string every time, so usually we can tell
+    // it's the same source without even looking at it
+    if (!!lookup_name && (source.cstr() == lookup_name.cstr()
+			  || source == lookup_name))
+	return lookup_id;
+
+    SourceId *s = sources[source];
+    if (!s)
+    {
+	s = new SourceId(source, sources.count());
+	sources.add(s, true);
+	add(WvBinLogRecord::Source, s->id, 0, when, source, source.len());
+    }
+    lookup_name = source;
+    lookup_id = s->id;
+    return s->id;
+}
+
+
+void WvBinLogFile::log(WvStringParm source, int loglevel,
+		       const char *_buf, size_t len)
+{
+    if (finishing || !is_wanted(source, (WvLog::LogLevel)loglevel))
+	return;
+
+    // a message that wouldn't fit even in an empty file gets cut short
+    size_t srclen = source.len();
+    if (recsize(srclen) + recsize(0) > filesize - sizeof(WvBinLogHeader))
+	return; // not even the source's name would fit
+    size_t room = filesize - sizeof(WvBinLogHeader) - recsize(srclen);
+    if (recsize(len) > room)
+	len = room - sizeof(WvBinLogRecord);
+
+    // leave room for a Source record too, in case we need one
+    if (!map || used + recsize(len) + recsize(srclen) > filesize
+	|| sources.count() >= MAX_SOURCES)
+    {
+	// don't hammer on whatever went wrong last time
+	if (!map && (long long)wvmonotime() < (long long)retry_at)
+	    return;
+	next_file();
+	if (!map)
+	    return;
+    }
+
+    WvTime now = wvtime();
+    unsigned id = source_id(source, now);
+    add(WvBinLogRecord::Message, id, loglevel, now, _buf, len);
+}
+
+
+bool WvBinLogFile::decode(WvStringParm filename, WvLogRcv &rcv)
+{
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+	return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(WvBinLogHeader))
+    {
+	close(fd);
+	return false;
+    }
+    size_t size = st.st_size;
+    void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+	return false;
+    const char *map = (const char *)p;
+
+    const WvBinLogHeader *hdr = (const WvBinLogHeader *)map;
+    bool ok = !memcmp(hdr->magic, WVBINLOG_MAGIC, sizeof(hdr->magic))
+	&& hdr->version == WVBINLOG_VERSION
+	&& hdr->size >= sizeof(WvBinLogHeader) && hdr->size <= size;
+
+    // source ids count up from zero, so an array is all we need
+    WvString *names = NULL;
+    size_t nnames = 0, names_size = 0;
+
+    for (size_t pos = ok ? hdr->size : size;
+	 pos + sizeof(WvBinLogRecord) <= size; )
+    {
+	const WvBinLogRecord *rec = (const WvBinLogRecord *)(map + pos);
+	if (!rec->size)
+	    break; // the end
+	if (rec->size < recsize(rec->len) || rec->size > size - pos)
+	{
+	    ok = false;
+	    break;
+	}
+	const char *text = (const char *)(rec + 1);
+
+	if (rec->type == WvBinLogRecord::Source)
+	{
+	    if (rec->source != nnames)
+	    {
+		ok = false;
+		break;
+	    }
+	    if (nnames == names_size)
+	    {
+		names_size = names_size ? names_size * 2 : 16;
+		WvString *newnames = new WvString[names_size];
+		for (size_t n = 0; n < nnames; n++)
+		    newnames[n] = names[n];
+		delete[] names;
+		names = newnames;
+	    }
+	    WvString &name = names[nnames++];
+	    name.setsize(rec->len + 1);
+	    memcpy(name.edit(), text, rec->len);
+	    name.edit()[rec->len] = 0;
+	}
+	else if (rec->type == WvBinLogRecord::Message)
+	{
+	    if (rec->source >= nnames || rec->level >= WvLog::NUM_LOGLEVELS)
+	    {
+		ok = false;
+		break;
+	    }
+	    rcv.log_at(rec->sec, names[rec->source], rec->level,
+		       text, rec->len);
+	}
+	// else a kind of record we don't know about; skip it
+
+	pos += rec->size;
+    }
+
+    delete[] names;
+    munmap(p, size);
+    return ok;
+}
@@ -54,16 +54,16 @@ void WvColorLogConsole::_begin_line()
     if (colorize)
     {
         const char *seq = WvColorLogConsole::color_start_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
     }
     WvLogConsole::_begin_line();
     if (colorize)
     {
         const char *seq;
         seq = WvColorLogConsole::clear_to_eol_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
         seq = WvColorLogConsole::color_end_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
     }
 }
 
@@ -74,16 +74,16 @@ void WvColorLogConsole::_mid_line(const char *str, size_t len)
     {
         const char *seq;
         seq = WvColorLogConsole::color_start_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
     }
     WvLogConsole::_mid_line(str, len);
     if (colorize)
     {
         const char *seq;
         seq = WvColorLogConsole::clear_to_eol_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
         seq = WvColorLogConsole::color_end_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
     }
 }
 
@@ -94,11 +94,11 @@ void WvColorLogConsole::_end_line()
     {
         const char *seq;
         seq = WvColorLogConsole::color_start_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
         seq = WvColorLogConsole::clear_to_eol_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
         seq = WvColorLogConsole::color_end_seq(last_level);
-        uwrite(seq, strlen(seq));
+        buffer_line(seq, strlen(seq));
     }
     WvLogConsole::_end_line();
 }
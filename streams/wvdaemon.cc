@@ -16,11 +16,17 @@
 #include "wvcrashlog.h"
 #include "wvfile.h"
 #include "wvatomicfile.h"
+#include "wvlistener.h"
 
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <fcntl.h>
+#include <poll.h>
+
+extern char **environ;
 #else
 #include "wvlogrcv.h"
 #endif
@@ -82,6 +88,16 @@ void WvDaemon::init(WvStringParm _name,
     daemonize = false;
     log_level = WvLog::Info;
     syslog = false;
+    handoff_restart = false;
+    handoff_timeout = 10000;
+    drain_timeout = 60000;
+    _argv = NULL;
+    _argv0 = NULL;
+    handoff_fd = -1;
+    handoff_pid = 0;
+    successor_fd = -1;
+    successor_pid = 0;
+    _draining = _handed_off = false;
     start_callback = _start_callback;
     run_callback = _run_callback;
     stop_callback = _stop_callback;
@@ -106,6 +122,10 @@ void WvDaemon::init(WvStringParm _name,
 	args.add_reset_bool_option(0, "no-syslog",
 		   "Do not write log entries to syslog", syslog);
     }
+    if (CAN_DAEMONIZE)
+	args.add_set_bool_option(0, "handoff-restart",
+		 "On SIGHUP, start a new copy and hand it the listening sockets",
+		 handoff_restart);
     
     args.set_version(WvString("%s version %s", name, version).cstr());
 }
@@ -205,6 +225,7 @@ int WvDaemon::run(int argc, char **argv)
 {
     if (!args.process(argc, argv, &_extra_args))
         return 1;
+    _argv = argv;
     return run(argv[0]);
 }
 
@@ -212,6 +233,7 @@ int WvDaemon::run(int argc, char **argv)
 int WvDaemon::_run(const char *argv0)
 {
     WvLogRcv *logr = NULL;
+    _argv0 = argv0;
 #ifndef _WIN32
     WvCrashLog crashlog;
     wvcrash_setup(argv0, version);
@@ -220,6 +242,8 @@ int WvDaemon::_run(const char *argv0)
     if (CAN_SYSLOG && syslog)
 	logr = new WvSyslog(name, false);
 
+    receive_handoff();
+
     _want_to_die = false;
     do_load();
     while (!want_to_die())
@@ -227,9 +251,27 @@ int WvDaemon::_run(const char *argv0)
         _want_to_restart = false;
 
         do_start();
+        finish_handoff();
+#ifndef _WIN32
+        // sighup_handler() ignores more SIGHUPs until we're done restarting
+        signal(SIGHUP, sighup_handler);
+#endif
         
         while (should_run())
             do_run();
+
+        if (want_to_restart() && handoff_restart && !_draining
+            && start_handoff())
+        {
+            // somebody else is taking over; keep going until they're ready,
+            // then finish up with the connections we already have and exit
+            _want_to_restart = false;
+            while (should_run())
+            {
+                do_run();
+                check_drained();
+            }
+        }
         
         do_stop();
     }
@@ -257,7 +299,8 @@ void WvDaemon::do_load()
             if (!!line)
             {
                 pid_t old_pid = line.num();
-                if (old_pid > 0 && (kill(old_pid, 0) == 0 || errno == EPERM))
+                if (old_pid > 0 && old_pid != handoff_pid
+                    && (kill(old_pid, 0) == 0 || errno == EPERM))
                 {
                     log(WvLog::Error,
                             "%s is already running (pid %s); exiting\n",
@@ -332,12 +375,227 @@ void WvDaemon::do_unload()
     log(WvLog::Notice, "Exiting with status %s\n", _exit_status);
 
 #ifndef _WIN32    
-    if (!!pid_file && daemonize)
+    // after a handoff, the pid file is the new process's
+    if (!!pid_file && daemonize && !_handed_off)
         ::unlink(pid_file);
 #endif
 }
 
 
+#ifndef _WIN32
+
+// Starts a new copy of ourselves and gives it our listeners.  We keep
+// using them too until successor_ready().
+bool WvDaemon::start_handoff()
+{
+    if (handoff_callback)
+        handoff_callback();
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0)
+    {
+        log(WvLog::Error, "Can't hand off: socketpair: %s\n",
+            strerror(errno));
+        return false;
+    }
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+
+    // set up everything the new process needs before fork(), since the
+    // child mustn't allocate anything if we have threads
+    WvString fdvar("WVDAEMON_HANDOFF_FD=%s", sv[1]);
+    WvString pidvar("WVDAEMON_HANDOFF_PID=%s", getpid());
+    int nenv = 0;
+    while (environ[nenv])
+        nenv++;
+    const char **envp = new const char *[nenv + 3];
+    int n = 0;
+    for (int i = 0; i < nenv; i++)
+        if (strncmp(environ[i], "WVDAEMON_HANDOFF_", 17))
+            envp[n++] = environ[i];
+    envp[n++] = fdvar;
+    envp[n++] = pidvar;
+    envp[n] = NULL;
+
+    const char *argv0_only[] = { _argv0, NULL };
+    char **argv = _argv ? _argv : (char **)argv0_only;
+    const char *exe = access("/proc/self/exe", X_OK) == 0
+        ? "/proc/self/exe" : argv[0];
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execve(exe, argv, (char **)envp);
+        _exit(127);
+    }
+    delete[] envp;
+    ::close(sv[1]);
+    if (pid < 0)
+    {
+        log(WvLog::Error, "Can't hand off: fork: %s\n", strerror(errno));
+        ::close(sv[0]);
+        return false;
+    }
+
+    if (WvListener::send_handoff(sv[0]) < 0)
+    {
+        log(WvLog::Error, "Can't hand off to pid %s: %s\n",
+            pid, strerror(errno));
+        ::close(sv[0]);
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return false;
+    }
+
+    log(WvLog::Notice, "Handing off to pid %s.\n", pid);
+    successor_fd = sv[0];
+    successor_pid = pid;
+    _draining = true;
+    drain_deadline = msecadd(wvtime(), handoff_timeout);
+    return true;
+}
+
+
+// Returns 1 if the process we're handing off to says it's running, 0 if
+// it hasn't yet, or -1 if it never will.
+int WvDaemon::successor_ready()
+{
+    struct pollfd pfd;
+    pfd.fd = successor_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 0) == 0)
+        return msecdiff(wvtime(), drain_deadline) < 0 ? 0 : -1;
+
+    char buf[16];
+    ssize_t len = recv(successor_fd, buf, sizeof(buf), 0);
+    if (len < 0 && (errno == EINTR || errno == EAGAIN))
+        return 0;
+    return len == 5 && !memcmp(buf, "ready", 5) ? 1 : -1;
+}
+
+
+// If we're replacing a process that's handing off to us, get its
+// listeners before anything might try to create its own.
+void WvDaemon::receive_handoff()
+{
+    const char *fdvar = getenv("WVDAEMON_HANDOFF_FD");
+    if (!fdvar)
+        return;
+    const char *pidvar = getenv("WVDAEMON_HANDOFF_PID");
+    handoff_fd = atoi(fdvar);
+    handoff_pid = pidvar ? atoi(pidvar) : 0;
+    unsetenv("WVDAEMON_HANDOFF_FD");
+    unsetenv("WVDAEMON_HANDOFF_PID");
+    fcntl(handoff_fd, F_SETFD, FD_CLOEXEC);
+
+    int count = WvListener::receive_handoff(handoff_fd);
+    if (count < 0)
+    {
+        log(WvLog::Warning, "Failed to take over listeners from pid %s: %s\n",
+            handoff_pid, strerror(errno));
+        ::close(handoff_fd);
+        handoff_fd = -1;
+    }
+    else
+        log(WvLog::Info, "Taking over %s listener(s) from pid %s.\n",
+            count, handoff_pid);
+}
+
+
+// Tells the process we took over from that it can stop listening.
+void WvDaemon::finish_handoff()
+{
+    if (handoff_fd < 0)
+        return;
+
+    if (send(handoff_fd, "ready", 5, MSG_NOSIGNAL) != 5)
+        log(WvLog::Warning, "Failed to tell pid %s we're running: %s\n",
+            handoff_pid, strerror(errno));
+    ::close(handoff_fd);
+    handoff_fd = -1;
+
+    int unused = WvListener::close_inherited();
+    if (unused)
+        log(WvLog::Info, "Closed %s listener(s) we don't use any more.\n",
+            unused);
+}
+
+#else // _WIN32
+
+bool WvDaemon::start_handoff()
+{
+    log(WvLog::Error, "Can't hand off to a new process on this system.\n");
+    return false;
+}
+
+
+int WvDaemon::successor_ready()
+{
+    return -1;
+}
+
+
+void WvDaemon::receive_handoff()
+{
+}
+
+
+void WvDaemon::finish_handoff()
+{
+}
+
+#endif // _WIN32
+
+
+void WvDaemon::check_drained()
+{
+    if (!_draining || !should_run())
+        return;
+
+#ifndef _WIN32
+    if (successor_fd >= 0)
+    {
+        int ready = successor_ready();
+        if (!ready)
+            return;
+
+        ::close(successor_fd);
+        successor_fd = -1;
+        if (ready < 0)
+        {
+            log(WvLog::Error, "New process (pid %s) didn't start; "
+                "restarting in this one.\n", successor_pid);
+            kill(successor_pid, SIGTERM);
+            waitpid(successor_pid, NULL, 0);
+            _draining = false;
+            restart();
+            return;
+        }
+
+        // when daemonizing, that was the first of the new process's two
+        // forks, and it's gone already
+        waitpid(successor_pid, NULL, WNOHANG);
+
+        int closed = WvListener::close_handed_off();
+        log(WvLog::Notice, "Handed %s listener(s) to pid %s; "
+            "finishing up with existing connections.\n",
+            closed, successor_pid);
+        _handed_off = true;
+        drain_deadline = msecadd(wvtime(), drain_timeout);
+    }
+#endif
+
+    if (is_drained())
+    {
+        log(WvLog::Notice, "All connections are finished; exiting.\n");
+        die();
+    }
+    else if (msecdiff(wvtime(), drain_deadline) >= 0)
+    {
+        log(WvLog::Notice, "Connections are taking too long; exiting.\n");
+        die();
+    }
+}
+
 bool WvDaemon::set_daemonize(void *)
 {
     daemonize = true;
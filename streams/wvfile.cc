@@ -6,10 +6,17 @@
  */
 #include "wvfile.h"
 #include "wvmoniker.h"
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 WvFile::WvFile()
 {
     readable = writable = false;
+#ifndef _WIN32
+    mapbuf = NULL;
+#endif
 }
 
 #ifndef _WIN32 // meaningless to do this on win32
@@ -19,6 +26,7 @@ WvFile::WvFile()
  */
 WvFile::WvFile(int rwfd) : WvFDStream(rwfd)
 {
+    mapbuf = NULL;
     if (rwfd > -1)
     {
 	/* We have to do it this way since O_RDONLY is defined as 0
@@ -36,10 +44,21 @@ WvFile::WvFile(int rwfd) : WvFDStream(rwfd)
 
 WvFile::WvFile(WvStringParm filename, int mode, int create_mode)
 {
+#ifndef _WIN32
+    mapbuf = NULL;
+#endif
     open(filename, mode, create_mode);
 }
 
 
+WvFile::~WvFile()
+{
+#ifndef _WIN32
+    delete mapbuf;
+#endif
+}
+
+
 static IWvStream *increator(WvStringParm s, IObject*)
 {
     return new WvFile(s, O_RDONLY, 0666);
@@ -153,3 +172,38 @@ bool WvFile::post_select(SelectInfo &si)
     return WvFDStream::post_select(si);
 #endif
 }
+
+
+#ifndef _WIN32
+WvMmapBuf *WvFile::mapped(size_t window)
+{
+    delete mapbuf;
+    mapbuf = NULL;
+
+    int fd = getrfd();
+    struct stat st;
+    if (!readable || fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+	return NULL;
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0)
+	return NULL;
+
+    // what we read ahead is still in inbuf, so map it instead
+    pos -= inbuf.used();
+    int mapfd = pos >= 0 ? dup(fd) : -1;
+    if (mapfd < 0)
+	return NULL;
+    mapbuf = new WvMmapBuf(mapfd, pos,
+			   st.st_size > pos ? st.st_size - pos : 0, window);
+    if (!mapbuf->isok())
+    {
+	delete mapbuf;
+	mapbuf = NULL;
+	return NULL;
+    }
+
+    inbuf.zap();
+    lseek(fd, st.st_size, SEEK_SET);
+    return mapbuf;
+}
+#endif
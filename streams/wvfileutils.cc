@@ -80,6 +80,28 @@ bool fcopy(WvStringParm src, WvStringParm dst)
     WvFile out(dst, O_CREAT|O_WRONLY, buf.st_mode & 007777);
     umask(oldmode);
 
+#ifndef _WIN32
+    // write out what we can straight from the mapped file; the
+    // autoforward below picks up anything that's left (or everything, if
+    // it couldn't be mapped)
+    WvBuf *data = in.mapped();
+    while (data && data->used() && out.isok())
+    {
+	size_t len = data->optgettable();
+	if (len > 1024*1024)
+	    len = 1024*1024;
+	const void *p = data->get(len);
+	if (!p)
+	{
+	    // couldn't map the next window.  mapped() left 'in' at the end
+	    // of the buffer, so back it up to the first byte we didn't get.
+	    lseek(in.getrfd(), -(off_t)data->used(), SEEK_CUR);
+	    break;
+	}
+	out.write(p, len);
+    }
+#endif
+
     in.autoforward(out);
     while (in.isok() && out.isok())
     {
@@ -39,8 +39,16 @@
 WvIStreamList WvIStreamList::globallist;
 
 
+struct WvIStreamList::Soon
+{
+    IWvStreamCallback cb;
+    Soon *next;
+};
+
+
 WvIStreamList::WvIStreamList():
-    in_select(false), dead_stream(false)
+    in_select(false), dead_stream(false),
+    soon(NULL), soon_tail(&soon), soon_spare(NULL), nsoon(0)
 {
     readcb = writecb = exceptcb = 0;
     auto_prune = true;
@@ -59,6 +67,63 @@ WvIStreamList::WvIStreamList():
 WvIStreamList::~WvIStreamList()
 {
     close();
+    zap_soon();
+    while (soon_spare)
+    {
+	Soon *next = soon_spare->next;
+	delete soon_spare;
+	soon_spare = next;
+    }
+}
+
+
+void WvIStreamList::runsoon(const IWvStreamCallback &cb)
+{
+    Soon *s = soon_spare;
+    if (s)
+	soon_spare = s->next;
+    else
+	s = new Soon;
+    s->cb = cb;
+    s->next = NULL;
+    *soon_tail = s;
+    soon_tail = &s->next;
+    nsoon++;
+}
+
+
+void WvIStreamList::run_soon()
+{
+    // take the whole queue first, so that callbacks queued from in here
+    // (or from a nested select) don't keep us going forever.
+    Soon *s = soon;
+    soon = NULL;
+    soon_tail = &soon;
+    nsoon = 0;
+
+    while (s)
+    {
+	Soon *next = s->next;
+	IWvStreamCallback cb;
+	cb.swap(s->cb);
+	s->next = soon_spare;
+	soon_spare = s;
+	cb();
+	s = next;
+    }
+}
+
+
+void WvIStreamList::zap_soon()
+{
+    while (soon)
+    {
+	Soon *next = soon->next;
+	delete soon;
+	soon = next;
+    }
+    soon_tail = &soon;
+    nsoon = 0;
 }
 
 
@@ -95,7 +160,7 @@ void WvIStreamList::pre_select(SelectInfo &si)
     sure_thing.zap();
     
     time_t alarmleft = alarm_remaining();
-    if (alarmleft == 0)
+    if (alarmleft == 0 || soon)
 	already_sure = true;
 
     IWvStream *old_in_stream = WvCrashInfo::in_stream;
@@ -145,7 +210,7 @@ bool WvIStreamList::post_select(SelectInfo &si)
     SelectRequest oldwant = si.wants;
     
     time_t alarmleft = alarm_remaining();
-    if (alarmleft == 0)
+    if (alarmleft == 0 || soon)
 	already_sure = true;
 
     IWvStream *old_in_stream = WvCrashInfo::in_stream;
@@ -264,6 +329,13 @@ void WvIStreamList::execute()
 
     sure_thing.zap();
 
+    if (soon)
+    {
+	WvCrashInfo::in_stream_id = "runsoon";
+	run_soon();
+	WvCrashInfo::in_stream_id = old_in_stream_id;
+    }
+
     level--;
     TRACE("[DONE %p]\n", this);
 }
@@ -275,6 +347,7 @@ void WvIStreamList::onfork(pid_t p)
     {
         // this is a child process: don't inherit the global streamlist
         globallist.zap(false);
+        globallist.zap_soon();
     }
 }
 #endif
@@ -12,6 +12,9 @@
 #include "wvfork.h"
 
 #include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #ifdef _WIN32
 #define snprintf _snprintf
@@ -229,11 +232,53 @@ WvLogRcv::WvLogRcv(WvLog::LogLevel _max_level) : custom_levels(5)
     last_time = 0;
     max_level = _max_level;
     at_newline = true;
+    linebuf = NULL;
+    linebuf_used = linebuf_size = 0;
+    flushing = false;
 }
 
 
 WvLogRcv::~WvLogRcv()
 {
+    free(linebuf);
+}
+
+
+void WvLogRcv::grow_linebuf(size_t len)
+{
+    size_t size = linebuf_size ? linebuf_size : 1024;
+    while (size < linebuf_used + len)
+	size *= 2;
+    linebuf = (char *)realloc(linebuf, size);
+    linebuf_size = size;
+}
+
+
+void WvLogRcv::flush_lines()
+{
+    // Writing might log something through us again.  That goes into a new
+    // buffer, which we write after this one.
+    if (flushing)
+	return;
+    flushing = true;
+    while (linebuf_used)
+    {
+	char *buf = linebuf;
+	size_t used = linebuf_used, size = linebuf_size;
+	linebuf = NULL;
+	linebuf_used = linebuf_size = 0;
+	
+	_flush_lines(buf, used);
+	
+	if (!linebuf)
+	{
+	    linebuf = buf; // nothing new; keep using the same space
+	    linebuf_size = size;
+	}
+	else
+	    free(buf);
+    }
+    flushing = false;
 }
 
 
@@ -269,40 +314,83 @@ static bool my_isprint(char _c)
 }
 
 
-void WvLogRcv::log(WvStringParm source, int _loglevel,
-			const char *_buf, size_t len)
+// Returns the first character that isn't my_isprint() (which includes
+// '\n'), or bufend if there isn't one.  Most log messages are nothing but
+// printable characters, so we check 16 at a time where we can: the
+// unprintable ones are the ASCII control characters.
+static const char *find_unprintable(const char *buf, const char *bufend)
 {
-    WvLog::LogLevel loglevel = (WvLog::LogLevel)_loglevel;
-    char hex[5];
-    WvLog::LogLevel threshold = max_level;
-    WvString srcname(source);
-    strlwr(srcname.edit());
+#ifdef __SSE2__
+    const __m128i ctl = _mm_set1_epi8(0x1f), del = _mm_set1_epi8(0x7f);
+    for (; bufend - buf >= 16; buf += 16)
+    {
+	__m128i x = _mm_loadu_si128((const __m128i *)buf);
+	__m128i bad = _mm_or_si128(
+	    _mm_cmpeq_epi8(_mm_max_epu8(x, ctl), ctl), // x <= 0x1f
+	    _mm_cmpeq_epi8(x, del));
+	int mask = _mm_movemask_epi8(bad);
+	if (mask)
+	    return buf + __builtin_ctz(mask);
+    }
+#endif
+    for (; buf < bufend; buf++)
+    {
+	if (!my_isprint(*buf))
+	    break;
+    }
+    return buf;
+}
+
 
-    Src_LvlDict::Iter i(custom_levels);
-    i.rewind(); 
+bool WvLogRcv::is_wanted(WvStringParm source, WvLog::LogLevel loglevel)
+{
+    WvLog::LogLevel threshold = max_level;
 
     // Check if the debug level for the source has been overridden
-    while (i.next())
+    if (custom_levels.count())
     {
-        if (strstr(srcname, i->src))
-        {
-            threshold = i->lvl;
-            break;
-        }
+	WvString srcname(source);
+	strlwr(srcname.edit());
+
+	Src_LvlDict::Iter i(custom_levels);
+	for (i.rewind(); i.next(); )
+	{
+	    if (strstr(srcname, i->src))
+	    {
+		threshold = i->lvl;
+		break;
+	    }
+	}
     }
      
-    if (loglevel > threshold)
+    return loglevel <= threshold;
+}
+
+
+void WvLogRcv::log(WvStringParm source, int _loglevel,
+			const char *_buf, size_t len)
+{
+    log_at(wvtime().tv_sec, source, _loglevel, _buf, len);
+}
+
+
+void WvLogRcv::log_at(time_t now, WvStringParm source, int _loglevel,
+		      const char *_buf, size_t len)
+{
+    WvLog::LogLevel loglevel = (WvLog::LogLevel)_loglevel;
+    char hex[5];
+
+    if (!is_wanted(source, loglevel))
 	return;
 
     // only need to start a new line with new headers if they headers have
     // changed.  if the source and level are the same as before, just continue
     // the previous log entry.
-    time_t now = wvtime().tv_sec;
     if (source != last_source
             || loglevel != last_level
             || WvLogRcvBase::force_new_line)
     {
-	end_line();
+	end_line(); // and write it out before _make_prefix() changes files
 	last_source = source;
 	last_level = loglevel;
         last_time = now;
@@ -327,7 +415,7 @@ void WvLogRcv::log(WvStringParm source, int _loglevel,
     {
 	if (buf[0] == '\n' || buf[0] == '\r')
 	{
-	    end_line();
+	    finish_line();
 	    buf++;
 	    continue;
 	}
@@ -348,29 +436,14 @@ void WvLogRcv::log(WvStringParm source, int _loglevel,
 	    continue;
 	}
 
-	// like strchr, but size-limited instead of null-terminated
-	for (cptr = buf; cptr < bufend; cptr++)
-	{
-	    if (*cptr == '\n' || !my_isprint(*cptr))
-		break;
-	}
-	
-	if (cptr >= bufend) // end of buffer
-	{
-	    mid_line(buf, bufend - buf);
-	    buf = bufend;
-	}
-	else if (*cptr == '\n') // end of line
-	{
-	    mid_line((const char *)buf, cptr - buf);
-	    buf = cptr;
-	}
-	else // therefore (!my_isprint(*cptr))
-	{
-	    mid_line(buf, cptr - buf);
-	    buf = cptr;
-	}
+	// everything up to the end of the line, or the next character that
+	// needs to be escaped
+	cptr = find_unprintable(buf, bufend);
+	mid_line(buf, cptr - buf);
+	buf = cptr;
     }
+    
+    flush_lines();
 }
 
 // input format: name=number, name=number, name=number, etc.
@@ -430,6 +503,12 @@ WvLogConsole::~WvLogConsole()
 
 
 void WvLogConsole::_mid_line(const char *str, size_t len)
+{
+    buffer_line(str, len);
+}
+
+
+void WvLogConsole::_flush_lines(const char *str, size_t len)
 {
     uwrite(str, len);
 }
@@ -39,6 +39,7 @@ WvLogFileBase::WvLogFileBase(WvStringParm _filename, WvLog::LogLevel _max_level)
       WvFile(_filename, O_WRONLY|O_APPEND|O_CREAT|O_LARGEFILE, 0644)
 {
     fsync_every = fsync_count = 0;
+    stamp_time = -1;
 }
 
 
@@ -46,10 +47,17 @@ WvLogFileBase::WvLogFileBase(WvLog::LogLevel _max_level)
     : WvLogRcv(_max_level) 
 { 
     fsync_every = fsync_count = 0;
+    stamp_time = -1;
 }
 
 
 void WvLogFileBase::_mid_line(const char *str, size_t len)
+{
+    buffer_line(str, len);
+}
+
+
+void WvLogFileBase::_flush_lines(const char *str, size_t len)
 {
     WvFile::write(str, len);
 }
@@ -64,6 +72,7 @@ void WvLogFileBase::_end_line()
         {
             fsync_count = fsync_every;
             //WvFile::print("tick!\n");
+            flush_lines();
             WvFile::flush(1000);
             fsync(getwfd());
         }
@@ -78,11 +87,16 @@ void WvLogFileBase::_end_line()
 
 void WvLogFileBase::_make_prefix(time_t timenow)
 {
-    struct tm* tmstamp = localtime(&timenow);
-    char timestr[30];
-    strftime(&timestr[0], 30, TIME_FORMAT, tmstamp);
+    // there's a new prefix whenever the source or level changes, but the
+    // time only needs formatting once a second
+    if (timenow != stamp_time)
+    {
+        struct tm* tmstamp = localtime(&timenow);
+        strftime(stamp, sizeof(stamp), TIME_FORMAT, tmstamp);
+        stamp_time = timenow;
+    }
 
-    prefix = WvString("%s: %s<%s>: ", timestr, last_source,
+    prefix = WvString("%s: %s<%s>: ", stamp, last_source,
         loglevels[last_level]);
     prelen = prefix.len();
 }
@@ -91,8 +105,8 @@ void WvLogFileBase::_make_prefix(time_t timenow)
 
 WvLogFile::WvLogFile(WvStringParm _filename, WvLog::LogLevel _max_level,
                      int _keep_for, bool _force_new_line, bool _allow_append)
-    : WvLogFileBase(_max_level), keep_for(_keep_for), filename(_filename),
-      allow_append(_allow_append)
+    : WvLogFileBase(_max_level), keep_for(_keep_for), last_checked(0),
+      filename(_filename), allow_append(_allow_append)
 {
     WvLogRcv::force_new_line = _force_new_line;
     // start_log(); // don't open log until the first message gets printed
@@ -103,17 +117,23 @@ void WvLogFile::_make_prefix(time_t timenow)
     if (!WvFile::isok())
 	start_log();
     
-    // struct tm *tmstamp = localtime(&timenow);
-    struct stat statbuf;
-
-    // Get the filesize
-    if (fstat(getfd(), &statbuf) == -1)
-        statbuf.st_size = 0;
-
-    // Make sure we are calculating last_day in the current time zone.
-    if (last_day != ((timenow + gmtoffset())/86400) 
-	|| statbuf.st_size > MAX_LOGFILE_SZ)
-        start_log();
+    // checking once a second is plenty
+    if (timenow != last_checked)
+    {
+        last_checked = timenow;
+        
+        // struct tm *tmstamp = localtime(&timenow);
+        struct stat statbuf;
+
+        // Get the filesize
+        if (fstat(getfd(), &statbuf) == -1)
+            statbuf.st_size = 0;
+
+        // Make sure we are calculating last_day in the current time zone.
+        if (last_day != ((timenow + gmtoffset())/86400) 
+            || statbuf.st_size > MAX_LOGFILE_SZ)
+            start_log();
+    }
 
     WvLogFileBase::_make_prefix(timenow);
 }
@@ -138,6 +158,7 @@ static void trim_old_logs(WvStringParm filename, WvStringParm base,
 
 WvString WvLogFile::start_log()
 {
+    flush_lines(); // they belong in the old file
     WvFile::close();
 
     int num = 0;
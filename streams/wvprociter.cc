@@ -11,6 +11,9 @@
 #include "wvfileutils.h"
 #include <sys/types.h>
 #include <signal.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 WvProcIter::WvProcIter() :
     dir_iter("/proc", false, true)
@@ -64,16 +67,204 @@ bool WvProcIter::next()
     return true;
 }
 
+WvProcTable::WvProcTable() :
+    generation(0), bypid(1024), byname(256)
+{
+    procfd = open("/proc", O_RDONLY | O_DIRECTORY);
+    if (procfd < 0)
+	fprintf(stderr, "WARNING: Can't open /proc: is it mounted?\n");
+    else
+        refresh();
+}
+
+
+WvProcTable::~WvProcTable()
+{
+    if (procfd >= 0)
+        close(procfd);
+}
+
+
+// Reads the whole of a (small) /proc file into buf and nul-terminates it.
+// Returns the number of bytes read, or -1 on error.
+static ssize_t read_procfile(int dirfd, const char *name,
+                             char *buf, size_t len)
+{
+    int fd = openat(dirfd, name, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    size_t used = 0;
+    while (used < len - 1)
+    {
+        ssize_t got = read(fd, buf + used, len - 1 - used);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            break;
+        used += got;
+    }
+    close(fd);
+    buf[used] = '\0';
+    return used;
+}
+
+
+void WvProcTable::read_proc(int pidfd, WvProcTableEnt &ent)
+{
+    char buf[4096];
+
+    ssize_t len = readlinkat(pidfd, "exe", buf, sizeof(buf) - 1);
+    if (len >= 0)
+    {
+        buf[len] = '\0';
+        ent.exe = buf;
+    }
+    else
+        ent.exe = WvString::null;
+
+    ent.cmdline.zap();
+    len = read_procfile(pidfd, "cmdline", buf, sizeof(buf));
+    for (const char *p = buf; len > 0 && p < buf + len; p += strlen(p) + 1)
+    {
+        WvString arg(p);
+        arg.unique();
+        ent.cmdline.append(arg);
+    }
+
+    if (!ent.cmdline.isempty() && !!*ent.cmdline.first())
+        ent.name = getfilename(*ent.cmdline.first());
+    else
+        ent.name = WvString::null;
+}
+
+
+void WvProcTable::add_name(WvProcTableEnt *ent)
+{
+    if (!ent->name)
+        return;
+    WvProcTableName *n = byname[ent->name];
+    if (!n)
+    {
+        n = new WvProcTableName(ent->name);
+        byname.add(n, true);
+    }
+    n->procs.append(ent, false);
+}
+
+
+void WvProcTable::del_name(WvProcTableEnt *ent)
+{
+    if (!ent->name)
+        return;
+    WvProcTableName *n = byname[ent->name];
+    if (!n)
+        return;
+    n->procs.unlink(ent);
+    if (n->procs.isempty())
+        byname.remove(n);
+}
+
+
+void WvProcTable::del(WvProcTableEnt *ent)
+{
+    del_name(ent);
+    bypid.remove(ent);
+}
+
+
+size_t WvProcTable::refresh()
+{
+    if (procfd < 0)
+        return 0;
+
+    int dirfd = dup(procfd);
+    DIR *dir = dirfd >= 0 ? fdopendir(dirfd) : NULL;
+    if (!dir)
+    {
+        if (dirfd >= 0)
+            close(dirfd);
+        return 0;
+    }
+    rewinddir(dir);
+
+    ++generation;
+    size_t nread = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL)
+    {
+        pid_t pid;
+        if (!isdigit(de->d_name[0]) || !wvstring_to_num(de->d_name, pid))
+            continue;
+
+        // A process's /proc directory gets a fresh inode when its pid is
+        // reused, so fstatat() is enough to tell if we've seen it before.
+        struct stat st;
+        if (fstatat(procfd, de->d_name, &st, 0) < 0)
+            continue; // exited since readdir()
+
+        WvProcTableEnt *ent = bypid[pid];
+        if (ent && (ent->dirino != st.st_ino
+                    || ent->dirctime != st.st_ctime))
+        {
+            // pid was reused by a new process
+            del(ent);
+            ent = NULL;
+        }
+
+        if (!ent)
+        {
+            int pidfd = openat(procfd, de->d_name, O_RDONLY | O_DIRECTORY);
+            if (pidfd < 0)
+                continue;
+            ent = new WvProcTableEnt;
+            ent->pid = pid;
+            ent->dirino = st.st_ino;
+            ent->dirctime = st.st_ctime;
+            read_proc(pidfd, *ent);
+            close(pidfd);
+            bypid.add(ent, true);
+            add_name(ent);
+            ++nread;
+        }
+        ent->generation = generation;
+    }
+    closedir(dir);
+
+    // forget about processes that have gone away
+    WvProcTableEntList dead;
+    WvProcTableEntDict::Iter i(bypid);
+    for (i.rewind(); i.next(); )
+        if (i->generation != generation)
+            dead.append(i.ptr(), false);
+
+    WvProcTableEntList::Iter j(dead);
+    for (j.rewind(); j.next(); )
+        del(j.ptr());
+
+    return nread;
+}
+
+
+const WvProcTableEntList *WvProcTable::find_name(WvStringParm name) const
+{
+    WvProcTableName *n = byname[name];
+    return n ? &n->procs : NULL;
+}
+
+
 bool wvkillall(WvStringParm name, int sig)
 {
     bool found = false;
-    WvProcIter i;
+    WvProcTable t;
+    const WvProcTableEntList *procs = t.find_name(name);
+    if (!procs)
+        return false;
+
+    WvProcTableEntList::Iter i(*procs);
     for (i.rewind(); i.next(); )
     {
-        if (!i->cmdline.isempty()
-                && !!*i->cmdline.first()
-                && getfilename(*i->cmdline.first()) == name
-                && i->pid > 0)
+        if (i->pid > 0)
         {
             ::kill(i->pid, sig);
             found = true;
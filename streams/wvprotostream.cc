@@ -23,6 +23,8 @@ WvProtoStream::WvProtoStream(WvStream *_cloned, WvLog *_debuglog)
     
     log_enable = true;
     state = 0;
+    ntokviews = 0;
+    tokviewline = NULL;
 }
 
 
@@ -138,20 +140,73 @@ WvProtoStream::Token *WvProtoStream::tokline(const char *line)
 { 
     if (!line) return NULL;
     
-    char *newline = strdup(line);
-    
     tokbuf.zap();
     tokbuf.put(line, strlen(line));
+    log_read(line);
+    
+    return next_token();
+}
 
-    if (logp && log_enable)
+
+static const char tokview_whitespace[] = " \t\r\n";
+
+
+/* Logs an input line (with the whitespace trimmed off both ends) if
+ * logging is enabled.  Doesn't change or copy the line.
+ */
+void WvProtoStream::log_read(const char *line)
+{
+    if (!logp || !log_enable)
+	return;
+
+    line += strspn(line, tokview_whitespace);
+    const char *end = line + strlen(line);
+    while (end > line && strchr(tokview_whitespace, end[-1]))
+	end--;
+    if (end > line)
     {
-	if (strlen(trim_string(newline)) > 0)
-	    (*logp)("Read: %s\n", trim_string(newline));
+	(*logp)("Read: ");
+	logp->write(line, end - line);
+	(*logp)("\n");
     }
+}
 
-    free(newline);
-    
-    return next_token();
+
+/* Splits the line in place, the same way next_token() would. */
+size_t WvProtoStream::tokview(char *line)
+{
+    ntokviews = 0;
+    tokviewline = line;
+    if (!line) return 0;
+
+    log_read(line);
+
+    char *p = line;
+    for (;;)
+    {
+	p += strspn(p, tokview_whitespace);
+	if (!*p)
+	    break;
+
+	TokenView &t = tokviews[ntokviews++];
+	t.off = p - line;
+	if (ntokviews == MAX_TOKVIEWS)
+	{
+	    // no room for any more: this one is everything that's left
+	    char *end = p + strlen(p);
+	    while (end > p && strchr(tokview_whitespace, end[-1]))
+		end--;
+	    *end = 0;
+	    t.len = end - p;
+	    break;
+	}
+
+	t.len = strcspn(p, tokview_whitespace);
+	p += t.len;
+	if (*p)
+	    *p++ = 0;
+    }
+    return ntokviews;
 }
 
 
@@ -205,6 +260,82 @@ void WvProtoStream::execute()
 
 
 
+//////////////////////////////////// WvProtoStream::TokenTable
+
+
+
+WvProtoStream::TokenTable::TokenTable(const char **_lookup,
+				      bool _case_sensitive)
+{
+    assert(_lookup);
+    lookup = _lookup;
+    case_sensitive = _case_sensitive;
+
+    int count;
+    for (count = 0; lookup[count]; count++)
+	;
+
+    // at most half full, so there are no long runs of collisions
+    unsigned numslots = 4;
+    while (numslots < (unsigned)count * 2)
+	numslots *= 2;
+    mask = numslots - 1;
+    slots = new int[numslots];
+    memset(slots, 0, numslots * sizeof(int));
+    lengths = new size_t[count];
+
+    for (int i = 0; i < count; i++)
+    {
+	lengths[i] = strlen(lookup[i]);
+
+	// if a word is in there twice, tokanal() finds the first one
+	if (find(lookup[i], lengths[i]) >= 0)
+	    continue;
+	unsigned slot = hash(lookup[i], lengths[i]) & mask;
+	while (slots[slot])
+	    slot = (slot + 1) & mask;
+	slots[slot] = i + 1;
+    }
+}
+
+
+WvProtoStream::TokenTable::~TokenTable()
+{
+    delete[] slots;
+    delete[] lengths;
+}
+
+
+// FNV-1a, folding to lowercase first if it's not case sensitive
+unsigned WvProtoStream::TokenTable::hash(const char *word, size_t len) const
+{
+    unsigned h = 2166136261U;
+    for (size_t i = 0; i < len; i++)
+    {
+	unsigned char c = word[i];
+	h ^= case_sensitive ? c : tolower(c);
+	h *= 16777619U;
+    }
+    return h;
+}
+
+
+int WvProtoStream::TokenTable::find(const char *word, size_t len) const
+{
+    for (unsigned slot = hash(word, len) & mask; slots[slot];
+	 slot = (slot + 1) & mask)
+    {
+	int i = slots[slot] - 1;
+	if (lengths[i] == len
+	    && (case_sensitive ? !memcmp(word, lookup[i], len)
+		: !strncasecmp(word, lookup[i], len)))
+	    return i;
+    }
+    return -1;
+}
+
+
+
 //////////////////////////////////// WvProtoStream::Token
 
 
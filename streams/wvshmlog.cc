@@ -0,0 +1,21 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A "Log Receiver" that keeps recent messages in a WvShmLogRing.
+ */
+#include "wvshmlog.h"
+
+WvShmLog::WvShmLog(size_t nslots, size_t slotsize, const char *filename,
+		   WvLog::LogLevel _max_level)
+    : WvLogRcv(_max_level), ring(nslots, slotsize, filename)
+{
+}
+
+
+void WvShmLog::log(WvStringParm source, int loglevel,
+		   const char *_buf, size_t len)
+{
+    if (is_wanted(source, (WvLog::LogLevel)loglevel))
+	ring.append(wvtime(), loglevel, source, source.len(), _buf, len);
+}
@@ -40,10 +40,26 @@ void WvStreamsDaemon::do_run()
     while (should_run())
     {
         WvDaemon::do_run();
-        WvIStreamList::globallist.runonce();
+        WvIStreamList::globallist.runonce(draining() ? 100 : -1);
+        check_drained();
     }
 }
 
+bool WvStreamsDaemon::is_drained()
+{
+    WvIStreamList::Iter i(WvIStreamList::globallist);
+    for (i.rewind(); i.next(); )
+    {
+        bool ours = false;
+        WvIStreamList::Iter j(streams);
+        for (j.rewind(); !ours && j.next(); )
+            ours = j.ptr() == i.ptr();
+        if (!ours)
+            return false;
+    }
+    return true;
+}
+
 void WvStreamsDaemon::do_stop()
 {
     WvIStreamList::Iter stream(streams);
@@ -85,7 +101,8 @@ void WvStreamsDaemon::add_die_stream(IWvStream *istream,
 
 void WvStreamsDaemon::restart_close_cb(IWvStream *s, const char *id)
 {
-    if (should_run())
+    // after a handoff, our listeners are supposed to close
+    if (should_run() && !draining())
     {
 	WvString err = s->geterr() ? s->errstr() : "no error";
         log(WvLog::Error, "%s is closed (%s); restarting\n",
@@ -96,7 +113,7 @@ void WvStreamsDaemon::restart_close_cb(IWvStream *s, const char *id)
 
 void WvStreamsDaemon::die_close_cb(IWvStream *s, const char *id)
 {
-    if (should_run())
+    if (should_run() && !draining())
     {
 	WvString err = s->geterr() ? s->errstr() : "no error";
         log(WvLog::Error, "%s is closed (%s); dying\n",
@@ -0,0 +1,195 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A pool of threads for work that would otherwise hold up the main loop.
+ * See wvworkpool.h.
+ */
+#include "wvworkpool.h"
+#include "wvistreamlist.h"
+#include <sys/eventfd.h>
+#include <stdint.h>
+
+struct WvWorkPool::Task
+{
+    Job job;
+    DoneCallback done;
+    size_t *left;       // for run(): how many of its jobs aren't done
+    Task *next;
+};
+
+
+WvWorkPool::WvWorkPool(int _nthreads)
+    : WvFdStream(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      quitting(false),
+      todo(NULL), todo_tail(&todo),
+      done(NULL), done_tail(&done),
+      npending(0)
+{
+    if (getrfd() < 0)
+	seterr(errno);
+
+    nthreads = _nthreads;
+    if (nthreads <= 0)
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0)
+	nthreads = 1;
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&work, NULL);
+    pthread_cond_init(&finished, NULL);
+
+    threads = new pthread_t[nthreads];
+    for (int n = 0; n < nthreads; n++)
+	pthread_create(&threads[n], NULL, worker, this);
+}
+
+
+WvWorkPool::~WvWorkPool()
+{
+    pthread_mutex_lock(&lock);
+    quitting = true;
+    pthread_cond_broadcast(&work);
+    pthread_mutex_unlock(&lock);
+
+    for (int n = 0; n < nthreads; n++)
+	pthread_join(threads[n], NULL);
+    deletev threads;
+
+    while (todo)
+    {
+	Task *t = todo;
+	todo = t->next;
+	delete t;
+    }
+    while (done)
+    {
+	Task *t = done;
+	done = t->next;
+	delete t;
+    }
+
+    pthread_cond_destroy(&finished);
+    pthread_cond_destroy(&work);
+    pthread_mutex_destroy(&lock);
+    close();
+}
+
+
+void WvWorkPool::submit(const Job &job, const DoneCallback &_done)
+{
+    Task *t = new Task;
+    t->job = job;
+    t->done = _done;
+    t->left = NULL;
+    t->next = NULL;
+    npending++;
+
+    pthread_mutex_lock(&lock);
+    *todo_tail = t;
+    todo_tail = &t->next;
+    pthread_cond_signal(&work);
+    pthread_mutex_unlock(&lock);
+}
+
+
+void WvWorkPool::run(const Job *jobs, size_t njobs)
+{
+    size_t left = njobs;
+
+    pthread_mutex_lock(&lock);
+    for (size_t n = 0; n < njobs; n++)
+    {
+	Task *t = new Task;
+	t->job = jobs[n];
+	t->left = &left;
+	t->next = NULL;
+	*todo_tail = t;
+	todo_tail = &t->next;
+    }
+    pthread_cond_broadcast(&work);
+    while (left)
+	pthread_cond_wait(&finished, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+
+void *WvWorkPool::worker(void *_pool)
+{
+    WvWorkPool &pool = *(WvWorkPool *)_pool;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;)
+    {
+	while (!pool.todo && !pool.quitting)
+	    pthread_cond_wait(&pool.work, &pool.lock);
+	if (pool.quitting)
+	    break;
+
+	Task *t = pool.todo;
+	pool.todo = t->next;
+	if (!pool.todo)
+	    pool.todo_tail = &pool.todo;
+	t->next = NULL;
+
+	pthread_mutex_unlock(&pool.lock);
+	t->job();
+	pthread_mutex_lock(&pool.lock);
+
+	if (t->left)
+	{
+	    if (!--*t->left)
+		pthread_cond_broadcast(&pool.finished);
+	    delete t;
+	    continue;
+	}
+
+	// the main loop only needs poking once, however many are done
+	if (!pool.done)
+	{
+	    uint64_t one = 1;
+	    ::write(pool.getwfd(), &one, sizeof(one));
+	}
+	*pool.done_tail = t;
+	pool.done_tail = &t->next;
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+
+void WvWorkPool::execute()
+{
+    WvFdStream::execute();
+
+    uint64_t junk;
+    ::read(getrfd(), &junk, sizeof(junk));
+
+    pthread_mutex_lock(&lock);
+    Task *list = done;
+    done = NULL;
+    done_tail = &done;
+    pthread_mutex_unlock(&lock);
+
+    while (list)
+    {
+	Task *t = list;
+	list = t->next;
+	npending--;
+	if (t->done)
+	    t->done();
+	delete t;
+    }
+}
+
+
+WvWorkPool &WvWorkPool::global()
+{
+    static WvWorkPool *pool;
+    if (!pool)
+    {
+	pool = new WvWorkPool;
+	WvIStreamList::globallist.append(pool, false, "global work pool");
+    }
+    return *pool;
+}
@@ -71,10 +71,12 @@ class UniConfd : public WvStreamsDaemon
     WvString permmon;
     WvStringList lmonikers;
     time_t commit_interval;
+    int nthreads;
 
     UniConfRoot cfg;
     bool first_time;
     IUniConfGen *permgen;
+    UniConfDaemon *daemon;
     
     bool namedgen_cb(WvStringParm option, void *)
     {
@@ -140,7 +142,8 @@ class UniConfd : public WvStreamsDaemon
 
         permgen = !!permmon ? wvcreate<IUniConfGen>(permmon) : NULL;
         
-        UniConfDaemon *daemon = new UniConfDaemon(cfg, needauth, permgen);
+        daemon = new UniConfDaemon(cfg, needauth, permgen);
+        daemon->setthreads(nthreads);
         add_die_stream(daemon, true, "uniconfd");
 	
 	if (lmonikers.isempty())
@@ -163,6 +166,25 @@ class UniConfd : public WvStreamsDaemon
         if (first_time)
             first_time = false;
     }
+
+    void save()
+    {
+        // so the process we're handing off to starts with our changes
+        cfg.commit();
+    }
+
+protected:
+
+    virtual void do_stop()
+    {
+        WvStreamsDaemon::do_stop();
+        daemon = NULL; // deleted by the globallist
+    }
+
+    virtual bool is_drained()
+    {
+        return !daemon || !daemon->connections();
+    }
     
 public:
 
@@ -171,9 +193,12 @@ public:
 			wv::bind(&UniConfd::startup, this)),
 	needauth(false),
 	commit_interval(5*60),
+	nthreads(0),
 	first_time(true),
-	permgen(NULL)
+	permgen(NULL),
+	daemon(NULL)
     {
+        handoff_callback = wv::bind(&UniConfd::save, this);
         args.add_option(0, "pid-file",
                 "Specify the .pid file to use (only applies with --daemonize)", "filename",
                 pid_file);
@@ -185,6 +210,9 @@ public:
 	args.add_option('l', "listen",
 		"Listen on the given socket (eg. tcp:4111, ssl:tcp:4112)",
 		"lmoniker", lmonikers);
+	args.add_option('t', "threads",
+		"Answer reads from a snapshot, using N worker threads",
+		"N", nthreads);
 	args.add_option('n', "named-gen",
 			"creates a \"named\" moniker 'name' from 'moniker'",
 			"name=moniker",
@@ -6,6 +6,7 @@
  */
 #include "uniconfdaemon.h"
 #include "uniconfdaemonconn.h"
+#include "uniconfreadpool.h"
 #include "wvlistener.h"
 #include "uninullgen.h"
 
@@ -16,7 +17,8 @@
 
 UniConfDaemon::UniConfDaemon(const UniConf &_cfg,
 			     bool auth, IUniConfGen *_permgen)
-    : cfg(_cfg), log("UniConf Daemon"), debug(log.split(WvLog::Debug1))
+    : cfg(_cfg), log("UniConf Daemon"), debug(log.split(WvLog::Debug1)),
+      readpool(NULL)
 {
     authenticate = auth;
 
@@ -32,6 +34,10 @@ UniConfDaemon::UniConfDaemon(const UniConf &_cfg,
 UniConfDaemon::~UniConfDaemon()
 {
     close();
+
+    // the connections have to let go of their replies before the pool goes
+    zap();
+    delete readpool;
     WVRELEASE(permgen);
 }
 
@@ -60,7 +66,20 @@ void UniConfDaemon::accept(WvStream *stream)
 				  new UniPermGen(permgen)), true, "ucpamconn");
     else
 #endif
-        append(new UniConfDaemonConn(stream, cfg), true, "ucdaemonconn");
+        append(new UniConfDaemonConn(stream, cfg, readpool), true,
+	       "ucdaemonconn");
+}
+
+
+void UniConfDaemon::setthreads(int nthreads)
+{
+    assert(!readpool);
+    if (nthreads > 0)
+    {
+	debug("Answering reads with %s threads.\n", nthreads);
+	readpool = new UniConfReadPool(cfg, nthreads);
+	append(readpool->stream(), false, "readpool");
+    }
 }
 
 
@@ -97,3 +116,15 @@ void UniConfDaemon::listen(WvStringParm lmoniker)
 	append(l, true, "listener");
     }
 }
+
+
+int UniConfDaemon::connections()
+{
+    int count = 0;
+    Iter i(*this);
+    for (i.rewind(); i.next(); )
+	if (i.link->id && (!strcmp(i.link->id, "ucdaemonconn")
+			   || !strcmp(i.link->id, "ucpamconn")))
+	    count++;
+    return count;
+}
@@ -12,10 +12,13 @@
 
 /***** UniConfDaemonConn *****/
 
-UniConfDaemonConn::UniConfDaemonConn(WvStream *_s, const UniConf &_root)
-    : UniClientConn(_s), root(_root)
+UniConfDaemonConn::UniConfDaemonConn(WvStream *_s, const UniConf &_root,
+				     UniConfReadPool *_pool)
+    : UniClientConn(_s), root(_root), pool(_pool), quit_when_flushed(false)
 {
     uses_continue_select = true;
+    if (pool)
+	_s->outbuf_limit(MAX_OUTBUF);
     addcallback();
     writecmd(EVENT_HELLO,
 	     spacecat(wvtcl_escape("UniConf Server ready."),
@@ -33,10 +36,100 @@ UniConfDaemonConn::~UniConfDaemonConn()
 
 void UniConfDaemonConn::close()
 {
+    PendingList::Iter i(pending);
+    for (i.rewind(); i.next(); )
+	if (i->reply)
+	    pool->cancel(i->reply);
+    pending.zap();
+
     UniClientConn::close();
 }
 
 
+size_t UniConfDaemonConn::uwrite(const void *buf, size_t len)
+{
+    if (pending.isempty())
+	return UniClientConn::uwrite(buf, len);
+
+    // wait behind the replies that are still being worked on
+    Pending *p = pending.last();
+    if (p->reply)
+    {
+	p = new Pending;
+	p->reply = NULL;
+	pending.append(p, true);
+    }
+    p->buf.put(buf, len);
+    return len;
+}
+
+
+void UniConfDaemonConn::submit(UniClientConn::Command cmd,
+			       const UniConfKey &key, bool recursive)
+{
+    // whatever didn't fit in the socket yet has to go before the reply
+    if (outbuf.used())
+    {
+	Pending *p = new Pending;
+	p->reply = NULL;
+	p->buf.merge(outbuf);
+	pending.append(p, true);
+    }
+
+    Pending *p = new Pending;
+    p->reply = pool->submit(cmd, key, recursive,
+			    wv::bind(&UniConfDaemonConn::flush_pending, this));
+    pending.append(p, true);
+}
+
+
+// Writes as much of 'buf' as the socket will take right now.  Returns true
+// if that was all of it.
+bool UniConfDaemonConn::send(WvBuf &buf)
+{
+    size_t used;
+    while ((used = buf.used()) > 0)
+    {
+	const void *data = buf.get(used);
+	size_t wrote = UniClientConn::uwrite(data, used);
+	if (wrote < used)
+	{
+	    buf.unget(used - wrote);
+	    return false;
+	}
+    }
+    return true;
+}
+
+
+void UniConfDaemonConn::flush_pending()
+{
+    bool blocked = false;
+    while (!pending.isempty())
+    {
+	Pending *p = pending.first();
+
+	// don't take any more of a reply until the client has caught up
+	// with what we already have of it
+	if (p->reply && send(p->buf) && pool->take(p->reply, p->buf))
+	    p->reply = NULL;
+	blocked = !send(p->buf);
+	if (blocked || p->reply)
+	    break;
+	pending.unlink_first();
+    }
+
+    // execute() tries again once the socket drains
+    if (blocked)
+	force_select(false, true, false);
+    else
+	undo_force_select(false, true, false);
+
+    if (pending.isempty() && quit_when_flushed)
+	close();
+}
+
+
 void UniConfDaemonConn::addcallback()
 {
     root.add_callback(this, wv::bind(&UniConfDaemonConn::deltacallback, this,
@@ -54,6 +147,9 @@ void UniConfDaemonConn::execute()
 {
     UniClientConn::execute();
 
+    if (!pending.isempty())
+	flush_pending();
+
     WvString command_string;
     UniClientConn::Command command = readcmd(command_string);
     
@@ -89,6 +185,13 @@ void UniConfDaemonConn::execute()
 		do_set(arg1, arg2);
 	    break;
 	    
+	case UniClientConn::REQ_SETV:
+	    // one pair per SETV, and then one with nothing to say it's the
+	    // end; like SET, none of them gets a reply
+	    if (!arg1.isnull())
+		do_set(arg1, arg2);
+	    break;
+	    
 	case UniClientConn::REQ_REMOVE:
 	    if (arg1.isnull())
 		do_malformed(command);
@@ -161,6 +264,13 @@ void UniConfDaemonConn::do_reply(WvStringParm reply)
 
 void UniConfDaemonConn::do_get(const UniConfKey &key)
 {
+    // if the snapshot is out of date, a lookup beats waiting for a new one
+    if (pool && !pool->stale())
+    {
+	submit(REQ_GET, key);
+	return;
+    }
+
     WvString value(root[key].getme());
     
     if (value.isnull())
@@ -172,12 +282,17 @@ void UniConfDaemonConn::do_get(const UniConfKey &key)
 
 void UniConfDaemonConn::do_set(const UniConfKey &key, WvStringParm value)
 {
+    if (pool)
+	pool->writing();
     root[key].setme(value);
 }
 
 
 void UniConfDaemonConn::do_remove(const UniConfKey &_key)
 {      
+    if (pool)
+	pool->writing();
+
     int notifications_sent = 0;
     bool single_key = true;
     
@@ -231,6 +346,12 @@ void UniConfDaemonConn::do_remove(const UniConfKey &_key)
 
 void UniConfDaemonConn::do_subtree(const UniConfKey &key, bool recursive)
 {
+    if (pool)
+    {
+	submit(REQ_SUBTREE, key, recursive);
+	return;
+    }
+
     static int niceness = 0;
     
     UniConf cfg(root[key]);
@@ -276,6 +397,12 @@ void UniConfDaemonConn::do_subtree(const UniConfKey &key, bool recursive)
 
 void UniConfDaemonConn::do_haschildren(const UniConfKey &key)
 {
+    if (pool && !pool->stale())
+    {
+	submit(REQ_HASCHILDREN, key);
+	return;
+    }
+
     bool haschild = root[key].haschildren();
     writecmd(REPLY_CHILD,
 	     spacecat(wvtcl_escape(key), haschild ? "TRUE" : "FALSE"));
@@ -301,7 +428,10 @@ void UniConfDaemonConn::do_refresh()
 void UniConfDaemonConn::do_quit()
 {
     writeok();
-    close();
+    if (pending.isempty())
+	close();
+    else
+	quit_when_flushed = true;
 }
 
 
@@ -0,0 +1,400 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * A pool of threads that answer read-only UniConf daemon requests.  See
+ * uniconfreadpool.h.
+ */
+#include "uniconfreadpool.h"
+#include "uniunwrapgen.h"
+#include "wvtclstring.h"
+
+// Everything a worker needs is copied into plain memory beforehand, and the
+// workers never create a WvString or a UniConfKey, since their reference
+// counts (even those of null strings) aren't thread safe.
+struct UniConfReadPool::Reply
+{
+    UniClientConn::Command cmd;
+    char *key;     // canonical key, for looking up in the snapshot
+    char *esckey;  // the key as the client should see it in the reply
+    bool recursive;
+    ReadyCallback cb;
+
+    UniSnapshotGen::Reader *reader;
+    const UniConfSnapshot *snap;
+
+    // protected by the pool's lock
+    WvDynBuf out;
+    bool finished;  // the worker is done with us
+    bool cancelled; // the owner is done with us
+    bool queued;    // we're in the pool's 'ready' list
+    Reply *next;
+};
+
+
+static char *copystr(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    return (char *)memcpy(new char[len], s, len);
+}
+
+
+UniConfReadPool::UniConfReadPool(const UniConf &cfg, int _nthreads)
+    : snapgen(new UniSnapshotGen(new UniUnwrapGen(cfg))),
+      wakeup(new WvLoopback),
+      nthreads(_nthreads > 0 ? _nthreads : 1),
+      quitting(false),
+      jobs(NULL), jobs_tail(&jobs),
+      ready(NULL), ready_tail(&ready),
+      held(NULL), held_tail(&held),
+      last_publish(wvstime()),
+      nanswered(0), npublished(0)
+{
+    wakeup->setcallback(wv::bind(&UniConfReadPool::wakeup_cb, this));
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&work, NULL);
+    pthread_cond_init(&drained, NULL);
+
+    threads = new pthread_t[nthreads];
+    for (int n = 0; n < nthreads; n++)
+        pthread_create(&threads[n], NULL, worker, this);
+}
+
+
+UniConfReadPool::~UniConfReadPool()
+{
+    pthread_mutex_lock(&lock);
+    quitting = true;
+    pthread_cond_broadcast(&work);
+    pthread_cond_broadcast(&drained);
+    pthread_mutex_unlock(&lock);
+
+    for (int n = 0; n < nthreads; n++)
+        pthread_join(threads[n], NULL);
+    deletev threads;
+
+    // nobody is left to take the rest of these
+    while (held)
+    {
+        Reply *r = held;
+        held = r->next;
+        destroy(r);
+    }
+    while (jobs)
+    {
+        Reply *r = jobs;
+        jobs = r->next;
+        destroy(r);
+    }
+    while (ready)
+    {
+        Reply *r = ready;
+        ready = r->next;
+        if (r->cancelled)
+            destroy(r);
+    }
+
+    pthread_cond_destroy(&drained);
+    pthread_cond_destroy(&work);
+    pthread_mutex_destroy(&lock);
+
+    WVRELEASE(wakeup);
+    WVRELEASE(snapgen);
+}
+
+
+UniConfReadPool::Reply *UniConfReadPool::submit(UniClientConn::Command cmd,
+                                                const UniConfKey &key,
+                                                bool recursive,
+                                                const ReadyCallback &cb)
+{
+    Reply *r = new Reply;
+    r->cmd = cmd;
+    r->key = copystr(key.printable());
+    r->esckey = copystr(wvtcl_escape(key));
+    r->recursive = recursive;
+    r->cb = cb;
+    r->reader = new UniSnapshotGen::Reader(*snapgen);
+    r->snap = NULL;
+    r->finished = r->cancelled = r->queued = false;
+    r->next = NULL;
+
+    if (stale())
+    {
+        // the current snapshot is missing something written before us
+        *held_tail = r;
+        held_tail = &r->next;
+        schedule();
+    }
+    else
+        queue(r);
+
+    return r;
+}
+
+
+void UniConfReadPool::queue(Reply *r)
+{
+    r->snap = r->reader->acquire();
+
+    pthread_mutex_lock(&lock);
+    *jobs_tail = r;
+    jobs_tail = &r->next;
+    pthread_cond_signal(&work);
+    pthread_mutex_unlock(&lock);
+}
+
+
+// Wakes up the main loop when it's time for the next snapshot.
+void UniConfReadPool::schedule()
+{
+    time_t wait = PUBLISH_MSEC - msecdiff(wvstime(), last_publish);
+    wakeup->alarm(wait > 0 ? wait : 0);
+}
+
+
+// Publishes a snapshot, and gives everybody who was waiting for it to the
+// workers.
+void UniConfReadPool::publish()
+{
+    snapgen->publish();
+    last_publish = wvstime();
+    npublished++;
+
+    while (held)
+    {
+        Reply *r = held;
+        held = r->next;
+        r->next = NULL;
+        queue(r);
+    }
+    held_tail = &held;
+}
+
+
+void UniConfReadPool::writing()
+{
+    if (held)
+        publish();
+}
+
+
+bool UniConfReadPool::take(Reply *r, WvBuf &out)
+{
+    pthread_mutex_lock(&lock);
+    bool was_full = r->out.used() >= MAX_BUFFERED;
+    out.merge(r->out);
+    if (was_full)
+        pthread_cond_broadcast(&drained);
+    bool done = r->finished;
+    if (done)
+    {
+        // still in the ready list; wakeup_cb() will free it
+        if (r->queued)
+        {
+            r->cancelled = true;
+            r = NULL;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (done && r)
+        destroy(r);
+    return done;
+}
+
+
+void UniConfReadPool::cancel(Reply *r)
+{
+    pthread_mutex_lock(&lock);
+    r->cancelled = true;
+    pthread_cond_broadcast(&drained);
+    bool now = r->finished && !r->queued;
+    pthread_mutex_unlock(&lock);
+
+    // otherwise, wakeup_cb() frees it once the worker is done
+    if (now)
+        destroy(r);
+}
+
+
+void UniConfReadPool::destroy(Reply *r)
+{
+    delete r->reader;
+    deletev r->key;
+    deletev r->esckey;
+    delete r;
+}
+
+
+void *UniConfReadPool::worker(void *_pool)
+{
+    UniConfReadPool &pool = *(UniConfReadPool *)_pool;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;)
+    {
+        while (!pool.jobs && !pool.quitting)
+            pthread_cond_wait(&pool.work, &pool.lock);
+        if (pool.quitting)
+            break;
+
+        Reply *r = pool.jobs;
+        pool.jobs = r->next;
+        if (!pool.jobs)
+            pool.jobs_tail = &pool.jobs;
+        r->next = NULL;
+
+        pthread_mutex_unlock(&pool.lock);
+        pool.answer(r);
+        pthread_mutex_lock(&pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+
+// Hands over a chunk of the reply to the main loop, waiting first if it's
+// too far behind.  Returns false if nobody wants the rest of the reply.
+bool UniConfReadPool::emit(Reply *r, WvDynBuf &chunk, bool finished)
+{
+    pthread_mutex_lock(&lock);
+    while (r->out.used() >= MAX_BUFFERED && !r->cancelled && !quitting)
+        pthread_cond_wait(&drained, &lock);
+
+    bool wanted = !r->cancelled && !quitting;
+    if (wanted)
+        r->out.merge(chunk);
+    else
+        chunk.zap();
+    if (finished || !wanted)
+    {
+        r->finished = true;
+        nanswered++;
+    }
+    push_ready(r);
+    pthread_mutex_unlock(&lock);
+    return wanted;
+}
+
+
+void UniConfReadPool::answer(Reply *r)
+{
+    const UniConfSnapshot &snap = *r->snap;
+    WvDynBuf chunk;
+
+    switch (r->cmd)
+    {
+    case UniClientConn::REQ_GET:
+        {
+            const char *value = snap.get(r->key);
+            if (!value)
+                chunk.putstr("FAIL\n");
+            else
+            {
+                chunk.putstr("ONEVAL ");
+                chunk.putstr(r->esckey);
+                chunk.putch(' ');
+                wvtcl_escape(chunk, value);
+                chunk.putch('\n');
+            }
+            break;
+        }
+
+    case UniClientConn::REQ_HASCHILDREN:
+        chunk.putstr("CHILD ");
+        chunk.putstr(r->esckey);
+        chunk.putstr(snap.haschildren(r->key) ? " TRUE\n" : " FALSE\n");
+        break;
+
+    case UniClientConn::REQ_SUBTREE:
+        {
+            if (!snap.exists(r->key))
+            {
+                chunk.putstr("FAIL\n");
+                break;
+            }
+
+            // keys in the reply are relative to the one asked for
+            size_t skip = 0;
+            UniConfSnapshot::Iter i(snap, r->key, r->recursive);
+            for (i.rewind(); i.next(); )
+            {
+                if (!skip && *r->key)
+                    skip = strlen(i.key()) - strlen(i.name());
+                chunk.putstr("VAL ");
+                wvtcl_escape(chunk, i.key() + skip);
+                chunk.putch(' ');
+                wvtcl_escape(chunk, i.value());
+                chunk.putch('\n');
+
+                if (chunk.used() >= CHUNK_SIZE && !emit(r, chunk, false))
+                    return;
+            }
+            chunk.putstr("OK\n");
+            break;
+        }
+
+    default:
+        chunk.putstr("FAIL {unexpected request}\n");
+        break;
+    }
+
+    emit(r, chunk, true);
+}
+
+
+void UniConfReadPool::push_ready(Reply *r)
+{
+    if (r->queued)
+        return;
+
+    // the main loop only needs one byte to wake it, however many replies
+    // have something to say.
+    if (!ready)
+        ::write(wakeup->getwfd(), "", 1);
+
+    r->queued = true;
+    *ready_tail = r;
+    ready_tail = &r->next;
+}
+
+
+void UniConfReadPool::wakeup_cb()
+{
+    char junk[64];
+    wakeup->read(junk, sizeof(junk));
+
+    if (held)
+    {
+        if (msecdiff(wvstime(), last_publish) >= PUBLISH_MSEC)
+            publish();
+        else
+            schedule();
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&lock);
+        Reply *r = ready;
+        if (r)
+        {
+            ready = r->next;
+            if (!ready)
+                ready_tail = &ready;
+            r->next = NULL;
+            r->queued = false;
+        }
+        bool dead = r && r->cancelled, finished = r && r->finished;
+        pthread_mutex_unlock(&lock);
+
+        if (!r)
+            break;
+        else if (!dead)
+            r->cb();
+        else if (finished)
+            destroy(r);
+        // else the worker hasn't noticed yet; it'll queue it again.
+    }
+}
@@ -82,3 +82,97 @@ WVTEST_MAIN("cache basics")
     // should have incurred any slow operations at all.
     WVPASSEQ(slow->how_slow(), 0);
 }
+
+
+WVTEST_MAIN("lazy UniCacheGen Sanity Test")
+{
+    UniCacheGen *gen = new UniCacheGen(new UniTempGen(), true);
+    UniConfGenSanityTester::sanity_test(gen, "lazycache:temp:");
+    WVRELEASE(gen);
+}
+
+
+WVTEST_MAIN("lazy cache")
+{
+    UniTempGen *t = new UniTempGen;
+    for (int i = 0; i < 10; i++)
+	for (int j = 0; j < 10; j++)
+	    t->set(WvString("sect%s/key%s", i, j), WvString("%s.%s", i, j));
+    UniSlowGen *slow = new UniSlowGen(t);
+    UniConfRoot root;
+    UniCacheGen *c = new UniCacheGen(slow, true);
+    root.mountgen(c, true);
+
+    // nothing gets loaded until we ask
+    WVPASSEQ(slow->how_slow(), 2); // refresh(), and the root's value
+    slow->reset_slow();
+
+    // one trip for a key's parent's children, then none for its siblings
+    WVPASSEQ(root["sect3/key4"].getme(), "3.4");
+    WVPASSEQ(slow->how_slow(), 1);
+    WVPASSEQ(root["sect3/key5"].getme(), "3.5");
+    WVPASSEQ(root["sect3/key99"].getme(), WvString::null);
+    WVFAIL(root["sect3/key5"].haschildren());
+    WVPASSEQ(slow->how_slow(), 2); // sect3/key5's children
+
+    // we know sect3/key99 isn't there, so it has no children either
+    WVFAIL(root["sect3/key99/foo"].exists());
+    WVPASSEQ(slow->how_slow(), 2);
+
+    // notifications keep it up to date
+    t->set("sect3/key4", "new");
+    WVPASSEQ(root["sect3/key4"].getme(), "new");
+    t->set("sect3/key99/foo", "vivified");
+    WVPASSEQ(root["sect3/key99"].getme(), "");
+    t->set("sect3/key5", WvString::null);
+    WVPASSEQ(root["sect3/key5"].getme(), WvString::null);
+    root["sect3/key6"].setme("through");
+    WVPASSEQ(t->get("sect3/key6"), "through");
+    WVPASSEQ(root["sect3/key6"].getme(), "through");
+
+    int count = 0;
+    UniConf::Iter i(root["sect3"]);
+    for (i.rewind(); i.next(); )
+	count++;
+    WVPASSEQ(count, 10);
+    WVPASSEQ(slow->how_slow(), 2);
+
+    // prefetch() gets a whole subtree at once
+    slow->reset_slow();
+    root["sect5"].prefetch(true);
+    WVPASSEQ(slow->how_slow(), 1);
+    WVPASSEQ(root["sect5/key7"].getme(), "5.7");
+    WVFAIL(root["sect5/key7"].haschildren());
+    WVPASSEQ(slow->how_slow(), 1);
+}
+
+
+WVTEST_MAIN("lazy cache with a limit")
+{
+    UniTempGen *t = new UniTempGen;
+    for (int i = 0; i < 10; i++)
+	for (int j = 0; j < 10; j++)
+	    t->set(WvString("sect%s/key%s", i, j), WvString("%s.%s", i, j));
+    UniSlowGen *slow = new UniSlowGen(t);
+    UniCacheGen *c = new UniCacheGen(slow, true, 25);
+
+    // room for two sections (plus their parents), but not three
+    WVPASSEQ(c->get("sect1/key1"), "1.1");
+    WVPASSEQ(c->get("sect2/key1"), "2.1");
+    WVPASSEQ(slow->how_slow(), 2);
+    WVPASSEQ(c->get("sect1/key2"), "1.2");
+    WVPASSEQ(slow->how_slow(), 2);
+
+    // sect2 is the least recently used, so it goes
+    WVPASSEQ(c->get("sect3/key1"), "3.1");
+    WVPASSEQ(c->get("sect1/key3"), "1.3");
+    WVPASSEQ(slow->how_slow(), 3);
+    WVPASSEQ(c->get("sect2/key3"), "2.3");
+    WVPASSEQ(slow->how_slow(), 4);
+
+    // keys we never loaded come straight from the inner generator
+    t->set("sect9/key9", "changed");
+    WVPASSEQ(c->get("sect9/key9"), "changed");
+
+    WVRELEASE(c);
+}
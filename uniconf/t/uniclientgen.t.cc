@@ -329,3 +329,118 @@ WVTEST_MAIN("timeout")
 
     kill(daemon.get_pid(), SIGCONT);
 }
+
+
+static int prefix_delta_count;
+static void prefix_delta_callback(const UniConf &, const UniConfKey &)
+{
+    ++prefix_delta_count;
+}
+
+
+WVTEST_MAIN("shared connections")
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    WvString sockname = wvtmpfilename("uniclientgen.t-sock");
+    unlink(sockname);
+
+    UniConfTestDaemon daemon(sockname, "temp:");
+
+    IUniConfGen *gen;
+    while (!(gen = wvcreate<IUniConfGen>(WvString("unix:%s", sockname)))
+           || !gen->isok())
+    {
+        WVRELEASE(gen);
+        wvout->print("Failed to connect, retrying...\n");
+        wvdelay(100);
+    }
+    UniConfRoot whole(gen);
+    UniConfRoot sub(WvString("unix:%s sub/dir", sockname));
+    UniConfRoot other(WvString("unix:%s other", sockname));
+
+    UniClientMux *mux = UniClientMux::find(WvString("unix:%s", sockname));
+    WVPASS(mux);
+    if (mux)
+        WVPASSEQ(mux->count(), 3);
+
+    whole["sub/dir/x"].setme("1");
+    whole["other/y"].setme("2");
+    WVPASSEQ(sub["x"].getme(), "1");
+    WVFAIL(sub["y"].exists());
+    WVPASSEQ(other["y"].getme(), "2");
+    WVPASSEQ(other.getme(), "");
+
+    sub["z"].setme("3");
+    WVPASSEQ(whole["sub/dir/z"].getme(), "3");
+    WVPASS(whole["sub/dir"].haschildren());
+    WVPASS(sub.haschildren());
+
+    WvString names;
+    UniConf::SortedIter i(sub);
+    for (i.rewind(); i.next(); )
+        names.append("%s=%s ", i->key(), i->getme());
+    WVPASSEQ(names, "x=1 z=3 ");
+
+    // each generator only hears about its own subtree
+    prefix_delta_count = 0;
+    sub.add_callback(&prefix_delta_count, "", prefix_delta_callback, true);
+    whole["other/y"].setme("4");
+    WVPASSEQ(other["y"].getme(), "4");
+    WVPASSEQ(prefix_delta_count, 0);
+    whole["sub/dir/x"].setme("5");
+    WVPASSEQ(sub["x"].getme(), "5");
+    WVPASSEQ(prefix_delta_count, 1);
+    sub.del_callback(&prefix_delta_count, "", true);
+
+    // the connection outlives any one of its users
+    other.unmount(other.whichmount(), true);
+    if (mux)
+        WVPASSEQ(mux->count(), 2);
+    WVPASSEQ(sub["z"].getme(), "3");
+}
+
+
+WVTEST_MAIN("shared connections and setv")
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    WvString sockname = wvtmpfilename("uniclientgen.t-sock");
+    unlink(sockname);
+
+    UniConfTestDaemon daemon(sockname, "temp:");
+
+    IUniConfGen *a, *b;
+    while (!(a = wvcreate<IUniConfGen>(WvString("unix:%s a", sockname)))
+           || !a->isok())
+    {
+        WVRELEASE(a);
+        wvout->print("Failed to connect, retrying...\n");
+        wvdelay(100);
+    }
+    b = wvcreate<IUniConfGen>(WvString("unix:%s b", sockname));
+    WVPASS(b && b->isok());
+    if (!b)
+        return;
+
+    b->set("x", "1");
+    WVPASSEQ(b->get("x"), "1");
+
+    // nothing the daemon says about a's setv gets mistaken for the
+    // answer to b's questions
+    UniConfPairList pairs;
+    pairs.add(new UniConfPair("x", "2"), true);
+    pairs.add(new UniConfPair("y/z", "3"), true);
+    pairs.add(new UniConfPair("q", WvString::null), true);
+    a->setv(pairs);
+    WVPASSEQ(b->get("x"), "1");
+    WVPASS(b->exists("x"));
+    WVFAIL(b->haschildren("x"));
+    WVPASSEQ(a->get("x"), "2");
+    WVPASSEQ(a->get("y/z"), "3");
+    WVPASS(a->haschildren("y"));
+    WVPASSEQ(b->get("x"), "1");
+
+    WVRELEASE(a);
+    WVRELEASE(b);
+}
@@ -14,7 +14,9 @@
 #include "wvpipe.h"
 #include "wvstringlist.h"
 #include "wvfileutils.h"
+#include "uniconfdaemonconn.h"
 #include <signal.h>
+#include <sys/socket.h>
 
 /**** Generic daemon testing helpers ****/
 
@@ -280,6 +282,123 @@ WVTEST_MAIN("daemon quit")
 }
 
 
+WVTEST_MAIN("daemon setv")
+{
+    UniConfRoot cfg("temp:");
+    signal(SIGPIPE, SIG_IGN);
+
+    cfg["gone"].setme("soon");
+    UniConfDaemon daemon(cfg, false, NULL);
+
+    // none of the SETVs gets an answer, only the notifications for them
+    WvStringList commands;
+    commands.append("setv pickles foo\nsetv subtree/fries bar1\nsetv gone\n"
+                    "setv\nget pickles");
+    commands.append("get subtree/fries");
+    commands.append("get gone");
+    WvStringListList expected_responses;
+    WvStringList hello_response;
+    hello_response.append(WvString("HELLO {UniConf Server ready.} %s",
+				   UNICONF_PROTOCOL_VERSION));
+    expected_responses.add(&hello_response, false);
+    WvStringList expected_get1;
+    expected_get1.append("NOTICE pickles foo");
+    expected_get1.append("NOTICE subtree {}");
+    expected_get1.append("NOTICE subtree/fries bar1");
+    expected_get1.append("NOTICE gone");
+    expected_get1.append("ONEVAL pickles foo");
+    expected_responses.add(&expected_get1, false);
+    WvStringList expected_get2;
+    expected_get2.append("ONEVAL subtree/fries bar1");
+    expected_responses.add(&expected_get2, false);
+    WvStringList expected_get3;
+    expected_get3.append("FAIL ");
+    expected_responses.add(&expected_get3, false);
+
+    WvString pipename = wvtmpfilename("uniconfd.t-pipe");
+    daemon.listen(WvString("unix:%s", pipename));
+    WvUnixAddr addr(pipename);
+    WvUnixConn *sock = new WvUnixConn(addr);
+    UniConfDaemonTestConn conn(sock, &commands, &expected_responses);
+
+    WvIStreamList::globallist.append(&conn, false, "conn");
+    WvIStreamList::globallist.append(&daemon, false, "daemon");
+    while (!WvIStreamList::globallist.isempty() && 
+           conn.isok() && daemon.isok())
+        WvIStreamList::globallist.runonce();
+
+    WVPASS(daemon.isok());
+    WvIStreamList::globallist.zap();
+    WVPASSEQ(cfg["pickles"].getme(), "foo");
+    WVPASSEQ(cfg["subtree/fries"].getme(), "bar1");
+    WVFAIL(cfg["gone"].exists());
+}
+
+
+// lets us see how much the daemon is holding on to for its client
+class OutbufFdStream : public WvFdStream
+{
+public:
+    OutbufFdStream(int fd) : WvFdStream(fd)
+        { }
+    size_t buffered()
+        { return outbuf.used(); }
+};
+
+
+WVTEST_MAIN("daemon threads and a slow client")
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    UniConfRoot cfg("temp:");
+    const int nkeys = 100000;
+    for (int n = 0; n < nkeys; n++)
+        cfg[WvString("big/key%s", n)].setmeint(n);
+    cfg["small"].setme("last");
+
+    UniConfReadPool pool(cfg, 2);
+    int socks[2];
+    WVPASS(!socketpair(AF_UNIX, SOCK_STREAM, 0, socks));
+    OutbufFdStream *server = new OutbufFdStream(socks[0]);
+    WvFdStream client(socks[1]);
+    server->set_nonblock(true);
+    client.set_nonblock(true);
+    UniConfDaemonConn conn(server, cfg, &pool);
+
+    WvIStreamList l;
+    l.append(pool.stream(), false, "pool");
+    l.append(&conn, false, "conn");
+
+    // nobody's reading the reply, so the daemon has to stop buffering it
+    client.print("subt big 1\nget small\n");
+    for (int n = 0; n < 200; n++)
+        l.runonce(10);
+    WVPASS(server->buffered() <= UniConfDaemonConn::MAX_OUTBUF);
+
+    // and carries on once somebody does
+    WvDynBuf all;
+    int lines = 0;
+    for (int n = 0; n < 10000 && lines < nkeys + 3; n++)
+    {
+        l.runonce(0);
+        if (!client.select(10))
+            continue;
+        char data[65536];
+        size_t len = client.read(data, sizeof(data));
+        for (size_t i = 0; i < len; i++)
+            if (data[i] == '\n')
+                lines++;
+        all.put(data, len);
+    }
+    WVPASSEQ(lines, nkeys + 3); // HELLO, the values, OK and ONEVAL
+
+    WvString got = all.getstr();
+    WVPASS(strstr(got, "\nVAL key0 0\n"));
+    const char *tail = "\nOK\nONEVAL small last\n";
+    WVPASS(!strcmp(got + got.len() - strlen(tail), tail));
+}
+
+
 /**** Daemon proxying test ****/
 
 // test that proxying between two uniconf daemons works
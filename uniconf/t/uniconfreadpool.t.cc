@@ -0,0 +1,180 @@
+#include "wvtest.h"
+#include "uniconfreadpool.h"
+#include "uniconfroot.h"
+
+
+struct ReplyCollector
+{
+    UniConfReadPool &pool;
+    UniConfReadPool::Reply *reply;
+    WvDynBuf out;
+    bool done;
+    int wakeups;
+
+    ReplyCollector(UniConfReadPool &_pool)
+        : pool(_pool), reply(NULL), done(false), wakeups(0)
+        { }
+
+    void ready()
+    {
+        wakeups++;
+        if (!done && pool.take(reply, out))
+            done = true;
+    }
+
+    void submit(UniClientConn::Command cmd, WvStringParm key,
+                bool recursive = false)
+    {
+        reply = pool.submit(cmd, key, recursive,
+                            wv::bind(&ReplyCollector::ready, this));
+    }
+
+    WvString wait()
+    {
+        for (int n = 0; !done && n < 1000; n++)
+            pool.stream()->runonce(100);
+        WVPASS(done);
+        return out.getstr();
+    }
+};
+
+
+static WvString ask(UniConfReadPool &pool, UniClientConn::Command cmd,
+                    WvStringParm key, bool recursive = false)
+{
+    ReplyCollector c(pool);
+    c.submit(cmd, key, recursive);
+    return c.wait();
+}
+
+
+WVTEST_MAIN("read pool replies")
+{
+    UniConfRoot cfg("temp:");
+    cfg["a/b/c"].setme("1");
+    cfg["a/b/d"].setme("two words");
+    cfg["a/e"].setme("3");
+
+    UniConfReadPool pool(cfg, 2);
+
+    WVPASSEQ(ask(pool, UniClientConn::REQ_GET, "a/b/c"), "ONEVAL a/b/c 1\n");
+    WVPASSEQ(ask(pool, UniClientConn::REQ_GET, "a/b/d"),
+             "ONEVAL a/b/d {two words}\n");
+    WVPASSEQ(ask(pool, UniClientConn::REQ_GET, "a/x"), "FAIL\n");
+    WVPASSEQ(ask(pool, UniClientConn::REQ_HASCHILDREN, "a/b"),
+             "CHILD a/b TRUE\n");
+    WVPASSEQ(ask(pool, UniClientConn::REQ_HASCHILDREN, "a/e"),
+             "CHILD a/e FALSE\n");
+    WVPASSEQ(ask(pool, UniClientConn::REQ_SUBTREE, "a"),
+             "VAL b {}\nVAL e 3\nOK\n");
+    WVPASSEQ(ask(pool, UniClientConn::REQ_SUBTREE, "a", true),
+             "VAL b {}\nVAL b/c 1\nVAL b/d {two words}\nVAL e 3\nOK\n");
+    WVPASSEQ(ask(pool, UniClientConn::REQ_SUBTREE, "nonexistent"), "FAIL\n");
+    WVPASSEQ(pool.answered(), 8);
+}
+
+
+WVTEST_MAIN("read pool snapshots")
+{
+    UniConfRoot cfg("temp:");
+    cfg["x"].setme("old");
+
+    UniConfReadPool pool(cfg, 1);
+
+    // each request sees the changes made before it, and none after
+    ReplyCollector before(pool);
+    before.submit(UniClientConn::REQ_GET, "x");
+    cfg["x"].setme("new");
+    ReplyCollector after(pool);
+    after.submit(UniClientConn::REQ_GET, "x");
+
+    WVPASSEQ(before.wait(), "ONEVAL x old\n");
+    WVPASSEQ(after.wait(), "ONEVAL x new\n");
+}
+
+
+WVTEST_MAIN("read pool publishing")
+{
+    UniConfRoot cfg("temp:");
+    cfg["x"].setme("0");
+
+    UniConfReadPool pool(cfg, 1);
+    WVFAIL(pool.stale());
+    unsigned long published = pool.published();
+
+    // a burst of reads after a write only costs one new snapshot
+    cfg["x"].setme("1");
+    WVPASS(pool.stale());
+    ReplyCollector *burst[10];
+    for (int n = 0; n < 10; n++)
+    {
+        burst[n] = new ReplyCollector(pool);
+        burst[n]->submit(UniClientConn::REQ_GET, "x");
+    }
+    for (int n = 0; n < 10; n++)
+    {
+        WVPASSEQ(burst[n]->wait(), "ONEVAL x 1\n");
+        delete burst[n];
+    }
+    WVPASSEQ(pool.published(), published + 1);
+    WVFAIL(pool.stale());
+
+    // but anything still waiting gets its snapshot before the next write
+    cfg["x"].setme("2");
+    ReplyCollector before(pool);
+    before.submit(UniClientConn::REQ_GET, "x");
+    pool.writing();
+    cfg["x"].setme("3");
+    ReplyCollector after(pool);
+    after.submit(UniClientConn::REQ_GET, "x");
+
+    WVPASSEQ(before.wait(), "ONEVAL x 2\n");
+    WVPASSEQ(after.wait(), "ONEVAL x 3\n");
+    WVPASSEQ(pool.published(), published + 3);
+}
+
+
+WVTEST_MAIN("read pool streaming")
+{
+    UniConfRoot cfg("temp:");
+    const int nkeys = 50000;
+    for (int n = 0; n < nkeys; n++)
+        cfg[WvString("big/section%s/key%s", n / 100, n)].setmeint(n);
+
+    UniConfReadPool pool(cfg, 2);
+
+    ReplyCollector c(pool);
+    c.submit(UniClientConn::REQ_SUBTREE, "big", true);
+
+    // somebody else's small request isn't stuck behind the big one
+    WVPASSEQ(ask(pool, UniClientConn::REQ_GET, "big/section3/key312"),
+             "ONEVAL big/section3/key312 312\n");
+
+    WvString all = c.wait();
+    WVPASS(c.wakeups > 1);
+
+    int lines = 0;
+    for (const char *cptr = all; *cptr; cptr++)
+        if (*cptr == '\n')
+            lines++;
+    WVPASSEQ(lines, nkeys + nkeys / 100 + 1);
+    WVPASS(!strncmp(all, "VAL section0 {}\nVAL section0/key0 0\n", 36));
+    WVPASS(strstr(all, "\nVAL section499/key49999 49999\n"));
+    WVPASS(!strcmp(all + all.len() - 4, "\nOK\n"));
+
+    // giving up halfway doesn't leak anything or hang the destructor
+    ReplyCollector quitter(pool);
+    quitter.submit(UniClientConn::REQ_SUBTREE, "big", true);
+    while (quitter.wakeups == 0)
+        pool.stream()->runonce(100);
+    pool.cancel(quitter.reply);
+    quitter.done = true;
+
+    ReplyCollector unread(pool);
+    unread.submit(UniClientConn::REQ_SUBTREE, "big", true);
+    pool.cancel(unread.reply);
+    unread.done = true;
+
+    WVPASSEQ(ask(pool, UniClientConn::REQ_GET, "big/section0/key0"),
+             "ONEVAL big/section0/key0 0\n");
+}
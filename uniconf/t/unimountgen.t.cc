@@ -3,6 +3,8 @@
 #include "unimountgen.h"
 #include "uniconf.h"
 #include "unitempgen.h"
+#include "unislowgen.h"
+#include "unidefgen.h"
 #include "uniconfgen-sanitytest.h"
 
 WVTEST_MAIN("UniMountGen Sanity Test")
@@ -211,3 +213,133 @@ WVTEST_MAIN("multiple generators - iterating with gaps")
     delete i;
 }
 
+
+
+WVTEST_MAIN("UniMountGen Sanity Test with cache")
+{
+    UniMountGen *gen = new UniMountGen;
+    gen->setcache(true);
+    gen->mount("/", "temp:", true);
+    UniConfGenSanityTester::sanity_test(gen, WvString::null);
+    WVRELEASE(gen);
+}
+
+
+WVTEST_MAIN("lookup cache")
+{
+    UniMountGen g;
+    g.setcache(true);
+    UniTempGen *t1 = new UniTempGen;
+    UniSlowGen *slow = new UniSlowGen(t1);
+    g.mountgen("/foo", slow, true);
+    UniTempGen *t2 = new UniTempGen;
+    g.mountgen("/foo/bar", t2, true);
+
+    t1->set("a/b", "1");
+    t2->set("c", "2");
+    slow->reset_slow();
+
+    // regets are free
+    WVPASSEQ(g.get("foo/a/b"), "1");
+    WVPASSEQ(g.get("foo/a/x"), WvString::null);
+    WVPASS(g.exists("foo/a"));
+    WVPASS(g.haschildren("foo/a"));
+    WVPASSEQ(slow->how_slow(), 4);
+    WVPASSEQ(g.get("FOO/a/b"), "1");
+    WVPASSEQ(g.get("foo/a/x"), WvString::null);
+    WVPASS(g.exists("foo/a"));
+    WVPASS(g.haschildren("foo/a"));
+    WVPASSEQ(slow->how_slow(), 4);
+    slow->reset_slow();
+
+    // trailing slashes still work, but aren't cached
+    WVPASSEQ(g.get("foo/a/b/"), WvString::null);
+    WVPASSEQ(g.get("foo/a/b"), "1");
+
+    // changes made inside any of the generators are noticed
+    t1->set("a/b", "3");
+    WVPASSEQ(g.get("foo/a/b"), "3");
+    t1->set("a/x", "4");
+    WVPASSEQ(g.get("foo/a/x"), "4");
+    WVPASS(g.haschildren("foo/a"));
+    WVPASSEQ(g.get("foo/bar/c"), "2");
+    t2->set("c", "5");
+    WVPASSEQ(g.get("foo/bar/c"), "5");
+
+    // deleting a key forgets about its children and parents
+    WVPASS(g.haschildren("foo/a"));
+    t1->set("a", WvString::null);
+    WVPASSEQ(g.get("foo/a/b"), WvString::null);
+    WVFAIL(g.exists("foo/a"));
+    WVFAIL(g.haschildren("foo/a"));
+    t1->set("a/y", "6");
+    WVPASS(g.exists("foo/a"));
+    WVPASS(g.haschildren("foo/a"));
+
+    // sets made through us too
+    g.set("foo/bar/c", "7");
+    WVPASSEQ(g.get("foo/bar/c"), "7");
+
+    // and mounting
+    WVPASSEQ(g.get("foo/a/y"), "6");
+    UniTempGen *t3 = new UniTempGen;
+    t3->set("y", "8");
+    g.mountgen("/foo/a", t3, true);
+    WVPASSEQ(g.get("foo/a/y"), "8");
+    g.unmount(t3, false);
+    WVPASSEQ(g.get("foo/a/y"), "6");
+}
+
+
+WVTEST_MAIN("lookup cache with wildcards")
+{
+    UniMountGen g;
+    g.setcache(true);
+    UniTempGen *t = new UniTempGen;
+    g.mountgen("/", new UniDefGen(t), true);
+
+    t->set("a/*/c", "1");
+    WVPASSEQ(g.get("a/b/c"), "1");
+    t->set("a/*/c", "2");
+    WVPASSEQ(g.get("a/b/c"), "2");
+}
+
+
+WVTEST_MAIN("lookup cache size limit")
+{
+    UniMountGen g;
+    g.setcache(true, 10);
+    IUniConfGen *t = g.mount("/", "temp:", true);
+    for (int i = 0; i < 100; i++)
+        t->set(i, i);
+    for (int i = 0; i < 100; i++)
+        WVPASSEQ(g.get(i), WvString(i));
+    t->set(50, "x");
+    WVPASSEQ(g.get(50), "x");
+}
+
+
+WVTEST_MAIN("lookup cache size limit with changes")
+{
+    UniMountGen g;
+    g.setcache(true, 10);
+    UniTempGen *t = new UniTempGen;
+    UniSlowGen *slow = new UniSlowGen(t);
+    g.mountgen("/", slow, true);
+    for (int i = 0; i < 5; i++)
+        t->set(WvString("a/%s", i), i);
+
+    // what's forgotten doesn't count towards the limit any more, so
+    // changing one key over and over doesn't flush the others
+    for (int i = 0; i < 5; i++)
+        WVPASSEQ(g.get(WvString("a/%s", i)), WvString(i));
+    for (int i = 0; i < 100; i++)
+    {
+        g.set("b/c", i);
+        WVPASSEQ(g.get("b/c"), WvString(i));
+    }
+    slow->reset_slow();
+    for (int i = 0; i < 5; i++)
+        WVPASSEQ(g.get(WvString("a/%s", i)), WvString(i));
+    WVPASSEQ(slow->how_slow(), 0);
+}
@@ -2,9 +2,13 @@
 #include "uniconfroot.h"
 #include "unitempgen.h"
 #include "uniretrygen.h"
+#include "uniwatch.h"
 #include "uniclientgen.h"
 #include "uniconfgen-sanitytest.h"
+#include "unifiltergen.h"
 #include "wvfileutils.h"
+#include "wvistreamlist.h"
+#include "wvmoniker.h"
 
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -160,3 +164,186 @@ WVTEST_MAIN("UniRetryGen: mount point exists")
     WVPASSEQ(uniconf["foo"].xget(""), WvString::null);    
 }
 
+
+// A generator over flaky_data that's only ok while flaky_up is true, and
+// counts how many times somebody tried to connect to it.
+static UniTempGen *flaky_data;
+static bool flaky_up;
+static int flaky_connects;
+
+class FlakyGen : public UniFilterGen
+{
+public:
+    FlakyGen() : UniFilterGen(flaky_data)
+        { flaky_data->addRef(); flaky_connects++; }
+    virtual bool isok()
+        { return flaky_up; }
+};
+
+static IUniConfGen *flakycreator(WvStringParm, IObject *)
+{
+    return new FlakyGen;
+}
+
+static WvMoniker<IUniConfGen> flakyreg("flaky", flakycreator);
+
+
+static int stale_deltas;
+static void stale_delta(const UniConf &, const UniConfKey &)
+{
+    stale_deltas++;
+}
+
+
+WVTEST_MAIN("UniRetryGen: stale while disconnected")
+{
+    flaky_data = new UniTempGen;
+    flaky_data->set("a", "1");
+    flaky_data->set("b/c", "2");
+    flaky_data->set("b/d", "3");
+    flaky_up = true;
+    flaky_connects = 0;
+
+    UniConfRoot cfg("retry:flaky: 20 stale");
+    WVPASSEQ(flaky_connects, 1);
+    WVPASSEQ(cfg["a"].getme(), "1");
+
+    // it notices the disconnection, but still knows everything
+    flaky_up = false;
+    WVPASSEQ(cfg["a"].getme(), "1");
+    WVPASSEQ(cfg["b/c"].getme(), "2");
+    WVPASS(cfg["b"].haschildren());
+    WVFAIL(cfg["x"].exists());
+    int count = 0;
+    UniConf::Iter i(cfg["b"]);
+    for (i.rewind(); i.next(); )
+        count++;
+    WVPASSEQ(count, 2);
+
+    // ...and it doesn't try to reconnect while you're waiting
+    for (int n = 0; n < 100; n++)
+        cfg["a"].getme();
+    WVPASSEQ(flaky_connects, 1);
+
+    // the main loop does, less and less often
+    flaky_data->set("a", "changed");
+    flaky_data->set("b/c", WvString::null);
+    flaky_data->set("e", "new");
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < 400)
+        WvIStreamList::globallist.runonce(10);
+    printf("%d reconnection attempts in 400ms\n", flaky_connects - 1);
+    WVPASS(flaky_connects - 1 >= 3);
+    WVPASS(flaky_connects - 1 <= 7);
+    WVPASSEQ(cfg["a"].getme(), "1");
+
+    // once it's back, we hear about exactly what changed
+    UniWatch watch(cfg, stale_delta);
+    stale_deltas = 0;
+    flaky_up = true;
+    start = wvtime();
+    while (cfg["a"].getme() == "1" && msecdiff(wvtime(), start) < 2000)
+        WvIStreamList::globallist.runonce(10);
+    WVPASSEQ(cfg["a"].getme(), "changed");
+
+    // the snapshot catches up from the main loop
+    while (stale_deltas < 3 && msecdiff(wvtime(), start) < 2000)
+        WvIStreamList::globallist.runonce(10);
+    WVPASSEQ(cfg["b/c"].getme(), WvString::null);
+    WVPASSEQ(cfg["b/d"].getme(), "3");
+    WVPASSEQ(cfg["e"].getme(), "new");
+    WVPASSEQ(stale_deltas, 3);
+
+    WVRELEASE(flaky_data);
+}
+
+
+WVTEST_MAIN("UniRetryGen: uniconfd restart under load")
+{
+    signal(SIGPIPE, SIG_IGN);
+    UniRetryGenTester t;
+    unlink(t.ini);
+
+    UniConfTestDaemon *daemon
+        = new UniConfTestDaemon(t.socket, WvString("ini:%s", t.ini));
+    wait_for_daemon(t);
+    UniConfRoot cfg(WvString("retry:unix:%s 50 stale", t.socket));
+    cfg["key"].setme("before");
+    cfg.commit();
+
+    // read as fast as we can (running the main loop in between) while the
+    // daemon is up, then down, then up again with a new value, and see
+    // how long the slowest read, or the slowest trip through the main
+    // loop, took each time
+    time_t slowest[3], slowest_loop[3];
+    const char *until[3] = { NULL, NULL, "after" };
+    for (int phase = 0; phase < 3; phase++)
+    {
+        if (phase == 1)
+        {
+            delete daemon;
+            UniConfRoot ini(WvString("ini:%s", t.ini));
+            ini["key"].setme("after");
+            for (int n = 0; n < 20000; n++)
+                ini[WvString("many/%s/%s", n / 100, n)].setmeint(n);
+            ini.commit();
+        }
+        else if (phase == 2)
+            daemon = new UniConfTestDaemon(t.socket,
+                                           WvString("ini:%s", t.ini));
+
+        slowest[phase] = slowest_loop[phase] = 0;
+        int wrong = 0;
+        WvTime start = wvtime();
+        while (msecdiff(wvtime(), start) < (until[phase] ? 10000 : 300))
+        {
+            WvTime before = wvtime();
+            WvString value(cfg["key"].getme());
+            time_t took = msecdiff(wvtime(), before);
+            if (took > slowest[phase])
+                slowest[phase] = took;
+            if (until[phase] && value == until[phase])
+                break;
+            if (value != "before")
+                wrong++;
+            before = wvtime();
+            WvIStreamList::globallist.runonce(0);
+            took = msecdiff(wvtime(), before);
+            if (took > slowest_loop[phase])
+                slowest_loop[phase] = took;
+        }
+        WVPASSEQ(wrong, 0);
+    }
+    WVPASSEQ(cfg["key"].getme(), "after");
+
+    // reading all of the new keys into the snapshot doesn't hold up the
+    // main loop either
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < 2000)
+    {
+        WvTime before = wvtime();
+        WvIStreamList::globallist.runonce(0);
+        time_t took = msecdiff(wvtime(), before);
+        if (took > slowest_loop[2])
+            slowest_loop[2] = took;
+    }
+    printf("slowest read: connected %ld ms, daemon down %ld ms, "
+           "reconnecting %ld ms\n",
+           (long)slowest[0], (long)slowest[1], (long)slowest[2]);
+    printf("slowest main loop: connected %ld ms, daemon down %ld ms, "
+           "reconnecting %ld ms\n",
+           (long)slowest_loop[0], (long)slowest_loop[1],
+           (long)slowest_loop[2]);
+    WVPASS(slowest[1] < 100);
+    WVPASS(slowest[2] < 1000);
+    WVPASS(slowest_loop[1] < 100);
+    WVPASS(slowest_loop[2] < 100);
+
+    // and it all made it there
+    delete daemon;
+    daemon = NULL;
+    WVPASSEQ(cfg["many/199/19999"].getme(), "19999");
+    WVPASSEQ(cfg["key"].getme(), "after");
+
+    unlink(t.ini);
+}
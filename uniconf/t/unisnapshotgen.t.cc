@@ -0,0 +1,149 @@
+#include "unisnapshotgen.h"
+#include "unitempgen.h"
+#include "uniconfroot.h"
+#include "wvtest.h"
+#include "uniconfgen-sanitytest.h"
+#include <pthread.h>
+
+
+WVTEST_MAIN("UniSnapshotGen Sanity Test")
+{
+    UniSnapshotGen *gen = new UniSnapshotGen(new UniTempGen);
+    UniConfGenSanityTester::sanity_test(gen, "snapshot:temp:");
+    WVRELEASE(gen);
+}
+
+
+WVTEST_MAIN("snapshot contents")
+{
+    UniTempGen *t = new UniTempGen;
+    t->set("a/b/c", "1");
+    t->set("a/B/d", "2");
+    t->set("a/e", "3");
+    t->set("Ab", "4");
+    t->set("a0", "5");
+    UniSnapshotGen *gen = new UniSnapshotGen(t);
+
+    {
+        UniSnapshotGen::Reader reader(*gen);
+        const UniConfSnapshot *snap = reader.acquire();
+        WVPASS(snap);
+        WVPASS(reader.acquire() == snap);
+
+        WVPASSEQ(snap->get("a/b/c"), "1");
+        WVPASSEQ(snap->get("/A//b/D/"), "2");
+        WVPASSEQ(snap->get("a/e"), "3");
+        WVPASSEQ(snap->get("ab"), "4");
+        WVPASSEQ(snap->get("a/b"), "");
+        WVPASSEQ(snap->get(""), "");
+        WVFAIL(snap->get("a/b/c/d"));
+        WVFAIL(snap->get("a/f"));
+        WVFAIL(snap->exists("b"));
+        WVPASS(snap->haschildren("a"));
+        WVPASS(snap->haschildren(""));
+        WVFAIL(snap->haschildren("a/e"));
+        WVFAIL(snap->haschildren("nonexistent"));
+
+        WvString names;
+        UniConfSnapshot::Iter i(*snap, "a");
+        for (i.rewind(); i.next(); )
+            names.append("%s ", i.name());
+        WVPASSEQ(names, "b e ");
+
+        WvString keys;
+        UniConfSnapshot::Iter j(*snap, "", true);
+        for (j.rewind(); j.next(); )
+            keys.append("%s=%s ", j.key(), j.value());
+        WVPASSEQ(keys, "a= a/b= a/b/c=1 a/b/d=2 a/e=3 a0=5 Ab=4 ");
+
+        UniConfSnapshot::Iter k(*snap, "nonexistent");
+        k.rewind();
+        WVFAIL(k.next());
+        reader.release();
+    }
+
+    WVRELEASE(gen);
+}
+
+
+WVTEST_MAIN("snapshot republishing")
+{
+    UniTempGen *t = new UniTempGen;
+    UniSnapshotGen *gen = new UniSnapshotGen(t);
+    UniConfRoot uni(gen);
+    UniSnapshotGen::Reader reader(*gen);
+
+    uni["x"].setmeint(1);
+    const UniConfSnapshot *snap = reader.acquire();
+    WVFAIL(snap->get("x"));
+    reader.release();
+
+    uni.commit();
+    snap = reader.acquire();
+    WVPASSEQ(snap->get("x"), "1");
+
+    // changes from underneath us count too, but an old snapshot doesn't
+    // change while we're still holding it.
+    t->set("y", "2");
+    uni.refresh();
+    WVFAIL(snap->get("y"));
+    WVPASS(reader.acquire() == snap);
+    reader.release();
+
+    snap = reader.acquire();
+    WVPASSEQ(snap->get("y"), "2");
+    reader.release();
+}
+
+
+static volatile bool stop_readers;
+
+static void *reader_thread(void *_gen)
+{
+    UniSnapshotGen::Reader reader(*(UniSnapshotGen *)_gen);
+    long bad = 0;
+
+    while (!stop_readers)
+    {
+        // 'a' and 'b' are always set together
+        const UniConfSnapshot *snap = reader.acquire();
+        const char *a = snap->get("a"), *b = snap->get("b");
+        if (!a || !b || strcmp(a, b))
+            bad++;
+        reader.release();
+    }
+    return (void *)bad;
+}
+
+
+WVTEST_MAIN("snapshot threads")
+{
+    UniTempGen *t = new UniTempGen;
+    t->set("a", "0");
+    t->set("b", "0");
+    UniSnapshotGen *gen = new UniSnapshotGen(t);
+
+    stop_readers = false;
+    pthread_t threads[4];
+    for (int n = 0; n < 4; n++)
+        pthread_create(&threads[n], NULL, reader_thread, gen);
+
+    for (int n = 1; n < 2000; n++)
+    {
+        gen->set("a", n);
+        gen->set("b", n);
+        gen->commit();
+    }
+
+    stop_readers = true;
+    long bad = 0;
+    for (int n = 0; n < 4; n++)
+    {
+        void *ret;
+        pthread_join(threads[n], &ret);
+        bad += (long)ret;
+    }
+    WVPASSEQ(bad, 0);
+
+    WVRELEASE(gen);
+}
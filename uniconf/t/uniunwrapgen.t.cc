@@ -56,6 +56,25 @@ WVTEST_MAIN("unwrap basics")
     WVPASSEQ(itcount(g.recursiveiterator("/foo")), 7);
 
     WVPASSEQ(itcount(g.recursiveiterator("/")), 26);
+
+    // recursive keys are relative to the top, not just the last segment
+    UniConfGen::Iter *i = g.recursiveiterator("/boo");
+    i->rewind();
+    WVPASS(i->next());
+    WVPASSEQ(i->key().printable(), "fah");
+    delete i;
+    i = g.recursiveiterator("/");
+    int found = 0;
+    for (i->rewind(); i->next(); )
+    {
+        if (i->value() == "x2")
+        {
+            WVPASSEQ(i->key().removefirst().printable(), "blah/1/3/3");
+            found++;
+        }
+    }
+    WVPASSEQ(found, 3);
+    delete i;
 }
 
 
@@ -0,0 +1,106 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * Measures gets from a uniconfd on the same machine holding a big tree,
+ * straight through a UniClientGen, through an (eager) UniCacheGen, and
+ * through a lazy one with a limit:
+ *
+ *     unicachetimingtest [sections [keys-per-section [hot-sections]]]
+ *
+ * The gets go round and round the keys of the first few ("hot") sections,
+ * the way a program usually reads a small corner of a big config.
+ */
+#include "uniconfdaemon.h"
+#include "uniconfroot.h"
+#include "unitempgen.h"
+#include "wvfileutils.h"
+#include "wvfork.h"
+#include "wvistreamlist.h"
+#include "wvtimeutils.h"
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+
+#define MSEC 2000
+
+
+static void run(WvStringParm what, WvStringParm moniker,
+                int nsect, int nkeys, int nhot)
+{
+    WvTime start = wvtime();
+    UniConfRoot uni(moniker);
+    WvString first(uni["sect0/key0"].getme());
+    time_t ready = msecdiff(wvtime(), start);
+
+    WvString *keys = new WvString[nhot * nkeys];
+    for (int n = 0; n < nhot * nkeys; n++)
+        keys[n] = WvString("sect%s/key%s", n % nhot, n / nhot);
+
+    start = wvtime();
+    unsigned long gets = 0, found = 0;
+    while (msecdiff(wvtime(), start) < MSEC)
+    {
+        for (int n = 0; n < 1000; n++, gets++)
+            if (!uni[keys[gets % (nhot * nkeys)]].getme().isnull())
+                found++;
+
+        // a real program would be running its main loop in between
+        WvIStreamList::globallist.runonce(0);
+    }
+    time_t elapsed = msecdiff(wvtime(), start);
+    printf("%-28s first answer %6ld ms %10.0f gets/sec (%lu of %lu found)\n",
+           what.cstr(), (long)ready, gets * 1000.0 / elapsed, found, gets);
+    delete[] keys;
+}
+
+
+int main(int argc, char **argv)
+{
+    int nsect = argc > 1 ? atoi(argv[1]) : 1000;
+    int nkeys = argc > 2 ? atoi(argv[2]) : 1000;
+    int nhot = argc > 3 ? atoi(argv[3]) : 10;
+
+    signal(SIGPIPE, SIG_IGN);
+    WvString sockname = wvtmpfilename("unicachetimingtest-sock");
+    unlink(sockname);
+
+    pid_t child = wvfork();
+    if (child == 0)
+    {
+        UniTempGen *t = new UniTempGen;
+        for (int s = 0; s < nsect; s++)
+            for (int k = 0; k < nkeys; k++)
+                t->set(WvString("sect%s/key%s", s, k), k);
+        UniConfRoot cfg(t);
+        UniConfDaemon daemon(cfg, false, NULL);
+        daemon.listen(WvString("unix:%s", sockname));
+        WvIStreamList::globallist.append(&daemon, false, "uniconfd");
+        while (daemon.isok())
+            WvIStreamList::globallist.runonce();
+        _exit(0);
+    }
+
+    WvString client("unix:%s", sockname);
+    for (;;)
+    {
+        UniConfRoot probe(client);
+        if (!probe["sect0/key0"].getme().isnull())
+            break;
+        wvdelay(100);
+    }
+    printf("%d sections of %d keys, reading %d of them\n",
+           nsect, nkeys, nhot);
+
+    run("no cache", client, nsect, nkeys, nhot);
+    run("cache", WvString("cache:%s", client), nsect, nkeys, nhot);
+    run("lazycache", WvString("lazycache:%s", client), nsect, nkeys, nhot);
+    run("lazycache, limit 2x hot",
+        WvString("lazycache:{%s} %s", client, nhot * nkeys * 2),
+        nsect, nkeys, nhot);
+
+    kill(child, SIGTERM);
+    waitpid(child, NULL, 0);
+    unlink(sockname);
+    return 0;
+}
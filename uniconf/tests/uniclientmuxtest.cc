@@ -0,0 +1,77 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2005 Net Integration Technologies, Inc.
+ *
+ * Compares mounting lots of subtrees of a running uniconfd with one
+ * connection each against sharing a single connection between them.
+ *
+ *     uniclientmuxtest <socket> [mounts] [daemon-pid]
+ *
+ * If you give the daemon's pid, its open file descriptors are counted too.
+ */
+#include "uniclientgen.h"
+#include "uniconfroot.h"
+#include "wvdiriter.h"
+#include "wvtimeutils.h"
+#include "wvunixsocket.h"
+#include <stdio.h>
+
+static int count_fds(WvStringParm pid)
+{
+    int count = 0;
+    WvDirIter i(WvString("/proc/%s/fd", pid), false);
+    for (i.rewind(); i.next(); )
+        count++;
+    return count;
+}
+
+
+static void run(WvStringParm sockname, int mounts, WvStringParm daemon,
+                bool shared)
+{
+    int fds = count_fds("self"), dfds = !daemon ? 0 : count_fds(daemon);
+
+    WvTime start = wvtime();
+    UniConfRoot uni;
+    for (int n = 0; n < mounts; n++)
+    {
+        WvString prefix("mount%s", n);
+        if (shared)
+            uni[prefix].mount(WvString("unix:%s %s", sockname, prefix));
+        else
+            uni[prefix].mountgen(new UniClientGen(new WvUnixConn(sockname)));
+    }
+    time_t mounted = msecdiff(wvtime(), start);
+
+    // make every mount talk to the daemon at least once
+    for (int n = 0; n < mounts; n++)
+        uni[WvString("mount%s/key", n)].setmeint(n);
+    for (int n = 0; n < mounts; n++)
+        uni[WvString("mount%s/key", n)].getmeint();
+    time_t used = msecdiff(wvtime(), start);
+
+    printf("%-8s %5d mounts: %6ld ms to mount, %6ld ms to use; "
+           "%d more fds here", shared ? "shared" : "separate", mounts,
+           (long)mounted, (long)used, count_fds("self") - fds);
+    if (!!daemon)
+        printf(", %d more in the daemon", count_fds(daemon) - dfds);
+    printf("\n");
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <socket> [mounts] [daemon-pid]\n",
+                argv[0]);
+        return 1;
+    }
+    WvString sockname(argv[1]);
+    int mounts = argc > 2 ? atoi(argv[2]) : 200;
+    WvString daemon(argc > 3 ? argv[3] : NULL);
+
+    run(sockname, mounts, daemon, false);
+    run(sockname, mounts, daemon, true);
+    return 0;
+}
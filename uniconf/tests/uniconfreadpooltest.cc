@@ -0,0 +1,163 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * Measures the latency of small gets while somebody else keeps dumping a
+ * big subtree, with the daemon's usual main loop formatting and with a
+ * UniConfReadPool.
+ *
+ *     uniconfreadpooltest [keys] [msec-per-run] [threads]
+ */
+#include "uniconfreadpool.h"
+#include "uniconfroot.h"
+#include "wvtclstring.h"
+#include "wvstrutils.h"
+#include "wvtimeutils.h"
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+
+#define GETS_PER_DUMP 100
+
+static long long usecs()
+{
+    WvTime now = wvtime();
+    return (long long)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+
+static void report(const char *what, std::vector<long> &lat,
+                   unsigned long dumps, time_t elapsed)
+{
+    std::sort(lat.begin(), lat.end());
+    size_t n = lat.size();
+    printf("%-20s get latency p50 %7ld us  p99 %7ld us  max %7ld us  "
+           "(%lu dumps, %.1f/sec)\n", what,
+           n ? lat[n / 2] : 0, n ? lat[n * 99 / 100] : 0, n ? lat[n - 1] : 0,
+           dumps, dumps * 1000.0 / elapsed);
+}
+
+
+// What UniConfDaemonConn does without a pool: the dump and the gets that
+// arrived behind it are answered one after the other.
+static void run_mainloop(UniConfRoot &cfg, char **keys, int nkeys, int msec)
+{
+    std::vector<long> lat;
+    unsigned long dumps = 0;
+    WvDynBuf out;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        long long arrived = usecs();
+
+        UniConf top(cfg["big"]);
+        UniConf::RecursiveIter it(top);
+        for (it.rewind(); it.next(); )
+            out.putstr(spacecat(wvtcl_escape(it->fullkey(top)),
+                                wvtcl_escape(it._value())));
+        out.zap();
+        dumps++;
+
+        for (int n = 0; n < GETS_PER_DUMP; n++)
+        {
+            const char *key = keys[(dumps * GETS_PER_DUMP + n) % nkeys];
+            out.putstr(spacecat(wvtcl_escape(key),
+                                wvtcl_escape(cfg[key].getme())));
+            out.zap();
+            lat.push_back(usecs() - arrived);
+        }
+    }
+    report("main loop", lat, dumps, msecdiff(wvtime(), start));
+}
+
+
+struct PoolRequest
+{
+    UniConfReadPool *pool;
+    UniConfReadPool::Reply *reply;
+    long long arrived;
+    std::vector<long> *lat;
+    bool done;
+
+    void ready()
+    {
+        WvDynBuf out;
+        if (pool->take(reply, out))
+        {
+            done = true;
+            if (lat)
+                lat->push_back(usecs() - arrived);
+        }
+    }
+};
+
+
+static void run_pool(UniConfRoot &cfg, char **keys, int nkeys, int msec,
+                     int nthreads)
+{
+    UniConfReadPool pool(cfg, nthreads);
+    std::vector<long> lat;
+    unsigned long dumps = 0;
+    PoolRequest dump, gets[GETS_PER_DUMP];
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        long long arrived = usecs();
+
+        dump.pool = &pool;
+        dump.lat = NULL;
+        dump.done = false;
+        dump.reply = pool.submit(UniClientConn::REQ_SUBTREE, "big", true,
+                                 wv::bind(&PoolRequest::ready, &dump));
+        dumps++;
+
+        for (int n = 0; n < GETS_PER_DUMP; n++)
+        {
+            PoolRequest &r = gets[n];
+            r.pool = &pool;
+            r.arrived = arrived;
+            r.lat = &lat;
+            r.done = false;
+            r.reply = pool.submit(UniClientConn::REQ_GET,
+                                  keys[(dumps * GETS_PER_DUMP + n) % nkeys],
+                                  false, wv::bind(&PoolRequest::ready, &r));
+        }
+
+        bool alldone = false;
+        while (!alldone)
+        {
+            pool.stream()->runonce(100);
+            alldone = dump.done;
+            for (int n = 0; n < GETS_PER_DUMP; n++)
+                alldone = alldone && gets[n].done;
+        }
+    }
+    report(WvString("pool, %s thread(s)", nthreads), lat, dumps,
+           msecdiff(wvtime(), start));
+}
+
+
+int main(int argc, char **argv)
+{
+    int nkeys = argc > 1 ? atoi(argv[1]) : 100000;
+    int msec = argc > 2 ? atoi(argv[2]) : 2000;
+    int maxthreads = argc > 3 ? atoi(argv[3]) : 4;
+
+    UniConfRoot cfg("temp:");
+    char **keys = new char*[nkeys];
+    for (int n = 0; n < nkeys; n++)
+    {
+        WvString key("big/section%s/key%s", n / 100, n);
+        keys[n] = strdup(key);
+        cfg[key].setmeint(n);
+    }
+
+    run_mainloop(cfg, keys, nkeys, msec);
+    for (int nthreads = 1; nthreads <= maxthreads; nthreads *= 2)
+        run_pool(cfg, keys, nkeys, msec, nthreads);
+
+    for (int n = 0; n < nkeys; n++)
+        free(keys[n]);
+    delete[] keys;
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2005 Net Integration Technologies, Inc.
+ *
+ * Measures repeated gets through a realistic stack of generators, with and
+ * without the root lookup cache:
+ *
+ *   outer root -> unwrap -> inner root -> default -> list
+ *       -> readonly -> subtree -> temp
+ *
+ *     unilookupcachetimingtest [keys] [msec-per-run]
+ */
+#include "uniconfroot.h"
+#include "unidefgen.h"
+#include "unilistgen.h"
+#include "unireadonlygen.h"
+#include "unisubtreegen.h"
+#include "unitempgen.h"
+#include "uniunwrapgen.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+
+static void run(UniConfRoot &uni, const char *what, int nkeys, int msec)
+{
+    WvString *keys = new WvString[nkeys];
+    for (int n = 0; n < nkeys; n++)
+        keys[n] = WvString("cfg/section%s/key%s", n % 20, n);
+
+    WvTime start = wvtime();
+    unsigned long gets = 0, found = 0;
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < nkeys; n++)
+        {
+            if (!uni[keys[n]].getme().isnull())
+                found++;
+            if (uni[keys[n]].exists())
+                found++;
+        }
+        gets += 2 * nkeys;
+    }
+    time_t elapsed = msecdiff(wvtime(), start);
+    printf("%-24s %10.0f lookups/sec (%lu found of %lu)\n", what,
+           gets * 1000.0 / elapsed, found, gets);
+    delete[] keys;
+}
+
+
+int main(int argc, char **argv)
+{
+    int nkeys = argc > 1 ? atoi(argv[1]) : 1000;
+    int msec = argc > 2 ? atoi(argv[2]) : 1000;
+
+    UniTempGen *data = new UniTempGen;
+    for (int n = 0; n < nkeys; n++)
+    {
+        // leave some holes to be filled in by the defaults and the list
+        if (n % 5)
+            data->set(WvString("base/cfg/section%s/key%s", n % 20, n), n);
+    }
+
+    UniTempGen *overrides = new UniTempGen;
+    for (int n = 0; n < nkeys; n += 10)
+        overrides->set(WvString("cfg/section%s/key%s", n % 20, n), "x");
+    overrides->set("cfg/*/key5", "default");
+
+    UniConfGenList *l = new UniConfGenList;
+    l->append(new UniReadOnlyGen(new UniSubtreeGen(data, "base")), true);
+    l->append(overrides, true);
+
+    UniConfRoot inner(new UniDefGen(new UniListGen(l)));
+    UniConfRoot outer(new UniUnwrapGen(inner));
+
+    run(outer, "no cache", nkeys, msec);
+    outer.setcache(true, nkeys * 4);
+    run(outer, "root lookup cache", nkeys, msec);
+
+    // one change per pass, to show the cost of invalidation
+    WvTime start = wvtime();
+    unsigned long gets = 0;
+    int pass = 0;
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        data->set(WvString("base/cfg/section%s/key%s", pass % 20, pass),
+                  pass);
+        pass = (pass + 1) % nkeys;
+        for (int n = 0; n < 100; n++)
+            outer[WvString("cfg/section%s/key%s", n % 20, n)].getme();
+        gets += 100;
+    }
+    printf("%-24s %10.0f lookups/sec\n", "cache, 1 change per 100",
+           gets * 1000.0 / msecdiff(wvtime(), start));
+
+    return 0;
+}
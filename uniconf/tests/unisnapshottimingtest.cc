@@ -0,0 +1,127 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * Measures how fast worker threads can read from a UniSnapshotGen while
+ * the main thread keeps changing and recommitting it.
+ *
+ *     unisnapshottimingtest [keys] [msec-per-run]
+ */
+#include "unisnapshotgen.h"
+#include "unitempgen.h"
+#include "uniconfroot.h"
+#include "wvtimeutils.h"
+#include <pthread.h>
+#include <stdio.h>
+
+static int nkeys;
+static char **keynames;
+static volatile bool stop_readers;
+
+struct ReaderStats
+{
+    UniSnapshotGen *gen;
+    pthread_t thread;
+    unsigned long gets, misses;
+};
+
+
+static void *reader_thread(void *_stats)
+{
+    ReaderStats &stats = *(ReaderStats *)_stats;
+    UniSnapshotGen::Reader reader(*stats.gen);
+    unsigned seed = (unsigned long)&stats;
+
+    stats.gets = stats.misses = 0;
+    while (!stop_readers)
+    {
+        const UniConfSnapshot *snap = reader.acquire();
+        for (int n = 0; n < 100; n++)
+        {
+            if (!snap->get(keynames[rand_r(&seed) % nkeys]))
+                stats.misses++;
+        }
+        stats.gets += 100;
+        reader.release();
+    }
+    return NULL;
+}
+
+
+int main(int argc, char **argv)
+{
+    nkeys = argc > 1 ? atoi(argv[1]) : 100000;
+    int msec = argc > 2 ? atoi(argv[2]) : 1000;
+
+    UniTempGen *t = new UniTempGen;
+    keynames = new char*[nkeys];
+    for (int n = 0; n < nkeys; n++)
+    {
+        WvString key("section%s/subsection%s/key%s", n / 1000, n / 100, n);
+        keynames[n] = strdup(key);
+        t->set(key, n);
+    }
+    UniSnapshotGen *gen = new UniSnapshotGen(t);
+    UniConfRoot uni(gen);
+
+    WvTime start = wvtime();
+    unsigned long gets = 0;
+    unsigned seed = 1;
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 100; n++)
+            uni[keynames[rand_r(&seed) % nkeys]].getme();
+        gets += 100;
+    }
+    printf("UniConf::getme(), main thread: %10.0f gets/sec\n",
+           gets * 1000.0 / msecdiff(wvtime(), start));
+
+    start = wvtime();
+    for (int n = 0; n < 10; n++)
+    {
+        uni["extra"].setmeint(n);
+        uni.commit();
+    }
+    printf("republishing %d keys: %.1f ms each\n", nkeys,
+           msecdiff(wvtime(), start) / 10.0);
+
+    for (int nthreads = 1; nthreads <= 8; nthreads *= 2)
+    {
+        ReaderStats *stats = new ReaderStats[nthreads];
+        stop_readers = false;
+        for (int n = 0; n < nthreads; n++)
+        {
+            stats[n].gen = gen;
+            pthread_create(&stats[n].thread, NULL, reader_thread, &stats[n]);
+        }
+
+        // keep the owning thread busy republishing in the meantime
+        int republished = 0;
+        start = wvtime();
+        while (msecdiff(wvtime(), start) < msec)
+        {
+            uni["extra"].setmeint(republished++);
+            uni.commit();
+            wvdelay(50);
+        }
+        stop_readers = true;
+
+        unsigned long total = 0, misses = 0;
+        for (int n = 0; n < nthreads; n++)
+        {
+            pthread_join(stats[n].thread, NULL);
+            total += stats[n].gets;
+            misses += stats[n].misses;
+        }
+        time_t elapsed = msecdiff(wvtime(), start);
+        printf("%d reader thread(s): %10.0f gets/sec "
+               "(%d republishes, %lu misses)\n",
+               nthreads, total * 1000.0 / elapsed, republished, misses);
+        delete[] stats;
+    }
+
+    for (int n = 0; n < nkeys; n++)
+        free(keynames[n]);
+    delete[] keynames;
+    return 0;
+}
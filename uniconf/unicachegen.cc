@@ -7,6 +7,9 @@
 #include "uniconf.h"
 #include "unicachegen.h"
 #include "wvmoniker.h"
+#include "wvtclstring.h"
+#include "wvstringlist.h"
+#include "unilistiter.h"
 #include "wvlinkerhack.h"
 
 WV_LINK(UniCacheGen);
@@ -22,15 +25,40 @@ static IUniConfGen *creator(WvStringParm s, IObject *_obj)
 static WvMoniker<IUniConfGen> reg("cache", creator);
 
 
+// "lazycache:{moniker} [maxkeys]"
+static IUniConfGen *lazycreator(WvStringParm encoded_params, IObject *_obj)
+{
+    WvStringList params;
+    wvtcl_decode(params, encoded_params);
+    WvString moniker = params.popstr();
+    size_t maxkeys = 0;
+    if (params.count() > 0)
+    {
+	int n = params.popstr().num();
+	if (n > 0)
+	    maxkeys = n;
+    }
+    return new UniCacheGen(wvcreate<IUniConfGen>(moniker, _obj),
+			   true, maxkeys);
+}
+
+static WvMoniker<IUniConfGen> lazyreg("lazycache", lazycreator);
+
+
 /***** UniCacheGen *****/
 
-UniCacheGen::UniCacheGen(IUniConfGen *_inner)
-    : log("UniCache", WvLog::Debug1), inner(_inner)
+UniCacheGen::UniCacheGen(IUniConfGen *_inner, bool _lazy, size_t maxkeys)
+    : log("UniCache", WvLog::Debug1), inner(_inner),
+      lazy(NULL), lru_head(NULL), lru_tail(NULL),
+      lazy_max(maxkeys), lazy_count(0), writes(0), pumped_writes(0),
+      pumped_at(wvtime_zero)
 {
     if (inner)
         inner->add_callback(this, wv::bind(&UniCacheGen::deltacallback, this,
 					   _1, _2));
     refreshed_once = false;
+    if (_lazy)
+	lazy = new LazyNode(NULL, UniConfKey::EMPTY);
 }
 
 
@@ -38,6 +66,7 @@ UniCacheGen::~UniCacheGen()
 {
     inner->del_callback(this);
     WVRELEASE(inner);
+    delete lazy;
 }
 
 
@@ -49,7 +78,9 @@ bool UniCacheGen::isok()
 
 bool UniCacheGen::refresh()
 {
-    if (!refreshed_once)
+    if (lazy)
+	return inner->refresh(); // notifications bring us up to date
+    else if (!refreshed_once)
     {
 	bool ret = inner->refresh();
 	loadtree();
@@ -64,6 +95,7 @@ bool UniCacheGen::refresh()
 void UniCacheGen::commit()
 {
     inner->commit();
+    writes++;
 }
 
 
@@ -90,17 +122,395 @@ void UniCacheGen::loadtree(const UniConfKey &key)
 
 void UniCacheGen::deltacallback(const UniConfKey &key, WvStringParm value)
 {
-    UniTempGen::set(key, value);
+    if (lazy)
+	lazydelta(key, value);
+    else
+	UniTempGen::set(key, value);
 }
 
+
 void UniCacheGen::set(const UniConfKey &key, WvStringParm value)
 {
     inner->set(key, value);
+    writes++; // its notification might not be here yet
 }
 
+
+void UniCacheGen::setv(const UniConfPairList &pairs)
+{
+    inner->setv(pairs);
+    writes++;
+}
+
+
+void UniCacheGen::flush_buffers()
+{
+    if (lazy)
+    {
+	inner->flush_buffers();
+	pumped_writes = writes;
+	pumped_at = wvstime();
+    }
+}
+
+
 WvString UniCacheGen::get(const UniConfKey &key)
 {
-    //inner->get(key);
-    inner->flush_buffers(); // update all pending notifications
-    return UniTempGen::get(key);
+    if (!lazy)
+    {
+	//inner->get(key);
+	inner->flush_buffers(); // update all pending notifications
+	return UniTempGen::get(key);
+    }
+
+    pump();
+    if (key.isempty())
+    {
+	// nobody's parent lists the root, so we just remember it
+	if (!lazy->known)
+	{
+	    lazy->value = inner->get(key);
+	    lazy->known = true;
+	}
+	return lazy->value;
+    }
+    if (key.hastrailingslash())
+	return WvString::null;
+
+    LazyNode *node = loadchildren(key.removelast())->findchild(key.last());
+    return (node && node->known) ? node->value : WvString::null;
+}
+
+
+bool UniCacheGen::haschildren(const UniConfKey &key)
+{
+    if (!lazy)
+	return UniTempGen::haschildren(key);
+
+    pump();
+    LazyNode::Iter i(*loadchildren(key));
+    for (i.rewind(); i.next(); )
+	if (i->known)
+	    return true;
+    return false;
+}
+
+
+UniConfGen::Iter *UniCacheGen::iterator(const UniConfKey &key)
+{
+    if (!lazy)
+	return UniTempGen::iterator(key);
+
+    pump();
+    LazyNode *node = loadchildren(key);
+    if (!node->loaded)
+	return NULL;
+    ListIter *it = new ListIter(this);
+    LazyNode::Iter i(*node);
+    for (i.rewind(); i.next(); )
+	if (i->known)
+	    it->add(i->key(), i->value);
+    return it;
+}
+
+
+void UniCacheGen::prefetch(const UniConfKey &key, bool recursive)
+{
+    if (!lazy)
+	return; // we already have everything
+
+    pump();
+    if (recursive)
+	loadsubtree(key);
+    else
+	loadchildren(key);
+}
+
+
+/***** Lazy mode *****/
+
+// Pumps the inner generator's notifications, if we might have missed any.
+// wvstime() only moves when somebody runs a select() (like the main loop,
+// or a UniClientGen waiting for an answer), so if it hasn't moved, and no
+// changes have gone through us, there's nothing new to see.
+void UniCacheGen::pump()
+{
+    if (writes == pumped_writes && wvstime() == pumped_at)
+	return;
+    inner->flush_buffers();
+    pumped_writes = writes;
+    pumped_at = wvstime();
+}
+
+
+// Returns the node for 'key', creating it (and its parents) if needed.
+UniCacheGen::LazyNode *UniCacheGen::lazynode(const UniConfKey &key)
+{
+    LazyNode *node = lazy;
+    UniConfKey::Iter i(key);
+    for (i.rewind(); i.next(); )
+    {
+	LazyNode *child = node->findchild(i());
+	if (!child)
+	{
+	    child = new LazyNode(node, i());
+	    lazy_count++;
+	}
+	node = child;
+    }
+    return node;
+}
+
+
+// Returns the node for 'key', after loading its children if we didn't
+// have them already.
+UniCacheGen::LazyNode *UniCacheGen::loadchildren(const UniConfKey &key)
+{
+    LazyNode *node = lazynode(key);
+    if (node->loaded)
+    {
+	use(node);
+	return node;
+    }
+
+    // if our parent didn't list us, we don't exist, so we have no children
+    Iter *i = NULL;
+    if (!node->parent() || !node->parent()->loaded || node->known)
+    {
+	i = inner->iterator(key);
+	if (!i && !inner->isok())
+	    return node; // don't remember the failure
+
+	// notifications that turned up while we were waiting might have
+	// taken our node away
+	node = lazynode(key);
+    }
+
+    LazyNode::Iter ci(*node);
+    for (ci.rewind(); ci.next(); )
+	ci->known = false;
+    if (i)
+    {
+	for (i->rewind(); i->next(); )
+	{
+	    LazyNode *child = node->findchild(i->key());
+	    if (!child)
+	    {
+		child = new LazyNode(node, i->key());
+		lazy_count++;
+	    }
+	    child->value = i->value();
+	    child->known = true;
+	}
+	delete i;
+    }
+    node->loaded = true;
+    use(node);
+
+    // anything under here that the inner generator didn't list is gone
+    UniConfKeyList gone;
+    LazyNode::Iter gi(*node);
+    for (gi.rewind(); gi.next(); )
+	if (!gi->known)
+	    gone.append(new UniConfKey(gi->key()), true);
+    UniConfKeyList::Iter g(gone);
+    for (g.rewind(); g.next(); )
+	forget(node->findchild(*g));
+
+    trim(node);
+    return node;
+}
+
+
+// Loads everything under 'key' in one go.
+void UniCacheGen::loadsubtree(const UniConfKey &key)
+{
+    Iter *i = inner->recursiveiterator(key);
+    if (!i)
+	return;
+
+    // forget whatever we had, so anything not listed is gone
+    LazyNode *top = lazynode(key);
+    LazyNode::Iter ci(*top);
+    UniConfKeyList gone;
+    for (ci.rewind(); ci.next(); )
+	gone.append(new UniConfKey(ci->key()), true);
+    UniConfKeyList::Iter g(gone);
+    for (g.rewind(); g.next(); )
+	forget(top->findchild(*g));
+    top = lazynode(key);
+    top->loaded = true;
+    use(top);
+
+    for (i->rewind(); i->next(); )
+    {
+	LazyNode *node = lazynode(UniConfKey(key, i->key()));
+	node->value = i->value();
+	node->known = true;
+	if (!node->loaded)
+	{
+	    node->loaded = true;
+	    use(node);
+	}
+    }
+    delete i;
+    trim(top);
+}
+
+
+// Makes 'node' the most recently used.
+void UniCacheGen::use(LazyNode *node)
+{
+    if (node == lru_head)
+	return;
+    unlist(node);
+    node->next = lru_head;
+    if (lru_head)
+	lru_head->prev = node;
+    lru_head = node;
+    if (!lru_tail)
+	lru_tail = node;
+}
+
+
+void UniCacheGen::unlist(LazyNode *node)
+{
+    if (node->prev)
+	node->prev->next = node->next;
+    else if (lru_head == node)
+	lru_head = node->next;
+    if (node->next)
+	node->next->prev = node->prev;
+    else if (lru_tail == node)
+	lru_tail = node->prev;
+    node->prev = node->next = NULL;
+}
+
+
+// Takes 'node' and everything under it out of the LRU list and the count.
+void UniCacheGen::discount(LazyNode *node)
+{
+    if (node->loaded)
+	unlist(node);
+    lazy_count--;
+    LazyNode::Iter i(*node);
+    for (i.rewind(); i.next(); )
+	discount(i.ptr());
+}
+
+
+// Throws away 'node' and everything under it.
+void UniCacheGen::forget(LazyNode *node)
+{
+    if (node == lazy)
+    {
+	delete lazy;
+	lazy = new LazyNode(NULL, UniConfKey::EMPTY);
+	lru_head = lru_tail = NULL;
+	lazy_count = 0;
+	return;
+    }
+
+    LazyNode *parent = node->parent();
+    discount(node);
+    delete node;
+    prune(parent);
+}
+
+
+// Forgets 'node's children, except the ones that other loaded nodes
+// hang from.
+void UniCacheGen::unload(LazyNode *node)
+{
+    unlist(node);
+    node->loaded = false;
+
+    UniConfKeyList gone;
+    LazyNode::Iter i(*node);
+    for (i.rewind(); i.next(); )
+    {
+	i->known = false;
+	i->value = WvString::null;
+	if (!i->loaded && !i->haschildren())
+	    gone.append(new UniConfKey(i->key()), true);
+    }
+    UniConfKeyList::Iter g(gone);
+    for (g.rewind(); g.next(); )
+    {
+	delete node->findchild(*g);
+	lazy_count--;
+    }
+    prune(node);
+}
+
+
+// Deletes 'node', and its parents, as long as they're not holding anything.
+void UniCacheGen::prune(LazyNode *node)
+{
+    while (node != lazy && !node->loaded && !node->known
+	   && !node->haschildren())
+    {
+	LazyNode *parent = node->parent();
+	delete node;
+	lazy_count--;
+	node = parent;
+    }
+}
+
+
+// Unloads the least recently used nodes (but not 'keep') until we're
+// back under lazy_max keys.
+void UniCacheGen::trim(LazyNode *keep)
+{
+    while (lazy_max && lazy_count > lazy_max && lru_tail && lru_tail != keep)
+	unload(lru_tail);
+}
+
+
+void UniCacheGen::lazydelta(const UniConfKey &key, WvStringParm value)
+{
+    if (key.isempty())
+    {
+	if (value.isnull())
+	    forget(lazy); // everything's gone
+	lazy->value = value;
+	lazy->known = true;
+	delta(key, value);
+	return;
+    }
+
+    LazyNode *parent = lazy->find(key.removelast());
+    LazyNode *node = lazy->find(key);
+    if (value.isnull())
+    {
+	if (node)
+	    forget(node);
+    }
+    else if (parent && parent->loaded)
+    {
+	if (!node)
+	{
+	    node = new LazyNode(parent, key.last());
+	    lazy_count++;
+	}
+	node->value = value;
+	node->known = true;
+    }
+
+    // a new key's parents exist now too, even if nobody told us
+    if (!value.isnull())
+    {
+	for (UniConfKey k = key.removelast(); !k.isempty(); k = k.removelast())
+	{
+	    LazyNode *p = lazy->find(k.removelast());
+	    if (!p || !p->loaded || p->findchild(k.last()))
+		continue;
+	    LazyNode *n = new LazyNode(p, k.last());
+	    n->value = WvString::empty;
+	    n->known = true;
+	    lazy_count++;
+	}
+    }
+
+    delta(key, value);
 }
@@ -21,25 +21,52 @@
 WV_LINK(UniClientGen);
 
 
+// Returns a generator for the subtree 'prefix' of the daemon known as 'id',
+// sharing the connection with any other generators already using it.
+// 'newconn' is only called if there's no such connection yet.
+static IUniConfGen *sharedgen(WvStringParm id, WvStringParm addr,
+			      WvStringParm dst, WvStringParm prefix,
+			      IWvStream *(*newconn)(WvStringParm))
+{
+    UniClientMux *mux = UniClientMux::find(id);
+    if (!mux)
+	mux = new UniClientMux(newconn(addr), dst, id);
+    return new UniClientGen(mux, prefix);
+}
+
+
 #ifndef _WIN32
 #include "wvunixsocket.h"
+static IWvStream *newunixconn(WvStringParm addr)
+{
+    return new WvUnixConn(addr);
+}
+
 static IUniConfGen *unixcreator(WvStringParm s, IObject *)
 {
     WvConstInPlaceBuf buf(s, s.len());
     WvString dst(wvtcl_getword(buf));
     if (!dst) dst = "";
+    WvString prefix(wvtcl_getword(buf));
 
-    return new UniClientGen(new WvUnixConn(dst), dst);
+    return sharedgen(WvString("unix:%s", dst), dst, dst, prefix,
+		     newunixconn);
 }
 static WvMoniker<IUniConfGen> unixreg("unix", unixcreator);
 #endif
 
 
+static IWvStream *newtcpconn(WvStringParm addr)
+{
+    return new WvTCPConn(addr);
+}
+
 static IUniConfGen *tcpcreator(WvStringParm _s, IObject *)
 {
     WvConstInPlaceBuf buf(_s, _s.len());
     WvString dst(wvtcl_getword(buf));
     if (!dst) dst = "";
+    WvString prefix(wvtcl_getword(buf));
 
     WvString s = dst;
     char *cptr = s.edit();
@@ -47,15 +74,21 @@ static IUniConfGen *tcpcreator(WvStringParm _s, IObject *)
     if (!strchr(cptr, ':')) // no default port
 	s.append(":%s", DEFAULT_UNICONF_DAEMON_TCP_PORT);
     
-    return new UniClientGen(new WvTCPConn(s), dst);
+    return sharedgen(WvString("tcp:%s", s), s, dst, prefix, newtcpconn);
 }
 
 
+static IWvStream *newsslconn(WvStringParm addr)
+{
+    return new WvSSLStream(new WvTCPConn(addr), NULL);
+}
+
 static IUniConfGen *sslcreator(WvStringParm _s, IObject *)
 {
     WvConstInPlaceBuf buf(_s, _s.len());
     WvString dst(wvtcl_getword(buf));
     if (!dst) dst = "";
+    WvString prefix(wvtcl_getword(buf));
 
     WvString s = dst;
     char *cptr = s.edit();
@@ -63,7 +96,7 @@ static IUniConfGen *sslcreator(WvStringParm _s, IObject *)
     if (!strchr(cptr, ':')) // no default port
 	s.append(":%s", DEFAULT_UNICONF_DAEMON_SSL_PORT);
     
-    return new UniClientGen(new WvSSLStream(new WvTCPConn(s), NULL), dst);
+    return sharedgen(WvString("ssl:%s", s), s, dst, prefix, newsslconn);
 }
 
 
@@ -101,26 +134,40 @@ static WvMoniker<IUniConfGen> wvstreamreg2("wv", wvstreamcreator);
 
 
 
-/***** UniClientGen *****/
+/***** UniClientMux *****/
 
-UniClientGen::UniClientGen(IWvStream *stream, WvStringParm dst) 
-    : log(WvString("UniClientGen to %s",
+static UniClientMux *shared_muxes;
+
+
+UniClientMux::UniClientMux(IWvStream *stream, WvStringParm dst,
+			   WvStringParm _id)
+    : id(_id),
+      next_shared(NULL),
+      log(WvString("UniClientGen to %s",
 		   dst.isnull() && stream->src() 
 		   ? *stream->src() : WvString(dst))),
-      timeout(60*1000),
       version(0)
 {
-    cmdinprogress = cmdsuccess = false;
-    result_list = NULL;
-
     conn = new UniClientConn(stream, dst);
-    conn->setcallback(wv::bind(&UniClientGen::conncallback, this));
+    conn->setcallback(wv::bind(&UniClientMux::conncallback, this));
     WvIStreamList::globallist.append(conn, false, "uniclientconn-via-gen");
+
+    if (!!id)
+    {
+	next_shared = shared_muxes;
+	shared_muxes = this;
+    }
 }
 
 
-UniClientGen::~UniClientGen()
+UniClientMux::~UniClientMux()
 {
+    UniClientMux **m;
+    for (m = &shared_muxes; *m && *m != this; m = &(*m)->next_shared)
+	;
+    if (*m)
+	*m = next_shared;
+
     if (isok())
 	conn->writecmd(UniClientConn::REQ_QUIT, "");
     WvIStreamList::globallist.unlink(conn);
@@ -128,6 +175,242 @@ UniClientGen::~UniClientGen()
 }
 
 
+UniClientMux *UniClientMux::find(WvStringParm id)
+{
+    // don't hand out a dead connection; whoever is reconnecting wants a
+    // new one.
+    for (UniClientMux *m = shared_muxes; m; m = m->next_shared)
+	if (m->id == id && m->isok())
+	    return m;
+    return NULL;
+}
+
+
+void UniClientMux::attach(UniClientGen *gen)
+{
+    gens.append(gen, false);
+}
+
+
+void UniClientMux::detach(UniClientGen *gen)
+{
+    // any replies still on their way to this generator get thrown away
+    PendingList::Iter i(pending);
+    for (i.rewind(); i.next(); )
+	if (i->gen == gen)
+	    i->gen = NULL;
+
+    gens.unlink(gen);
+    if (gens.isempty())
+	delete this;
+}
+
+
+void UniClientMux::writecmd(UniClientGen *gen, UniClientConn::Command cmd,
+			    WvStringParm payload)
+{
+    switch (cmd)
+    {
+    case UniClientConn::REQ_SET:
+    case UniClientConn::REQ_SETV:
+    case UniClientConn::REQ_REMOVE:
+	break; // no reply
+
+    default:
+	Pending *p = new Pending;
+	p->gen = gen;
+	pending.append(p, true);
+	break;
+    }
+
+    conn->writecmd(cmd, payload);
+}
+
+
+void UniClientMux::notify(const UniConfKey &key, WvStringParm value)
+{
+    // A delta callback might get rid of any of the generators, including
+    // the last one (and thus us), so hold onto them until we're done.
+    int n = 0, count = gens.count();
+    UniClientGen **targets = new UniClientGen*[count];
+    UniClientGenList::Iter i(gens);
+    for (i.rewind(); i.next(); )
+    {
+	i->addRef();
+	targets[n++] = i.ptr();
+    }
+
+    for (n = 0; n < count; n++)
+    {
+	UniConfKey subkey;
+	if (targets[n]->prefix.suborsame(key, subkey))
+	    targets[n]->delta(subkey, value);
+    }
+
+    for (n = 0; n < count; n++)
+	targets[n]->release();
+    deletev targets;
+}
+
+
+void UniClientMux::conncallback()
+{
+    UniClientConn::Command command = conn->readcmd();
+    static const WvStringMask nasty_space(' ');
+
+    // replies belong to the oldest request still waiting for one
+    UniClientGen *gen = NULL;
+    bool done = false;
+    switch (command)
+    {
+    case UniClientConn::REPLY_OK:
+    case UniClientConn::REPLY_FAIL:
+    case UniClientConn::REPLY_CHILD:
+    case UniClientConn::REPLY_ONEVAL:
+	done = true;
+	// fall through
+    case UniClientConn::PART_VALUE:
+	if (pending.isempty())
+	{
+	    log(WvLog::Debug, "Discarding unexpected reply.\n");
+	    return;
+	}
+	gen = pending.first()->gen;
+	if (done)
+	    pending.unlink_first();
+	if (!gen)
+	    return;
+	break;
+
+    default:
+	break;
+    }
+
+    switch (command)
+    {
+        case UniClientConn::NONE:
+            // do nothing
+            break;
+
+        case UniClientConn::REPLY_OK:
+            gen->cmdsuccess = true;
+            gen->cmdinprogress = false;
+            break;
+
+        case UniClientConn::REPLY_FAIL:
+            gen->result_key = WvString::null;
+            gen->cmdsuccess = false;
+            gen->cmdinprogress = false;
+            break;
+
+        case UniClientConn::REPLY_CHILD:
+        case UniClientConn::REPLY_ONEVAL:
+            {
+                WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
+                WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
+
+                if (!key.isnull() && !value.isnull())
+                {
+                    gen->result_key = key;
+                    gen->result = value;
+                    gen->cmdsuccess = true;
+                }
+                gen->cmdinprogress = false;
+                break;
+            }
+
+        case UniClientConn::PART_VALUE:
+            {
+                WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
+                WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
+
+                if (!key.isnull() && !value.isnull())
+                {
+                    if (gen->result_list)
+			gen->result_list->add(key, value);
+                }
+                break;
+            }
+
+        case UniClientConn::EVENT_HELLO:
+            {
+		WvStringList greeting;
+		wvtcl_decode(greeting, conn->payloadbuf.getstr(), nasty_space);
+		WvString server(greeting.popstr());
+		WvString version_string(greeting.popstr());
+
+		if (server.isnull() || strncmp(server, "UniConf", 7))
+		{
+		    // wrong type of server!
+		    log(WvLog::Error, "Connected to a non-UniConf server!\n");
+
+		    UniClientGenList::Iter i(gens);
+		    for (i.rewind(); i.next(); )
+		    {
+			i->cmdinprogress = false;
+			i->cmdsuccess = false;
+		    }
+		    conn->close();
+		}
+		else
+		{
+		    version = 0;
+		    sscanf(version_string, "%d", &version);
+		    log(WvLog::Debug3, "UniConf version %s.\n", version);
+		}
+                break;
+            }
+
+        case UniClientConn::EVENT_NOTICE:
+            {
+                WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
+                WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
+                notify(key, value);
+            }   
+
+        default:
+            // discard unrecognized commands
+            break;
+    }
+}
+
+
+/***** UniClientGen *****/
+
+UniClientGen::UniClientGen(IWvStream *stream, WvStringParm dst) 
+    : mux(new UniClientMux(stream, dst)),
+      conn(mux->conn),
+      log(mux->log.app),
+      timeout(60*1000)
+{
+    cmdinprogress = cmdsuccess = false;
+    result_list = NULL;
+    mux->attach(this);
+}
+
+
+UniClientGen::UniClientGen(UniClientMux *_mux, const UniConfKey &_prefix)
+    : mux(_mux),
+      conn(mux->conn),
+      prefix(_prefix),
+      log(prefix.isempty() ? mux->log.app
+	  : WvString("%s %s", mux->log.app, prefix)),
+      timeout(60*1000)
+{
+    cmdinprogress = cmdsuccess = false;
+    result_list = NULL;
+    if (prefix.hastrailingslash())
+	prefix = prefix.removelast();
+    mux->attach(this);
+}
+
+
+UniClientGen::~UniClientGen()
+{
+    mux->detach(this);
+}
+
+
 time_t UniClientGen::set_timeout(time_t _timeout)
 {
     if (_timeout < 1000)
@@ -138,6 +421,18 @@ time_t UniClientGen::set_timeout(time_t _timeout)
 }
 
 
+UniConfKey UniClientGen::wirekey(const UniConfKey &key) const
+{
+    // UniConfKey(prefix, key) would add a trailing slash for the root
+    if (prefix.isempty())
+	return key;
+    else if (key.isempty())
+	return prefix;
+    else
+	return UniConfKey(prefix, key);
+}
+
+
 bool UniClientGen::isok()
 {
     return (conn && conn->isok());
@@ -146,7 +441,7 @@ bool UniClientGen::isok()
 
 bool UniClientGen::refresh()
 {
-    conn->writecmd(UniClientConn::REQ_REFRESH);
+    mux->writecmd(this, UniClientConn::REQ_REFRESH);
     return do_select();
 }
 
@@ -159,18 +454,19 @@ void UniClientGen::flush_buffers()
 
 void UniClientGen::commit()
 {
-    conn->writecmd(UniClientConn::REQ_COMMIT);
+    mux->writecmd(this, UniClientConn::REQ_COMMIT);
     do_select();
 }
 
 WvString UniClientGen::get(const UniConfKey &key)
 {
     WvString value;
-    conn->writecmd(UniClientConn::REQ_GET, wvtcl_escape(key));
+    UniConfKey fullkey(wirekey(key));
+    mux->writecmd(this, UniClientConn::REQ_GET, wvtcl_escape(fullkey));
 
     if (do_select())
     {
-        if (result_key == key)
+        if (result_key == fullkey)
             value = result;
 //        else
 //            seterror("Error: server sent wrong key pair.");
@@ -184,12 +480,14 @@ void UniClientGen::set(const UniConfKey &key, WvStringParm newvalue)
     //set_queue.append(new WvString(key), true);
     hold_delta();
 
+    UniConfKey fullkey(wirekey(key));
     if (newvalue.isnull())
-	conn->writecmd(UniClientConn::REQ_REMOVE, wvtcl_escape(key));
+	mux->writecmd(this, UniClientConn::REQ_REMOVE,
+		      wvtcl_escape(fullkey));
     else
-	conn->writecmd(UniClientConn::REQ_SET,
-		       spacecat(wvtcl_escape(key),
-				wvtcl_escape(newvalue), ' '));
+	mux->writecmd(this, UniClientConn::REQ_SET,
+		      spacecat(wvtcl_escape(fullkey),
+			       wvtcl_escape(newvalue), ' '));
 
     flush_buffers();
     unhold_delta();
@@ -198,28 +496,15 @@ void UniClientGen::set(const UniConfKey &key, WvStringParm newvalue)
 
 void UniClientGen::setv(const UniConfPairList &pairs)
 {
+    // Not SETV: daemons didn't always understand it, even ones that claim
+    // protocol version 19, and the FAIL they send back would be taken as
+    // the reply to whatever request is next in line on a shared
+    // connection.  A SET never gets an answer.
     hold_delta();
 
     UniConfPairList::Iter i(pairs);
-    if (version >= 19)
-    {
-	// Much like how VAL works, SETV continues sending key-value pairs
-	// until it sends a terminating SETV, which has no arguments.
-	for (i.rewind(); i.next(); )
-	{
-	    conn->writecmd(UniClientConn::REQ_SETV,
-			   spacecat(wvtcl_escape(i->key()),
-				    wvtcl_escape(i->value()), ' '));
-	}
-	conn->writecmd(UniClientConn::REQ_SETV);
-    }
-    else
-    {
-	for (i.rewind(); i.next(); )
-	{
-	    set(i->key(), i->value());
-	}
-    }
+    for (i.rewind(); i.next(); )
+	set(i->key(), i->value());
 
     unhold_delta();
 }
@@ -227,11 +512,13 @@ void UniClientGen::setv(const UniConfPairList &pairs)
 
 bool UniClientGen::haschildren(const UniConfKey &key)
 {
-    conn->writecmd(UniClientConn::REQ_HASCHILDREN, wvtcl_escape(key));
+    UniConfKey fullkey(wirekey(key));
+    mux->writecmd(this, UniClientConn::REQ_HASCHILDREN,
+		  wvtcl_escape(fullkey));
 
     if (do_select())
     {
-        if (result_key == key && result == "TRUE")
+        if (result_key == fullkey && result == "TRUE")
             return true;
     }
 
@@ -244,8 +531,9 @@ UniClientGen::Iter *UniClientGen::do_iterator(const UniConfKey &key,
 {
     assert(!result_list);
     result_list = new UniListIter(this);
-    conn->writecmd(UniClientConn::REQ_SUBTREE,
-		   WvString("%s %s", wvtcl_escape(key), WvString(recursive)));
+    mux->writecmd(this, UniClientConn::REQ_SUBTREE,
+		  WvString("%s %s", wvtcl_escape(wirekey(key)),
+			   WvString(recursive)));
 
     if (do_select())
     {
@@ -274,117 +562,22 @@ UniClientGen::Iter *UniClientGen::recursiveiterator(const UniConfKey &key)
 }
 
 
-void UniClientGen::conncallback()
-{
-    UniClientConn::Command command = conn->readcmd();
-    static const WvStringMask nasty_space(' ');
-    switch (command)
-    {
-        case UniClientConn::NONE:
-            // do nothing
-            break;
-
-        case UniClientConn::REPLY_OK:
-            cmdsuccess = true;
-            cmdinprogress = false;
-            break;
-
-        case UniClientConn::REPLY_FAIL:
-            result_key = WvString::null;
-            cmdsuccess = false;
-            cmdinprogress = false;
-            break;
-
-        case UniClientConn::REPLY_CHILD:
-            {
-                WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
-                WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
-
-                if (!key.isnull() && !value.isnull())
-                {
-                    result_key = key;
-                    result = value;
-                    cmdsuccess = true;
-                }
-                cmdinprogress = false;
-                break;
-
-            }
-
-        case UniClientConn::REPLY_ONEVAL:
-            {
-                WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
-                WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
-
-                if (!key.isnull() && !value.isnull())
-                {
-                    result_key = key;
-                    result = value;
-                    cmdsuccess = true;
-                }
-
-                cmdinprogress = false;
-                break;
-            }
-
-        case UniClientConn::PART_VALUE:
-            {
-                WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
-                WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
-
-                if (!key.isnull() && !value.isnull())
-                {
-                    if (result_list)
-			result_list->add(key, value);
-                }
-                break;
-            }
-
-        case UniClientConn::EVENT_HELLO:
-            {
-		WvStringList greeting;
-		wvtcl_decode(greeting, conn->payloadbuf.getstr(), nasty_space);
-		WvString server(greeting.popstr());
-		WvString version_string(greeting.popstr());
-
-		if (server.isnull() || strncmp(server, "UniConf", 7))
-		{
-		    // wrong type of server!
-		    log(WvLog::Error, "Connected to a non-UniConf server!\n");
-
-		    cmdinprogress = false;
-		    cmdsuccess = false;
-		    conn->close();
-		}
-		else
-		{
-		    version = 0;
-		    sscanf(version_string, "%d", &version);
-		    log(WvLog::Debug3, "UniConf version %s.\n", version);
-		}
-                break;
-            }
-
-        case UniClientConn::EVENT_NOTICE:
-            {
-                WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
-                WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
-                delta(key, value);
-            }   
-
-        default:
-            // discard unrecognized commands
-            break;
-    }
-}
-
-
 // FIXME: horribly horribly evil!!
 bool UniClientGen::do_select()
 {
     wvstime_sync();
 
-    hold_delta();
+    // Other generators sharing our connection would have had to wait for
+    // their notifications if they had their own, so make them wait now.
+    int n = 0, count = mux->gens.count();
+    UniClientGen **held = new UniClientGen*[count];
+    UniClientGenList::Iter i(mux->gens);
+    for (i.rewind(); i.next(); )
+    {
+	i->addRef();
+	i->hold_delta();
+	held[n++] = i.ptr();
+    }
     
     cmdinprogress = true;
     cmdsuccess = false;
@@ -431,7 +624,13 @@ bool UniClientGen::do_select()
 //    if (!cmdsuccess)
 //        seterror("Error: server timed out on response.");
 
-    unhold_delta();
+    bool success = cmdsuccess;
+    for (n = 0; n < count; n++)
+    {
+	held[n]->unhold_delta();
+	held[n]->release();
+    }
+    deletev held;
     
-    return cmdsuccess;
+    return success;
 }
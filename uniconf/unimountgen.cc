@@ -14,7 +14,8 @@
 
 /***** UniMountGen *****/
 
-UniMountGen::UniMountGen()
+UniMountGen::UniMountGen() :
+    cache(NULL), cache_max(0), cache_count(0), cache_generation(0)
 {
     // nothing special
 }
@@ -23,10 +24,140 @@ UniMountGen::UniMountGen()
 UniMountGen::~UniMountGen()
 {
     zap();
+    delete cache;
+}
+
+
+void UniMountGen::setcache(bool enable, size_t maxkeys)
+{
+    delete cache;
+    cache = NULL;
+    cache_count = 0;
+    cache_generation++;
+    cache_max = maxkeys;
+    if (enable)
+        cache = new CacheNode(NULL, UniConfKey::EMPTY);
+}
+
+
+void UniMountGen::flushcache()
+{
+    cache_generation++;
+    if (cache && cache->haschildren())
+    {
+        delete cache;
+        cache = new CacheNode(NULL, UniConfKey::EMPTY);
+    }
+    else if (cache)
+        cache->forget();
+    cache_count = 0;
+}
+
+
+// Trailing slashes don't change where a key is in the tree, but they do
+// change the answer, so keys with them are just never cached.
+bool UniMountGen::cacheable(const UniConfKey &key) const
+{
+    return cache && !key.hastrailingslash();
+}
+
+
+// Returns the cache node for 'key', creating it if needed, or NULL if the
+// cache is off.
+UniMountGen::CacheNode *UniMountGen::cachenode(const UniConfKey &key)
+{
+    if (!cache)
+        return NULL;
+
+    CacheNode *node = cache;
+    size_t added = 0;
+    UniConfKey::Iter i(key);
+    for (i.rewind(); i.next(); )
+    {
+        CacheNode *child = node->findchild(i());
+        if (!child)
+        {
+            if (++cache_count > cache_max)
+            {
+                flushcache();
+                return NULL;
+            }
+            child = new CacheNode(node, i());
+            added++;
+        }
+        node = child;
+    }
+
+    // the new nodes are a chain ending at 'node'; everything above them
+    // got that much bigger
+    CacheNode *p = node;
+    for (size_t n = 1; n <= added; n++, p = p->parent())
+        p->size = n;
+    for (; p; p = p->parent())
+        p->size += added;
+    return node;
+}
+
+
+void UniMountGen::invalidate(const UniConfKey &key)
+{
+    if (!cache)
+        return;
+
+    cache_generation++;
+
+    // a change to a wildcard key (eg. in a UniDefGen) could mean anything
+    if (key.iswild())
+    {
+        flushcache();
+        return;
+    }
+
+    // the key's parents might have appeared, or lost their last child;
+    // its children might be gone.
+    CacheNode *node = cache;
+    UniConfKey::Iter i(key);
+    for (i.rewind(); node && i.next(); )
+    {
+        node->forget();
+        node = node->findchild(i());
+    }
+    if (node && node != cache)
+    {
+        cache_count -= node->size;
+        for (CacheNode *p = node->parent(); p; p = p->parent())
+            p->size -= node->size;
+        delete node;
+    }
+    else if (node)
+        node->forget();
 }
 
 
 WvString UniMountGen::get(const UniConfKey &key)
+{
+    if (!cacheable(key))
+        return _get(key);
+
+    CacheNode *node = cache->find(key);
+    if (node && node->value_known)
+        return node->value;
+
+    // the generators might send notifications (or we might get
+    // reconfigured) while we're asking them, in which case our answer
+    // might be stale already.
+    unsigned generation = cache_generation;
+    WvString value = _get(key);
+    if (generation == cache_generation && (node = cachenode(key)) != NULL)
+    {
+        node->value = value;
+        node->value_known = true;
+    }
+    return value;
+}
+
+
+WvString UniMountGen::_get(const UniConfKey &key)
 {
     UniGenMount *found = findmount(key);
     if (!found)
@@ -45,6 +176,9 @@ WvString UniMountGen::get(const UniConfKey &key)
 
 void UniMountGen::set(const UniConfKey &key, WvStringParm value)
 {
+    // not every generator notifies us of its own sets right away
+    invalidate(key);
+
     UniGenMount *found = findmount(key);
     if (!found)
         return;
@@ -81,6 +215,7 @@ void UniMountGen::setv(const UniConfPairList &pairs)
 	UniConfPairList::Iter pair(pairs);
 	for (pair.rewind(); pair.next(); )
 	{
+	    invalidate(pair->key());
 	    UniGenMount *found = findmount(pair->key());
 	    if (!found)
 		continue;
@@ -98,6 +233,23 @@ void UniMountGen::setv(const UniConfPairList &pairs)
 
 
 bool UniMountGen::exists(const UniConfKey &key)
+{
+    if (!cacheable(key))
+        return _exists(key);
+
+    CacheNode *node = cache->find(key);
+    if (node && node->exists >= 0)
+        return node->exists;
+
+    unsigned generation = cache_generation;
+    bool result = _exists(key);
+    if (generation == cache_generation && (node = cachenode(key)) != NULL)
+        node->exists = result;
+    return result;
+}
+
+
+bool UniMountGen::_exists(const UniConfKey &key)
 {
     UniGenMount *found = findmount(key);
     //fprintf(stdout, "unimountgen:exists:found %p\n", found);
@@ -111,6 +263,23 @@ bool UniMountGen::exists(const UniConfKey &key)
 
 
 bool UniMountGen::haschildren(const UniConfKey &key)
+{
+    if (!cacheable(key))
+        return _haschildren(key);
+
+    CacheNode *node = cache->find(key);
+    if (node && node->children >= 0)
+        return node->children;
+
+    unsigned generation = cache_generation;
+    bool result = _haschildren(key);
+    if (generation == cache_generation && (node = cachenode(key)) != NULL)
+        node->children = result;
+    return result;
+}
+
+
+bool UniMountGen::_haschildren(const UniConfKey &key)
 {
     UniGenMount *found = findmount(key);
 //    fprintf(stdout, "haschildren:found %p\n", found);
@@ -148,6 +317,7 @@ bool UniMountGen::has_subkey(const UniConfKey &key, UniGenMount *found)
 
 bool UniMountGen::refresh()
 {
+    flushcache();
     hold_delta();
 
     bool result = true;
@@ -161,6 +331,24 @@ bool UniMountGen::refresh()
 }
 
 
+void UniMountGen::prefetch(const UniConfKey &key, bool recursive)
+{
+    UniGenMount *found = findmount(key);
+    if (found)
+        found->gen->prefetch(trimkey(found->key, key), recursive);
+    if (!recursive)
+        return;
+
+    // ...and whatever's mounted underneath it
+    MountList::Iter i(mounts);
+    for (i.rewind(); i.next(); )
+    {
+        if (i.ptr() != found && key.suborsame(i->key))
+            i->gen->prefetch(UniConfKey::EMPTY, true);
+    }
+}
+
+
 void UniMountGen::commit()
 {
     hold_delta();
@@ -194,6 +382,7 @@ IUniConfGen *UniMountGen::mountgen(const UniConfKey &key,
     if (!gen)
 	return NULL;
     
+    flushcache();
     UniGenMount *newgen = new UniGenMount(gen, key);
     gen->add_callback(this, wv::bind(&UniMountGen::gencallback, this,
 				     newgen->key, _1, _2));
@@ -207,6 +396,7 @@ IUniConfGen *UniMountGen::mountgen(const UniConfKey &key,
         gen->refresh();
 
     mounts.prepend(newgen, true);
+    flushcache();
     
     delta(key, get(key));
     unhold_delta();
@@ -234,6 +424,7 @@ void UniMountGen::unmount(IUniConfGen *gen, bool commit)
     if (commit)
         gen->commit();
     gen->del_callback(this);
+    flushcache();
 
     UniConfKey key(i->key);
     IUniConfGen *next = NULL;
@@ -245,6 +436,7 @@ void UniMountGen::unmount(IUniConfGen *gen, bool commit)
     // leading up to it (in case they lost their mountpoint due to the
     // unmounted generator)
     i.xunlink();
+    flushcache();
     if (i.next())
         next = i->gen;
 
@@ -401,7 +593,9 @@ UniMountGen::UniGenMount *UniMountGen::findmountunder(const UniConfKey &key)
 void UniMountGen::gencallback(const UniConfKey &base, const UniConfKey &key,
 			      WvStringParm value)
 {
-    delta(UniConfKey(base, key), value);
+    UniConfKey fullkey(base, key);
+    invalidate(fullkey);
+    delta(fullkey, value);
 }
 
 
@@ -6,9 +6,12 @@
  * generator is no longer OK.
  */
 #include "uniretrygen.h"
+#include "unitempgen.h"
+#include "wvistreamlist.h"
 #include "wvmoniker.h"
 #include "wvtclstring.h"
 #include "wvstringlist.h"
+#include "wvstringtable.h"
 #include "wvlinkerhack.h"
 
 WV_LINK(UniRetryGen);
@@ -20,6 +23,14 @@ WV_LINK(UniRetryGen);
 #define DPRINTF if (0) printf
 #endif
 
+// the longest we'll back off between reconnection attempts, unless the
+// retry interval itself is longer
+#define MAX_BACKOFF_MS (60*1000)
+
+// how long resyncing may hold up the main loop before it lets everybody
+// else have a turn
+#define RESYNC_SLICE_MS 10
+
 
 static IUniConfGen *creator(WvStringParm encoded_params, IObject *_obj)
 {
@@ -37,9 +48,10 @@ static IUniConfGen *creator(WvStringParm encoded_params, IObject *_obj)
     time_t retry_interval_ms = retry_interval_ms_str.num();
     if (retry_interval_ms < 0)
     	retry_interval_ms = 0;
+    bool serve_stale = params.count() > 0 && params.popstr() == "stale";
     return new UniRetryGen(moniker,
 			   UniRetryGen::ReconnectCallback(),
-                           retry_interval_ms);
+                           retry_interval_ms, serve_stale);
 }
 
 static WvMoniker<IUniConfGen> reg("retry", creator);
@@ -49,24 +61,64 @@ static WvMoniker<IUniConfGen> reg("retry", creator);
 
 UniRetryGen::UniRetryGen(WvStringParm _moniker,
         ReconnectCallback _reconnect_callback,
-    	time_t _retry_interval_ms) 
+    	time_t _retry_interval_ms, bool serve_stale) 
     : UniFilterGen(NULL),
     	log(WvString("UniRetryGen %s", _moniker), WvLog::Debug1),
     	moniker(_moniker),
         reconnect_callback(_reconnect_callback),
     	retry_interval_ms(_retry_interval_ms),
-    	next_reconnect_attempt(wvtime())
+    	next_reconnect_attempt(wvtime()),
+        snapshot(NULL), retrystream(NULL),
+        backoff_ms(_retry_interval_ms), resyncing(false)
 {
     DPRINTF("UniRetryGen::UniRetryGen(%s, %ld)\n",
     	    moniker.cstr(), retry_interval_ms);
-    
-    maybe_reconnect();
+
+    // everybody who lost the same daemon has to pick different delays,
+    // whatever anyone else in the process did to random()
+    WvTime now = wvtime();
+    jitter_state[0] = getpid();
+    jitter_state[1] = now.tv_sec ^ now.tv_usec;
+    jitter_state[2] = (unsigned long)this >> 4;
+
+    if (serve_stale)
+    {
+        snapshot = new UniTempGen;
+        snapshot->add_callback(this,
+                wv::bind(&UniRetryGen::snapshotcallback, this, _1, _2));
+        retrystream = new WvStream;
+        retrystream->setcallback(wv::bind(&UniRetryGen::retry, this));
+        WvIStreamList::globallist.append(retrystream, false, "uniretrygen");
+        retry();
+
+        // there's nothing stale to serve yet, so read it all now
+        while (!todo.isempty())
+            resync();
+    }
+    else
+        maybe_reconnect();
+}
+
+
+UniRetryGen::~UniRetryGen()
+{
+    if (retrystream)
+    {
+        WvIStreamList::globallist.unlink(retrystream);
+        WVRELEASE(retrystream);
+    }
+    if (snapshot)
+    {
+        snapshot->del_callback(this);
+        WVRELEASE(snapshot);
+    }
 }
 
 
 void UniRetryGen::maybe_reconnect()
 {
-    if (!inner())
+    // with a snapshot, the main loop reconnects; see retry()
+    if (!inner() && !snapshot)
     {
     	if (!(wvtime() < next_reconnect_attempt))
     	{
@@ -116,11 +168,140 @@ void UniRetryGen::maybe_disconnect()
     	
     	WVRELEASE(old_inner);
 
-        next_reconnect_attempt = msecadd(wvtime(), retry_interval_ms);
+        if (snapshot)
+        {
+            todo.zap(); // no point resyncing with nothing
+            schedule_retry();
+        }
+        else
+            next_reconnect_attempt = msecadd(wvtime(), retry_interval_ms);
     }
 }
 
 
+void UniRetryGen::schedule_retry()
+{
+    // wait somewhere between half and all of the current backoff, so that
+    // everybody who lost the same daemon doesn't come back at once
+    time_t wait = backoff_ms;
+    if (wait > 1)
+        wait -= nrand48(jitter_state) % (wait / 2 + 1);
+    retrystream->alarm(wait);
+    next_reconnect_attempt = msecadd(wvtime(), wait);
+
+    time_t max = retry_interval_ms > MAX_BACKOFF_MS
+        ? retry_interval_ms : MAX_BACKOFF_MS;
+    backoff_ms = backoff_ms ? backoff_ms * 2 : 10;
+    if (backoff_ms > max)
+        backoff_ms = max;
+}
+
+
+// Called by the main loop when it's time to try reconnecting, or to do
+// some more resyncing.
+void UniRetryGen::retry()
+{
+    if (inner())
+    {
+        if (!todo.isempty())
+            resync();
+        return;
+    }
+
+    IUniConfGen *gen = wvcreate<IUniConfGen>(moniker);
+    if (!gen || !gen->isok())
+    {
+        DPRINTF("UniRetryGen::retry: failed; waiting %ld ms\n", backoff_ms);
+        WVRELEASE(gen);
+        schedule_retry();
+        return;
+    }
+
+    log("Connected\n");
+    setinner(gen);
+    backoff_ms = retry_interval_ms;
+
+    todo.append(new UniConfKey(UniConfKey::EMPTY), true);
+    retrystream->alarm(0);
+
+    if (!!reconnect_callback) reconnect_callback(*this);
+    maybe_disconnect();
+}
+
+
+// Brings the snapshot up to date with the (newly connected) inner
+// generator, sending notifications for just the keys that changed.  Each
+// call reads one section at a time for up to RESYNC_SLICE_MS, and then
+// lets the main loop call it again for the rest.  Reads are answered by
+// the inner generator in the meantime, so only the snapshot is behind.
+void UniRetryGen::resync()
+{
+    WvTime start = wvtime();
+    hold_delta();
+    resyncing = true;
+    do
+    {
+        UniConfKey key(*todo.first());
+        todo.unlink_first();
+
+        Iter *i = inner()->iterator(key);
+        maybe_disconnect();
+        if (!inner())
+        {
+            delete i; // and maybe_disconnect() gave up on the resync
+            break;
+        }
+        if (!i)
+        {
+            // it's gone since we read its parent
+            if (!key.isempty())
+                snapshot->set(key, WvString::null);
+            continue;
+        }
+
+        WvStringTable present(16);
+        for (i->rewind(); i->next(); )
+        {
+            UniConfKey child(key, i->key());
+            present.add(new WvString(i->key().printable()), true);
+            snapshot->set(child, i->value()); // no-op if it's the same
+            todo.append(new UniConfKey(child), true);
+        }
+        delete i;
+
+        UniConfKeyList gone;
+        i = snapshot->iterator(key);
+        for (i->rewind(); i->next(); )
+            if (!present[i->key().printable()])
+                gone.append(new UniConfKey(key, i->key()), true);
+        delete i;
+        UniConfKeyList::Iter g(gone);
+        for (g.rewind(); g.next(); )
+            snapshot->set(*g, WvString::null);
+    } while (!todo.isempty() && msecdiff(wvtime(), start) < RESYNC_SLICE_MS);
+    resyncing = false;
+    unhold_delta();
+
+    if (!todo.isempty())
+        retrystream->alarm(0);
+}
+
+
+void UniRetryGen::snapshotcallback(const UniConfKey &key, WvStringParm value)
+{
+    if (resyncing)
+        delta(key, value);
+}
+
+
+void UniRetryGen::gencallback(const UniConfKey &key, WvStringParm value)
+{
+    if (snapshot)
+        snapshot->set(key, value);
+    UniFilterGen::gencallback(key, value);
+}
+
+
 void UniRetryGen::commit()
 {
     maybe_reconnect();
@@ -169,19 +350,17 @@ WvString UniRetryGen::get(const UniConfKey &key)
     	result = UniFilterGen::get(key);
     	DPRINTF("UniRetryGen::get(%s) returns %s\n", key.printable().cstr(), result.cstr());
     }
-    else if (key == "")
-    {
-        result = "";
-    	DPRINTF("UniRetryGen::get(%s) returns %s because it is root key\n", key.printable().cstr(), result.cstr());        
-    }
-    else
-    {
-    	DPRINTF("UniRetryGen::get(%s): !isok()\n", key.printable().cstr());
-    	result = WvString::null;
-    }
     
     maybe_disconnect();
 
+    if (!inner())
+    {
+        result = snapshot ? snapshot->get(key) : WvString::null;
+        if (key == "" && result.isnull())
+            result = "";
+    	DPRINTF("UniRetryGen::get(%s): !isok(), returns %s\n", key.printable().cstr(), result.cstr());
+    }
+
     return result;
 }
 
@@ -203,30 +382,24 @@ bool UniRetryGen::exists(const UniConfKey &key)
     
     DPRINTF("UniRetryGen::exists(%s)\n", key.printable().cstr());
     
-    bool result;
+    bool result = false;
     if (UniFilterGen::isok())
     {
     	result = UniFilterGen::exists(key);
     	DPRINTF("UniRetryGen::exists: returns %s\n", result? "true": "false");
     }
-    else
+    
+    maybe_disconnect();
+
+    if (!inner())
     {
     	DPRINTF("UniRetryGen::exists: !isok()\n");
-        if (key == "")
-        {
-            // here we assume that at least the mount point exists
-            // see void UniMountGen::makemount() that create all the keys with
-            // an empty string
-            result = true;
-        }
-        else 
-        {
-            result = false;
-        }
+        // here we assume that at least the mount point exists
+        // see void UniMountGen::makemount() that create all the keys with
+        // an empty string
+        result = key == "" || (snapshot && snapshot->exists(key));
     }
     
-    maybe_disconnect();
-    
     return result;
 }
 
@@ -235,13 +408,14 @@ bool UniRetryGen::haschildren(const UniConfKey &key)
 {
     maybe_reconnect();
     
-    bool result;
+    bool result = false;
     if (UniFilterGen::isok())
     	result = UniFilterGen::haschildren(key);
-    else
-    	result = false;
     
     maybe_disconnect();
+
+    if (!inner() && snapshot)
+        result = snapshot->haschildren(key);
     
     return result;
 }
@@ -263,13 +437,14 @@ UniConfGen::Iter *UniRetryGen::iterator(const UniConfKey &key)
 {
     maybe_reconnect();
     
-    Iter *result;
+    Iter *result = NULL;
     if (UniFilterGen::isok())
     	result = UniFilterGen::iterator(key);
-    else
-    	result = NULL;
     
     maybe_disconnect();
+
+    if (!result && !inner() && snapshot)
+        result = snapshot->iterator(key);
     
     return result;
 }
@@ -282,6 +457,9 @@ UniConfGen::Iter *UniRetryGen::recursiveiterator(const UniConfKey &key)
     Iter *result = UniFilterGen::recursiveiterator(key);
     
     maybe_disconnect();
+
+    if (!result && !inner() && snapshot)
+        result = snapshot->recursiveiterator(key);
     
     return result;
 }
@@ -0,0 +1,411 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * A UniConf generator that publishes read-only snapshots of its inner
+ * generator for use by other threads.  See unisnapshotgen.h.
+ */
+#include "unisnapshotgen.h"
+#include "wvmoniker.h"
+#include "wvassert.h"
+#include <ctype.h>
+#include <limits.h>
+
+// if 'obj' is non-NULL and is a UniConfGen, wrap that; otherwise wrap the
+// given moniker.
+static IUniConfGen *creator(WvStringParm s, IObject *_obj)
+{
+    return new UniSnapshotGen(wvcreate<IUniConfGen>(s, _obj));
+}
+
+static WvMoniker<IUniConfGen> reg("snapshot", creator);
+
+
+/***** UniConfSnapshot *****/
+
+// Compares two canonical keys, case insensitively, so that each key sorts
+// right before all of its descendants.  (Treating '/' as lower than any
+// other character does that.)
+static int keycmp(const char *a, const char *b)
+{
+    for (;; a++, b++)
+    {
+        int ca = (*a == '/') ? 1 : tolower((unsigned char)*a);
+        int cb = (*b == '/') ? 1 : tolower((unsigned char)*b);
+        if (ca != cb || !ca)
+            return ca - cb;
+    }
+}
+
+
+// Returns true if 'key' is 'parent' itself or one of its descendants.
+static bool keyunder(const char *parent, const char *key)
+{
+    if (!*parent)
+        return true;
+    for (; *parent; parent++, key++)
+        if (tolower((unsigned char)*parent) != tolower((unsigned char)*key))
+            return false;
+    return !*key || *key == '/';
+}
+
+
+struct SnapItem
+{
+    WvString key, value;
+
+    SnapItem(WvStringParm _key, WvStringParm _value) :
+        key(_key), value(_value)
+        { }
+};
+DeclareWvList(SnapItem);
+
+
+static int snapitemcmp(const void *a, const void *b)
+{
+    return keycmp((*(SnapItem **)a)->key, (*(SnapItem **)b)->key);
+}
+
+
+UniConfSnapshot::UniConfSnapshot(IUniConfGen *gen)
+{
+    SnapItemList items;
+    WvString rootval;
+    if (gen)
+    {
+        rootval = gen->get(UniConfKey::EMPTY);
+
+        IUniConfGen::Iter *i = gen->recursiveiterator(UniConfKey::EMPTY);
+        for (i->rewind(); i->next(); )
+        {
+            WvString value(i->value());
+            if (!value.isnull())
+                items.append(new SnapItem(i->key().printable(), value), true);
+        }
+        delete i;
+    }
+
+    // every key brings at most one new ancestor per slash
+    SnapItem **sorted = new SnapItem*[items.count()];
+    size_t nitems = 0, maxall = 1;
+    SnapItemList::Iter i(items);
+    for (i.rewind(); i.next(); )
+    {
+        sorted[nitems++] = i.ptr();
+        for (const char *c = i->key; *c; c++)
+            maxall += (*c == '/');
+        maxall++;
+    }
+    qsort(sorted, nitems, sizeof(*sorted), snapitemcmp);
+
+    // The iterator doesn't promise to give us the parents of every key, so
+    // fill in any gaps, and drop duplicates while we're at it.  'stack'
+    // holds the chain of ancestors of the key being added.
+    SnapItemList parents;
+    SnapItem root("", !rootval ? WvString("") : rootval);
+    SnapItem **all = new SnapItem*[maxall];
+    unsigned *stack = new unsigned[maxall];
+    unsigned nall = 0, depth = 0;
+    stack[depth++] = nall;
+    all[nall++] = &root;
+    for (size_t n = 0; n < nitems; n++)
+    {
+        const char *key = sorted[n]->key;
+        if (!keycmp(all[nall-1]->key, key))
+            continue; // duplicate
+
+        while (!keyunder(all[stack[depth-1]]->key, key))
+            depth--;
+
+        // synthesize any missing ancestors, shortest first
+        size_t have = strlen(all[stack[depth-1]]->key);
+        const char *slash = strchr(key + have + (have ? 1 : 0), '/');
+        for (; slash; slash = strchr(slash + 1, '/'))
+        {
+            WvString parent;
+            parent.setsize(slash - key + 1);
+            strncpy(parent.edit(), key, slash - key);
+            parent.edit()[slash - key] = '\0';
+
+            SnapItem *p = new SnapItem(parent, "");
+            parents.append(p, true);
+            stack[depth++] = nall;
+            all[nall++] = p;
+        }
+        stack[depth++] = nall;
+        all[nall++] = sorted[n];
+    }
+
+    size_t total = 0;
+    for (unsigned n = 0; n < nall; n++)
+        total += strlen(all[n]->key) + strlen(all[n]->value) + 2;
+
+    nentries = nall;
+    entries = new Entry[nentries];
+    strings = new char[total];
+
+    // copy everything into place, closing off each subtree as we leave it
+    depth = 0;
+    char *p = strings;
+    for (unsigned n = 0; n < nentries; n++)
+    {
+        Entry &e = entries[n];
+        size_t len = strlen(all[n]->key) + 1;
+        e.key = (const char *)memcpy(p, all[n]->key.cstr(), len);
+        p += len;
+        len = strlen(all[n]->value) + 1;
+        e.value = (const char *)memcpy(p, all[n]->value.cstr(), len);
+        p += len;
+        const char *slash = strrchr(e.key, '/');
+        e.name = slash ? slash + 1 : e.key;
+
+        while (depth && !keyunder(entries[stack[depth-1]].key, e.key))
+            entries[stack[--depth]].end = n;
+        stack[depth++] = n;
+    }
+    while (depth)
+        entries[stack[--depth]].end = nentries;
+
+    deletev stack;
+    deletev all;
+    deletev sorted;
+}
+
+
+UniConfSnapshot::~UniConfSnapshot()
+{
+    deletev entries;
+    deletev strings;
+}
+
+
+int UniConfSnapshot::find(const char *key) const
+{
+    // canonicalize the key the way UniConfKey would
+    char buf[256];
+    size_t len = strlen(key);
+    char *canon = len < sizeof(buf) ? buf : new char[len + 1];
+    char *out = canon;
+    for (const char *in = key; *in; in++)
+    {
+        if (*in == '/' && (out == canon || out[-1] == '/'))
+            continue;
+        *out++ = *in;
+    }
+    if (out > canon && out[-1] == '/')
+        out--;
+    *out = '\0';
+
+    int lo = 0, hi = nentries - 1, found = -1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        int cmp = keycmp(entries[mid].key, canon);
+        if (cmp == 0)
+        {
+            found = mid;
+            break;
+        }
+        else if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+
+    if (canon != buf)
+        deletev canon;
+    return found;
+}
+
+
+const char *UniConfSnapshot::get(const char *key) const
+{
+    int n = find(key);
+    return n >= 0 ? entries[n].value : NULL;
+}
+
+
+bool UniConfSnapshot::haschildren(const char *key) const
+{
+    int n = find(key);
+    return n >= 0 && entries[n].end > (unsigned)n + 1;
+}
+
+
+UniConfSnapshot::Iter::Iter(const UniConfSnapshot &_snap, const char *key,
+                            bool _recursive) :
+    snap(_snap), recursive(_recursive)
+{
+    top = snap.find(key);
+    rewind();
+}
+
+
+void UniConfSnapshot::Iter::rewind()
+{
+    cur = top;
+}
+
+
+bool UniConfSnapshot::Iter::next()
+{
+    if (top < 0)
+        return false;
+    if (recursive || cur == (unsigned)top)
+        cur++;
+    else
+        cur = snap.entries[cur].end;
+    return cur < snap.entries[top].end;
+}
+
+
+/***** UniSnapshotGen::Reader *****/
+
+UniSnapshotGen::Reader::Reader(UniSnapshotGen &_gen) :
+    gen(_gen), active(0), snap(NULL)
+{
+    pthread_mutex_lock(&gen.readers_lock);
+    next = gen.readers;
+    gen.readers = this;
+    pthread_mutex_unlock(&gen.readers_lock);
+}
+
+
+UniSnapshotGen::Reader::~Reader()
+{
+    release();
+
+    pthread_mutex_lock(&gen.readers_lock);
+    Reader **r;
+    for (r = &gen.readers; *r && *r != this; r = &(*r)->next)
+        ;
+    if (*r)
+        *r = next;
+    pthread_mutex_unlock(&gen.readers_lock);
+}
+
+
+const UniConfSnapshot *UniSnapshotGen::Reader::acquire()
+{
+    if (!snap)
+    {
+        // announce the epoch before looking at 'current'; pairs with the
+        // barrier between publishing and scanning in the owning thread.
+        active = gen.epoch;
+        __sync_synchronize();
+        snap = gen.current;
+    }
+    return snap;
+}
+
+
+void UniSnapshotGen::Reader::release()
+{
+    if (snap)
+    {
+        __sync_synchronize(); // finish reading before we say we're done
+        snap = NULL;
+        active = 0;
+    }
+}
+
+
+/***** UniSnapshotGen *****/
+
+UniSnapshotGen::UniSnapshotGen(IUniConfGen *inner) :
+    UniFilterGen(inner),
+    current(NULL), epoch(1), dirty(true), readers(NULL)
+{
+    pthread_mutex_init(&readers_lock, NULL);
+    publish();
+}
+
+
+UniSnapshotGen::~UniSnapshotGen()
+{
+    wvassert(!readers, "UniSnapshotGen destroyed with active readers");
+
+    RetiredList::Iter i(retired);
+    for (i.rewind(); i.next(); )
+        delete i->snap;
+    retired.zap();
+    delete current;
+    pthread_mutex_destroy(&readers_lock);
+}
+
+
+void UniSnapshotGen::publish()
+{
+    if (dirty)
+    {
+        dirty = false;
+
+        UniConfSnapshot *old = current;
+        UniConfSnapshot *snap = new UniConfSnapshot(inner());
+        __sync_synchronize(); // snapshot contents before the pointer
+        current = snap;
+
+        if (old)
+        {
+            // readers that announce the new epoch are guaranteed to see
+            // the new snapshot, so the old one is only in use by readers
+            // still at an older epoch.
+            Retired *r = new Retired;
+            r->snap = old;
+            r->epoch = __sync_add_and_fetch(&epoch, 1);
+            retired.append(r, true);
+        }
+    }
+
+    reclaim();
+}
+
+
+void UniSnapshotGen::reclaim()
+{
+    if (retired.isempty())
+        return;
+
+    __sync_synchronize();
+    unsigned long oldest = ULONG_MAX;
+    pthread_mutex_lock(&readers_lock);
+    for (Reader *r = readers; r; r = r->next)
+    {
+        unsigned long e = r->active;
+        if (e && e < oldest)
+            oldest = e;
+    }
+    pthread_mutex_unlock(&readers_lock);
+
+    RetiredList::Iter i(retired);
+    for (i.rewind(); i.next(); )
+    {
+        if (i->epoch <= oldest)
+        {
+            delete i->snap;
+            i.xunlink();
+        }
+    }
+}
+
+
+void UniSnapshotGen::commit()
+{
+    UniFilterGen::commit();
+    publish();
+}
+
+
+bool UniSnapshotGen::refresh()
+{
+    bool ok = UniFilterGen::refresh();
+    publish();
+    return ok;
+}
+
+
+void UniSnapshotGen::gencallback(const UniConfKey &key, WvStringParm value)
+{
+    dirty = true;
+    UniFilterGen::gencallback(key, value);
+}
@@ -142,11 +142,12 @@ public:
 
 class UniUnwrapGen::RecursiveIter : public UniConfGen::Iter
 {
+    UniConf top;
     UniConf::RecursiveIter i;
     
 public:
     RecursiveIter(const UniConf &cfg)
-	: i(cfg)
+	: top(cfg), i(cfg)
         { }
     virtual ~RecursiveIter()
         { }
@@ -154,7 +155,8 @@ public:
     /***** Overridden members *****/
     virtual void rewind() { i.rewind(); }
     virtual bool next() { return i.next(); }
-    virtual UniConfKey key() const { return i->key(); }
+    // keys from a recursive iterator are relative to where it started
+    virtual UniConfKey key() const { return i->fullkey(top); }
     virtual WvString value() const { return i->getme(); }
 };
 
@@ -0,0 +1,240 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast URLs and addresses get parsed, and how fast
+ * WvHttpPool can hash the connection it wants, next to the way all of
+ * those used to be done.
+ *
+ *     urlparsetest [msec-per-run] [distinct-urls]
+ */
+#include "wvhttppool.h"
+#include "wvtimeutils.h"
+#include "strutils.h"
+#include <stdio.h>
+#include <ctype.h>
+
+
+// What WvUrl's constructor used to do, minus the DNS lookup
+struct OldUrl
+{
+    WvString proto, hostname, user, password, file;
+    int port;
+
+    OldUrl(WvStringParm url)
+    {
+        WvString work(url);
+        char *cptr, *wptr = work.edit();
+        port = 0;
+        wptr = trim_string(wptr);
+        cptr = wptr + strcspn(wptr, " \t\r\n");
+        *cptr = 0;
+        cptr = strchr(wptr, ':');
+        if (!cptr)
+            return;
+        *cptr = 0;
+        proto = wptr;
+        wptr = cptr + 3;
+        cptr = strchr(wptr, '@');
+        if (!cptr)
+        {
+            user = "";
+            password = "";
+        }
+        else
+        {
+            *cptr = 0;
+            char *cptr2 = strchr(wptr, ':');
+            if (cptr2 && (*(cptr2+1) != 0))
+            {
+                *cptr2 = 0;
+                password = cptr2 + 1;
+            }
+            else
+                password = "";
+            user = wptr;
+            wptr = cptr + 1;
+        }
+        cptr = strchr(wptr, '/');
+        if (!cptr)
+            file = "/";
+        else
+        {
+            file = cptr;
+            *cptr = 0;
+        }
+        cptr = strchr(wptr, ':');
+        if (!cptr)
+            port = 80;
+        else
+        {
+            port = atoi(cptr+1);
+            *cptr = 0;
+        }
+        hostname = wptr;
+    }
+};
+
+
+// What WvIPAddr::string_init() and WvIPPortAddr::string_init() used to do
+static void old_ipportaddr(const char *string, unsigned char binaddr[4],
+                           int &port)
+{
+    const char *iptr, *nptr = string;
+    unsigned char *cptr = binaddr;
+    memset(binaddr, 0, 4);
+    for (int count = 0; count < 4 && nptr; count++)
+    {
+        iptr = nptr;
+        nptr = strchr(iptr, '.');
+        if (nptr) nptr++;
+        *cptr++ = strtol(iptr, NULL, 10);
+        if (!nptr) break;
+    }
+
+    const char *sptr;
+    for (sptr = string; *sptr && isdigit((unsigned char)*sptr); sptr++)
+        ;
+    if (!*sptr)
+    {
+        port = atoi(string);
+        return;
+    }
+    cptr = (unsigned char *)strchr(string, ':');
+    if (!cptr)
+        cptr = (unsigned char *)strchr(string, ' ');
+    if (!cptr)
+        cptr = (unsigned char *)strchr(string, '\t');
+    port = cptr ? atoi((char *)cptr + 1) : 0;
+}
+
+
+static unsigned old_target_hash(const WvUrlStream::Target &n)
+{
+    WvString key("%s%s", n.remaddr, n.username);
+    return WvHash(key);
+}
+
+
+static void report(const char *what, unsigned long n, WvTime start)
+{
+    printf("%-45s %10.0f/sec\n", what, n * 1000.0 / msecdiff(wvtime(), start));
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 1000;
+    int ndistinct = argc > 2 ? atoi(argv[2]) : 1000;
+
+    // the kind of thing WvHttpPool gets asked for: lots of files from a
+    // few servers
+    WvString *urls = new WvString[ndistinct];
+    for (int n = 0; n < ndistinct; n++)
+        urls[n] = WvString("http://user:pw@10.0.0.%s:8080/dir/file%s.html",
+                           n % 8, n);
+    unsigned long count, sum = 0;
+    WvTime start;
+
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            OldUrl url(urls[count % ndistinct]);
+            sum += url.port;
+        }
+    }
+    report("old WvUrl parsing", count, start);
+
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            WvUrl::Parts p;
+            WvUrl::parse(urls[count % ndistinct], p);
+            sum += p.port;
+        }
+    }
+    report("WvUrl::parse()", count, start);
+
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            WvUrl url(urls[count % ndistinct]);
+            sum += url.getport();
+        }
+    }
+    report(WvString("WvUrl, %s different URLs", ndistinct), count, start);
+
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            WvUrl url(urls[count % 16]);
+            sum += url.getport();
+        }
+    }
+    report("WvUrl, the same 16 URLs", count, start);
+
+    const char *addrs[] = { "10.0.0.1:80", "192.168.100.200:8080",
+                            "127.0.0.1", "5555" };
+    unsigned char binaddr[4];
+    int port;
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            old_ipportaddr(addrs[count % 4], binaddr, port);
+            sum += port + binaddr[3];
+        }
+    }
+    report("old WvIPPortAddr parsing", count, start);
+
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            WvIPPortAddr a(addrs[count % 4]);
+            sum += a.port + a.binaddr[3];
+        }
+    }
+    report("WvIPPortAddr parsing", count, start);
+
+    WvUrlStream::Target target(WvIPPortAddr("10.0.0.1:8080"), "user");
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+            sum += old_target_hash(target);
+    }
+    report("old Target hashing", count, start);
+
+    count = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 1000; n++, count++)
+        {
+            WvUrlStream::Target t(WvIPPortAddr(binaddr, n), "user");
+            sum += WvHash(t);
+        }
+    }
+    report("Target construction and hashing", count, start);
+
+    delete[] urls;
+    return sum == 42; // so none of it gets optimized away
+}
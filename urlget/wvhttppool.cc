@@ -20,8 +20,7 @@ int WvUrlStream::max_requests = 100;
 
 unsigned WvHash(const WvUrlStream::Target &n)
 {
-    WvString key("%s%s", n.remaddr, n.username);
-    return (WvHash(key));
+    return n.hash;
 }
 
 
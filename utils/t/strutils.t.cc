@@ -924,6 +924,89 @@ WVTEST_MAIN("cstr_unescape")
             && size == 6 && memcmp(data, "onetwo", size) == 0);
 }
 
+// what cstr_escape() gives back, without the quotes around it
+static WvString unquote(WvStringParm s)
+{
+    WvString inside(s.cstr() + 1);
+    inside.edit()[inside.len() - 1] = 0;
+    return inside;
+}
+
+/** Tests the escaping functions on longer strings.
+ * They skip over the parts that don't need escaping in big pieces, so
+ * check them against escaping one character at a time, with the
+ * characters that do need it in all sorts of places.
+ */
+WVTEST_MAIN("escapes, long strings")
+{
+    static const CStrExtraEscape q_escapes[] =
+        { { 'q', "\\Q" }, { 0, NULL } };
+    static const CStrExtraEscape pct_escapes[] =
+        { { 'q', "%" }, { 0, NULL } };
+    static const char special[] = "\\\"\n\xff{q% !/";
+    char data[100];
+    bool ok = true;
+
+    for (int where = 0; where < 100; where += 3)
+    {
+        for (unsigned s = 0; s < sizeof(special) - 1; s++)
+        {
+            for (int i = 0; i < 100; i++)
+                data[i] = 'a' + i % 26;
+            data[where] = special[s];
+            data[99 - where / 2] = special[(s + 3) % (sizeof(special) - 1)];
+            data[99] = 0;
+            WvString str(data);
+
+            WvString cstr("\""), tcl("\""), q("\""), url(""), bs("");
+            for (int i = 0; i < 99; i++)
+            {
+                cstr.append(unquote(cstr_escape(&data[i], 1)));
+                tcl.append(unquote(cstr_escape(&data[i], 1,
+                                               CSTR_TCLSTR_ESCAPES)));
+                q.append(unquote(cstr_escape(&data[i], 1, q_escapes)));
+                url.append(url_encode(WvString("%c", data[i])));
+                bs.append(backslash_escape(WvString("%c", data[i])));
+            }
+            cstr.append("\""); tcl.append("\""); q.append("\"");
+
+            if (cstr != cstr_escape(data, 99)
+                || tcl != cstr_escape(data, 99, CSTR_TCLSTR_ESCAPES)
+                || q != cstr_escape(data, 99, q_escapes)
+                || url != url_encode(str)
+                || bs != backslash_escape(str))
+                ok = false;
+
+            // and back again
+            char back[100];
+            size_t size;
+            if (!cstr_unescape(q, back, sizeof(back), size, q_escapes)
+                || size != 99 || memcmp(back, data, 99)
+                || url_decode(url) != str)
+                ok = false;
+            if (!strchr(str, '%'))
+            {
+                if (!cstr_unescape(cstr_escape(data, 99, pct_escapes),
+                                   back, sizeof(back), size, pct_escapes)
+                    || size != 99 || memcmp(back, data, 99))
+                    ok = false;
+            }
+
+            // not enough room: as much as there's room for
+            memset(back, 0, sizeof(back));
+            if (cstr_unescape(tcl, back, 50, size, CSTR_TCLSTR_ESCAPES)
+                || size != 99 || memcmp(back, data, 50) || back[50])
+                ok = false;
+        }
+    }
+    WVPASS(ok);
+
+    // url_decode() trims spaces, and leaves a % near the end alone
+    WVPASSEQ(url_decode("  a+b%41%4 "), "a bA%4");
+    WVPASSEQ(url_decode("a%zzb%", true), "ab%");
+    WVPASSEQ(url_decode(" + "), " ");
+}
+
 void foo(WvStringParm s)
 {
     wvcon->print("foo: s is `%s'\n", s);
@@ -1197,3 +1280,83 @@ WVTEST_MAIN("intl_datetime")
     WVPASS(checkdateformat(intl_date(dt)));
     WVPASS(checkdatetimeformat(intl_datetime(dt)));
 }
+
+
+// what the date and time functions used to do every time
+static WvString slow_time(const char *format, time_t t, bool local = true)
+{
+    char buf[80];
+    strftime(buf, sizeof(buf), format, local ? localtime(&t) : gmtime(&t));
+    return buf;
+}
+
+
+#ifndef _WIN32 // no setenv(), or zoneinfo names
+WVTEST_MAIN("dates and times into buffers")
+{
+    WvString oldtz = getenv("TZ");
+    static const char *zones[] = {
+        "UTC", "America/Toronto", "Australia/Adelaide", "Asia/Kolkata"
+    };
+
+    for (unsigned z = 0; z < sizeof(zones) / sizeof(zones[0]); z++)
+    {
+        setenv("TZ", zones[z], 1);
+        tzset();
+
+        // every 37 minutes for a week on either side of the changes to
+        // and from daylight saving time in 2006, and all over the place
+        static const time_t starts[] = { 1143352800, 1161468000, 0 };
+        bool ok = true;
+        for (int i = 0; i < 1000 + 2 * 14 * 24 * 60 / 37; i++)
+        {
+            time_t t = i < 1000 ? (time_t)i * 2147483 + i % 37
+                : starts[(i - 1000) % 2] + (i - 1000) / 2 * 37 * 60;
+            char buf[80];
+
+            WvString expect = slow_time("%a, %d %b %Y %H:%M:%S %z", t);
+            if (rfc822_date(t, buf, sizeof(buf)) != expect.len()
+                || expect != buf || rfc822_date(t) != expect)
+            {
+                printf("rfc822_date(%ld): %s != %s\n", (long)t, buf,
+                       expect.cstr());
+                ok = false;
+            }
+            expect = slow_time("%a, %d %b %Y %H:%M:%S GMT", t, false);
+            if (rfc1123_date(t, buf, sizeof(buf)) != expect.len()
+                || expect != buf || rfc1123_date(t) != expect)
+                ok = false;
+            if (local_date(t, buf, sizeof(buf)) == 0
+                || slow_time("%b %d %I:%M:%S %p", t) != buf
+                || intl_time(t, buf, sizeof(buf)) == 0
+                || slow_time("%H:%M:%S", t) != buf
+                || intl_date(t, buf, sizeof(buf)) == 0
+                || slow_time("%Y-%m-%d", t) != buf
+                || intl_datetime(t, buf, sizeof(buf)) == 0
+                || slow_time("%Y-%m-%d %H:%M:%S", t) != buf
+                || intl_datetime(t) != buf)
+            {
+                printf("%ld: %s\n", (long)t, buf);
+                ok = false;
+            }
+        }
+        WVPASS(ok);
+    }
+
+    // not enough room: nothing
+    char small[10] = "x";
+    WVPASSEQ(intl_datetime(1152558117, small, sizeof(small)), 0);
+    WVPASSEQ(small, "");
+    WVPASSEQ(intl_date(1152558117, small, 11), 10);
+
+    // rfc1123_date() has no "now": before 1970 is just before 1970
+    WVPASSEQ(rfc1123_date(-86400), "Wed, 31 Dec 1969 00:00:00 GMT");
+    WVPASSEQ(rfc1123_date(-1), "Wed, 31 Dec 1969 23:59:59 GMT");
+
+    if (oldtz)
+        setenv("TZ", oldtz, 1);
+    else
+        unsetenv("TZ");
+    tzset();
+}
+#endif
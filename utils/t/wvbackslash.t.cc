@@ -68,3 +68,74 @@ WVTEST_MAIN("backslashtest.cc")
         WVRELEASE(stream);
     }
 }
+
+
+// Long runs that don't need escaping are copied in one go, so try some
+// with the escapes in different places, and with not much room to put
+// the results in.
+WVTEST_MAIN("long runs")
+{
+    char data[200];
+    for (int i = 0; i < 200; i++)
+        data[i] = 'a' + i % 26;
+    static const char special[] = { '\\', '"', '\n', '\0', '\xff', '\x01' };
+    bool ok = true;
+
+    for (int where = 0; where < 200; where += 11)
+    {
+        for (unsigned s = 0; s < sizeof(special); s++)
+        {
+            data[where] = special[s];
+            data[199 - where] = special[(s + 1) % sizeof(special)];
+
+            // one character at a time
+            WvBackslashEncoder enc1;
+            WvDynBuf expect;
+            for (int i = 0; i < 200; i++)
+            {
+                WvConstInPlaceBuf in(&data[i], 1);
+                enc1.encode(in, expect, false);
+            }
+
+            // all at once
+            WvBackslashEncoder enc;
+            WvDynBuf encoded;
+            WvConstInPlaceBuf in(data, 200);
+            if (!enc.flush(in, encoded)
+                || encoded.used() != expect.used()
+                || memcmp(encoded.peek(0, encoded.used()),
+                          expect.peek(0, expect.used()), expect.used()))
+                ok = false;
+
+            // a little at a time: it stops where it runs out of room
+            WvBackslashEncoder enc2;
+            WvDynBuf pieces;
+            WvConstInPlaceBuf in2(data, 200);
+            char room[7];
+            while (in2.used())
+            {
+                WvInPlaceBuf out(room, 0, sizeof(room));
+                enc2.encode(in2, out, false);
+                if (!out.used())
+                {
+                    ok = false;
+                    break;
+                }
+                pieces.merge(out);
+            }
+            if (pieces.getstr() != expect.getstr())
+                ok = false;
+
+            // and back
+            WvBackslashDecoder dec;
+            WvDynBuf decoded;
+            if (!dec.flush(encoded, decoded) || decoded.used() != 200
+                || memcmp(decoded.get(200), data, 200))
+                ok = false;
+
+            data[where] = 'a' + where % 26;
+            data[199 - where] = 'a' + (199 - where) % 26;
+        }
+    }
+    WVPASS(ok);
+}
@@ -157,3 +157,78 @@ WVTEST_MAIN("wvdynbuf big lines")
     WVPASS(*buf.get(4096) == '1');
 }
 
+
+
+// getch() and putch() work through cursors that don't always tell the
+// store right away; make sure everything else still sees the same thing.
+WVTEST_MAIN("byte-at-a-time cursors")
+{
+    WvDynBuf buf;
+    for (int i = 0; i < 5000; i++)
+    {
+	buf.putch('a' + i % 26);
+	WVPASSEQ(buf.used(), size_t(i + 1));
+    }
+    buf.put("123", 3);
+    WVPASSEQ(buf.used(), 5003);
+    WVPASSEQ(buf.peekch(4999), 'a' + 4999 % 26);
+    WVPASSEQ(buf.strchr('1'), 5001);
+
+    WVPASSEQ(buf.getch(), 'a');
+    WVPASSEQ(buf.getch(), 'b');
+    WVPASSEQ(buf.used(), 5001);
+    buf.unget(2);
+    WVPASSEQ(buf.used(), 5003);
+    WVPASSEQ(buf.getch(), 'a');
+    const unsigned char *p = buf.get(4);
+    WVPASS(!memcmp(p, "bcde", 4));
+    buf.skip(21);
+    WVPASSEQ(buf.getch(), 'a');
+    WVPASSEQ(buf.optgettable() > 0, true);
+
+    // a write in the middle of reading, and a read in the middle of
+    // writing
+    buf.putch('!');
+    WVPASSEQ(buf.getch(), 'b');
+    buf.putch('?');
+    WVPASSEQ(buf.used(), 5003 - 27 + 1);
+    WvString rest(buf.getstr());
+    WVPASSEQ(rest.len(), 5003 - 27 + 1);
+    WVPASS(!strcmp(rest + rest.len() - 5, "123!?"));
+    WVPASSEQ(buf.used(), 0);
+
+    // other buffers get everything when merging
+    WvDynBuf other;
+    other.putch('1');
+    other.putch('2');
+    buf.putch('0');
+    buf.merge(other);
+    WVPASSEQ(other.used(), 0);
+    WVPASSEQ(buf.getstr(), "012");
+
+    // ...and so do views of the store
+    buf.putch('q');
+    {
+	WvBufView view(buf);
+	WVPASSEQ(view.used(), 1);
+	WVPASSEQ(view.getch(), 'q');
+	view.putch('r');
+    }
+    WVPASSEQ(buf.getstr(), "r");
+
+    // fixed-size buffers fill up exactly
+    WvInPlaceBuf small(3);
+    small.putch('a');
+    small.putch('b');
+    WVPASSEQ(small.free(), 1);
+    small.putch('c');
+    WVPASSEQ(small.free(), 0);
+    WVPASSEQ(small.used(), 3);
+    WVPASSEQ(small.getch(), 'a');
+    small.zap();
+    WVPASSEQ(small.used(), 0);
+    WVPASSEQ(small.free(), 3);
+    small.putch('z');
+    WVPASSEQ(small.getch(), 'z');
+    WVPASSEQ(small.used(), 0);
+}
@@ -0,0 +1,102 @@
+#include "wvtest.h"
+#include "wvcrc.h"
+#include <zlib.h>
+#include <stdlib.h>
+
+// the slowest, simplest way, to check the fast ones against
+static uint32_t bitwise(uint32_t poly, uint32_t crc,
+			const unsigned char *p, size_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+	crc ^= *p++;
+	for (int bit = 0; bit < 8; bit++)
+	    crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+    }
+    return ~crc;
+}
+
+
+WVTEST_MAIN("crc32 and crc32c check values")
+{
+    printf("using %s\n", wvcrc_impl());
+    WVPASSEQ(wvcrc32(0, "123456789", 9), 0xcbf43926U);
+    WVPASSEQ(wvcrc32c(0, "123456789", 9), 0xe3069283U);
+    WVPASSEQ(wvcrc32(0, "", 0), 0);
+    WVPASSEQ(wvcrc32c(0, NULL, 0), 0);
+
+    // 32 bytes of zeros and of 0xff, from RFC 3720's examples
+    unsigned char buf[32];
+    memset(buf, 0, sizeof(buf));
+    WVPASSEQ(wvcrc32c(0, buf, sizeof(buf)), 0x8a9136aaU);
+    memset(buf, 0xff, sizeof(buf));
+    WVPASSEQ(wvcrc32c(0, buf, sizeof(buf)), 0x62a8ab43U);
+}
+
+
+WVTEST_MAIN("crc32 and crc32c of every length and alignment")
+{
+    const size_t max = 1100;
+    unsigned char *data = new unsigned char[max + 16];
+    srandom(42);
+    for (size_t i = 0; i < max + 16; i++)
+	data[i] = random();
+
+    int bad32 = 0, bad32c = 0, badzlib = 0;
+    for (size_t off = 0; off < 16; off++)
+    {
+	for (size_t len = 0; len <= max; len += (len < 300 ? 1 : 37))
+	{
+	    const unsigned char *p = data + off;
+	    uint32_t want = bitwise(0xedb88320U, 0, p, len);
+	    if (wvcrc32(0, p, len) != want)
+		bad32++;
+	    if (crc32(0, p, len) != want)
+		badzlib++;
+	    if (wvcrc32c(0, p, len) != bitwise(0x82f63b78U, 0, p, len))
+		bad32c++;
+	}
+    }
+    WVPASSEQ(bad32, 0);
+    WVPASSEQ(bad32c, 0);
+    WVPASSEQ(badzlib, 0);
+    delete[] data;
+}
+
+
+WVTEST_MAIN("crc32 and crc32c a piece at a time")
+{
+    const size_t len = 100000;
+    unsigned char *data = new unsigned char[len];
+    for (size_t i = 0; i < len; i++)
+	data[i] = i * 7 + (i >> 8);
+
+    uint32_t whole32 = wvcrc32(0, data, len);
+    uint32_t whole32c = wvcrc32c(0, data, len);
+    WVPASSEQ(whole32, (uint32_t)crc32(0, data, len));
+    // long enough for crc32c to be done in three streams at once
+    WVPASSEQ(whole32c, bitwise(0x82f63b78U, 0, data, len));
+
+    // in odd-sized pieces, some too small to be folded and some not
+    size_t sizes[] = { 1, 7, 63, 64, 65, 800, 30000, 13 };
+    int bad = 0;
+    for (int start = 0; start < 8; start++)
+    {
+	uint32_t c32 = 0, c32c = 0;
+	size_t done = 0;
+	for (int n = start; done < len; n++)
+	{
+	    size_t piece = sizes[n % 8];
+	    if (piece > len - done)
+		piece = len - done;
+	    c32 = wvcrc32(c32, data + done, piece);
+	    c32c = wvcrc32c(c32c, data + done, piece);
+	    done += piece;
+	}
+	if (c32 != whole32 || c32c != whole32c)
+	    bad++;
+    }
+    WVPASSEQ(bad, 0);
+    delete[] data;
+}
@@ -47,26 +47,49 @@ WVTEST_MAIN("repetition")
     WVPASSEQ(num, 7);
     
     cb1(1);
-    cb1 = 0;  // though the callback is now gone, the underlying stream is still
-	      // on the globallist (though close()d), and alarm(0)'d; it will
-	      // still run.
+    cb1 = 0;  // though the callback is now gone, the call is still queued
+	      // on the globallist; it will still run.
     l.runonce(10);
     WVPASSEQ(num, 8);
 
-#if WVDELAYED_SUPPORTS_NESTING_PROPERLY
-    // FIXME: See wvdelayedcallback.h for information about why nested
-    // WvDelayedCallback objects don't actually work.
+    // nested delayed callbacks take one more pass per level
     cb5(100);
     cb4(200);
-    WVPASSEQ(num, 7);
+    WVPASSEQ(num, 8);
     l.runonce(10);
-    WVPASSEQ(num, 207);
+    WVPASSEQ(num, 208);
     l.runonce(10);
-    WVPASSEQ(num, 207);
+    WVPASSEQ(num, 208);
     l.runonce(10);
-    WVPASSEQ(num, 207);
+    WVPASSEQ(num, 308);
     l.runonce(10);
-    WVPASSEQ(num, 307);
-#endif    
+    WVPASSEQ(num, 308);
 }
 
+
+WVTEST_MAIN("no streams")
+{
+    num = 0;
+    size_t streams = WvIStreamList::globallist.count();
+
+    InnerCallback cb = wv::delayed(&add_cb);
+    InnerCallback copy = cb;
+    WVPASSEQ(WvIStreamList::globallist.count(), streams);
+    WVPASSEQ(WvIStreamList::globallist.runsoon_count(), 0);
+
+    // each copy gets its own call...
+    cb(1);
+    copy(2);
+    WVPASSEQ(WvIStreamList::globallist.runsoon_count(), 2);
+    WvIStreamList::globallist.runonce(0);
+    WVPASSEQ(num, 3);
+    WVPASSEQ(WvIStreamList::globallist.runsoon_count(), 0);
+
+    // ...but calling the same one again before it runs only replaces it
+    cb(10);
+    cb(20);
+    copy(300);
+    WVPASSEQ(WvIStreamList::globallist.runsoon_count(), 2);
+    WvIStreamList::globallist.runonce(0);
+    WVPASSEQ(num, 323);
+}
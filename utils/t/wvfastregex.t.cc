@@ -0,0 +1,335 @@
+#include "wvtest.h"
+#include "wvfastregex.h"
+#include "wvtimeutils.h"
+#include <stdlib.h>
+
+
+WVTEST_MAIN("fast basic syntax")
+{
+    WvFastRegex re("ab+c", WvRegex::BASIC);
+    WVPASS(re.isok());
+
+    WVFAIL(re.match(""));
+    WVFAIL(re.match("a"));
+    WVFAIL(re.match("ac"));
+    WVFAIL(re.match("abc"));
+    WVPASS(re.match("ab+c"));
+    WVPASS(re.match("prefixab+csuffix"));
+    WVFAIL(re.match("abbc"));
+    WVFAIL(re.match("adc"));
+
+    WvFastRegex re2("\\(ab\\)*c\\{2,3\\}$", WvRegex::BASIC);
+    WVPASS(re2.isok());
+    WVPASS(re2.match("ababcc"));
+    WVPASS(re2.match("xccc"));
+    WVFAIL(re2.match("abc"));
+    WVFAIL(re2.match("abcc "));
+}
+
+
+WVTEST_MAIN("fast extended syntax")
+{
+    WvFastRegex re("ab+c");
+    WVPASS(re.isok());
+
+    WVFAIL(re.match(""));
+    WVFAIL(re.match("a"));
+    WVFAIL(re.match("ac"));
+    WVPASS(re.match("abc"));
+    WVPASS(re.match("prefixabbcsuffix"));
+    WVPASS(re.match("abbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbc"));
+    WVFAIL(re.match("adc"));
+
+    WvFastRegex re2("^(GET|POST) /[a-z]{2,4}(\\.html)?$");
+    WVPASS(re2.match("GET /abc"));
+    WVPASS(re2.match("POST /abcd.html"));
+    WVFAIL(re2.match("PUT /abc"));
+    WVFAIL(re2.match("GET /a"));
+    WVFAIL(re2.match("GET /abcde"));
+    WVFAIL(re2.match(" GET /abc"));
+
+    WvFastRegex re3("[[:digit:]]+[^a-z ]x|[]]");
+    WVPASS(re3.match("12Ax"));
+    WVPASS(re3.match("]"));
+    WVFAIL(re3.match("12ax"));
+    WVFAIL(re3.match("12 x"));
+}
+
+
+WVTEST_MAIN("fast regex flags")
+{
+    WvFastRegex icase("hello [a-c]+", WvRegex::EXTENDED | WvRegex::ICASE);
+    WVPASS(icase.match("say HeLLo ABC"));
+    WVFAIL(icase.match("say HeLLo xyz"));
+
+    WvFastRegex re("^WvStream$");
+    WVPASS(re.match("WvStream"));
+    WVFAIL(re.match("WvStream", WvRegex::NOTBOL));
+    WVFAIL(re.match("WvStream", WvRegex::NOTEOL));
+    WVFAIL(re.match("one\nWvStream\ntwo"));
+
+    WvFastRegex nl("^WvStream$", WvRegex::EXTENDED | WvRegex::NEWLINE);
+    WVPASS(nl.match("one\nWvStream\ntwo"));
+    WVPASS(nl.match("WvStream\n", WvRegex::NOTEOL));
+    WVFAIL(nl.match("one WvStream\ntwo"));
+
+    WvFastRegex dot("a.b", WvRegex::EXTENDED | WvRegex::NEWLINE);
+    WVFAIL(dot.match("a\nb"));
+    WVPASS(dot.match("a\nb a b"));
+    WvFastRegex dot2("a.b");
+    WVPASS(dot2.match("a\nb"));
+}
+
+
+WVTEST_MAIN("fast regex errors")
+{
+    WvFastRegex re;
+    WVFAIL(re.match("anything"));
+
+    WVFAIL(re.set("(abc"));
+    WVFAIL(re.isok());
+    WVFAIL(re.match("abc"));
+    WVFAIL(WvFastRegex("[abc").isok());
+    WVFAIL(WvFastRegex("a{3,1}").isok());
+    WVFAIL(WvFastRegex("*a").isok());
+    WVFAIL(WvFastRegex("(a)\\1").isok());
+    WVFAIL(WvFastRegex("[[:nonsense:]]").isok());
+    WVPASS(WvFastRegex("a)").isok());
+}
+
+
+WVTEST_MAIN("fast continuable_match")
+{
+    WvFastRegex re("Wv(Stream|String)");
+    int match_start, match_end;
+
+    WVPASS(re.continuable_match("This is WvStreams", match_start, match_end));
+    WVPASSEQ(match_start, 8);
+    WVPASSEQ(match_end, 16);
+
+    WVPASS(re.continuable_match("WvString is part of WvStreams",
+                                match_start, match_end));
+    WVPASSEQ(match_start, 0);
+    WVPASSEQ(match_end, 8);
+
+    // leftmost, then longest
+    WvFastRegex re2("b+|ab*c|abbbbbd");
+    WVPASS(re2.continuable_match("xxabbbbbd", match_start, match_end));
+    WVPASSEQ(match_start, 2);
+    WVPASSEQ(match_end, 9);
+
+    size_t start, end;
+    const char data[] = "no nul \0 in here: abc";
+    WvFastRegex re3("[a-c]+$");
+    WVPASS(re3.continuable_match_span(data, sizeof(data) - 1, start, end));
+    WVPASSEQ(start, sizeof(data) - 4);
+    WVPASSEQ(end, sizeof(data) - 1);
+    WVPASS(re3.match_span(data, sizeof(data) - 1));
+    WVFAIL(re3.match_span(data, 5));
+}
+
+
+// Lots of patterns and strings, checked against regexec()
+WVTEST_MAIN("fast regex agrees with WvRegex")
+{
+    const char *patterns[] = {
+        "a", "abc", "a*", "a+b", "(a|b)*c", "^abc", "abc$", "^$", "^",
+        "$", "a?b?c?", "(ab|a)(bc|c)", "[a-c]+", "[^a]b", "x*y*z*",
+        "(a*)*", "(a|aa)+$", "a{2}", "a{1,2}b", "(ab){2,}", "^a|b$",
+        "a$|^b", "(^a|c)b", "a($|b)", ".", "a.c", "\\.", "[[:upper:]]+",
+        "b(a|$)", "(a|^)b", "(x|y|z|)+q", "c*(ab)*", "[.]|[[.-.]]",
+        NULL
+    };
+    const char *strings[] = {
+        "", "a", "ab", "abc", "aabbcc", "cab", "xyz", "abcabc", "bca",
+        "a\nb", "b\na", "ab\nc", "\n", "ABC", "aaab", "ababab", "zq",
+        "x.y", "a-b", "qqq\nabc\n", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaab",
+        NULL
+    };
+    int cflags[] = {
+        WvRegex::EXTENDED,
+        WvRegex::EXTENDED | WvRegex::ICASE,
+        WvRegex::EXTENDED | WvRegex::NEWLINE,
+    };
+    int eflags[] = { 0, WvRegex::NOTBOL, WvRegex::NOTEOL };
+
+    int checked = 0, bad = 0;
+    for (int c = 0; c < 3; c++)
+        for (int p = 0; patterns[p]; p++)
+        {
+            WvRegex slow(patterns[p], cflags[c]);
+            WvFastRegex fast(patterns[p], cflags[c]);
+            if (!fast.isok())
+            {
+                printf("didn't compile: '%s'\n", patterns[p]);
+                bad++;
+                continue;
+            }
+            for (int s = 0; strings[s]; s++)
+                for (int e = 0; e < 3; e++)
+                {
+                    int ss = -1, se = -1, fs = -1, fe = -1;
+                    bool sm = slow.continuable_match(strings[s], eflags[e],
+                                                     ss, se);
+                    bool fm = fast.continuable_match(strings[s], eflags[e],
+                                                     fs, fe);
+                    bool fm2 = fast.match(strings[s], eflags[e]);
+                    checked++;
+                    if (sm != fm || sm != fm2
+                        || (sm && (ss != fs || se != fe)))
+                    {
+                        printf("'%s' (%d) on '%s' (%d): "
+                               "regexec %d [%d,%d), fast %d/%d [%d,%d)\n",
+                               patterns[p], cflags[c], strings[s],
+                               eflags[e], sm, ss, se, fm, fm2, fs, fe);
+                        bad++;
+                    }
+                }
+        }
+    printf("%d checked\n", checked);
+    WVPASSEQ(bad, 0);
+}
+
+
+WVTEST_MAIN("fast regex over a WvBuf in pieces")
+{
+    WvDynBuf buf(4, 16);
+    for (int i = 0; i < 100; i++)
+        buf.putstr("some words ");
+    buf.putstr("a needle in ");
+    for (int i = 0; i < 100; i++)
+        buf.putstr("more hay ");
+    WVPASS(buf.optpeekable(0) < buf.used());
+    size_t used = buf.used();
+
+    WVPASS(WvFastRegex("ne+dle").match(buf));
+    WVPASS(WvFastRegex("a needle in more").match(buf));
+    WVPASS(WvFastRegex("hay $").match(buf));
+    WVFAIL(WvFastRegex("hay $").match(buf, WvRegex::NOTEOL));
+    WVFAIL(WvFastRegex("needles").match(buf));
+    WVPASSEQ(buf.used(), used);
+
+    WvFastRegexSet set;
+    set.add("needle");
+    set.add("haystack");
+    set.add("^some");
+    bool which[3];
+    WVPASSEQ(set.match(buf, which), 2);
+    WVPASS(which[0]);
+    WVFAIL(which[1]);
+    WVPASS(which[2]);
+    WVPASSEQ(buf.used(), used);
+}
+
+
+WVTEST_MAIN("fast regex set")
+{
+    WvFastRegexSet set;
+    WVPASSEQ(set.match("anything"), 0);
+
+    WVPASSEQ(set.add("^kernel: .*error"), 0);
+    WVPASSEQ(set.add("sshd\\[[0-9]+\\]: Failed"), 1);
+    WVPASSEQ(set.add("(disk|raid) (full|degraded)$"), 2);
+    WVPASSEQ(set.add("x*"), 3);
+    WVPASSEQ(set.add("(broken"), -1);
+    WVFAIL(set.isok());
+    WVPASSEQ(set.count(), 4);
+
+    bool which[4];
+    WVPASSEQ(set.match("kernel: usb error on raid degraded", which), 3);
+    WVPASS(which[0]);
+    WVFAIL(which[1]);
+    WVPASS(which[2]);
+    WVPASS(which[3]);
+
+    WVPASSEQ(set.match("sshd[1234]: Failed password", which), 2);
+    WVFAIL(which[0]);
+    WVPASS(which[1]);
+    WVFAIL(which[2]);
+
+    WVPASSEQ(set.match("raid degraded", which, WvRegex::NOTEOL), 1);
+    WVFAIL(which[2]);
+
+    // the same answers as one at a time
+    const char *lines[] = {
+        "kernel: error", "kernel:error", "x kernel: error", "disk full",
+        "disk full now", "sshd[]: Failed", "sshd[1]: Failed", "", NULL
+    };
+    const char *pats[] = {
+        "^kernel: .*error", "sshd\\[[0-9]+\\]: Failed",
+        "(disk|raid) (full|degraded)$", "x*"
+    };
+    int bad = 0;
+    for (int l = 0; lines[l]; l++)
+    {
+        set.match(lines[l], which);
+        for (int p = 0; p < 4; p++)
+            if (which[p] != WvRegex(pats[p]).match(lines[l]))
+                bad++;
+    }
+    WVPASSEQ(bad, 0);
+}
+
+
+WVTEST_MAIN("fast regex takes linear time")
+{
+    // these make a backtracking matcher take forever
+    WvString as("");
+    for (int i = 0; i < 20000; i++)
+        as.append("a");
+
+    WvTime start = wvtime();
+    WVFAIL(WvFastRegex("(a|aa)*b").match(as));
+    WVFAIL(WvFastRegex("(a*)*b").match(as));
+    WVFAIL(WvFastRegex("^(a?){30}a{30}$").match(as));
+    WVPASS(WvFastRegex("^(a?){30}a{30}").match(as));
+    int start_at, end_at;
+    WVPASS(WvFastRegex("(a|aa)*").continuable_match(as, start_at, end_at));
+    WVPASSEQ(start_at, 0);
+    WVPASSEQ(end_at, 20000);
+    WVPASS(msecdiff(wvtime(), start) < 2000);
+}
+
+
+WVTEST_MAIN("fast regex with too many DFA states")
+{
+    // the DFA for this has 2^16 states, more than fit, so it has to keep
+    // throwing them away and starting over
+    WvFastRegex re("a[ab]{15}c");
+    WvRegex slow("a[ab]{15}c");
+    srandom(1);
+    int bad = 0;
+    for (int n = 0; n < 20; n++)
+    {
+        WvString s;
+        s.setsize(20002);
+        for (int i = 0; i < 20000; i++)
+            s.edit()[i] = "ab"[random() % 2];
+        s.edit()[20000] = (n % 2) ? 'c' : 'a';
+        s.edit()[20001] = 0;
+        int ss, se, fs, fe;
+        bool sm = slow.continuable_match(s, ss, se);
+        bool fm = re.continuable_match(s, fs, fe);
+        if (sm != fm || (sm && (ss != fs || se != fe)) || fm != re.match(s))
+            bad++;
+    }
+    WVPASSEQ(bad, 0);
+}
+
+
+WVTEST_MAIN("fast regex cache")
+{
+    size_t before = WvFastRegex::cached();
+    WvFastRegex a("cache test [0-9]+");
+    WVPASSEQ(WvFastRegex::cached(), before + 1);
+    WvFastRegex b("cache test [0-9]+");
+    WVPASSEQ(WvFastRegex::cached(), before + 1);
+    WvFastRegex c("cache test [0-9]+", WvRegex::EXTENDED | WvRegex::ICASE);
+    WVPASSEQ(WvFastRegex::cached(), before + 2);
+
+    WvFastRegex d(b);
+    WVPASS(d.match("cache test 12"));
+    d = c;
+    WVPASS(d.match("CACHE TEST 12"));
+    WVFAIL(b.match("CACHE TEST 12"));
+}
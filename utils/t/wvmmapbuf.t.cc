@@ -0,0 +1,98 @@
+#include "wvtest.h"
+#include "wvmmapbuf.h"
+#include "wvfileutils.h"
+#include <fcntl.h>
+
+// A file whose n'th byte is n % 251, so you can tell where you are in it
+static WvString makefile(size_t size)
+{
+    WvString name(wvtmpfilename("wvtest-mmapbuf"));
+    FILE *f = fopen(name, "w");
+    for (size_t n = 0; n < size; n++)
+	fputc(n % 251, f);
+    fclose(f);
+    return name;
+}
+
+
+static bool matches(const unsigned char *p, size_t at, size_t len)
+{
+    for (size_t n = 0; n < len; n++)
+	if (p[n] != (at + n) % 251)
+	    return false;
+    return true;
+}
+
+
+WVTEST_MAIN("mmap buffer")
+{
+    size_t page = getpagesize();
+    size_t size = 3 * page + 100;
+    WvString name(makefile(size));
+
+    // with a one-page window, so it has to keep moving it
+    WvMmapBuf buf(name, page);
+    WVPASS(buf.isok());
+    WVPASSEQ(buf.used(), size);
+    WVPASSEQ(buf.optgettable(), page);
+    WVPASSEQ(buf.free(), 0);
+
+    // the whole thing, a window at a time
+    size_t at = 0;
+    bool ok = true;
+    while (buf.used())
+    {
+	size_t len = buf.optgettable();
+	if (!len || len > page)
+	    break;
+	ok = ok && matches(buf.get(len), at, len);
+	at += len;
+    }
+    WVPASS(ok);
+    WVPASSEQ(at, size);
+
+    // going back, and more at once than fits in a window
+    buf.unget(size);
+    WVPASSEQ(buf.used(), size);
+    buf.skip(page - 10);
+    WVPASS(matches(buf.get(20), page - 10, 20));
+    WVPASS(matches(buf.get(2 * page + 50), page + 10, 2 * page + 50));
+    WVPASSEQ(buf.used(), 40);
+    WVPASS(matches(buf.peek(-(int)page, page), size - 40 - page, page));
+    WVPASSEQ(buf.getch(), (size - 40) % 251);
+    WVPASS(matches(buf.peek(0, 39), size - 39, 39));
+    WVPASS(matches(buf.get(39), size - 39, 39));
+    WVFAIL(buf.get(1));
+
+    buf.zap();
+    WVPASSEQ(buf.used(), 0);
+    unlink(name);
+}
+
+
+WVTEST_MAIN("mmap buffer of part of a file")
+{
+    size_t page = getpagesize();
+    WvString name(makefile(2 * page));
+    int fd = open(name, O_RDONLY);
+
+    // doesn't have to start on a page boundary
+    WvMmapBuf buf(fd, 1000, page);
+    WVPASS(buf.isok());
+    WVPASSEQ(buf.used(), page);
+    WVPASSEQ(buf.optgettable(), page); // the default window is big
+    WVPASS(matches(buf.get(page), 1000, page));
+
+    WvMmapBuf rest(open(name, O_RDONLY), page + 7, (size_t)-1);
+    WVPASSEQ(rest.used(), page - 7);
+    WVPASS(matches(rest.get(rest.used()), page + 7, page - 7));
+
+    WvMmapBuf past(open(name, O_RDONLY), 3 * page, (size_t)-1);
+    WVPASS(past.isok());
+    WVPASSEQ(past.used(), 0);
+
+    WvMmapBuf none("/nonexistent/file");
+    WVFAIL(none.isok());
+    WVPASSEQ(none.used(), 0);
+    unlink(name);
+}
@@ -0,0 +1,141 @@
+#include "wvtest.h"
+#include "wvrateadjust.h"
+
+// The one-sample-at-a-time way WvRateAdjust used to do it, to compare with.
+static void slow_adjust(const unsigned char *in, unsigned isamps,
+			int sampsize, long long plus, long long minus,
+			long long &bucket, WvBuf &out)
+{
+    for (unsigned s = 0; s < isamps; s++, in += sampsize)
+    {
+	bucket += plus;
+	while (bucket >= minus)
+	{
+	    out.put(in, sampsize);
+	    bucket -= minus;
+	}
+    }
+}
+
+
+static unsigned char *make_samples(unsigned len)
+{
+    unsigned char *samples = new unsigned char[len];
+    for (unsigned i = 0; i < len; i++)
+	samples[i] = i * 7 + i / 251;
+    return samples;
+}
+
+
+static bool same(WvBuf &a, WvBuf &b)
+{
+    size_t len = a.used();
+    return len == b.used()
+	&& !memcmp(a.peek(0, len), b.peek(0, len), len);
+}
+
+
+WVTEST_MAIN("fixed rates")
+{
+    // up, down, the same, tiny changes, and a lot
+    static const int rates[][4] = {
+	{ 44100, 1, 48000, 1 },
+	{ 48000, 1, 44100, 1 },
+	{ 8000, 1, 8000, 1 },
+	{ 8000, 1, 16001, 2 },
+	{ 8020, 1, 8000, 1 },
+	{ 8000, 1, 32000, 1 },
+	{ 32000, 1, 8000, 1 },
+	{ 11025, 1, 7, 1 },
+    };
+    unsigned char *samples = make_samples(4 * 50000);
+
+    for (unsigned r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+    {
+	const int *rate = rates[r];
+	for (int sampsize = 1; sampsize <= 4; sampsize += 3)
+	{
+	    WvRateAdjust adj(sampsize, rate[0], rate[1], rate[2], rate[3]);
+	    WVPASSEQ(adj.getirate(), rate[0] / rate[1]);
+	    WVPASSEQ(adj.getorate(), rate[2] / rate[3]);
+
+	    // in uneven pieces, to make sure the bucket carries over
+	    WvDynBuf in, out, expect;
+	    long long bucket = 0;
+	    unsigned done = 0, piece = 1;
+	    while (done < 50000)
+	    {
+		if (piece > 50000 - done)
+		    piece = 50000 - done;
+		in.put(samples + done * sampsize, piece * sampsize);
+		WVPASS(adj.encode(in, out));
+		WVPASSEQ(in.used(), 0);
+		slow_adjust(samples + done * sampsize, piece, sampsize,
+			    (long long)rate[2] * rate[1],
+			    (long long)rate[0] * rate[3], bucket, expect);
+		done += piece;
+		piece = piece * 3 + 1;
+	    }
+	    WVPASS(same(out, expect));
+	    WVPASSEQ(out.used() / sampsize,
+		     (size_t)(50000LL * rate[2] * rate[1]
+			      / ((long long)rate[0] * rate[3])));
+	}
+    }
+    delete[] samples;
+}
+
+
+WVTEST_MAIN("partial samples")
+{
+    WvRateAdjust adj(4, 8000, 1, 8000, 1);
+    WvDynBuf in, out;
+
+    // not even one whole sample: it waits
+    in.put("abc", 3);
+    WVPASS(adj.encode(in, out));
+    WVPASSEQ(in.used(), 3);
+    WVPASSEQ(out.used(), 0);
+
+    // but can't be flushed
+    WVFAIL(adj.flush(in, out));
+    WVPASSEQ(in.used(), 3);
+
+    // and goes out once the rest shows up
+    in.put("defghi", 6);
+    WVPASS(adj.encode(in, out));
+    WVPASSEQ(in.used(), 1);
+    WVPASSEQ(out.getstr(), "abcdefgh");
+    in.put("jkl", 3);
+    WVPASS(adj.flush(in, out));
+    WVPASSEQ(out.getstr(), "ijkl");
+    WVPASSEQ(in.used(), 0);
+}
+
+
+WVTEST_MAIN("estimated rate")
+{
+    // nothing's known about the input rate but a guess, and what the
+    // clock says: at least the right sort of number of samples comes out
+    WvRateAdjust adj(2, 1000, 1000), adj2(2, 1000, &adj);
+    unsigned char *samples = make_samples(2 * 100);
+    WvDynBuf in, out, out2;
+    for (int n = 0; n < 5; n++)
+    {
+	in.put(samples, 2 * 100);
+	WVPASS(adj.encode(in, out));
+	WVPASSEQ(in.used(), 0);
+	wvdelay(100);
+    }
+    printf("irate=%d, out=%u\n", adj.getirate(), (unsigned)out.used() / 2);
+    WVPASS(out.used() / 2 > 100);
+    WVPASS(out.used() / 2 < 2000);
+    WVPASSEQ(out.used() % 2, 0);
+
+    // the other way, matching our estimate of our own input rate
+    WVPASS(adj2.encode(out, out2));
+    WVPASSEQ(out.used(), 0);
+    WVPASS(out2.used() > 0);
+    WVPASSEQ(out2.used() % 2, 0);
+    delete[] samples;
+}
@@ -0,0 +1,129 @@
+#include "wvtest.h"
+#include "wvshmlogring.h"
+#include "wvstring.h"
+#include "wvfileutils.h"
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static WvString readall(FILE *f)
+{
+    WvString s;
+    long len = ftell(f);
+    s.setsize(len + 1);
+    rewind(f);
+    len = fread(s.edit(), 1, len, f);
+    s.edit()[len] = 0;
+    fclose(f);
+    return s;
+}
+
+
+// Just the sources and messages, without the timestamps
+static WvString dumped(const WvShmLogRing &ring)
+{
+    FILE *f = tmpfile();
+    ring.dump(fileno(f));
+    WvString s(readall(f));
+    WvString out("");
+    for (char *line = strtok(s.edit(), "\n"); line; line = strtok(NULL, "\n"))
+	out.append("%s\n", strchr(line, ' ') + 1);
+    return out;
+}
+
+
+static void add(WvShmLogRing &ring, int level, const char *src,
+		const char *msg)
+{
+    ring.append(wvtime(), level, src, strlen(src), msg, strlen(msg));
+}
+
+
+WVTEST_MAIN("shm log ring")
+{
+    WvShmLogRing ring(4, 128);
+    WVPASS(ring.isok());
+    WVPASSEQ(dumped(ring), "");
+
+    add(ring, 4, "src", "one\n");
+    add(ring, 0, "other", "two");
+    WVPASSEQ(ring.count(), 2);
+    WVPASSEQ(dumped(ring), "src<Info>: one\nother<Crit>: two\n");
+
+    // only the newest four are left
+    for (int n = 3; n <= 9; n++)
+	add(ring, 4, "src", WvString("%s\n", n));
+    WVPASSEQ(ring.count(), 9);
+    WVPASSEQ(dumped(ring),
+	     "src<Info>: 6\nsrc<Info>: 7\nsrc<Info>: 8\nsrc<Info>: 9\n");
+
+    // long ones get cut short
+    char big[1000];
+    memset(big, 'x', sizeof(big));
+    ring.append(wvtime(), 4, "src", 3, big, sizeof(big));
+    WvString last(dumped(ring));
+    WVPASS(strstr(last, "src<Info>: xxxx"));
+    WVPASS(last.len() < 4 * 128);
+}
+
+
+WVTEST_MAIN("shm log ring in a file")
+{
+    WvString name(wvtmpfilename("wvtest-logring"));
+    {
+	WvShmLogRing ring(16, 128, name);
+	WVPASS(ring.isok());
+	add(ring, 4, "parent", "before");
+
+	// a child that dies without cleaning anything up still leaves its
+	// messages behind
+	pid_t pid = fork();
+	if (!pid)
+	{
+	    add(ring, 1, "child", "about to die");
+	    _exit(1);
+	}
+	waitpid(pid, NULL, 0);
+	add(ring, 4, "parent", "after");
+    }
+
+    FILE *f = tmpfile();
+    WVPASS(WvShmLogRing::dump(name, fileno(f)));
+    WvString s(readall(f));
+    WVPASS(strstr(s, " parent<Info>: before\n"));
+    WVPASS(strstr(s, " child<Err>: about to die\n"));
+    WVPASS(strstr(s, " parent<Info>: after\n"));
+
+    WVFAIL(WvShmLogRing::dump("/dev/null", 1));
+    WVFAIL(WvShmLogRing::dump("/nonexistent/ring", 1));
+    unlink(name);
+}
+
+
+WVTEST_MAIN("shm log ring with two writers")
+{
+    // a parent and child writing at once never mix up their messages
+    WvShmLogRing ring(256, 128);
+    pid_t pid = fork();
+    const char *who = pid ? "parent" : "child";
+    for (int n = 0; n < 5000; n++)
+	add(ring, 4, who, WvString("%s message %s", who, n));
+    if (!pid)
+	_exit(0);
+    waitpid(pid, NULL, 0);
+    WVPASSEQ(ring.count(), 10000);
+
+    WvString s(dumped(ring));
+    int lines = 0, bad = 0;
+    for (char *line = strtok(s.edit(), "\n"); line; line = strtok(NULL, "\n"))
+    {
+	lines++;
+	char src[16], msgsrc[16];
+	int num;
+	if (sscanf(line, "%15[a-z]<Info>: %15s message %d", src, msgsrc,
+		   &num) != 3 || strcmp(src, msgsrc) || num >= 5000)
+	    bad++;
+    }
+    WVPASSEQ(bad, 0);
+    WVPASSEQ(lines, 256);
+}
@@ -0,0 +1,82 @@
+#include "wvstringcache.h"
+#include "wvtest.h"
+
+
+WVTEST_MAIN("string cache sharing")
+{
+    WvStringCache cache;
+    size_t before = WvStringCache::count();
+
+    WvString a = cache.get("hello");
+    WvString b = cache.get(WvString("hel%s", "lo"));
+    WvString c = cache.get("world");
+    WVPASSEQ(a, "hello");
+    WVPASSEQ(c, "world");
+    WVPASS(a.cstr() == b.cstr());
+    WVPASS(a.cstr() != c.cstr());
+    WVPASSEQ(WvStringCache::count(), before + 2);
+
+    // nobody gets to change the cached copy
+    b.edit()[0] = 'j';
+    WVPASSEQ(b, "jello");
+    WVPASSEQ(a, "hello");
+    WVPASSEQ(cache.get("hello"), "hello");
+
+    WVPASS(cache.get(WvString::null).isnull());
+    WVPASSEQ(cache.get(""), "");
+
+    WvString big;
+    big.setsize(100000);
+    memset(big.edit(), 'x', 99999);
+    big.edit()[99999] = 0;
+    WvString big2 = cache.get(big);
+    WVPASSEQ(big2, big);
+    WVPASS(cache.get(big).cstr() == big2.cstr());
+}
+
+
+WVTEST_MAIN("string cache reclaiming")
+{
+    WvStringCache cache;
+    cache.clean();
+    size_t before = WvStringCache::count();
+    size_t mem_before = WvStringCache::memused();
+
+    {
+        WvString *keep = new WvString[10000];
+        for (int n = 0; n < 10000; n++)
+            keep[n] = cache.get(WvString("value number %s", n));
+        WVPASSEQ(WvStringCache::count(), before + 10000);
+        WVPASS(WvStringCache::memused() > mem_before + 10000 * 16);
+
+        // still in use, so they stay, and they're still the same
+        cache.clean();
+        WVPASSEQ(WvStringCache::count(), before + 10000);
+        WVPASS(cache.get("value number 1234").cstr() == keep[1234].cstr());
+        delete[] keep;
+    }
+
+    // unused strings go away bit by bit without anybody calling clean()
+    WvString x;
+    for (int n = 0; n < 100000; n++)
+        x = cache.get(WvString("other %s", n % 100));
+    WVPASS(WvStringCache::count() < before + 1000);
+
+    cache.clean();
+    WVPASSEQ(WvStringCache::count(), before + 1);
+    WVPASS(WvStringCache::memused() <= mem_before + 65536 * 2);
+}
+
+
+WVTEST_MAIN("string cache outlives its users")
+{
+    WvString s;
+    {
+        WvStringCache cache;
+        s = cache.get("still here");
+    }
+    WVPASSEQ(s, "still here");
+
+    WvStringCache cache;
+    WVPASS(cache.get("still here").cstr() == s.cstr());
+}
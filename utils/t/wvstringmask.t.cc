@@ -72,3 +72,97 @@ WVTEST_MAIN("wvstringmask")
     }
     WVPASSEQ(d.first(), 'c');
 }
+
+
+// the slow way, to check find() against
+static const char *scan(const WvStringMask &m, const char *p, const char *end)
+{
+    for (; p < end; p++)
+	if (m[*p])
+	    return p;
+    return end;
+}
+
+
+WVTEST_MAIN("find")
+{
+    char buf[300];
+    for (int i = 0; i < 300; i++)
+	buf[i] = 'a' + i % 26;
+    const char *end = buf + sizeof(buf);
+
+    // none, one (memchr), a few ranges, and more ranges than find() skips
+    // at once
+    WvStringMask none, one('z'), few("\\\"\n"), lots("aeiou\x80\xff"), all;
+    for (int c = 0; c < 256; c += 2)
+	lots.set(c, true);
+    for (int c = 1; c < 256; c++)
+	all.set(c, true);
+    all.set('\0', true);
+    WvStringMask *masks[] = { &none, &one, &few, &lots, &all };
+
+    for (unsigned m = 0; m < sizeof(masks) / sizeof(masks[0]); m++)
+    {
+	const WvStringMask &mask = *masks[m];
+	bool ok = true;
+	for (int where = 0; where < 300; where += 7)
+	{
+	    static const char special[] = { 'z', '\\', '\n', '\xff', '\x80',
+					    'b', '\0', 'Z' };
+	    for (unsigned s = 0; s < sizeof(special); s++)
+	    {
+		char save = buf[where];
+		buf[where] = special[s];
+		for (int start = 0; start < 40; start += 3)
+		    if (mask.find(buf + start, end)
+			    != scan(mask, buf + start, end))
+			ok = false;
+		buf[where] = save;
+	    }
+	}
+	WVPASS(ok);
+	WVPASS(mask.find(buf, buf) == buf);
+    }
+
+    // changing the mask changes what it finds
+    WVPASS(few.find(buf, end) == end);
+    few.set('c', true);
+    WVPASS(few.find(buf, end) == buf + 2);
+    few.zap();
+    WVPASS(few.find(buf, end) == end);
+}
+
+
+WVTEST_MAIN("count")
+{
+    char buf[300];
+    for (int i = 0; i < 300; i++)
+	buf[i] = i * 37 + i / 7;
+    const char *end = buf + sizeof(buf);
+
+    // few enough ranges to count 16 at a time, and too many
+    WvStringMask none, few("\\\"\n"), lots, all;
+    for (int c = 0; c < 256; c += 3)
+	lots.set(c, true);
+    for (int c = 0; c < 256; c++)
+	all.set(c, true);
+    WvStringMask *masks[] = { &none, &few, &lots, &all };
+
+    for (unsigned m = 0; m < sizeof(masks) / sizeof(masks[0]); m++)
+    {
+	const WvStringMask &mask = *masks[m];
+	bool ok = true;
+	for (int start = 0; start < 40; start += 3)
+	{
+	    size_t expect = 0;
+	    for (const char *p = buf + start; p < end; p++)
+		if (mask[*p])
+		    expect++;
+	    if (mask.count(buf + start, end) != expect)
+		ok = false;
+	}
+	WVPASS(ok);
+    }
+    WVPASSEQ(all.count(buf, end), 300);
+    WVPASSEQ(none.count(buf, end), 0);
+}
@@ -78,6 +78,16 @@ WVTEST_MAIN("wvtime()")
 */
 
 
+WVTEST_MAIN("wvmonotime()")
+{
+    WvTime start = wvmonotime();
+    wvdelay(50);
+    time_t passed = msecdiff(wvmonotime(), start);
+    WVPASS(passed >= 50);
+    WVPASS(passed < 5000);
+}
+
+
 WVTEST_MAIN("msecadd()")
 {
     WvTime result, tmp;
@@ -0,0 +1,102 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast WvBuf's getch(), putch(), get(4) and put(4) are,
+ * next to calling the store for every one of them the way they all
+ * used to.
+ *
+ *     bufcursortest [bytes-per-run]
+ */
+#include "wvbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void report(const char *buftype, const char *what, size_t n,
+                   double start)
+{
+    double secs = now() - start;
+    printf("%-14s %-12s %8.1f Mops/sec\n", buftype, what, n / secs / 1e6);
+}
+
+
+template<class Buf>
+static unsigned run(const char *buftype, Buf &buf, size_t nbytes)
+{
+    unsigned sum = 0;
+    unsigned char four[4] = { 1, 2, 3, 4 };
+    double start;
+    size_t n;
+
+    buf.zap(); // a WvInPlaceBuf never gets its space back otherwise
+    start = now();
+    for (n = 0; n < nbytes; n++)
+        buf.getstore()->fastput(four, 1);
+    report(buftype, "old putch", nbytes, start);
+    start = now();
+    for (n = 0; n < nbytes; n++)
+        sum += *(const unsigned char *)buf.getstore()->get(1);
+    report(buftype, "old getch", nbytes, start);
+
+    buf.zap(); // a WvInPlaceBuf never gets its space back otherwise
+    start = now();
+    for (n = 0; n < nbytes; n++)
+        buf.putch(n);
+    report(buftype, "putch", nbytes, start);
+    start = now();
+    for (n = 0; n < nbytes; n++)
+        sum += buf.getch();
+    report(buftype, "getch", nbytes, start);
+
+    buf.zap(); // a WvInPlaceBuf never gets its space back otherwise
+    start = now();
+    for (n = 0; n < nbytes / 4; n++)
+        buf.getstore()->put(four, 4);
+    report(buftype, "old put(4)", nbytes / 4, start);
+    start = now();
+    for (n = 0; n < nbytes / 4; n++)
+        sum += *(const unsigned char *)buf.getstore()->get(4);
+    report(buftype, "old get(4)", nbytes / 4, start);
+
+    buf.zap(); // a WvInPlaceBuf never gets its space back otherwise
+    start = now();
+    for (n = 0; n < nbytes / 4; n++)
+        buf.put(four, 4);
+    report(buftype, "put(4)", nbytes / 4, start);
+    start = now();
+    for (n = 0; n < nbytes / 4; n++)
+        sum += *buf.get(4);
+    report(buftype, "get(4)", nbytes / 4, start);
+
+    return sum;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t nbytes = argc > 1 ? atoi(argv[1]) : 1000000;
+    unsigned sum = 0;
+
+    {
+        WvDynBuf buf;
+        sum += run("WvDynBuf", buf, nbytes);
+    }
+    {
+        WvInPlaceBuf buf(nbytes);
+        sum += run("WvInPlaceBuf", buf, nbytes);
+    }
+    {
+        WvCircularBuf buf(nbytes);
+        sum += run("WvCircularBuf", buf, nbytes);
+    }
+    return sum == 42; // so none of it gets optimized away
+}
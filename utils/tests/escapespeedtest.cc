@@ -0,0 +1,171 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast the escaping functions and WvBackslashEncoder and
+ * WvBackslashDecoder get through text that hardly needs any escaping (the
+ * usual case: UniConf keys and values) and text that needs lots.  The
+ * character-at-a-time cstr_escape(), url_encode() and backslash_escape()
+ * they used to be are here too, to compare with.
+ *
+ *     escapespeedtest [msec-per-run]
+ */
+#include "wvstrutils.h"
+#include "wvbackslash.h"
+#include "wvtimeutils.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LEN 4096
+
+
+// the table cstr_escape() looks things up in
+static WvString xlat[256];
+
+static void make_xlat()
+{
+    for (int c = 0; c < 256; c++)
+    {
+        char ch = c;
+        xlat[c] = cstr_escape(&ch, 1);
+        xlat[c].edit()[xlat[c].len() - 1] = 0;
+        xlat[c] = xlat[c].cstr() + 1;
+    }
+}
+
+
+static WvString old_cstr_escape(const void *data, size_t size)
+{
+    const char *cdata = (const char *)data;
+    WvString result;
+    result.setsize(4*size + 3);
+    char *cstr = result.edit();
+    *cstr++ = '\"';
+    while (size-- > 0)
+    {
+        const char *esc = xlat[(unsigned char)*cdata++];
+        while (*esc) *cstr++ = *esc++;
+    }
+    *cstr++ = '\"';
+    *cstr = '\0';
+    return result;
+}
+
+
+static WvString old_url_encode(WvStringParm str)
+{
+    WvDynBuf retval;
+    for (unsigned i = 0; i < str.len(); i++)
+    {
+        if ((isalnum(str[i]) || strchr("_.!~*'()-", str[i]))
+            && str[i] != '%')
+            retval.put(&str[i], 1);
+        else
+        {
+            char buf[4];
+            sprintf(buf, "%%%02X", str[i] & 0xff);
+            retval.put(&buf, 3);
+        }
+    }
+    return retval.getstr();
+}
+
+
+static WvString old_backslash_escape(WvStringParm s1)
+{
+    WvString s2;
+    s2.setsize(s1.len() * 2 + 1);
+    const char *p1 = s1;
+    char *p2 = s2.edit();
+    while (*p1)
+    {
+        if (!isalnum(*p1))
+            *p2++ = '\\';
+        *p2++ = *p1++;
+    }
+    *p2 = 0;
+    return s2;
+}
+
+
+static void report(const char *what, const char *input, unsigned long bytes,
+                   WvTime start)
+{
+    double secs = msecdiff(wvtime(), start) / 1000.0;
+    printf("%-28s %-6s %8.1f MB/sec\n", what, input, bytes / secs / 1000000);
+}
+
+
+#define TIME(what, input, code) \
+    do { \
+        unsigned long bytes = 0; \
+        WvTime start = wvtime(); \
+        while (msecdiff(wvtime(), start) < msec) \
+            for (int n = 0; n < 100; n++, bytes += LEN) \
+                { code; } \
+        report(what, input, bytes, start); \
+    } while (0)
+
+
+static void run(const char *input, const char *text, int msec)
+{
+    WvString str(text);
+
+    TIME("cstr_escape, old", input, old_cstr_escape(text, LEN));
+    TIME("cstr_escape", input, cstr_escape(text, LEN));
+    WvString escaped = cstr_escape(text, LEN);
+    char *back = new char[LEN];
+    size_t size;
+    TIME("cstr_unescape", input, cstr_unescape(escaped, back, LEN, size));
+    delete[] back;
+
+    TIME("url_encode, old", input, old_url_encode(str));
+    TIME("url_encode", input, url_encode(str));
+    WvString url = url_encode(str);
+    TIME("url_decode", input, url_decode(url));
+
+    TIME("backslash_escape, old", input, old_backslash_escape(str));
+    TIME("backslash_escape", input, backslash_escape(str));
+
+    WvBackslashEncoder enc;
+    WvDynBuf in, out;
+    TIME("WvBackslashEncoder", input,
+         in.put(text, LEN); enc.encode(in, out); out.zap());
+    enc.encode(in, out);
+    in.put(text, LEN);
+    enc.encode(in, out);
+    WvString encoded = out.getstr();
+    WvBackslashDecoder dec;
+    TIME("WvBackslashDecoder", input,
+         in.putstr(encoded); dec.encode(in, out); out.zap());
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 1000;
+    make_xlat();
+    char *text = new char[LEN + 1];
+    text[LEN] = 0;
+
+    // mostly letters and digits, with a slash or a quote now and then
+    srandom(42);
+    for (int i = 0; i < LEN; i++)
+    {
+        int r = random() % 64;
+        text[i] = r == 0 ? '/' : r == 1 ? '"' : 'a' + r % 26;
+    }
+    run("clean", text, msec);
+
+    // one in every two or three needs escaping
+    for (int i = 0; i < LEN; i++)
+    {
+        int r = random() % 8;
+        text[i] = r < 3 ? "\"\\\n /\t%+"[random() % 8] : 'a' + r;
+    }
+    run("dirty", text, msec);
+
+    delete[] text;
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how many samples per second WvRateAdjust gets through, next to
+ * the sample-at-a-time loop it used to have, for some rate changes that
+ * are small (the usual case) and some that aren't.
+ *
+ *     rateadjspeedtest [msec-per-run]
+ */
+#include "wvrateadjust.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BLOCK 4096      // samples per encode()
+
+
+// WvRateAdjust::_encode() as it was, with fixed rates
+static void old_adjust(WvBuf &inbuf, WvBuf &outbuf, int sampsize,
+                       int plus, int minus, int &bucket)
+{
+    unsigned isamps = inbuf.used() / sampsize;
+    unsigned omax = isamps + isamps/2;
+    const unsigned char *iptr = inbuf.get(isamps * sampsize);
+    unsigned char *ostart, *optr;
+    ostart = optr = outbuf.alloc(omax * sampsize);
+
+    for (unsigned s = 0; s < isamps; s++, iptr += sampsize)
+    {
+        bucket += plus;
+        while (bucket >= minus)
+        {
+            if ((unsigned)(optr - ostart) >= omax * sampsize)
+                ostart = optr = outbuf.alloc(omax * sampsize);
+            for (int i = 0; i < sampsize; i++)
+                optr[i] = iptr[i];
+            optr += sampsize;
+            bucket -= minus;
+        }
+    }
+    outbuf.unalloc(omax*sampsize - (optr - ostart));
+}
+
+
+static void report(const char *what, int sampsize, int irate, int orate,
+                   unsigned long samples, WvTime start)
+{
+    double secs = msecdiff(wvtime(), start) / 1000.0;
+    printf("%-12s %d-byte %5d->%5d Hz %8.1f M samples/sec\n", what,
+           sampsize, irate, orate, samples / secs / 1000000);
+}
+
+
+static void run(int sampsize, int irate, int orate, int msec)
+{
+    unsigned char *block = new unsigned char[BLOCK * sampsize];
+    for (int i = 0; i < BLOCK * sampsize; i++)
+        block[i] = random();
+    WvDynBuf in, out;
+
+    int bucket = 0;
+    unsigned long samples = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 100; n++, samples += BLOCK)
+        {
+            in.put(block, BLOCK * sampsize);
+            old_adjust(in, out, sampsize, orate, irate, bucket);
+            out.zap();
+        }
+    }
+    report("per sample", sampsize, irate, orate, samples, start);
+
+    WvRateAdjust adj(sampsize, irate, 1, orate, 1);
+    samples = 0;
+    start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+    {
+        for (int n = 0; n < 100; n++, samples += BLOCK)
+        {
+            in.put(block, BLOCK * sampsize);
+            adj.encode(in, out);
+            out.zap();
+        }
+    }
+    report("runs", sampsize, irate, orate, samples, start);
+
+    delete[] block;
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 1000;
+    static const int rates[][2] = {
+        { 8000, 8020 },
+        { 8020, 8000 },
+        { 44100, 44100 },
+        { 44100, 48000 },
+        { 48000, 44100 },
+        { 8000, 16000 },
+    };
+    for (int sampsize = 2; sampsize <= 4; sampsize += 2)
+        for (unsigned r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+            run(sampsize, rates[r][0], rates[r][1], msec);
+    return 0;
+}
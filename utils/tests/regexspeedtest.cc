@@ -0,0 +1,174 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2004 Net Integration Technologies, Inc.
+ *
+ * Measures how fast WvRegex (regexec()) and WvFastRegex filter syslog-ish
+ * lines: one pattern, a dozen patterns one at a time, the dozen as a
+ * WvFastRegexSet, and making a regex for every line.  Then a pattern that
+ * regexec() takes time proportional to the square of the input for.
+ *
+ *     regexspeedtest [msec-per-run]
+ */
+#include "wvfastregex.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *patterns[] = {
+    "sshd\\[[0-9]+\\]: Failed password for (invalid user )?[a-z]+",
+    "kernel: .*I/O error",
+    "(md[0-9]+|raid).*(degraded|failed)",
+    "segfault at [0-9a-f]+ ip [0-9a-f]+",
+    "Out of memory: Kill(ed)? process [0-9]+",
+    "eth[0-9]: link (up|down)$",
+    "CRON\\[[0-9]+\\]: \\(root\\) CMD",
+    "(ERROR|CRITICAL|FATAL):",
+    "session opened for user [a-z]+ by",
+    "dhclient.*DHCPACK of ([0-9]+\\.){3}[0-9]+",
+    "temperature above threshold",
+    "^[A-Z][a-z]{2} [ 0-9][0-9] [0-9:]{8} [a-z]+ postfix/smtpd",
+    NULL
+};
+#define NPATTERNS (sizeof(patterns) / sizeof(patterns[0]) - 1)
+
+static const char *templates[] = {
+    "sshd[%s]: Accepted publickey for %s from 10.0.%s.%s port %s ssh2",
+    "sshd[%s]: Failed password for %s from 10.0.%s.%s port %s ssh2",
+    "kernel: [%s.%s] usb %s-1: new high-speed USB device number %s",
+    "CRON[%s]: (root) CMD (run-parts /etc/cron.hourly %s %s %s)",
+    "postfix/smtpd[%s]: connect from unknown[10.%s.%s.%s]",
+    "dhclient[%s]: DHCPACK of 192.168.%s.%s from 192.168.%s.1",
+    "systemd[1]: Started Session %s of user %s (%s/%s).",
+    "myapp[%s]: request %s took %s ms, status %s",
+};
+#define NTEMPLATES (sizeof(templates) / sizeof(templates[0]))
+
+#define NLINES 10000
+static WvString lines[NLINES];
+static size_t total_bytes;
+
+
+static void make_lines()
+{
+    const char *users[] = { "root", "alice", "bob", "backup", "www" };
+    srandom(42);
+    for (int i = 0; i < NLINES; i++)
+    {
+        WvString msg(templates[random() % NTEMPLATES],
+                     random() % 65536, users[random() % 5],
+                     random() % 256, random() % 256, random() % 65536);
+        lines[i] = WvString("Oct %s %02s:%02s:%02s host%s %s",
+                            1 + i / 3600, i / 60 % 24, i / 60 % 60, i % 60,
+                            random() % 4, msg);
+        total_bytes += lines[i].len();
+    }
+}
+
+
+static void report(const char *what, unsigned long n, WvTime start,
+                   unsigned long found)
+{
+    double ms = msecdiff(wvtime(), start);
+    printf("%-32s %10.0f lines/sec %8.1f MB/sec (%lu hits)\n", what,
+           n * 1000.0 / ms, n * (double)total_bytes / NLINES / ms / 1000,
+           found);
+}
+
+
+template <class Regex>
+static void one(const char *what, int msec)
+{
+    Regex re(patterns[0]);
+    unsigned long count = 0, found = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+        for (int n = 0; n < NLINES; n++, count++)
+            if (re.match(lines[n]))
+                found++;
+    report(what, count, start, found);
+}
+
+
+template <class Regex>
+static void each(const char *what, int msec)
+{
+    Regex *re[NPATTERNS];
+    for (size_t p = 0; p < NPATTERNS; p++)
+        re[p] = new Regex(patterns[p]);
+    unsigned long count = 0, found = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+        for (int n = 0; n < NLINES; n++, count++)
+            for (size_t p = 0; p < NPATTERNS; p++)
+                if (re[p]->match(lines[n]))
+                    found++;
+    report(what, count, start, found);
+    for (size_t p = 0; p < NPATTERNS; p++)
+        delete re[p];
+}
+
+
+static void set(const char *what, int msec)
+{
+    WvFastRegexSet re;
+    for (size_t p = 0; p < NPATTERNS; p++)
+        re.add(patterns[p]);
+    unsigned long count = 0, found = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+        for (int n = 0; n < NLINES; n++, count++)
+            found += re.match(lines[n]);
+    report(what, count, start, found);
+}
+
+
+// the way code that doesn't keep its regexes around does it
+template <class Regex>
+static void fresh(const char *what, int msec)
+{
+    unsigned long count = 0, found = 0;
+    WvTime start = wvtime();
+    while (msecdiff(wvtime(), start) < msec)
+        for (int n = 0; n < 1000; n++, count++)
+            if (Regex(patterns[n % NPATTERNS]).match(lines[n]))
+                found++;
+    report(what, count, start, found);
+}
+
+
+template <class Regex>
+static void nasty(const char *what, int len)
+{
+    WvString s("");
+    for (int i = 0; i < len; i++)
+        s.append("a");
+    Regex re("(a|aa)*c");
+    WvTime start = wvtime();
+    bool found = re.match(s);
+    printf("%-32s %d a's: %ld ms (%s)\n", what, len,
+           (long)msecdiff(wvtime(), start), found ? "match" : "no match");
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 1000;
+    make_lines();
+    printf("%d lines, %lu bytes; %lu patterns\n", NLINES,
+           (unsigned long)total_bytes, (unsigned long)NPATTERNS);
+
+    one<WvRegex>("WvRegex, one pattern", msec);
+    one<WvFastRegex>("WvFastRegex, one pattern", msec);
+    each<WvRegex>("WvRegex, each pattern", msec);
+    each<WvFastRegex>("WvFastRegex, each pattern", msec);
+    set("WvFastRegexSet, all at once", msec);
+    fresh<WvRegex>("new WvRegex every line", msec);
+    fresh<WvFastRegex>("new WvFastRegex every line", msec);
+
+    for (int len = 1000; len <= 16000; len *= 4)
+    {
+        nasty<WvRegex>("WvRegex, (a|aa)*c", len);
+        nasty<WvFastRegex>("WvFastRegex, (a|aa)*c", len);
+    }
+    return 0;
+}
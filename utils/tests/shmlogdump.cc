@@ -0,0 +1,31 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Prints the messages a program left in a file-backed WvShmLogRing, for
+ * when it's crashed (or is still running; it's safe to look).
+ *
+ *     shmlogdump ringfile...
+ */
+#include "wvshmlogring.h"
+#include <stdio.h>
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+	fprintf(stderr, "Usage: %s ringfile...\n", argv[0]);
+	return 1;
+    }
+
+    int ret = 0;
+    for (int i = 1; i < argc; i++)
+    {
+	if (!WvShmLogRing::dump(argv[i], 1))
+	{
+	    fprintf(stderr, "%s: not a log ring\n", argv[i]);
+	    ret = 1;
+	}
+    }
+    return ret;
+}
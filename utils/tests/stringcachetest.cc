@@ -0,0 +1,164 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2005 Net Integration Technologies, Inc.
+ *
+ * Measures WvStringCache's speed, memory use, and longest pause, next to
+ * the old way of keeping a WvStringTable and scanning all of it in
+ * clean().
+ *
+ *     stringcachetest [values] [distinct-values]
+ */
+#include "wvstringcache.h"
+#include "wvstringtable.h"
+#include "wvstringlist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static size_t rss_kb()
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    unsigned long pages = 0, resident = 0;
+    if (f)
+    {
+        if (fscanf(f, "%lu %lu", &pages, &resident) != 2)
+            resident = 0;
+        fclose(f);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+
+// What WvStringCache used to be
+class OldStringCache
+{
+    WvStringTable t;
+public:
+    OldStringCache() : t(10000)
+        { }
+
+    WvString get(WvStringParm s)
+    {
+        WvString *ret = t[s];
+        if (!ret)
+        {
+            ret = new WvString(s);
+            t.add(ret, true);
+        }
+        return *ret;
+    }
+
+    void clean()
+    {
+        WvStringList l;
+        WvStringTable::Iter i(t);
+        for (i.rewind(); i.next(); )
+            if (i->is_unique())
+                l.append(i.ptr(), false);
+        WvStringList::Iter j(l);
+        for (j.rewind(); j.next(); )
+            t.remove(j.ptr());
+    }
+
+    size_t count()
+        { return t.count(); }
+};
+
+
+template<class Cache>
+static void run(const char *name, Cache &cache, char **input, int nvalues)
+{
+    size_t rss_before = rss_kb();
+    WvString *values = new WvString[nvalues];
+
+    // load everything, like reading a big config file
+    double worst = 0, start = now();
+    int slow = 0;
+    for (int n = 0; n < nvalues; n++)
+    {
+        double t = now();
+        values[n] = cache.get(input[n]);
+        t = now() - t;
+        if (t > worst)
+            worst = t;
+        if (t > 0.001)
+            slow++;
+    }
+    double elapsed = now() - start;
+    printf("%-6s load:  %8.0f gets/sec, longest get %6.2f ms, %d over 1 ms, "
+           "%zu strings, %zu kB more RSS\n", name, nvalues / elapsed,
+           worst * 1000, slow, (size_t)cache.count(), rss_kb() - rss_before);
+
+    // throw away most of it and keep going, like replacing the config
+    for (int n = 0; n < nvalues; n++)
+        if (n % 10)
+            values[n] = WvString::null;
+    worst = 0;
+    slow = 0;
+    start = now();
+    for (int n = 0; n < nvalues; n++)
+    {
+        double t = now();
+        values[n] = cache.get(input[(n + nvalues / 2) % nvalues]);
+        t = now() - t;
+        if (t > worst)
+            worst = t;
+        if (t > 0.001)
+            slow++;
+    }
+    elapsed = now() - start;
+    printf("%-6s churn: %8.0f gets/sec, longest get %6.2f ms, %d over 1 ms, "
+           "%zu strings\n", name, nvalues / elapsed, worst * 1000, slow,
+           (size_t)cache.count());
+
+    delete[] values;
+    start = now();
+    cache.clean();
+    printf("%-6s clean() of everything: %.2f ms, %zu strings left\n",
+           name, (now() - start) * 1000, (size_t)cache.count());
+}
+
+
+struct NewCache : public WvStringCache
+{
+    size_t count()
+        { return WvStringCache::count(); }
+};
+
+
+int main(int argc, char **argv)
+{
+    int nvalues = argc > 1 ? atoi(argv[1]) : 2000000;
+    int ndistinct = argc > 2 ? atoi(argv[2]) : nvalues / 4;
+
+    char **input = new char*[nvalues];
+    for (int n = 0; n < nvalues; n++)
+    {
+        WvString s("some/config/value/number/%s", random() % ndistinct);
+        input[n] = strdup(s);
+    }
+
+    {
+        NewCache cache;
+        run("new", cache, input, nvalues);
+        printf("new    memory in use by the cache: %zu kB\n",
+               WvStringCache::memused() / 1024);
+    }
+    {
+        OldStringCache cache;
+        run("old", cache, input, nvalues);
+    }
+
+    for (int n = 0; n < nvalues; n++)
+        free(input[n]);
+    delete[] input;
+    return 0;
+}
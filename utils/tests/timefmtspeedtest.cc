@@ -0,0 +1,78 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how many dates per second rfc822_date(), rfc1123_date() and
+ * intl_datetime() format: the way they used to (localtime() or gmtime(),
+ * then strftime() into a new WvString), the way they do now, and into a
+ * buffer.  Once with the same second over and over, like log messages
+ * and HTTP headers get, and once with a different second every time.
+ *
+ *     timefmtspeedtest [msec-per-run]
+ */
+#include "wvstrutils.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+static WvString old_format(const char *format, time_t when, bool local)
+{
+    WvString out;
+    out.setsize(80);
+    struct tm *tm = local ? localtime(&when) : gmtime(&when);
+    strftime(out.edit(), 80, format, tm);
+    return out;
+}
+
+
+static void report(const char *what, const char *how, unsigned long n,
+                   WvTime start)
+{
+    double secs = msecdiff(wvtime(), start) / 1000.0;
+    printf("%-14s %-22s %10.0f dates/sec\n", what, how, n / secs);
+}
+
+
+#define TIME(what, how, code) \
+    do { \
+        unsigned long n = 0; \
+        WvTime start = wvtime(); \
+        while (msecdiff(wvtime(), start) < msec) \
+            for (int i = 0; i < 1000; i++, n++) \
+                { time_t t = base + (step ? n : 0); code; } \
+        report(what, how, n, start); \
+    } while (0)
+
+
+static void run(time_t base, bool step, int msec)
+{
+    printf("\n%s:\n", step ? "A new second every time" : "The same second");
+    char buf[80];
+
+    TIME("rfc822_date", "localtime, strftime",
+         old_format("%a, %d %b %Y %H:%M:%S %z", t, true));
+    TIME("rfc822_date", "WvString", rfc822_date(t));
+    TIME("rfc822_date", "buffer", rfc822_date(t, buf, sizeof(buf)));
+
+    TIME("rfc1123_date", "gmtime, strftime",
+         old_format("%a, %d %b %Y %H:%M:%S GMT", t, false));
+    TIME("rfc1123_date", "WvString", rfc1123_date(t));
+    TIME("rfc1123_date", "buffer", rfc1123_date(t, buf, sizeof(buf)));
+
+    TIME("intl_datetime", "localtime, strftime",
+         old_format("%Y-%m-%d %H:%M:%S", t, true));
+    TIME("intl_datetime", "WvString", intl_datetime(t));
+    TIME("intl_datetime", "buffer", intl_datetime(t, buf, sizeof(buf)));
+}
+
+
+int main(int argc, char **argv)
+{
+    int msec = argc > 1 ? atoi(argv[1]) : 1000;
+    time_t now = time(NULL);
+    run(now, false, msec);
+    run(now, true, msec);
+    return 0;
+}
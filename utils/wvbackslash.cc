@@ -37,8 +37,12 @@ static inline int fromoctal(char digit)
 /***** WvBackslashEncoder *****/
 
 WvBackslashEncoder::WvBackslashEncoder(WvStringParm _nasties) :
-    nasties(_nasties)
+    nasties(_nasties), dirty(_nasties)
 {
+    dirty.set(escapein, true);
+    for (int c = 0; c < 256; c++)
+        if (c == '\0' || !isprint(c))
+            dirty.set(c, true);
 }
 
 
@@ -52,11 +56,24 @@ bool WvBackslashEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
         const unsigned char *datain = inbuf.get(len);
         for (size_t i = 0; i < len; ++i)
         {
+            // copy everything up to the next thing that needs escaping
+            const char *run = (const char *)datain + i;
+            size_t runlen = dirty.find(run, (const char *)datain + len) - run;
+            if (runlen > avail)
+                runlen = avail;
+            if (runlen)
+            {
+                outbuf.put(run, runlen);
+                avail -= runlen;
+                if ((i += runlen) == len)
+                    break;
+            }
+
             int c = datain[i];
             
             // handle 1 character escape sequences
             if (avail < 1)
-                { outbuf.unget(len - i); return ! flush; }
+                { inbuf.unget(len - i); return ! flush; }
             const char *foundnasty = NULL;
             const char *foundspecial = NULL;
             if (c != '\0')
@@ -76,7 +93,7 @@ bool WvBackslashEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
             
             // handle 2 character escape sequences
             if (avail < 2)
-                { outbuf.unget(len - i); return ! flush; }
+                { inbuf.unget(len - i); return ! flush; }
             if (foundnasty != NULL)
             {
                 outbuf.putch('\\');
@@ -94,7 +111,7 @@ bool WvBackslashEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
 
             // handle 4 character escape sequences
             if (avail < 4)
-                { outbuf.unget(len - i); return ! flush; }
+                { inbuf.unget(len - i); return ! flush; }
             outbuf.put("\\x", 2);
             outbuf.putch(tohex(c >> 4));
             outbuf.putch(tohex(c & 15));
@@ -133,6 +150,22 @@ bool WvBackslashDecoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
         const unsigned char *datain = inbuf.get(len);
         for (size_t i = 0; i < len; ++i)
         {
+            if (state == Initial && value == -1 && tmpbuf.used() == 0)
+            {
+                // nothing pending: copy up to the next backslash in one go
+                const unsigned char *bs = (const unsigned char *)
+                    memchr(datain + i, '\\', len - i);
+                size_t run = (bs ? bs - datain : len) - i;
+                size_t avail = outbuf.free();
+                if (run > avail)
+                    run = avail;
+                outbuf.put(datain + i, run);
+                if ((i += run) == len)
+                    break;
+                if (outbuf.free() == 0)
+                    { inbuf.unget(len - i); return ! flush; }
+            }
+
             int c = datain[i];
 
             switch (state)
@@ -95,6 +95,59 @@ size_t WvBufBase<unsigned char>::_match(const void *bytelist,
 }
 
 
+// The most space we'll alloc() at once for put() to fill in.  It only
+// gets given back if somebody needs the store before it's used up, but
+// WvDynBufStore will say it has unlimited room if you ask.
+#define MAX_PUT_CURSOR 1024
+
+const unsigned char *WvBufBase<unsigned char>::slowget(size_t count)
+{
+    if (count > used())
+        return NULL;
+    sync();
+
+    // take as much as we can get cheaply, and hand it out a bit at a time
+    size_t avail = store->optgettable();
+    if (avail > store->used())
+        avail = store->used();
+    if (count == 0 || count > avail)
+        return static_cast<const unsigned char*>(store->get(count));
+    const unsigned char *data =
+        static_cast<const unsigned char*>(store->get(avail));
+    if (!data)
+        return NULL; // eg. a WvMmapBuf that couldn't map the file
+    rcur = data + count;
+    rend = data + avail;
+    return data;
+}
+
+
+void WvBufBase<unsigned char>::slowput(const void *data, size_t count)
+{
+    sync();
+    if (count == 0 || count > MAX_PUT_CURSOR)
+    {
+        store->put(data, count);
+        return;
+    }
+
+    size_t avail = store->optallocable();
+    if (avail > MAX_PUT_CURSOR)
+        avail = MAX_PUT_CURSOR;
+    if (avail < count)
+    {
+        // the contiguous space left is too small; once it's filled up,
+        // there'll be a new chunk for the next put()
+        store->put(data, count);
+        return;
+    }
+    wcur = static_cast<unsigned char*>(store->alloc(avail));
+    wend = wcur + avail;
+    memcpy(wcur, data, count);
+    wcur += count;
+}
+
+
 /***** WvConstStringBuffer *****/
 
 WvConstStringBuffer::WvConstStringBuffer(WvStringParm _str)
@@ -6,6 +6,7 @@
  * crashes.
  */
 #include "wvcrash.h"
+#include "wvshmlogring.h"
 #include "wvtask.h"
 
 #include <errno.h>
@@ -211,6 +212,13 @@ static void wvcrash_real(int sig, int fd, pid_t pid)
         }
     }
     
+    // Write out the contents of any WvShmLogRings
+    if (WvShmLogRing::any())
+    {
+        wr(fd, "\nLog ring:\n");
+        WvShmLogRing::dump_all(fd);
+    }
+
     // Write out the assertion message, as logged by __assert*_fail(), if any.
     {
 	const char *assert_msg = wvcrash_read_assert();
@@ -0,0 +1,427 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * CRC32 and CRC32C.  See wvcrc.h.
+ *
+ * Without any help from the CPU, it's "slicing by 8": eight 256-entry
+ * tables, so that each 8 bytes of input takes eight lookups instead of
+ * eight rounds of one lookup that each depend on the last.
+ *
+ * With PCLMULQDQ, CRC32 is done by folding 64 bytes at a time with
+ * carry-less multiplies, as in "Fast CRC Computation for Generic
+ * Polynomials Using PCLMULQDQ Instruction" (Gopal et al., Intel, 2009).
+ * SSE 4.2's crc32 instruction only does CRC32C, which it then does 8
+ * bytes at a time in three streams at once; ARMv8's instructions do both,
+ * 8 bytes at a time.
+ */
+#include "wvcrc.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+# define WVCRC_X86 1
+# include <immintrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+# define WVCRC_ARM 1
+# include <arm_acle.h>
+# include <sys/auxv.h>
+# ifndef HWCAP_CRC32
+#  define HWCAP_CRC32 (1 << 7)
+# endif
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# define WVCRC_LITTLE_ENDIAN 1
+#endif
+
+#define CRC32_POLY  0xedb88320U // reflected 0x04c11db7
+#define CRC32C_POLY 0x82f63b78U // reflected 0x1edc6f41
+
+typedef uint32_t CrcTable[8][256];
+typedef uint32_t CrcFunc(uint32_t crc, const unsigned char *p, size_t len);
+
+static CrcTable crc32_table, crc32c_table;
+static CrcFunc *crc32_func, *crc32c_func;
+static const char *impl;
+
+
+static void make_table(CrcTable &t, uint32_t poly)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (-(crc & 1) & poly);
+        t[0][i] = crc;
+    }
+    for (int i = 0; i < 256; i++)
+        for (int k = 1; k < 8; k++)
+            t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xff];
+}
+
+
+// 'crc' here (and in all the CrcFuncs) is the running state, which is the
+// bitwise inverse of the CRC so far.
+static uint32_t crc_bytes(const CrcTable &t, uint32_t crc,
+                          const unsigned char *p, size_t len)
+{
+    while (len--)
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+
+static uint32_t crc_sliced(const CrcTable &t, uint32_t crc,
+                           const unsigned char *p, size_t len)
+{
+#ifdef WVCRC_LITTLE_ENDIAN
+    while (len >= 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff]
+            ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff]
+            ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    return crc_bytes(t, crc, p, len);
+}
+
+
+static uint32_t crc32_soft(uint32_t crc, const unsigned char *p, size_t len)
+{
+    return crc_sliced(crc32_table, crc, p, len);
+}
+
+
+static uint32_t crc32c_soft(uint32_t crc, const unsigned char *p, size_t len)
+{
+    return crc_sliced(crc32c_table, crc, p, len);
+}
+
+
+#ifdef WVCRC_X86
+
+// Folds 'len' bytes, which must be at least 64 and a multiple of 16.  The
+// constants are x^(4*128+32), x^(4*128-32), x^(128+32), x^(128-32) and
+// x^64 mod P(x), bit-reflected and shifted left by one, followed by P(x)
+// itself and floor(x^64 / P(x)) for the final Barrett reduction.
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_fold(uint32_t crc, const unsigned char *p, size_t len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    p += 64;
+    len -= 64;
+
+    // four independent 128-bit folds at once
+    x0 = k1k2;
+    while (len >= 64)
+    {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                           _mm_loadu_si128((const __m128i *)(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                           _mm_loadu_si128((const __m128i *)(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                           _mm_loadu_si128((const __m128i *)(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                           _mm_loadu_si128((const __m128i *)(p + 0x30)));
+        p += 64;
+        len -= 64;
+    }
+
+    // fold the four into one
+    x0 = k3k4;
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // and any 16-byte blocks that are left
+    while (len >= 16)
+    {
+        x2 = _mm_loadu_si128((const __m128i *)p);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        p += 16;
+        len -= 16;
+    }
+
+    // 128 bits down to 64
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = k5k0;
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction down to 32
+    x0 = poly;
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return _mm_extract_epi32(x1, 1);
+}
+
+
+static uint32_t crc32_pclmul(uint32_t crc, const unsigned char *p, size_t len)
+{
+    if (len >= 64)
+    {
+        size_t n = len & ~(size_t)15;
+        crc = crc32_fold(crc, p, n);
+        p += n;
+        len -= n;
+    }
+    return crc32_soft(crc, p, len);
+}
+
+
+// For CRC32C, the crc32 instruction can start every cycle, but takes three
+// to finish, so it's three times faster to do three separate streams at
+// once and put them together at the end.  That takes a table that moves a
+// CRC past 'len' bytes of zeros, for each length of stream.
+#define CRC32C_LONG 8192
+#define CRC32C_SHORT 256
+typedef uint32_t ShiftTable[4][256];
+static ShiftTable crc32c_long, crc32c_short;
+
+
+// a times b, modulo the CRC32C polynomial (all bit-reflected)
+static uint32_t multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t p = 0;
+    for (uint32_t m = 1U << 31; m; m >>= 1)
+    {
+        if (a & m)
+            p ^= b;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+
+static void make_shift_table(ShiftTable &t, size_t len)
+{
+    // x^(8*len) mod P
+    uint32_t xn = 1U << 31;
+    for (size_t i = 0; i < len * 8; i++)
+        xn = (xn & 1) ? (xn >> 1) ^ CRC32C_POLY : xn >> 1;
+    for (int k = 0; k < 4; k++)
+        for (uint32_t v = 0; v < 256; v++)
+            t[k][v] = multmodp(xn, v << (8 * k));
+}
+
+
+static inline uint32_t shift(const ShiftTable &t, uint32_t crc)
+{
+    return t[0][crc & 0xff] ^ t[1][(crc >> 8) & 0xff]
+        ^ t[2][(crc >> 16) & 0xff] ^ t[3][crc >> 24];
+}
+
+
+#ifdef __x86_64__
+
+__attribute__((target("sse4.2")))
+static inline uint32_t crc32c_three(const ShiftTable &t, size_t stream,
+                                    uint32_t crc, const unsigned char *p)
+{
+    uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+    const unsigned char *end = p + stream;
+    while (p < end)
+    {
+        uint64_t v0, v1, v2;
+        memcpy(&v0, p, 8);
+        memcpy(&v1, p + stream, 8);
+        memcpy(&v2, p + stream * 2, 8);
+        crc0 = _mm_crc32_u64(crc0, v0);
+        crc1 = _mm_crc32_u64(crc1, v1);
+        crc2 = _mm_crc32_u64(crc2, v2);
+        p += 8;
+    }
+    return shift(t, shift(t, crc0) ^ crc1) ^ crc2;
+}
+
+#endif
+
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len)
+{
+#ifdef __x86_64__
+    while (len >= CRC32C_LONG * 3)
+    {
+        crc = crc32c_three(crc32c_long, CRC32C_LONG, crc, p);
+        p += CRC32C_LONG * 3;
+        len -= CRC32C_LONG * 3;
+    }
+    while (len >= CRC32C_SHORT * 3)
+    {
+        crc = crc32c_three(crc32c_short, CRC32C_SHORT, crc, p);
+        p += CRC32C_SHORT * 3;
+        len -= CRC32C_SHORT * 3;
+    }
+
+    uint64_t crc64 = crc;
+    while (len >= 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = crc64;
+#else
+    while (len >= 4)
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        len -= 4;
+    }
+#endif
+    while (len--)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+
+#endif // WVCRC_X86
+
+
+#ifdef WVCRC_ARM
+
+__attribute__((target("+crc")))
+static uint32_t crc32_armv8(uint32_t crc, const unsigned char *p, size_t len)
+{
+    while (len >= 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32d(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = __crc32b(crc, *p++);
+    return crc;
+}
+
+
+__attribute__((target("+crc")))
+static uint32_t crc32c_armv8(uint32_t crc, const unsigned char *p, size_t len)
+{
+    while (len >= 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = __crc32cb(crc, *p++);
+    return crc;
+}
+
+#endif // WVCRC_ARM
+
+
+static void crc_init()
+{
+    make_table(crc32_table, CRC32_POLY);
+    make_table(crc32c_table, CRC32C_POLY);
+    crc32_func = crc32_soft;
+    crc32c_func = crc32c_soft;
+    impl = "table, table";
+
+#ifdef WVCRC_X86
+    __builtin_cpu_init();
+    bool pclmul = __builtin_cpu_supports("pclmul")
+        && __builtin_cpu_supports("sse4.1");
+    bool sse42 = __builtin_cpu_supports("sse4.2");
+    if (pclmul)
+        crc32_func = crc32_pclmul;
+    if (sse42)
+    {
+        make_shift_table(crc32c_long, CRC32C_LONG);
+        make_shift_table(crc32c_short, CRC32C_SHORT);
+        crc32c_func = crc32c_sse42;
+    }
+    impl = pclmul ? (sse42 ? "pclmul, sse4.2" : "pclmul, table")
+        : (sse42 ? "table, sse4.2" : "table, table");
+#endif
+#ifdef WVCRC_ARM
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+    {
+        crc32_func = crc32_armv8;
+        crc32c_func = crc32c_armv8;
+        impl = "armv8, armv8";
+    }
+#endif
+}
+
+
+// Sets everything up before main(), so that it's all ready before there
+// can be more than one thread; it's also checked each time, in case
+// someone else's static constructor gets here first.
+static struct CrcInit
+{
+    CrcInit()
+        { if (!impl) crc_init(); }
+} crcinit;
+
+
+uint32_t wvcrc32(uint32_t crc, const void *buf, size_t len)
+{
+    if (!impl) crc_init();
+    return ~crc32_func(~crc, (const unsigned char *)buf, len);
+}
+
+
+uint32_t wvcrc32c(uint32_t crc, const void *buf, size_t len)
+{
+    if (!impl) crc_init();
+    return ~crc32c_func(~crc, (const unsigned char *)buf, len);
+}
+
+
+const char *wvcrc_impl()
+{
+    if (!impl) crc_init();
+    return impl;
+}
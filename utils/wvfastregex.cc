@@ -0,0 +1,1372 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2004 Net Integration Technologies, Inc.
+ *
+ * Regular expressions without backtracking.  See wvfastregex.h.
+ *
+ * A pattern is parsed into a tree, and the tree is compiled into a
+ * Thompson NFA: a list of instructions that the matcher can be at many of
+ * at once.  Matching runs a DFA whose states are sets of those
+ * instructions.  Each state, and each transition out of it, is worked out
+ * the first time the input gets there and remembered after that, so
+ * most bytes cost one table lookup.  If the remembered states get too
+ * big, they're thrown away and worked out again as needed.
+ *
+ * ^ and $ are the tricky part, since they look at the byte before and the
+ * byte after.  Each state remembers whether the byte before was a line
+ * break (or there wasn't one); a $ waits in the set until the next byte
+ * (or the end of the input, which is an extra symbol) shows up, and if
+ * that lets it through, whatever comes after it sees the same byte.
+ *
+ * To find where a match is, leftmost-longest like regexec(), we go
+ * backwards through the input with the reversed pattern to find the
+ * leftmost place a match starts, then forwards from there to find the
+ * longest one.
+ */
+#include "wvfastregex.h"
+#include "wvhashtable.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#define MAX_DEPTH 1000          // parens inside parens
+#define MAX_INSTS 50000         // size of the compiled pattern
+#define MAX_DFA_MEM (2 << 20)   // bytes of DFA states before starting over
+#define MAX_CACHED 256          // compiled patterns kept around
+
+
+struct RxCharSet
+{
+    uint32_t bits[8];
+
+    RxCharSet()
+        { memset(bits, 0, sizeof(bits)); }
+    void add(int c)
+        { bits[c >> 5] |= 1U << (c & 31); }
+    void add(int lo, int hi)
+        { for (int c = lo; c <= hi; c++) add(c); }
+    void remove(int c)
+        { bits[c >> 5] &= ~(1U << (c & 31)); }
+    bool has(int c) const
+        { return bits[c >> 5] & (1U << (c & 31)); }
+    void invert()
+        { for (int i = 0; i < 8; i++) bits[i] = ~bits[i]; }
+    void fold()
+    {
+        for (int c = 'a'; c <= 'z'; c++)
+            if (has(c) || has(toupper(c)))
+            {
+                add(c);
+                add(toupper(c));
+            }
+    }
+};
+
+
+struct RxNode
+{
+    enum Type { EMPTY, CHARS, CAT, ALT, STAR, PLUS, QUEST, BOL, EOL };
+    Type type;
+    int left, right;    // children (indexes into the list of nodes)
+    int set;            // for CHARS
+
+    RxNode(Type _type, int _left = -1, int _right = -1, int _set = -1)
+        : type(_type), left(_left), right(_right), set(_set) {}
+};
+
+
+// Parses POSIX regular expressions, extended or basic, into RxNodes.
+// Repeated subexpressions ("x{3}") are the same node more than once.
+class RxParser
+{
+public:
+    std::vector<RxNode> &nodes;
+    std::vector<RxCharSet> &sets;
+    const char *p;
+    bool ext, icase, newline;
+    int depth;
+    int errcode;
+    WvString errstr;
+
+    RxParser(std::vector<RxNode> &_nodes, std::vector<RxCharSet> &_sets,
+             int cflags)
+        : nodes(_nodes), sets(_sets)
+    {
+        ext = cflags & WvRegex::EXTENDED;
+        icase = cflags & WvRegex::ICASE;
+        newline = cflags & WvRegex::NEWLINE;
+        depth = 0;
+        errcode = 0;
+    }
+
+    int parse(const char *pattern)
+    {
+        p = pattern;
+        int root = alt();
+        if (root >= 0 && *p)
+            return fail(REG_EPAREN, "unmatched ) or \\)");
+        return root;
+    }
+
+private:
+    int fail(int code, const char *str)
+    {
+        if (!errcode)
+        {
+            errcode = code;
+            errstr = str;
+        }
+        return -1;
+    }
+
+    int node(RxNode::Type type, int left = -1, int right = -1)
+    {
+        nodes.push_back(RxNode(type, left, right));
+        return nodes.size() - 1;
+    }
+
+    int chars(RxCharSet &set)
+    {
+        if (icase)
+            set.fold();
+        sets.push_back(set);
+        nodes.push_back(RxNode(RxNode::CHARS, -1, -1, sets.size() - 1));
+        return nodes.size() - 1;
+    }
+
+    int literal(int c)
+    {
+        RxCharSet set;
+        set.add(c);
+        return chars(set);
+    }
+
+    // "|" in ERE, "\|" in BRE
+    bool at_alt()
+        { return ext ? *p == '|' : p[0] == '\\' && p[1] == '|'; }
+
+    // ")" in ERE, "\)" in BRE.  An unmatched ) in an ERE is an ordinary
+    // character, as it is to regcomp().
+    bool at_close()
+    {
+        if (ext)
+            return *p == ')' && depth > 0;
+        return p[0] == '\\' && p[1] == ')';
+    }
+
+    int alt()
+    {
+        int n = cat();
+        while (n >= 0 && at_alt())
+        {
+            p += ext ? 1 : 2;
+            int right = cat();
+            if (right < 0)
+                return -1;
+            n = node(RxNode::ALT, n, right);
+        }
+        return n;
+    }
+
+    int cat()
+    {
+        int n = -1;
+        while (*p && !at_alt() && !at_close())
+        {
+            int next = repeat(n < 0);
+            if (next < 0)
+                return -1;
+            n = (n < 0) ? next : node(RxNode::CAT, n, next);
+        }
+        return n < 0 ? node(RxNode::EMPTY) : n;
+    }
+
+    int repeat(bool first)
+    {
+        int n = atom(first);
+        while (n >= 0)
+        {
+            int min, max; // max < 0 means no limit
+            if (*p == '*')
+            {
+                p++;
+                min = 0, max = -1;
+            }
+            else if (ext ? *p == '+' : p[0] == '\\' && p[1] == '+')
+            {
+                p += ext ? 1 : 2;
+                min = 1, max = -1;
+            }
+            else if (ext ? *p == '?' : p[0] == '\\' && p[1] == '?')
+            {
+                p += ext ? 1 : 2;
+                min = 0, max = 1;
+            }
+            else if (ext ? *p == '{' && isdigit((unsigned char)p[1])
+                         : p[0] == '\\' && p[1] == '{')
+            {
+                p += ext ? 1 : 2;
+                if (!bounds(min, max))
+                    return -1;
+            }
+            else
+                break;
+            n = repeated(n, min, max);
+        }
+        return n;
+    }
+
+    bool bounds(int &min, int &max)
+    {
+        if (!isdigit((unsigned char)*p))
+            return fail(REG_BADBR, "invalid repetition count"), false;
+        min = strtol(p, (char **)&p, 10);
+        max = min;
+        if (*p == ',')
+        {
+            p++;
+            max = isdigit((unsigned char)*p) ? strtol(p, (char **)&p, 10) : -1;
+        }
+        if (ext ? *p != '}' : p[0] != '\\' || p[1] != '}')
+            return fail(REG_EBRACE, "unmatched { or \\{"), false;
+        p += ext ? 1 : 2;
+        if (min > RE_DUP_MAX || max > RE_DUP_MAX || (max >= 0 && max < min))
+            return fail(REG_BADBR, "invalid repetition count"), false;
+        return true;
+    }
+
+    int repeated(int n, int min, int max)
+    {
+        if (min == 0 && max < 0)
+            return node(RxNode::STAR, n);
+        if (min == 1 && max < 0)
+            return node(RxNode::PLUS, n);
+        if (min == 0 && max == 1)
+            return node(RxNode::QUEST, n);
+
+        // x{2,5} is xx(x(x(x)?)?)?
+        int result = -1;
+        for (int i = 0; i < min; i++)
+            result = (result < 0) ? n : node(RxNode::CAT, result, n);
+        int rest = -1;
+        if (max < 0)
+            rest = node(RxNode::STAR, n);
+        else
+            for (int i = min; i < max; i++)
+                rest = node(RxNode::QUEST,
+                            rest < 0 ? n : node(RxNode::CAT, n, rest));
+        if (rest >= 0)
+            result = (result < 0) ? rest : node(RxNode::CAT, result, rest);
+        return result < 0 ? node(RxNode::EMPTY) : result;
+    }
+
+    int atom(bool first)
+    {
+        char c = *p;
+        if (ext ? c == '(' : c == '\\' && p[1] == '(')
+        {
+            p += ext ? 1 : 2;
+            if (depth >= MAX_DEPTH)
+                return fail(REG_ESPACE, "too many parentheses");
+            depth++;
+            int n = alt();
+            depth--;
+            if (n < 0)
+                return -1;
+            if (!(ext ? *p == ')' : p[0] == '\\' && p[1] == ')'))
+                return fail(REG_EPAREN, "unmatched ( or \\(");
+            p += ext ? 1 : 2;
+            return n;
+        }
+        if (c == '^' && (ext || first))
+        {
+            p++;
+            return node(RxNode::BOL);
+        }
+        if (c == '$' && (ext || !p[1]
+                         || (p[1] == '\\' && (p[2] == ')' || p[2] == '|'))))
+        {
+            p++;
+            return node(RxNode::EOL);
+        }
+        if (ext && (c == '*' || c == '+' || c == '?'
+                    || (c == '{' && isdigit((unsigned char)p[1]))))
+            return fail(REG_BADRPT, "nothing to repeat");
+        if (c == '.')
+        {
+            p++;
+            RxCharSet set;
+            set.add(0, 255);
+            if (newline)
+                set.remove('\n');
+            return chars(set);
+        }
+        if (c == '[')
+        {
+            p++;
+            return bracket();
+        }
+        if (c == '\\')
+        {
+            p++;
+            return escape();
+        }
+        p++;
+        return literal((unsigned char)c);
+    }
+
+    int escape()
+    {
+        char c = *p;
+        if (!c)
+            return fail(REG_EESCAPE, "trailing backslash");
+        if (c >= '1' && c <= '9')
+            return fail(REG_ESUBREG, "back-references aren't supported");
+        if (strchr("bB<>`'", c))
+            return fail(REG_BADPAT, "word and buffer boundaries "
+                        "aren't supported");
+        p++;
+        if (c == 'w' || c == 'W' || c == 's' || c == 'S')
+        {
+            RxCharSet set;
+            for (int i = 0; i < 256; i++)
+                if (tolower(c) == 'w' ? isalnum(i) || i == '_' : isspace(i))
+                    set.add(i);
+            if (isupper(c))
+            {
+                set.invert();
+                if (newline)
+                    set.remove('\n');
+            }
+            return chars(set);
+        }
+        return literal((unsigned char)c);
+    }
+
+    // one end of a range in a bracket: a character, or [.c.] or [=c=]
+    int bracket_char()
+    {
+        if (p[0] == '[' && (p[1] == '.' || p[1] == '='))
+        {
+            char delim = p[1];
+            if (!p[2] || p[3] != delim || p[4] != ']')
+                return fail(REG_ECOLLATE, "invalid collating element");
+            int c = (unsigned char)p[2];
+            p += 5;
+            return c;
+        }
+        return (unsigned char)*p++;
+    }
+
+    bool char_class(RxCharSet &set)
+    {
+        const char *end = strstr(p, ":]");
+        if (!end)
+            return fail(REG_EBRACK, "unmatched [ or [^"), false;
+        WvString name;
+        name.setsize(end - p + 1);
+        memcpy(name.edit(), p, end - p);
+        name.edit()[end - p] = 0;
+        p = end + 2;
+
+        static const struct {
+            const char *name;
+            int (*func)(int);
+        } classes[] = {
+            { "alpha", isalpha }, { "digit", isdigit }, { "alnum", isalnum },
+            { "upper", isupper }, { "lower", islower }, { "space", isspace },
+            { "blank", isblank }, { "punct", ispunct }, { "print", isprint },
+            { "graph", isgraph }, { "cntrl", iscntrl }, { "xdigit", isxdigit },
+            { NULL, NULL }
+        };
+        for (int i = 0; classes[i].name; i++)
+            if (name == classes[i].name)
+            {
+                for (int c = 0; c < 256; c++)
+                    if (classes[i].func(c))
+                        set.add(c);
+                return true;
+            }
+        return fail(REG_ECTYPE, "invalid character class"), false;
+    }
+
+    int bracket()
+    {
+        RxCharSet set;
+        bool negate = false;
+        if (*p == '^')
+        {
+            negate = true;
+            p++;
+        }
+        for (bool first = true; ; first = false)
+        {
+            if (!*p)
+                return fail(REG_EBRACK, "unmatched [ or [^");
+            if (*p == ']' && !first)
+            {
+                p++;
+                break;
+            }
+            if (p[0] == '[' && p[1] == ':')
+            {
+                p += 2;
+                if (!char_class(set))
+                    return -1;
+                continue;
+            }
+            int lo = bracket_char();
+            if (lo < 0)
+                return -1;
+            if (p[0] == '-' && p[1] && p[1] != ']')
+            {
+                p++;
+                int hi = bracket_char();
+                if (hi < 0)
+                    return -1;
+                if (hi < lo)
+                    return fail(REG_ERANGE, "invalid range end");
+                set.add(lo, hi);
+            }
+            else
+                set.add(lo);
+        }
+        if (icase)
+            set.fold();
+        if (negate)
+        {
+            set.invert();
+            if (newline)
+                set.remove('\n');
+        }
+        return chars(set);
+    }
+};
+
+
+struct RxInst
+{
+    enum Op {
+        CHARS,          // consume a byte in sets[arg], then go to out
+        SPLIT,          // go to both out and arg
+        AFTER_NL,       // go to out if at the start or just after a newline
+        BEFORE_NL,      // go to out if at the end or just before a newline
+        MATCH           // pattern number arg matched
+    };
+    int op, out, arg;
+
+    RxInst(int _op, int _out, int _arg)
+        : op(_op), out(_out), arg(_arg) {}
+};
+
+
+// A DFA state: a set of instructions, all of which are CHARS, BEFORE_NL
+// or MATCH (the rest having been followed already).
+struct RxState
+{
+    enum {
+        AFTER_NL = 1,      // the byte before was a newline, or there wasn't one
+        MATCH_HERE = 2,    // a match ends here
+        MATCH_BEFORE = 4,  // a match ended before the byte that got us here
+        MATCHED = MATCH_HERE | MATCH_BEFORE,
+        DEAD = 8,          // nothing left that could ever match
+        IDLE = 16          // nothing's started matching; see RxMachine::accel
+    };
+
+    unsigned hash;
+    RxState *chain;     // the next state in the same hash bucket
+    int flags;
+    int ninsts;         // instructions in the set
+    int nbefore;        // MATCH instructions reached before the last byte
+    int *insts;         // ninsts instructions, then nbefore MATCHes
+    RxState *next[1];   // where each symbol goes, or NULL if not known yet
+};
+
+
+// The instructions for a pattern (or several) going in one direction,
+// and the DFA built from them.
+class RxMachine
+{
+public:
+    std::vector<RxInst> insts;
+    int start, ustart;   // anchored, and unanchored (".*" in front)
+    int npatterns;
+
+    // From bytes to symbols: bytes that every CHARS instruction treats
+    // the same are the same symbol.  After the bytes come two extra
+    // symbols for the end of the input: one where $ matches, and one
+    // where it doesn't (for NOTEOL).
+    const unsigned char *bytemap;
+    const int *classrep;
+    const std::vector<RxCharSet> *sets;
+    int nclasses, nsyms, nl_class;
+    bool newline;
+
+    // In the unanchored search, the state we're in while nothing has
+    // started to match is "idle", and it stays that way until a byte that
+    // could start a match.  If there's only one of those, memchr() can
+    // find it a lot faster than the DFA; if there are none, we can stop.
+    // accel is that byte, NO_ACCEL, or NEVER.  idle is its instructions.
+    enum { NO_ACCEL = -1, NEVER = 256 };
+    int accel;
+    std::vector<int> idle;
+
+    RxState **buckets;
+    unsigned nbuckets;
+    std::vector<RxState *> states;
+    size_t mem;
+    RxState *starts[2][2]; // [anchored][after_nl]
+    int flushes;
+
+    // scratch space for step()
+    std::vector<unsigned> mark, nmark;
+    unsigned gen;
+    std::vector<int> work, nextset, before, stack;
+
+    RxMachine()
+    {
+        npatterns = 0;
+        nbuckets = 1024;
+        buckets = new RxState*[nbuckets];
+        memset(buckets, 0, nbuckets * sizeof(RxState *));
+        memset(starts, 0, sizeof(starts));
+        mem = 0;
+        flushes = 0;
+        gen = 0;
+    }
+
+    ~RxMachine()
+    {
+        flush();
+        delete[] buckets;
+    }
+
+    int emit(int op, int out, int arg)
+    {
+        insts.push_back(RxInst(op, out, arg));
+        return insts.size() - 1;
+    }
+
+    // Compile the tree under n so that it carries on to 'next' after it
+    // matches.  Returns the instruction to start at, or -1 if it's too big.
+    int compile(const std::vector<RxNode> &nodes, int n, int next,
+                bool reverse)
+    {
+        if (next < 0 || insts.size() > MAX_INSTS)
+            return -1;
+        const RxNode &node = nodes[n];
+        int s, body;
+        switch (node.type)
+        {
+        case RxNode::EMPTY:
+            return next;
+        case RxNode::CHARS:
+            return emit(RxInst::CHARS, next, node.set);
+        case RxNode::CAT:
+            if (reverse)
+                return compile(nodes, node.right,
+                               compile(nodes, node.left, next, reverse),
+                               reverse);
+            return compile(nodes, node.left,
+                           compile(nodes, node.right, next, reverse),
+                           reverse);
+        case RxNode::ALT:
+            s = compile(nodes, node.left, next, reverse);
+            body = compile(nodes, node.right, next, reverse);
+            if (s < 0 || body < 0)
+                return -1;
+            return emit(RxInst::SPLIT, s, body);
+        case RxNode::QUEST:
+            body = compile(nodes, node.left, next, reverse);
+            if (body < 0)
+                return -1;
+            return emit(RxInst::SPLIT, body, next);
+        case RxNode::STAR:
+        case RxNode::PLUS:
+            s = emit(RxInst::SPLIT, -1, next);
+            body = compile(nodes, node.left, s, reverse);
+            if (body < 0)
+                return -1;
+            insts[s].out = body;
+            return node.type == RxNode::STAR ? s : body;
+        case RxNode::BOL:
+            return emit(reverse ? RxInst::BEFORE_NL : RxInst::AFTER_NL,
+                        next, 0);
+        case RxNode::EOL:
+            return emit(reverse ? RxInst::AFTER_NL : RxInst::BEFORE_NL,
+                        next, 0);
+        }
+        return -1;
+    }
+
+    // Put 'start' in front of an unanchored loop, and get ready to match.
+    void finish(int _start, const std::vector<RxCharSet> &_sets,
+                const unsigned char *_bytemap, const int *_classrep,
+                int _nclasses, bool _newline)
+    {
+        start = _start;
+        sets = &_sets;
+        bytemap = _bytemap;
+        classrep = _classrep;
+        nclasses = _nclasses;
+        nsyms = nclasses + 2;
+        nl_class = bytemap['\n'];
+        newline = _newline;
+
+        // any byte at all is the last set
+        ustart = emit(RxInst::SPLIT, start, -1);
+        int any = emit(RxInst::CHARS, ustart, sets->size() - 1);
+        insts[ustart].arg = any;
+
+        mark.resize(insts.size(), 0);
+        nmark.resize(insts.size(), 0);
+        find_accel();
+    }
+
+    void find_accel()
+    {
+        accel = NO_ACCEL;
+        newgen();
+        closure(idle, mark, ustart, false);
+        std::sort(idle.begin(), idle.end());
+
+        RxCharSet first;
+        for (size_t i = 0; i < idle.size(); i++)
+        {
+            const RxInst &in = insts[idle[i]];
+            if (in.op != RxInst::CHARS)
+                return; // a $ or an empty match
+            if (in.out != ustart)
+                for (int c = 0; c < 256; c++)
+                    if ((*sets)[in.arg].has(c))
+                        first.add(c);
+        }
+        if (newline)
+            first.add('\n'); // that's not idle: it's at the start of a line
+
+        int count = 0;
+        for (int c = 0; c < 256; c++)
+            if (first.has(c))
+            {
+                count++;
+                accel = c;
+            }
+        if (count == 0)
+            accel = NEVER;
+        else if (count > 1)
+            accel = NO_ACCEL;
+    }
+
+    void flush()
+    {
+        for (size_t i = 0; i < states.size(); i++)
+            free(states[i]);
+        states.clear();
+        memset(buckets, 0, nbuckets * sizeof(RxState *));
+        memset(starts, 0, sizeof(starts));
+        mem = 0;
+    }
+
+    void newgen()
+    {
+        if (!++gen)
+        {
+            std::fill(mark.begin(), mark.end(), 0);
+            std::fill(nmark.begin(), nmark.end(), 0);
+            gen = 1;
+        }
+    }
+
+    // Add instruction i, and everything it leads to without consuming a
+    // byte, to 'list'.
+    void closure(std::vector<int> &list, std::vector<unsigned> &marks,
+                 int i, bool after_nl)
+    {
+        stack.push_back(i);
+        while (!stack.empty())
+        {
+            i = stack.back();
+            stack.pop_back();
+            if (marks[i] == gen)
+                continue;
+            marks[i] = gen;
+            const RxInst &in = insts[i];
+            switch (in.op)
+            {
+            case RxInst::SPLIT:
+                stack.push_back(in.arg);
+                stack.push_back(in.out);
+                break;
+            case RxInst::AFTER_NL:
+                if (after_nl)
+                    stack.push_back(in.out);
+                break;
+            default:
+                list.push_back(i);
+                break;
+            }
+        }
+    }
+
+    RxState *find(bool after_nl, std::vector<int> &set,
+                  std::vector<int> &matched)
+    {
+        std::sort(set.begin(), set.end());
+        std::sort(matched.begin(), matched.end());
+
+        unsigned hash = after_nl ? 1 : 0;
+        for (size_t i = 0; i < set.size(); i++)
+            hash = hash * 31 + set[i];
+        hash = hash * 31 + 0xffff;
+        for (size_t i = 0; i < matched.size(); i++)
+            hash = hash * 31 + matched[i];
+
+        RxState *s;
+        for (s = buckets[hash % nbuckets]; s; s = s->chain)
+            if (s->hash == hash && (s->flags & RxState::AFTER_NL) == after_nl
+                && s->ninsts == (int)set.size()
+                && s->nbefore == (int)matched.size()
+                && std::equal(set.begin(), set.end(), s->insts)
+                && std::equal(matched.begin(), matched.end(),
+                              s->insts + s->ninsts))
+                return s;
+
+        size_t size = sizeof(RxState) + (nsyms - 1) * sizeof(RxState *)
+            + (set.size() + matched.size()) * sizeof(int);
+        if (mem + size > MAX_DFA_MEM)
+        {
+            flushes++;
+            flush();
+        }
+        s = (RxState *)malloc(size);
+        memset(s, 0, size);
+        s->hash = hash;
+        s->ninsts = set.size();
+        s->nbefore = matched.size();
+        s->insts = (int *)&s->next[nsyms];
+        std::copy(set.begin(), set.end(), s->insts);
+        std::copy(matched.begin(), matched.end(), s->insts + s->ninsts);
+        s->flags = after_nl ? RxState::AFTER_NL : 0;
+        for (size_t i = 0; i < set.size(); i++)
+            if (insts[set[i]].op == RxInst::MATCH)
+                s->flags |= RxState::MATCH_HERE;
+        if (!matched.empty())
+            s->flags |= RxState::MATCH_BEFORE;
+        if (set.empty())
+            s->flags |= RxState::DEAD;
+        if (accel != NO_ACCEL && !after_nl && matched.empty() && set == idle)
+            s->flags |= RxState::IDLE;
+
+        s->chain = buckets[hash % nbuckets];
+        buckets[hash % nbuckets] = s;
+        states.push_back(s);
+        mem += size;
+        return s;
+    }
+
+    RxState *startstate(bool anchored, bool after_nl)
+    {
+        RxState *&s = starts[anchored][after_nl];
+        if (!s)
+        {
+            newgen();
+            nextset.clear();
+            before.clear();
+            closure(nextset, mark, anchored ? start : ustart, after_nl);
+            s = find(after_nl, nextset, before);
+        }
+        return s;
+    }
+
+    // Where 's' goes on symbol 'sym'.  This might throw away every state
+    // (including 's') to make room.
+    RxState *step(RxState *s, int sym)
+    {
+        bool end = sym >= nclasses;
+        bool eol = (sym == nclasses)
+            || (newline && sym == nl_class);
+        bool after_nl = s->flags & RxState::AFTER_NL;
+        bool next_after_nl = newline && sym == nl_class;
+
+        newgen();
+        work.assign(s->insts, s->insts + s->ninsts);
+        nextset.clear();
+        before.clear();
+        for (int i = 0; i < s->ninsts; i++)
+            mark[s->insts[i]] = gen;
+        for (size_t k = 0; k < work.size(); k++)
+        {
+            const RxInst &in = insts[work[k]];
+            if (in.op == RxInst::CHARS)
+            {
+                if (!end && (*sets)[in.arg].has(classrep[sym]))
+                    closure(nextset, nmark, in.out, next_after_nl);
+            }
+            else if (in.op == RxInst::BEFORE_NL)
+            {
+                if (eol)
+                    closure(work, mark, in.out, after_nl);
+            }
+            else if (in.op == RxInst::MATCH && (int)k >= s->ninsts)
+                before.push_back(work[k]);
+        }
+
+        // if find() had to make room, 's' is gone
+        int f = flushes;
+        RxState *n = find(next_after_nl, nextset, before);
+        if (flushes == f)
+            s->next[sym] = n;
+        return n;
+    }
+};
+
+
+// A compiled pattern (or set of them), forwards and backwards.
+class WvFastRegexProg
+{
+public:
+    WvString key;
+    int refs;
+    int cflags;
+    int errcode;
+    WvString errstr;
+    std::vector<RxCharSet> sets;
+    std::vector<bool> found; // which patterns of a set matched
+    unsigned char bytemap[256];
+    int classrep[256];
+    int nclasses;
+    RxMachine fwd, rev;
+
+    WvFastRegexProg(WvStringParm _key, int _cflags)
+        : key(_key), refs(1), cflags(_cflags), errcode(0) {}
+
+    // Pattern n says it matched with MATCH n.  Finding where a match is
+    // takes the reversed pattern, which sets don't need.
+    bool compile(const char * const *patterns, int count, bool reverse)
+    {
+        std::vector<RxNode> nodes;
+        std::vector<int> roots;
+        for (int i = 0; i < count; i++)
+        {
+            RxParser parser(nodes, sets, cflags);
+            int root = parser.parse(patterns[i]);
+            if (root < 0)
+            {
+                errcode = parser.errcode;
+                errstr = parser.errstr;
+                return false;
+            }
+            roots.push_back(root);
+        }
+
+        RxCharSet any;
+        any.add(0, 255);
+        sets.push_back(any);
+        make_bytemap();
+
+        if (!build(fwd, nodes, roots, false)
+            || (reverse && !build(rev, nodes, roots, true)))
+        {
+            errcode = REG_ESPACE;
+            errstr = "regular expression too big";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void make_bytemap()
+    {
+        // a new symbol starts wherever any set changes its mind
+        bool boundary[256];
+        memset(boundary, 0, sizeof(boundary));
+        boundary['\n'] = boundary['\n' + 1] = true;
+        for (size_t i = 0; i < sets.size(); i++)
+            for (int c = 1; c < 256; c++)
+                if (sets[i].has(c) != sets[i].has(c - 1))
+                    boundary[c] = true;
+
+        nclasses = 0;
+        for (int c = 0; c < 256; c++)
+        {
+            if (c && boundary[c])
+                nclasses++;
+            bytemap[c] = nclasses;
+            if (!c || boundary[c])
+                classrep[nclasses] = c;
+        }
+        nclasses++;
+    }
+
+    bool build(RxMachine &m, const std::vector<RxNode> &nodes,
+               const std::vector<int> &roots, bool reverse)
+    {
+        int start = -1;
+        for (size_t i = 0; i < roots.size(); i++)
+        {
+            int match = m.emit(RxInst::MATCH, -1, i);
+            int s = m.compile(nodes, roots[i], match, reverse);
+            if (s < 0)
+                return false;
+            start = (start < 0) ? s : m.emit(RxInst::SPLIT, start, s);
+        }
+        m.npatterns = roots.size();
+        m.finish(start, sets, bytemap, classrep, nclasses,
+                 cflags & WvRegex::NEWLINE);
+        return true;
+    }
+};
+
+
+static inline RxState *next(RxMachine &m, RxState *s, int sym)
+{
+    RxState *n = s->next[sym];
+    return n ? n : m.step(s, sym);
+}
+
+
+// The symbol for the end of the input
+static inline int endsym(RxMachine &m, bool noteol)
+{
+    return m.nclasses + (noteol ? 1 : 0);
+}
+
+
+// Skip ahead to where the idle state could stop being idle.
+static inline const unsigned char *skip(RxMachine &m, const unsigned char *p,
+                                        const unsigned char *end)
+{
+    if (m.accel == RxMachine::NEVER)
+        return end;
+    const void *q = memchr(p, m.accel, end - p);
+    return q ? (const unsigned char *)q : end;
+}
+
+
+// Feed 'len' bytes at 'p' to an unanchored search from state 'state', and
+// stop as soon as anything matches.
+static bool search(RxMachine &m, RxState *&state,
+                   const unsigned char *p, size_t len)
+{
+    const unsigned char *end = p + len;
+    const unsigned char *bytemap = m.bytemap;
+    RxState *s = state;
+    if (s->flags & RxState::IDLE)
+        p = skip(m, p, end);
+    while (p < end)
+    {
+        s = next(m, s, bytemap[*p++]);
+        if (s->flags & (RxState::MATCHED | RxState::IDLE))
+        {
+            if (s->flags & RxState::MATCHED)
+                break;
+            p = skip(m, p, end);
+        }
+    }
+    state = s;
+    return s->flags & RxState::MATCHED;
+}
+
+
+// For sets: note which patterns matched in state 's'.
+static void note(RxMachine &m, RxState *s, std::vector<bool> &matched,
+                 int &nmatched)
+{
+    if (!(s->flags & RxState::MATCHED))
+        return;
+    for (int i = 0; i < s->ninsts + s->nbefore; i++)
+    {
+        const RxInst &in = m.insts[s->insts[i]];
+        if (in.op == RxInst::MATCH && !matched[in.arg])
+        {
+            matched[in.arg] = true;
+            nmatched++;
+        }
+    }
+}
+
+
+// The same as search(), but for sets: stop only when all the patterns
+// have matched.
+static void search(RxMachine &m, RxState *&state, const unsigned char *p,
+                   size_t len, std::vector<bool> &matched, int &nmatched)
+{
+    const unsigned char *end = p + len;
+    const unsigned char *bytemap = m.bytemap;
+    int npatterns = m.npatterns;
+    RxState *s = state, *last = NULL;
+    int flushes = m.flushes;
+    if (s->flags & RxState::IDLE)
+        p = skip(m, p, end);
+    while (p < end)
+    {
+        s = next(m, s, bytemap[*p++]);
+        if (s->flags & (RxState::MATCHED | RxState::IDLE))
+        {
+            if ((s->flags & RxState::MATCHED)
+                && (s != last || m.flushes != flushes))
+            {
+                note(m, s, matched, nmatched);
+                if (nmatched == npatterns)
+                    break;
+                last = s;
+                flushes = m.flushes;
+            }
+            if (s->flags & RxState::IDLE)
+                p = skip(m, p, end);
+        }
+    }
+    state = s;
+}
+
+
+// The end of the longest match that starts at 'start', or -1.
+static ssize_t longest(RxMachine &m, const unsigned char *buf, size_t len,
+                       size_t start, int eflags)
+{
+    bool after_nl = start ? m.newline && buf[start - 1] == '\n'
+                          : !(eflags & WvRegex::NOTBOL);
+    RxState *s = m.startstate(true, after_nl);
+    ssize_t last = (s->flags & RxState::MATCH_HERE) ? (ssize_t)start : -1;
+    for (size_t i = start; i < len; i++)
+    {
+        if (s->flags & RxState::DEAD)
+            return last;
+        s = next(m, s, m.bytemap[buf[i]]);
+        if (s->flags & RxState::MATCH_BEFORE)
+            last = i;
+        if (s->flags & RxState::MATCH_HERE)
+            last = i + 1;
+    }
+    s = next(m, s, endsym(m, eflags & WvRegex::NOTEOL));
+    if (s->flags & RxState::MATCH_BEFORE)
+        last = len;
+    return last;
+}
+
+
+// Where the leftmost match starts, or -1: run the reversed pattern from
+// the end, and the last place it matches is the answer.
+static ssize_t leftmost(RxMachine &m, const unsigned char *buf, size_t len,
+                        int eflags)
+{
+    // backwards, the end of the input is the start, and vice versa
+    RxState *s = m.startstate(false, !(eflags & WvRegex::NOTEOL));
+    ssize_t first = (s->flags & RxState::MATCH_HERE) ? (ssize_t)len : -1;
+    for (size_t i = len; i-- > 0; )
+    {
+        s = next(m, s, m.bytemap[buf[i]]);
+        if (s->flags & RxState::MATCH_BEFORE)
+            first = i + 1;
+        if (s->flags & RxState::MATCH_HERE)
+            first = i;
+    }
+    s = next(m, s, endsym(m, eflags & WvRegex::NOTBOL));
+    if (s->flags & RxState::MATCH_BEFORE)
+        first = 0;
+    return first;
+}
+
+
+DeclareWvDict(WvFastRegexProg, WvString, key);
+
+static WvFastRegexProgDict *cache;
+
+
+static void release(WvFastRegexProg *prog)
+{
+    if (prog && !--prog->refs)
+        delete prog;
+}
+
+
+// Forget the cache at exit, so it doesn't look like a leak.  Anyone still
+// using one of its patterns keeps it until they're done.
+static struct CacheCleanup
+{
+    ~CacheCleanup()
+    {
+        if (!cache)
+            return;
+        WvFastRegexProgDict::Iter i(*cache);
+        for (i.rewind(); i.next(); )
+            release(i.ptr());
+        delete cache;
+        cache = NULL;
+    }
+} cache_cleanup;
+
+
+// Make room in the cache by forgetting the patterns nobody's using.
+static void trim_cache()
+{
+    WvList<WvFastRegexProg> unused;
+    WvFastRegexProgDict::Iter i(*cache);
+    for (i.rewind(); i.next(); )
+        if (i->refs == 1)
+            unused.append(i.ptr(), false);
+
+    WvList<WvFastRegexProg>::Iter j(unused);
+    for (j.rewind(); j.next(); )
+    {
+        cache->remove(j.ptr());
+        release(j.ptr());
+    }
+}
+
+
+WvFastRegex::WvFastRegex(const WvFastRegex &other)
+    : WvErrorBase(other), prog(other.prog)
+{
+    if (prog)
+        prog->refs++;
+}
+
+
+WvFastRegex::~WvFastRegex()
+{
+    release(prog);
+}
+
+
+WvFastRegex &WvFastRegex::operator= (const WvFastRegex &other)
+{
+    if (other.prog)
+        other.prog->refs++;
+    release(prog);
+    prog = other.prog;
+    WvErrorBase::operator= (other);
+    return *this;
+}
+
+
+bool WvFastRegex::set(WvStringParm regex, int cflags)
+{
+    release(prog);
+    prog = NULL;
+
+    if (!cache)
+        cache = new WvFastRegexProgDict(MAX_CACHED);
+    WvString key("%s:%s", cflags, regex);
+    prog = (*cache)[key];
+    if (prog)
+    {
+        prog->refs++;
+        return true;
+    }
+
+    prog = new WvFastRegexProg(key, cflags);
+    const char *pattern = regex.cstr() ? regex.cstr() : "";
+    if (!prog->compile(&pattern, 1, true))
+    {
+        seterr_both(prog->errcode, prog->errstr);
+        release(prog);
+        prog = NULL;
+        return false;
+    }
+
+    if (cache->count() >= MAX_CACHED)
+        trim_cache();
+    prog->refs++;
+    cache->add(prog, false);
+    return true;
+}
+
+
+bool WvFastRegex::match_span(const void *buf, size_t len, int eflags) const
+{
+    if (!prog)
+        return false;
+    RxMachine &m = prog->fwd;
+    RxState *s = m.startstate(false, !(eflags & WvRegex::NOTBOL));
+    if ((s->flags & RxState::MATCHED)
+        || search(m, s, (const unsigned char *)buf, len))
+        return true;
+    s = next(m, s, endsym(m, eflags & WvRegex::NOTEOL));
+    return s->flags & RxState::MATCHED;
+}
+
+
+bool WvFastRegex::match(WvBuf &buf, int eflags) const
+{
+    if (!prog)
+        return false;
+    RxMachine &m = prog->fwd;
+    RxState *s = m.startstate(false, !(eflags & WvRegex::NOTBOL));
+    if (s->flags & RxState::MATCHED)
+        return true;
+
+    size_t used = buf.used();
+    for (size_t off = 0; off < used; )
+    {
+        size_t avail = buf.optpeekable(off);
+        if (search(m, s, buf.peek(off, avail), avail))
+            return true;
+        off += avail;
+    }
+    s = next(m, s, endsym(m, eflags & WvRegex::NOTEOL));
+    return s->flags & RxState::MATCHED;
+}
+
+
+bool WvFastRegex::continuable_match_span(const void *buf, size_t len,
+                                         size_t &match_start,
+                                         size_t &match_end, int eflags) const
+{
+    if (!prog)
+        return false;
+    const unsigned char *p = (const unsigned char *)buf;
+    ssize_t start = leftmost(prog->rev, p, len, eflags);
+    if (start < 0)
+        return false;
+    ssize_t end = longest(prog->fwd, p, len, start, eflags);
+    if (end < start)
+        return false;
+    match_start = start;
+    match_end = end;
+    return true;
+}
+
+
+bool WvFastRegex::continuable_match(WvStringParm string, int eflags,
+                                    int &match_start, int &match_end) const
+{
+    size_t start, end;
+    if (!continuable_match_span(string.cstr(), string.len(),
+                                start, end, eflags))
+        return false;
+    match_start = start;
+    match_end = end;
+    return true;
+}
+
+
+size_t WvFastRegex::cached()
+{
+    return cache ? cache->count() : 0;
+}
+
+
+WvFastRegexSet::WvFastRegexSet(int _cflags)
+    : cflags(_cflags), prog(NULL)
+{
+}
+
+
+WvFastRegexSet::~WvFastRegexSet()
+{
+    release(prog);
+}
+
+
+int WvFastRegexSet::add(WvStringParm regex)
+{
+    std::vector<RxNode> nodes;
+    std::vector<RxCharSet> sets;
+    RxParser parser(nodes, sets, cflags);
+    if (parser.parse(regex.cstr() ? regex.cstr() : "") < 0)
+    {
+        seterr_both(parser.errcode, parser.errstr);
+        return -1;
+    }
+
+    release(prog);
+    prog = NULL;
+    patterns.append(regex);
+    return patterns.count() - 1;
+}
+
+
+bool WvFastRegexSet::compile()
+{
+    if (prog)
+        return true;
+
+    std::vector<const char *> list;
+    WvStringList::Iter i(patterns);
+    for (i.rewind(); i.next(); )
+        list.push_back(i->cstr() ? i->cstr() : "");
+
+    prog = new WvFastRegexProg(WvString::null, cflags);
+    if (!prog->compile(&list[0], list.size(), false))
+    {
+        seterr_both(prog->errcode, prog->errstr);
+        release(prog);
+        prog = NULL;
+        return false;
+    }
+    return true;
+}
+
+
+// The start and end of matching a set, around search()ing each piece of
+// the input.  'found' is the prog's, so that there's nothing to allocate.
+static RxState *set_begin(WvFastRegexProg *prog, int eflags, int &nfound)
+{
+    RxMachine &m = prog->fwd;
+    prog->found.assign(m.npatterns, false);
+    nfound = 0;
+    RxState *s = m.startstate(false, !(eflags & WvRegex::NOTBOL));
+    note(m, s, prog->found, nfound);
+    return s;
+}
+
+
+static int set_end(WvFastRegexProg *prog, RxState *s, int nfound,
+                   bool *matched, int eflags)
+{
+    RxMachine &m = prog->fwd;
+    if (nfound < m.npatterns)
+    {
+        s = next(m, s, endsym(m, eflags & WvRegex::NOTEOL));
+        note(m, s, prog->found, nfound);
+    }
+    if (matched)
+        for (int n = 0; n < m.npatterns; n++)
+            matched[n] = prog->found[n];
+    return nfound;
+}
+
+
+int WvFastRegexSet::match_span(const void *buf, size_t len, bool *matched,
+                               int eflags)
+{
+    if (!patterns.count() || !compile())
+    {
+        for (size_t n = 0; matched && n < patterns.count(); n++)
+            matched[n] = false;
+        return 0;
+    }
+
+    int nfound;
+    RxState *s = set_begin(prog, eflags, nfound);
+    if (nfound < prog->fwd.npatterns)
+        search(prog->fwd, s, (const unsigned char *)buf, len,
+               prog->found, nfound);
+    return set_end(prog, s, nfound, matched, eflags);
+}
+
+
+int WvFastRegexSet::match(WvBuf &buf, bool *matched, int eflags)
+{
+    if (!patterns.count() || !compile())
+    {
+        for (size_t n = 0; matched && n < patterns.count(); n++)
+            matched[n] = false;
+        return 0;
+    }
+
+    int nfound;
+    RxState *s = set_begin(prog, eflags, nfound);
+    size_t used = buf.used();
+    for (size_t off = 0; off < used && nfound < prog->fwd.npatterns; )
+    {
+        size_t avail = buf.optpeekable(off);
+        search(prog->fwd, s, buf.peek(off, avail), avail,
+               prog->found, nfound);
+        off += avail;
+    }
+    return set_end(prog, s, nfound, matched, eflags);
+}
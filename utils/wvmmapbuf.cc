@@ -0,0 +1,176 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A read-only buffer of a file's contents, mapped into memory instead of
+ * read into it.  See wvmmapbuf.h.
+ */
+#include "wvmmapbuf.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/***** WvMmapBufStore *****/
+
+WvMmapBufStore::WvMmapBufStore(int _granularity, int _fd, off_t _start,
+                               size_t _size, size_t _window) :
+    WvReadOnlyBufferStoreMixin<WvBufStore>(_granularity),
+    fd(_fd), start(_start), size(_size), readidx(0), ok(fd >= 0),
+    map(NULL), mapoff(0), maplen(0)
+{
+    size_t pagesize = getpagesize();
+    window = (_window + pagesize - 1) / pagesize * pagesize;
+    if (!window)
+        window = pagesize;
+
+    struct stat st;
+    if (ok && size == (size_t)-1)
+    {
+        if (fstat(fd, &st) < 0)
+            ok = false;
+        else
+            size = st.st_size > start ? st.st_size - start : 0;
+    }
+    if (!ok)
+        size = 0;
+}
+
+
+WvMmapBufStore::~WvMmapBufStore()
+{
+    unmap();
+    if (fd >= 0)
+        close(fd);
+}
+
+
+void WvMmapBufStore::unmap()
+{
+    if (map)
+        munmap((void *)map, maplen);
+    map = NULL;
+    maplen = 0;
+}
+
+
+const unsigned char *WvMmapBufStore::mapped(size_t idx, size_t count)
+{
+    off_t want = start + idx;
+    if (map && want >= mapoff && want + count <= mapoff + maplen)
+        return map + (want - mapoff);
+
+    unmap();
+    mapoff = want - want % getpagesize();
+    size_t len = window;
+    if (len < want - mapoff + count)
+        len = want - mapoff + count;
+    if (mapoff + len > start + size)
+        len = start + size - mapoff;
+
+    void *p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, mapoff);
+    if (p == MAP_FAILED)
+    {
+        ok = false;
+        return NULL;
+    }
+#ifdef MADV_SEQUENTIAL
+    // read ahead aggressively, and don't keep what's behind us
+    madvise(p, len, MADV_SEQUENTIAL);
+#endif
+    map = (const unsigned char *)p;
+    maplen = len;
+    return map + (want - mapoff);
+}
+
+
+size_t WvMmapBufStore::used() const
+{
+    return size - readidx;
+}
+
+
+size_t WvMmapBufStore::optgettable() const
+{
+    return optpeekable(0);
+}
+
+
+const void *WvMmapBufStore::get(size_t count)
+{
+    assert(count <= size - readidx ||
+        ! "attempted to get() more than used()");
+    if (count == 0)
+        return NULL;
+    const void *ptr = mapped(readidx, count);
+    if (ptr)
+        readidx += count;
+    return ptr;
+}
+
+
+void WvMmapBufStore::unget(size_t count)
+{
+    assert(count <= readidx ||
+        ! "attempted to unget() more than ungettable()");
+    readidx -= count;
+}
+
+
+size_t WvMmapBufStore::ungettable() const
+{
+    return readidx;
+}
+
+
+size_t WvMmapBufStore::optpeekable(int offset) const
+{
+    size_t avail = peekable(offset);
+    if (!avail)
+        return 0;
+
+    // whatever's left of this window, or of the next one we'd map
+    off_t want = start + readidx + offset;
+    size_t inwindow;
+    if (map && want >= mapoff && want < off_t(mapoff + maplen))
+        inwindow = mapoff + maplen - want;
+    else
+        inwindow = window - want % getpagesize();
+    return avail < inwindow ? avail : inwindow;
+}
+
+
+const void *WvMmapBufStore::peek(int offset, size_t count)
+{
+    if (count == 0)
+        return NULL;
+    assert(((offset <= 0) ?
+        size_t(-offset) <= readidx :
+        size_t(offset) < size - readidx) ||
+        ! "attempted to peek() with invalid offset or count");
+    return mapped(readidx + offset, count);
+}
+
+
+void WvMmapBufStore::zap()
+{
+    unmap();
+    readidx = size = 0;
+}
+
+
+
+/***** WvMmapBuf *****/
+
+WvMmapBuf::WvMmapBuf(int fd, off_t start, size_t size, size_t window) :
+    WvBufBase<unsigned char>(& mystore),
+    mystore(1, fd, start, size, window)
+{
+}
+
+
+WvMmapBuf::WvMmapBuf(WvStringParm filename, size_t window) :
+    WvBufBase<unsigned char>(& mystore),
+    mystore(1, ::open(filename, O_RDONLY), 0, (size_t)-1, window)
+{
+}
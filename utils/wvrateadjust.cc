@@ -8,6 +8,7 @@
  * See wvrateadjust.h.
  */
 #include "wvrateadjust.h"
+#include <string.h>
 
 WvRateAdjust::WvRateAdjust(int _sampsize, int _irate_base, int _orate)
 #if 0
@@ -38,26 +39,40 @@ WvRateAdjust::WvRateAdjust(int _sampsize, int _irate_base,
 }
 
 
+WvRateAdjust::WvRateAdjust(int _sampsize, int _irate_n, int _irate_d,
+			   int _orate_n, int _orate_d)
+{
+    match_rate = NULL;
+    init(_sampsize, 0);
+
+    irate_n = _irate_n;
+    irate_d = _irate_d;
+    orate_n = _orate_n;
+    orate_d = _orate_d;
+    fixed = true;
+}
+
+
 void WvRateAdjust::init(int _sampsize, int _irate_base)
 {
     sampsize = _sampsize;
     irate_n = _irate_base * 10;
     irate_d = 10;
-    epoch = wvtime();
+    epoch = wvmonotime();
     epoch.tv_sec--;
+    fixed = false;
     bucket = 0;
 }
 
 
-// we always use all input samples and produce an appropriate number of
+// we always use all input samples (except for a partial one at the end,
+// which waits for the rest of it) and produce an appropriate number of
 // output samples.
 bool WvRateAdjust::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
 {
-    if (!inbuf.used()) return true;
-    assert((inbuf.used() % sampsize) == 0); // can't deal with partial samples
-    
-    WvTime now = wvtime();
     unsigned isamps = inbuf.used() / sampsize;
+    if (!isamps)
+	return !flush || !inbuf.used();
     
     // match our output rate to another stream's input rate, if requested
     if (match_rate)
@@ -67,71 +82,88 @@ bool WvRateAdjust::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
     }
     
     // adjust the input rate estimate
-    if (!epoch.tv_sec)
-	epoch = now;
-    irate_n += isamps * 10;
-    irate_d = msecdiff(wvtime(), epoch) / 100;
-    if (!irate_d)
-	irate_d = 1;
+    if (!fixed)
+    {
+	WvTime now = wvmonotime();
+	if (!epoch.tv_sec)
+	    epoch = now;
+	irate_n += isamps * 10;
+	irate_d = msecdiff(now, epoch) / 100;
+	if (!irate_d)
+	    irate_d = 1;
 
 #if 0
-    log("irate=%s (%s/%s), orate=%s (%s/%s), bucket=%s\n",
-	getirate(), irate_n, irate_d, getorate(), orate_n, orate_d,
-	bucket);
+	log("irate=%s (%s/%s), orate=%s (%s/%s), bucket=%s\n",
+	    getirate(), irate_n, irate_d, getorate(), orate_n, orate_d,
+	    bucket);
 #endif
 
-    // reduce the rate estimate if it's getting out of control FIXME:
-    // this method is (almost) unbearably cheesy because it's very
-    // "blocky" - it doesn't happen every time, so it'll cause sudden
-    // jumps from one value to the next.  Hopefully not a big deal,
-    // since the input rate is supposed to be constant anyway.  The
-    // hardcoded constants are also rather weird.
-    if (irate_d > 100) // ten seconds
-    {
-	epoch.tv_sec++; // time now starts one second later
-	irate_n = irate_n * (irate_d - 10)/irate_d;
-	irate_d -= 10;
+	// reduce the rate estimate if it's getting out of control FIXME:
+	// this method is (almost) unbearably cheesy because it's very
+	// "blocky" - it doesn't happen every time, so it'll cause sudden
+	// jumps from one value to the next.  Hopefully not a big deal,
+	// since the input rate is supposed to be constant anyway.  The
+	// hardcoded constants are also rather weird.
+	if (irate_d > 100) // ten seconds
+	{
+	    epoch.tv_sec++; // time now starts one second later
+	    irate_n = irate_n * (irate_d - 10)/irate_d;
+	    irate_d -= 10;
 
 #if 0
-	log("  JUMP!  new irate=%s (%s/%s)\n", getirate(), irate_n, irate_d);
+	    log("  JUMP!  new irate=%s (%s/%s)\n", getirate(), irate_n,
+		irate_d);
 #endif
+	}
     }
 	
-    int plus = orate_n * irate_d, minus = irate_n * orate_d;
+    long long plus = (long long)orate_n * irate_d;
+    long long minus = (long long)irate_n * orate_d;
+    long long drift = plus - minus, b = bucket;
     //log("plus=%s, minus=%s, ", plus, minus);
 
-    unsigned omax = isamps + isamps/2;
-    //log("isamps=%s, omax=%s\n", isamps, omax);
+    // we know exactly how many samples will come out
+    unsigned osamps = (b + isamps * plus) / minus;
+    //log("isamps=%s, osamps=%s\n", isamps, osamps);
     
     const unsigned char *iptr = inbuf.get(isamps * sampsize);
-    unsigned char *ostart, *optr;
-    
-    ostart = optr = outbuf.alloc(omax * sampsize);
+    unsigned char *optr = outbuf.alloc(osamps * sampsize);
 
-    // copy the buffers using the "Bresenham line-drawing" algorithm.
-    for (unsigned s = 0; s < isamps; s++, iptr += sampsize)
+    // copy the buffers using the "Bresenham line-drawing" algorithm, but
+    // a run at a time: when the rates are close, most samples go out
+    // exactly once, and we can work out where the next one that doesn't
+    // is instead of stepping up to it.
+    for (unsigned s = 0; s < isamps; )
     {
-	bucket += plus;
-	//log("s=%s, bucket=%s (+%s, -%s)\n", s, bucket, plus, minus);
-	
-	while (bucket >= minus)
+	//log("s=%s, bucket=%s (+%s, -%s)\n", s, b, plus, minus);
+	if (b + drift >= 0 && b + drift < minus)
 	{
-	    // allocate more buffer space if needed
-	    if ((unsigned)(optr - ostart) >= omax * sampsize)
-		ostart = optr = outbuf.alloc(omax * sampsize);
-	    
-	    for (int i = 0; i < sampsize; i++)
-		optr[i] = iptr[i];
-	    optr += sampsize;
-	    bucket -= minus;
+	    // this one goes out once, and so does everything up until the
+	    // bucket drifts out of [0, minus)
+	    unsigned run = isamps - s;
+	    if (drift > 0 && (minus - 1 - b) / drift < run)
+		run = (minus - 1 - b) / drift;
+	    else if (drift < 0 && b / -drift < run)
+		run = b / -drift;
+
+	    memcpy(optr, iptr, run * sampsize);
+	    optr += run * sampsize;
+	    iptr += run * sampsize;
+	    b += run * drift;
+	    s += run;
+	}
+	else
+	{
+	    // this one gets dropped, or goes out more than once
+	    b += plus;
+	    for (; b >= minus; b -= minus, optr += sampsize)
+		for (int i = 0; i < sampsize; i++)
+		    optr[i] = iptr[i];
+	    iptr += sampsize;
+	    s++;
 	}
     }
+    bucket = b;
     
-    unsigned un = omax*sampsize - (optr - ostart);
-    //log("unalloc %s/%s (%s)\n", un, omax*sampsize, optr-ostart);
-    outbuf.unalloc(un);
-    
-    return true;
+    return !flush || !inbuf.used();
 }
-
-
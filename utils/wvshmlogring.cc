@@ -0,0 +1,225 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A fixed-size ring of recent log messages in shared memory.  See
+ * wvshmlogring.h.
+ */
+#include "wvshmlogring.h"
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SLOTSIZE 4096 // dump() copies a slot onto the stack
+
+// the same as WvLogRcv::loglevels, which we can't get at from here
+static const char *levelnames[] = {
+    "Crit", "Err", "Warn", "Notice", "Info",
+    "*1", "*2", "*3", "*4", "*5",
+};
+
+WvShmLogRing *WvShmLogRing::first_ring;
+
+
+WvShmLogRing::WvShmLogRing(size_t _nslots, size_t _slotsize,
+			   const char *filename)
+{
+    hdr = NULL;
+    mapsize = 0;
+    next_ring = NULL;
+
+    size_t nslots = 1;
+    while (nslots < _nslots)
+	nslots *= 2;
+    size_t slotsize = (_slotsize + 7) & ~(size_t)7;
+    if (slotsize < sizeof(WvShmLogRingSlot) + 64)
+	slotsize = sizeof(WvShmLogRingSlot) + 64;
+    if (slotsize > MAX_SLOTSIZE)
+	slotsize = MAX_SLOTSIZE;
+    mapsize = sizeof(WvShmLogRingHeader) + nslots * slotsize;
+
+    int fd;
+    if (filename)
+	fd = open(filename, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    else
+	fd = open("/dev/zero", O_RDWR);
+    if (fd < 0)
+    {
+	seterr(errno);
+	return;
+    }
+    if (filename && ftruncate(fd, mapsize) < 0)
+    {
+	seterr(errno);
+	close(fd);
+	return;
+    }
+
+    void *p = mmap(NULL, mapsize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+	seterr(errno);
+	return;
+    }
+
+    // it starts out all zeroes, so every slot is already empty
+    hdr = (WvShmLogRingHeader *)p;
+    memcpy(hdr->magic, WVSHMLOGRING_MAGIC, sizeof(hdr->magic));
+    hdr->version = WVSHMLOGRING_VERSION;
+    hdr->size = sizeof(WvShmLogRingHeader);
+    hdr->nslots = nslots;
+    hdr->slotsize = slotsize;
+    hdr->next = 0;
+
+    next_ring = first_ring;
+    first_ring = this;
+}
+
+
+WvShmLogRing::~WvShmLogRing()
+{
+    WvShmLogRing **i;
+    for (i = &first_ring; *i; i = &(*i)->next_ring)
+    {
+	if (*i == this)
+	{
+	    *i = next_ring;
+	    break;
+	}
+    }
+
+    if (hdr)
+	munmap(hdr, mapsize);
+}
+
+
+void WvShmLogRing::append(const WvTime &when, int level,
+			  const char *source, size_t srclen,
+			  const char *msg, size_t len)
+{
+    if (!hdr)
+	return;
+
+    uint64_t seq = __sync_fetch_and_add(&hdr->next, 1);
+    WvShmLogRingSlot *slot = (WvShmLogRingSlot *)((char *)hdr + hdr->size
+	+ (seq & (hdr->nslots - 1)) * hdr->slotsize);
+
+    // nobody should believe this slot until we're done with it
+    slot->seq = 0;
+    __sync_synchronize();
+
+    size_t room = hdr->slotsize - sizeof(WvShmLogRingSlot);
+    if (srclen > 255)
+	srclen = 255;
+    if (srclen > room)
+	srclen = room;
+    if (len > room - srclen)
+	len = room - srclen;
+
+    slot->sec = when.tv_sec;
+    slot->usec = when.tv_usec;
+    slot->level = level;
+    slot->srclen = srclen;
+    slot->len = len;
+    memcpy(slot + 1, source, srclen);
+    memcpy((char *)(slot + 1) + srclen, msg, len);
+
+    __sync_synchronize();
+    slot->seq = seq + 1;
+}
+
+
+void WvShmLogRing::dump(int fd) const
+{
+    if (hdr)
+	dump(hdr, fd);
+}
+
+
+void WvShmLogRing::dump(const WvShmLogRingHeader *hdr, int fd)
+{
+    uint64_t next = hdr->next;
+    uint64_t seq = next > hdr->nslots ? next - hdr->nslots : 0;
+    char copy[MAX_SLOTSIZE];
+    const WvShmLogRingSlot *c = (const WvShmLogRingSlot *)copy;
+
+    for (; seq < next; seq++)
+    {
+	const WvShmLogRingSlot *slot = (const WvShmLogRingSlot *)
+	    ((const char *)hdr + hdr->size
+	     + (seq & (hdr->nslots - 1)) * hdr->slotsize);
+
+	// skip it if it's being written, or was overwritten while we
+	// copied it
+	if (slot->seq != seq + 1)
+	    continue;
+	__sync_synchronize();
+	memcpy(copy, slot, hdr->slotsize);
+	__sync_synchronize();
+	if (slot->seq != seq + 1
+	    || sizeof(*c) + c->srclen + c->len > hdr->slotsize)
+	    continue;
+
+	const char *src = (const char *)(c + 1);
+	const char *msg = src + c->srclen;
+	char stamp[64];
+	int stamplen = snprintf(stamp, sizeof(stamp), "%u.%06u ",
+				(unsigned)c->sec, (unsigned)c->usec);
+	write(fd, stamp, stamplen);
+	write(fd, src, c->srclen);
+	stamplen = snprintf(stamp, sizeof(stamp), "<%s>: ",
+		c->level < sizeof(levelnames) / sizeof(levelnames[0])
+			    ? levelnames[c->level] : "?");
+	write(fd, stamp, stamplen);
+	write(fd, msg, c->len);
+	if (!c->len || msg[c->len - 1] != '\n')
+	    write(fd, "\n", 1);
+    }
+}
+
+
+bool WvShmLogRing::dump(const char *filename, int fd)
+{
+    int ringfd = open(filename, O_RDONLY);
+    if (ringfd < 0)
+	return false;
+    struct stat st;
+    if (fstat(ringfd, &st) < 0
+	|| (size_t)st.st_size < sizeof(WvShmLogRingHeader))
+    {
+	close(ringfd);
+	return false;
+    }
+    size_t size = st.st_size;
+    void *p = mmap(NULL, size, PROT_READ, MAP_SHARED, ringfd, 0);
+    close(ringfd);
+    if (p == MAP_FAILED)
+	return false;
+
+    const WvShmLogRingHeader *h = (const WvShmLogRingHeader *)p;
+    bool ok = !memcmp(h->magic, WVSHMLOGRING_MAGIC, sizeof(h->magic))
+	&& h->version == WVSHMLOGRING_VERSION
+	&& h->size >= sizeof(WvShmLogRingHeader)
+	&& h->nslots && !(h->nslots & (h->nslots - 1))
+	&& h->slotsize >= sizeof(WvShmLogRingSlot)
+	&& h->slotsize <= MAX_SLOTSIZE
+	&& h->size + (uint64_t)h->nslots * h->slotsize <= size;
+    if (ok)
+	dump(h, fd);
+
+    munmap(p, size);
+    return ok;
+}
+
+
+void WvShmLogRing::dump_all(int fd)
+{
+    for (WvShmLogRing *i = first_ring; i; i = i->next_ring)
+	i->dump(fd);
+}
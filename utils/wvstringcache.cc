@@ -5,93 +5,370 @@
  * Definition for the WvStringCache class.  See wvstringcache.h.
  */
 #include "wvstringcache.h"
-#include "wvstringlist.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
-WvStringTable *WvStringCache::t;
-int WvStringCache::refcount;
-size_t WvStringCache::clean_threshold;
+#define PAGE_SIZE     65536
+#define BIG_STRING    (PAGE_SIZE / 8) // longer than this gets its own malloc
+#define MIN_SLOTS     64
+#define SWEEP_STEP    4   // index slots checked for garbage per get()
+#define MIGRATE_STEP  16  // old index slots moved to the new one per get()
 
-WvStringCache::WvStringCache()
+struct WvStringCache::Pool
 {
-    refcount++;
-    if (!t)
+    // The cache's own link in buf.links keeps anybody else from freeing
+    // or editing a string in place; once it's the only one left, nobody
+    // else is using the string.
+    struct Entry
+    {
+	unsigned hash;
+	unsigned len;
+	bool big;
+	WvStringBuf buf; // must be last: the string follows it
+    };
+
+    struct Page
+    {
+	size_t live; // entries still in use in this page
+    };
+
+    struct Index
     {
-	t = new WvStringTable;
-	clean_threshold = 0;
+	Entry **slots;
+	size_t mask, used, tombs;
+    };
+
+    Page *page;       // the one we're allocating from
+    size_t page_used; // bytes of 'page' handed out so far
+    size_t npages, bigmem;
+
+    Index cur, old;   // while 'old' has slots, entries move to 'cur'
+    size_t migrated;  // slots of 'old' already moved
+    size_t sweep;     // next slot of 'cur' to check for garbage
+    size_t clean_threshold; // count() at which a lazy clean() does anything
+
+    Pool();
+    ~Pool();
+
+    WvString get(const char *s);
+    void clean(bool lazy);
+    bool empty() const
+        { return !cur.used && !old.used; }
+    size_t count() const
+        { return cur.used + old.used; }
+    size_t memused() const
+        { return npages * PAGE_SIZE + bigmem
+	      + (cur.mask + 1 + (old.slots ? old.mask + 1 : 0))
+		* sizeof(Entry *); }
+
+private:
+    Entry *newentry(const char *s, size_t len, unsigned hash);
+    void freeentry(Entry *e);
+    Entry *find(Index &idx, const char *s, size_t len, unsigned hash);
+    void insert(Index &idx, Entry *e);
+    void grow();
+    void migrate(size_t n);
+    void reclaim(size_t n);
+    static void initindex(Index &idx, size_t nslots);
+    static size_t entrysize(size_t len)
+        { return (offsetof(Entry, buf) + offsetof(WvStringBuf, data) + len + 1
+		  + sizeof(void *) - 1) & ~(sizeof(void *) - 1); }
+};
+
+// marks a slot whose entry was freed or moved, so probing goes past it
+#define TOMB ((Entry *)1)
+
+
+// A WvString that shares one of our buffers, instead of copying it
+class WvInternedString : public WvString
+{
+public:
+    WvInternedString(WvStringBuf *_buf)
+    {
+	unlink();
+	link(_buf, _buf->data);
     }
+};
+
+
+WvStringCache::Pool::Pool()
+    : page(NULL), page_used(PAGE_SIZE), npages(0), bigmem(0),
+      migrated(0), sweep(0), clean_threshold(0)
+{
+    initindex(cur, MIN_SLOTS);
+    old.slots = NULL;
+    old.mask = old.used = old.tombs = 0;
 }
 
 
-WvStringCache::~WvStringCache()
+WvStringCache::Pool::~Pool()
 {
-    refcount--;
-    if (!refcount)
+    // only deleted once nobody else has any of our strings
+    clean(false);
+    if (page)
     {
-	delete t;
-	t = NULL;
-	clean_threshold = 0;
+	free(page);
+	npages--;
     }
-    else
-	clean();
+    free(cur.slots);
+    free(old.slots);
 }
-    
 
-WvString WvStringCache::get(WvStringParm s)
+
+void WvStringCache::Pool::initindex(Index &idx, size_t nslots)
 {
-    // return s; // disable cache
-    WvString *ret = (*t)[s];
-    if (ret)
+    idx.slots = (Entry **)calloc(nslots, sizeof(Entry *));
+    idx.mask = nslots - 1;
+    idx.used = idx.tombs = 0;
+}
+
+
+WvStringCache::Pool::Entry *WvStringCache::Pool::newentry(const char *s,
+							  size_t len,
+							  unsigned hash)
+{
+    size_t size = entrysize(len);
+    Entry *e;
+    if (size > BIG_STRING)
     {
-	// printf("found(%s)\n", s.cstr());
-	return *ret;
+	e = (Entry *)malloc(size);
+	e->big = true;
+	bigmem += size;
     }
     else
     {
-	// printf("  new(%s)\n", s.cstr());
-	ret = new WvString(s);
-	t->add(ret, true);
-	return *ret;
+	if (page_used + size > PAGE_SIZE)
+	{
+	    // nobody will allocate from the old page again, so it can go
+	    // as soon as it's empty
+	    if (page && !page->live)
+	    {
+		free(page);
+		npages--;
+	    }
+	    void *p;
+	    if (posix_memalign(&p, PAGE_SIZE, PAGE_SIZE))
+		abort();
+	    page = (Page *)p;
+	    page->live = 0;
+	    page_used = (sizeof(Page) + sizeof(void *) - 1)
+		& ~(sizeof(void *) - 1);
+	    npages++;
+	}
+	e = (Entry *)((char *)page + page_used);
+	page_used += size;
+	page->live++;
+	e->big = false;
     }
+
+    e->hash = hash;
+    e->len = len;
+    e->buf.size = len + 1;
+    e->buf.links = 1;
+    memcpy(e->buf.data, s, len + 1);
+    return e;
 }
 
 
-void WvStringCache::clean()
+void WvStringCache::Pool::freeentry(Entry *e)
 {
-    // do we actually need to clean yet?  Skip it if we haven't added too
-    // many items since the last clean, since cleaning is pretty slow.
-    if (t->count() < clean_threshold)
+    if (e->big)
+    {
+	bigmem -= entrysize(e->len);
+	free(e);
 	return;
-    
-    WvStringList l;
-    
-    // use a two-stage process so the iterator doesn't get messed up
-    // FIXME: this might actually be unnecessary with WvScatterHash, but
-    // someone should actually confirm that before taking this out.
-    {
-	WvStringTable::Iter i(*t);
-	for (i.rewind(); i.next(); )
+    }
+
+    Page *p = (Page *)((uintptr_t)e & ~(uintptr_t)(PAGE_SIZE - 1));
+    if (!--p->live && p != page)
+    {
+	free(p);
+	npages--;
+    }
+}
+
+
+WvStringCache::Pool::Entry *WvStringCache::Pool::find(Index &idx,
+						      const char *s,
+						      size_t len,
+						      unsigned hash)
+{
+    for (size_t i = hash & idx.mask; ; i = (i + 1) & idx.mask)
+    {
+	Entry *e = idx.slots[i];
+	if (!e)
+	    return NULL;
+	if (e != TOMB && e->hash == hash && e->len == len
+	    && !memcmp(e->buf.data, s, len))
+	    return e;
+    }
+}
+
+
+void WvStringCache::Pool::insert(Index &idx, Entry *e)
+{
+    size_t i = e->hash & idx.mask;
+    while (idx.slots[i] && idx.slots[i] != TOMB)
+	i = (i + 1) & idx.mask;
+    if (idx.slots[i] == TOMB)
+	idx.tombs--;
+    idx.slots[i] = e;
+    idx.used++;
+}
+
+
+// Starts moving everything to a new index sized for what's in use now,
+// which might be smaller than the old one.  The moving happens a little
+// at a time in migrate().
+void WvStringCache::Pool::grow()
+{
+    if (old.slots)
+	migrate(old.mask + 1);
+
+    size_t nslots = MIN_SLOTS;
+    while (nslots < cur.used * 4)
+	nslots *= 2;
+
+    old = cur;
+    migrated = 0;
+    sweep = 0;
+    initindex(cur, nslots);
+}
+
+
+void WvStringCache::Pool::migrate(size_t n)
+{
+    for (; n && migrated <= old.mask; migrated++, n--)
+    {
+	Entry *e = old.slots[migrated];
+	if (e && e != TOMB)
 	{
-	    if (i->is_unique()) // last remaining instance
-	    {
-		// printf("CLEANUP(%s)\n", i->cstr());
-		l.append(i.ptr(), false);
-	    }
+	    old.slots[migrated] = TOMB;
+	    old.used--;
+	    insert(cur, e);
 	}
     }
-    
-//    printf("CLEANUP-1: %d elements at start (%d to remove)\n",
-//	   (int)t->count(), (int)l.count());
-    
-    {
-	WvStringList::Iter i(l);
-	for (i.rewind(); i.next(); )
-	    t->remove(i.ptr());
+
+    if (migrated > old.mask)
+    {
+	free(old.slots);
+	old.slots = NULL;
+	old.mask = old.used = old.tombs = 0;
+    }
+}
+
+
+void WvStringCache::Pool::reclaim(size_t n)
+{
+    for (; n; n--, sweep = (sweep + 1) & cur.mask)
+    {
+	Entry *e = cur.slots[sweep];
+	if (e && e != TOMB && e->buf.links == 1)
+	{
+	    cur.slots[sweep] = TOMB;
+	    cur.used--;
+	    cur.tombs++;
+	    freeentry(e);
+	}
     }
-    
-    clean_threshold = t->count() + t->count()/10 + 1;
-    
-//    printf("CLEANUP-2: %d elements left (thres=%d).\n", 
-//	   (int)t->count(), (int)clean_threshold);
 }
 
 
+WvString WvStringCache::Pool::get(const char *s)
+{
+    if (old.slots)
+	migrate(MIGRATE_STEP);
+    reclaim(SWEEP_STEP);
+
+    // FNV-1a, and the length while we're at it
+    unsigned hash = 2166136261u;
+    const char *cptr;
+    for (cptr = s; *cptr; cptr++)
+	hash = (hash ^ (unsigned char)*cptr) * 16777619u;
+    size_t len = cptr - s;
+
+    Entry *e = find(cur, s, len, hash);
+    if (!e && old.slots)
+	e = find(old, s, len, hash);
+    if (!e)
+    {
+	if ((cur.used + cur.tombs + 1) * 2 > cur.mask + 1)
+	    grow();
+	e = newentry(s, len, hash);
+	insert(cur, e);
+    }
+    return WvInternedString(&e->buf);
+}
+
+
+void WvStringCache::Pool::clean(bool lazy)
+{
+    // get() cleans up as it goes, so a lazy clean is only worth it if a
+    // lot has been added since last time.
+    if (lazy && count() < clean_threshold)
+	return;
+
+    if (old.slots)
+	migrate(old.mask + 1);
+    reclaim(cur.mask + 1);
+    if (cur.used * 8 < cur.mask + 1 && cur.mask + 1 > MIN_SLOTS)
+    {
+	grow();
+	migrate(old.mask + 1);
+    }
+    clean_threshold = count() + count() / 10 + 1;
+}
+
+
+WvStringCache::Pool *WvStringCache::pool;
+int WvStringCache::refcount;
+
+WvStringCache::WvStringCache()
+{
+    refcount++;
+    if (!pool)
+	pool = new Pool;
+}
+
+
+WvStringCache::~WvStringCache()
+{
+    refcount--;
+    pool->clean(true);
+
+    // strings that are still in use elsewhere keep the pool around for
+    // the next WvStringCache
+    if (!refcount && pool->empty())
+    {
+	delete pool;
+	pool = NULL;
+    }
+}
+
+
+WvString WvStringCache::get(WvStringParm s)
+{
+    if (s.isnull())
+	return s;
+    return pool->get(s);
+}
+
+
+void WvStringCache::clean()
+{
+    pool->clean(false);
+}
+
+
+size_t WvStringCache::count()
+{
+    return pool ? pool->count() : 0;
+}
+
+
+size_t WvStringCache::memused()
+{
+    return pool ? pool->memused() : 0;
+}
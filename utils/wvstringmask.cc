@@ -8,6 +8,9 @@
  * create them in your functions, and then they won't be so bad.
  */
 #include "wvstringmask.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 WvStringMask::WvStringMask(WvStringParm s)
 {
@@ -36,6 +39,7 @@ void WvStringMask::zap()
 {
     memset(_set, 0, sizeof(bool) * sizeof(_set));
     _first = '\0';
+    find_ranges();
 }
 
 void WvStringMask::set(const char c, bool value)
@@ -43,7 +47,8 @@ void WvStringMask::set(const char c, bool value)
     if (!_first)
 	_first = c;
 
-    _set[unsigned(c)] = value;
+    _set[(unsigned char)c] = value;
+    find_ranges();
 }
 
 void WvStringMask::set(WvStringParm s, bool value)
@@ -57,8 +62,178 @@ void WvStringMask::set(WvStringParm s, bool value)
 
 	while (*c)
 	{
-	    _set[unsigned(*c)] = value;
+	    _set[(unsigned char)*c] = value;
 	    ++c;
 	}
+	find_ranges();
     }
 }
+
+void WvStringMask::find_ranges()
+{
+    // the biggest runs of characters that aren't in the mask
+    nranges = nset = 0;
+    all_ranges = true;
+    for (int c = 0; c < 256; )
+    {
+	if (_set[c])
+	{
+	    nset++;
+	    c++;
+	    continue;
+	}
+
+	int start = c;
+	while (c < 256 && !_set[c])
+	    c++;
+	int w = c - 1 - start, r;
+	if (nranges < MAX_RANGES)
+	    r = nranges++;
+	else
+	{
+	    all_ranges = false;
+	    if (width[MAX_RANGES - 1] < w)
+		r = MAX_RANGES - 1;
+	    else
+		continue;
+	}
+	for (; r > 0 && width[r - 1] < w; r--)
+	{
+	    lo[r] = lo[r - 1];
+	    width[r] = width[r - 1];
+	}
+	lo[r] = start;
+	width[r] = w;
+    }
+}
+
+#ifdef __SSE2__
+// The ranges, ready to check 16 characters against at once.
+struct WvStringMask::Ranges
+{
+    __m128i lo[MAX_RANGES], width[MAX_RANGES];
+    int n;
+
+    Ranges(const unsigned char *_lo, const unsigned char *_width, int _n)
+    {
+	n = _n;
+	for (int r = 0; r < n; r++)
+	{
+	    lo[r] = _mm_set1_epi8(_lo[r]);
+	    width[r] = _mm_set1_epi8(_width[r]);
+	}
+    }
+
+    // 0xff for each of the 16 characters at 'p' that's in one of the
+    // ranges, and 0 for the rest
+    __m128i inside(const char *p) const
+    {
+	__m128i x = _mm_loadu_si128((const __m128i *)p);
+	__m128i in = inside(x, 0);
+	switch (n)
+	{
+	case 4: in = _mm_or_si128(in, inside(x, 3));
+	case 3: in = _mm_or_si128(in, inside(x, 2));
+	case 2: in = _mm_or_si128(in, inside(x, 1));
+	}
+	return in;
+    }
+
+    __m128i inside(__m128i x, int r) const
+    {
+	// x is in a range if (x - lo) <= width, without a sign
+	__m128i d = _mm_sub_epi8(x, lo[r]);
+	return _mm_cmpeq_epi8(_mm_min_epu8(d, width[r]), d);
+    }
+
+    // one bit for each of them that isn't
+    unsigned outside(const char *p) const
+	{ return ~_mm_movemask_epi8(inside(p)) & 0xffff; }
+};
+#endif
+
+const char *WvStringMask::find_more(const char *p, const char *end) const
+{
+    if (!nset)
+	return end;
+    if (nset == 1 && _first && _set[(unsigned char)_first])
+    {
+	const char *found = (const char *)memchr(p, _first, end - p);
+	return found ? found : end;
+    }
+
+#ifdef __SSE2__
+    if (nranges)
+    {
+	// One at a time up to where the blocks line up, which is often as
+	// far as it gets when most things are in the mask.
+	for (; p < end && ((size_t)p & 15); p++)
+	    if (_set[(unsigned char)*p])
+		return p;
+
+	Ranges ranges(lo, width, nranges);
+	for (; end - p >= 16; p += 16)
+	{
+	    // what's outside the ranges might still not be in the mask, if
+	    // there were more than MAX_RANGES of them
+	    for (unsigned outside = ranges.outside(p); outside;
+		 outside &= outside - 1)
+	    {
+		const char *q = p + __builtin_ctz(outside);
+		if (_set[(unsigned char)*q])
+		    return q;
+	    }
+	}
+    }
+#endif
+
+    for (; p < end; p++)
+	if (_set[(unsigned char)*p])
+	    return p;
+    return end;
+}
+
+size_t WvStringMask::count(const char *p, const char *end) const
+{
+    size_t n = 0;
+    if (!nset)
+	return n;
+
+#ifdef __SSE2__
+    if (nranges)
+    {
+	Ranges ranges(lo, width, nranges);
+	if (all_ranges)
+	{
+	    // Everything outside the ranges is in the mask.  Add up what's
+	    // inside, a byte for each of the 16, and every so often (before
+	    // they can overflow) into the total.
+	    const __m128i zero = _mm_setzero_si128();
+	    while (end - p >= 16)
+	    {
+		__m128i inside = zero;
+		const char *start = p;
+		const char *stop = p + (end - p < 255 * 16 ? end - p : 255 * 16);
+		for (; stop - p >= 16; p += 16)
+		    inside = _mm_sub_epi8(inside, ranges.inside(p));
+		__m128i sums = _mm_sad_epu8(inside, zero);
+		n += (p - start) - _mm_cvtsi128_si32(sums)
+		    - _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+	    }
+	}
+	else
+	{
+	    for (; end - p >= 16; p += 16)
+		for (unsigned outside = ranges.outside(p); outside;
+		     outside &= outside - 1)
+		    if (_set[(unsigned char)p[__builtin_ctz(outside)]])
+			n++;
+	}
+    }
+#endif
+
+    for (; p < end; p++)
+	if (_set[(unsigned char)*p])
+	    n++;
+    return n;
+}
@@ -7,6 +7,7 @@
  */
 #include "wvstrutils.h"
 #include "wvbuf.h"
+#include "wvstringmask.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
@@ -307,27 +308,53 @@ bool isnewline(char c)
 }
 
 
+// Copy from 'p' up to 'end' into 'out', and return the end of the copy.
+// The short runs between two escapes aren't worth calling memcpy() for.
+static inline char *copy_run(char *out, const char *p, const char *end)
+{
+    if (end - p >= 16)
+    {
+        memcpy(out, p, end - p);
+        return out + (end - p);
+    }
+    while (p < end)
+        *out++ = *p++;
+    return out;
+}
+
+
 // ex: WvString foo = url_decode("I+am+text.%0D%0A");
 WvString url_decode(WvStringParm str, bool no_space)
 {
     if (!str)
         return str;
  
-    const char *iptr;
-    char *optr;
-    const char *idx1, *idx2;
+    static const WvStringMask special("%+"), percent('%');
+    const WvStringMask &mask = no_space ? percent : special;
     static const char hex[] = "0123456789ABCDEF";
-    WvString in, intmp(str), out;
+    const char *idx1, *idx2;
 
-    in = trim_string(intmp.edit());
-    out.setsize(strlen(in) + 1);
+    // trim the spaces off without making a copy first
+    const char *iptr = str, *end = iptr + str.len();
+    while (end > iptr && isspace(end[-1]))
+        end--;
+    while (iptr < end && isspace(*iptr))
+        iptr++;
 
-    optr = out.edit();
-    for (iptr = in, optr = out.edit(); *iptr; iptr++)
+    // it can only get shorter
+    WvString out;
+    out.setsize(end - iptr + 1);
+    char *optr = out.edit();
+    while (iptr < end)
     {
-        if (*iptr == '+' && !no_space)
+        const char *next = mask.find(iptr, end);
+        optr = copy_run(optr, iptr, next);
+        if ((iptr = next) == end)
+            break;
+
+        if (*iptr == '+')
             *optr++ = ' ';
-        else if (*iptr == '%' && iptr[1] && iptr[2])
+        else if (end - iptr > 2)
         {
             idx1 = strchr(hex, toupper((unsigned char) iptr[1]));
             idx2 = strchr(hex, toupper((unsigned char) iptr[2]));
@@ -339,6 +366,7 @@ WvString url_decode(WvStringParm str, bool no_space)
         }
         else
             *optr++ = *iptr;
+        iptr++;
     }
 
     *optr = 0;
@@ -347,29 +375,54 @@ WvString url_decode(WvStringParm str, bool no_space)
 }
 
 
+// the characters url_encode() escapes when it isn't told which
+static WvStringMask url_unsafe()
+{
+    WvStringMask mask;
+    for (int c = 1; c < 256; c++)
+        if (!isalnum(c) && !strchr("_.!~*'()-", c))
+            mask.set(c, true);
+    return mask;
+}
+
+
 // And its magic companion: url_encode
 WvString url_encode(WvStringParm str, WvStringParm unsafe)
 {
-    unsigned int i;
-    WvDynBuf retval;
+    static const WvStringMask default_mask = url_unsafe();
+    WvStringMask custom_mask;
+    if (!!unsafe)
+    {
+        custom_mask.set(unsafe, true);
+        custom_mask.set('%', true);
+    }
+    const WvStringMask &mask = !!unsafe ? custom_mask : default_mask;
+
+    // count the escapes first, so the result is allocated exactly once
+    const char *iptr = str, *end = iptr + str.len(), *p;
+    size_t nescapes = 0;
+    for (p = mask.find(iptr, end); p < end; p = mask.find(p + 1, end))
+        nescapes++;
 
-    for (i=0; i < str.len(); i++)
+    static const char hex[] = "0123456789ABCDEF";
+    WvString out;
+    out.setsize(end - iptr + 2 * nescapes + 1);
+    char *optr = out.edit();
+    while (iptr < end)
     {
-        if (((!!unsafe && !strchr(unsafe, str[i])) ||
-             (!unsafe && (isalnum(str[i]) || strchr("_.!~*'()-", str[i])))) &&
-            str[i] != '%')
-        {
-            retval.put(&str[i], 1);
-        }
-        else
-        {               
-            char buf[4];
-            sprintf(buf, "%%%02X", str[i] & 0xff);
-            retval.put(&buf, 3);
-        }
+        const char *next = mask.find(iptr, end);
+        optr = copy_run(optr, iptr, next);
+        if ((iptr = next) == end)
+            break;
+
+        *optr++ = '%';
+        *optr++ = hex[(unsigned char)*iptr >> 4];
+        *optr++ = hex[*iptr & 15];
+        iptr++;
     }
+    *optr = 0;
 
-    return retval.getstr();
+    return out;
 }
 
 
@@ -392,18 +445,199 @@ WvString diff_dates(time_t t1, time_t t2)
 }
 
 
-WvString rfc822_date(time_t when)
+// Like gmtime() and timegm(), without any locking or looking at the time
+// zone: the days are counted from 0000-03-01 so that leap days come last.
+static void time_to_tm(time_t t, struct tm &tm)
 {
-    WvString out;
-    out.setsize(80);
+    long days = t / 86400, secs = t % 86400;
+    if (secs < 0)
+    {
+        days--;
+        secs += 86400;
+    }
+    tm.tm_hour = secs / 3600;
+    tm.tm_min = secs / 60 % 60;
+    tm.tm_sec = secs % 60;
+    tm.tm_wday = (days % 7 + 11) % 7; // 1970-01-01 was a Thursday
+
+    days += 719468;
+    long era = (days >= 0 ? days : days - 146096) / 146097;
+    long doe = days - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    long year = yoe + era * 400 + (mp >= 10);
+    tm.tm_mday = doy - (153 * mp + 2) / 5 + 1;
+    tm.tm_mon = mp < 10 ? mp + 2 : mp - 10;
+    tm.tm_year = year - 1900;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    tm.tm_yday = mp >= 10 ? doy - 306 : doy + 59 + leap;
+    tm.tm_isdst = 0;
+}
+
+static time_t tm_to_time(const struct tm &tm)
+{
+    long year = tm.tm_year + 1900 - (tm.tm_mon < 2);
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yoe = year - era * 400;
+    long doy = (153 * (tm.tm_mon + (tm.tm_mon < 2 ? 10 : -2)) + 2) / 5
+        + tm.tm_mday - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long days = era * 146097 + doe - 719468;
+    return (time_t)days * 86400 + tm.tm_hour * 3600 + tm.tm_min * 60
+        + tm.tm_sec;
+}
+
+
+namespace {
+// A stretch of time, from 'start' up to (not including) 'end', over which
+// local time is 'gmtoff' seconds ahead of UTC.
+struct TzSpan
+{
+    time_t start, end;
+    long gmtoff;
+    int isdst;
+};
+}
 
+static long gmtoff_at(time_t t, int *isdst = NULL)
+{
+    struct tm *l = localtime(&t);
+    if (isdst)
+        *isdst = l->tm_isdst;
+    return tm_to_time(*l) - t;
+}
+
+// Find where the offset from UTC changes between 'same', where it's
+// 'gmtoff', and 'other', where it isn't: the first second after the change.
+static time_t gmtoff_change(time_t same, time_t other, long gmtoff)
+{
+    while (same - other > 1 || other - same > 1)
+    {
+        time_t mid = same + (other - same) / 2;
+        if (gmtoff_at(mid) == gmtoff)
+            same = mid;
+        else
+            other = mid;
+    }
+    return other > same ? other : same;
+}
+
+// The offset from UTC at 't'.  It only asks localtime() (which locks, and
+// may look at the time zone file) when 't' is outside the stretch it
+// asked about last time, which goes up to the next daylight saving change
+// or a day either side of 't', whichever comes first.  A change to $TZ
+// starts it over.
+static const TzSpan &tz_span(time_t t)
+{
+    static TzSpan span = { 0, 0, 0, 0 };
+    static WvString tz;
+    const char *newtz = getenv("TZ");
+    if (tz != newtz)
+    {
+        tz = newtz;
+        span.start = span.end = 0;
+    }
+    if (t >= span.start && t < span.end)
+        return span;
+
+    const time_t day = 24*60*60;
+    span.gmtoff = gmtoff_at(t, &span.isdst);
+    span.start = t - day;
+    if (gmtoff_at(span.start) != span.gmtoff)
+        span.start = gmtoff_change(t, span.start, span.gmtoff);
+    span.end = t + day;
+    if (gmtoff_at(span.end) != span.gmtoff)
+        span.end = gmtoff_change(t, span.end, span.gmtoff);
+    return span;
+}
+
+
+namespace {
+// The last second a format was used for, and what came out.
+struct TimeCache
+{
+    time_t when;
+    long gmtoff;
+    size_t len;
+    char text[64];
+};
+}
+
+// Format 'when' into 'buf' with strftime(), and then, if 'zone' is set,
+// the offset from UTC like %z.  It's only done once a second: after that,
+// it's just copied out of 'cache'.
+static size_t format_time(TimeCache &cache, const char *format, bool local,
+                          bool zone, time_t when, char *buf, size_t size)
+{
+    long gmtoff = 0;
+    int isdst = 0;
+    if (local)
+    {
+        const TzSpan &span = tz_span(when);
+        gmtoff = span.gmtoff;
+        isdst = span.isdst;
+    }
+
+    if (when != cache.when || gmtoff != cache.gmtoff || !cache.len)
+    {
+        struct tm tm;
+        time_to_tm(when + gmtoff, tm);
+        tm.tm_isdst = isdst;
+        cache.len = strftime(cache.text, sizeof(cache.text), format, &tm);
+        if (zone && cache.len && cache.len + 5 < sizeof(cache.text))
+        {
+            long mins = (gmtoff < 0 ? -gmtoff : gmtoff) / 60;
+            char *p = cache.text + cache.len;
+            p[0] = gmtoff < 0 ? '-' : '+';
+            p[1] = '0' + mins / 600 % 10;
+            p[2] = '0' + mins / 60 % 10;
+            p[3] = '0' + mins % 60 / 10;
+            p[4] = '0' + mins % 10;
+            p[5] = 0;
+            cache.len += 5;
+        }
+        cache.when = when;
+        cache.gmtoff = gmtoff;
+    }
+
+    if (!cache.len || cache.len >= size)
+    {
+        if (size)
+            buf[0] = 0;
+        return 0;
+    }
+    memcpy(buf, cache.text, cache.len + 1);
+    return cache.len;
+}
+
+
+size_t rfc822_date(time_t when, char *buf, size_t size)
+{
+    static TimeCache cache = { -1 };
     if (when < 0)
         when = time(NULL);
+    return format_time(cache, "%a, %d %b %Y %H:%M:%S ", true, true, when,
+                       buf, size);
+}
 
-    struct tm *tmwhen = localtime(&when);
-    strftime(out.edit(), 80, "%a, %d %b %Y %H:%M:%S %z", tmwhen);
 
-    return out;
+WvString rfc822_date(time_t when)
+{
+    char buf[80];
+    rfc822_date(when, buf, sizeof(buf));
+    return buf;
+}
+
+
+// the characters backslash_escape() escapes: !isalnum()
+static WvStringMask not_alnum()
+{
+    WvStringMask mask;
+    for (int c = 1; c < 256; c++)
+        if (!isalnum(c))
+            mask.set(c, true);
+    return mask;
 }
 
 
@@ -413,15 +647,23 @@ WvString backslash_escape(WvStringParm s1)
     if (!s1)
         return "";
 
+    static const WvStringMask mask = not_alnum();
+    const char *p1 = s1, *end = p1 + s1.len(), *p;
+    size_t nescapes = 0;
+    for (p = mask.find(p1, end); p < end; p = mask.find(p + 1, end))
+        nescapes++;
+
     WvString s2;
-    s2.setsize(s1.len() * 2 + 1);
+    s2.setsize(end - p1 + nescapes + 1);
 
-    const char *p1 = s1;
     char *p2 = s2.edit();
-    while (*p1)
+    while (p1 < end)
     {
-        if (!isalnum(*p1))
-            *p2++ = '\\';
+        const char *next = mask.find(p1, end);
+        p2 = copy_run(p2, p1, next);
+        if ((p1 = next) == end)
+            break;
+        *p2++ = '\\';
         *p2++ = *p1++;
     }
     *p2 = 0;
@@ -775,15 +1017,19 @@ WvString undupe(WvStringParm s, char c)
 }
 
 
-WvString rfc1123_date(time_t t)
+size_t rfc1123_date(time_t when, char *buf, size_t size)
 {
-    struct tm *tm = gmtime(&t);
-    WvString s;
+    static TimeCache cache = { -1 };
+    return format_time(cache, "%a, %d %b %Y %H:%M:%S GMT", false, false,
+                       when, buf, size);
+}
 
-    s.setsize(128);
-    strftime(s.edit(), 128, "%a, %d %b %Y %H:%M:%S GMT", tm);
 
-    return s;
+WvString rfc1123_date(time_t t)
+{
+    char buf[128];
+    rfc1123_date(t, buf, sizeof(buf));
+    return buf;
 }
 
 
@@ -1045,51 +1291,141 @@ static inline bool cstr_unescape_char(const char *&cstr, char &ch)
     }
 }
 
+namespace {
+// How cstr_escape() writes each character: the ones in 'mask' need more
+// than just copying, and become 'esc', which is 'len' long.  If none are
+// longer than four, 'esc4' has them too, padded out to four so they can
+// all be copied the same way.  If they're all one, two or four long, the
+// ones in 'two' are at least two long and the ones in 'four' are four.
+struct CStrEscapes
+{
+    WvStringMask mask, two, four;
+    const char *esc[256];
+    unsigned char len[256];
+    char esc4[256][4];
+    bool short_escapes, tiered;
+
+    CStrEscapes(const CStrExtraEscape extra_escapes[]);
+};
+}
+
+CStrEscapes::CStrEscapes(const CStrExtraEscape extra_escapes[])
+{
+    for (int c = 0; c < 256; c++)
+        esc[c] = cstr_escape_char(c);
+    for (const CStrExtraEscape *extra = extra_escapes;
+            extra && extra->ch && extra->esc; ++extra)
+    {
+        unsigned char c = extra->ch;
+        if (esc[c] == cstr_escape_char(c)) // the first one wins
+            esc[c] = extra->esc;
+    }
+
+    short_escapes = tiered = true;
+    for (int c = 0; c < 256; c++)
+    {
+        len[c] = strlen(esc[c]);
+        if (len[c] != 1 || esc[c][0] != (char)c)
+            mask.set(c, true);
+        two.set(c, len[c] >= 2);
+        four.set(c, len[c] >= 4);
+        if (len[c] != 1 && len[c] != 2 && len[c] != 4)
+            tiered = false;
+        if (len[c] > 4)
+            short_escapes = false;
+        else
+            strncpy(esc4[c], esc[c], 4);
+    }
+}
+
 WvString cstr_escape(const void *data, size_t size,
         const CStrExtraEscape extra_escapes[])
 {
     if (!data) return WvString::null;
 
-    const char *cdata = (const char *)data;
+    static const CStrEscapes plain(NULL), tcl(CSTR_TCLSTR_ESCAPES);
+    const CStrEscapes *custom = NULL, *xlat = &plain;
+    if (extra_escapes == CSTR_TCLSTR_ESCAPES)
+        xlat = &tcl;
+    else if (extra_escapes)
+        xlat = custom = new CStrEscapes(extra_escapes);
+
+    const char *cdata = (const char *)data, *end = cdata + size;
+
+    // Work out exactly how long it'll be first.  (Plus one: the last
+    // escape might be copied four bytes at a time, over the closing quote.)
+    size_t len = size + 3;
+    if (xlat->tiered)
+        len += xlat->two.count(cdata, end) + 2 * xlat->four.count(cdata, end);
+    else
+    {
+        for (size_t i = 0; i < size; i++)
+            len += xlat->len[(unsigned char)cdata[i]] - 1;
+    }
 
     WvString result;
-    result.setsize(4*size + 3); // We could do better but it would slow us down
+    result.setsize(len + 1);
     char *cstr = result.edit();
     
     *cstr++ = '\"';
-    while (size-- > 0)
+    while (cdata < end)
     {
-    	const char *esc = NULL;
-        if (extra_escapes)
+        const char *next = xlat->mask.find(cdata, end);
+        cstr = copy_run(cstr, cdata, next);
+        if ((cdata = next) == end)
+            break;
+
+        // Where there's one escape there are usually more, so do the next
+        // few one at a time, and keep going while they're still there.
+        const char *block;
+        do
         {
-            const CStrExtraEscape *extra = &extra_escapes[0];
-            while (extra->ch && extra->esc)
+            block = cdata;
+            char *out = cstr;
+            const char *stop = end - cdata > 16 ? cdata + 16 : end;
+            if (xlat->short_escapes)
             {
-                if (*cdata == extra->ch)
+                for (; cdata < stop; cdata++)
                 {
-                    esc = extra->esc;
-                    break;
+                    unsigned char c = *cdata;
+                    memcpy(cstr, xlat->esc4[c], 4);
+                    cstr += xlat->len[c];
                 }
-                
-                ++extra;
             }
-        }
-        if (!esc) esc = cstr_escape_char(*cdata);
-        ++cdata;
-        while (*esc) *cstr++ = *esc++;
+            else
+            {
+                for (; cdata < stop; cdata++)
+                {
+                    const char *esc = xlat->esc[(unsigned char)*cdata];
+                    while (*esc) *cstr++ = *esc++;
+                }
+            }
+            if (cstr - out == cdata - block)
+                break;
+        } while (cdata < end);
     }
     *cstr++ = '\"';
     *cstr = '\0';
     
+    delete custom;
     return result;
 }
 
 bool cstr_unescape(WvStringParm cstr, void *data, size_t max_size, size_t &size,
         const CStrExtraEscape extra_escapes[])
 {
-    const char *q = cstr;
+    const char *q = cstr, *end = q + cstr.len();
     char *cdata = (char *)data;
     
+    // Everything up to the next backslash or quote is just copied, unless
+    // there are extra escapes that start with something else.
+    static const WvStringMask special("\\\"");
+    bool runs = true;
+    for (const CStrExtraEscape *extra = extra_escapes;
+            extra && extra->ch && extra->esc; ++extra)
+        if (extra->esc[0] != '\\')
+            runs = false;
+
     if (!q) goto misformatted;
     size = 0;
     
@@ -1101,6 +1437,21 @@ bool cstr_unescape(WvStringParm cstr, void *data, size_t max_size, size_t &size,
         if (*q++ != '\"') goto misformatted;
         while (*q && *q != '\"')
         {
+            if (runs)
+            {
+                const char *next = special.find(q, end);
+                size_t len = next - q;
+                if (cdata && size < max_size)
+                {
+                    size_t n = max_size - size < len ? max_size - size : len;
+                    memcpy(cdata, q, n);
+                    cdata += n;
+                }
+                size += len;
+                if ((q = next) == end || *q == '\"')
+                    break;
+            }
+
             bool found = false;
             char unesc;
             if (extra_escapes)
@@ -1134,60 +1485,64 @@ misformatted:
     return false;
 }
 
-WvString local_date(time_t when)
+size_t local_date(time_t when, char *buf, size_t size)
 {
-    WvString out;
-    out.setsize(80);
-
+    static TimeCache cache = { -1 };
     if (when < 0)
         when = time(NULL);
+    return format_time(cache, "%b %d %I:%M:%S %p", true, false, when, buf, size);
+}
 
-    struct tm *tmwhen = localtime(&when);
-    strftime(out.edit(), 80, "%b %d %I:%M:%S %p", tmwhen);
+WvString local_date(time_t when)
+{
+    char buf[80];
+    local_date(when, buf, sizeof(buf));
+    return buf;
+}
 
-    return out;
+size_t intl_time(time_t when, char *buf, size_t size)
+{
+    static TimeCache cache = { -1 };
+    if (when < 0)
+        when = time(NULL);
+    return format_time(cache, "%H:%M:%S", true, false, when, buf, size);
 }
 
 WvString intl_time(time_t when)
 {
-    WvString out;
-    out.setsize(12);
+    char buf[12];
+    intl_time(when, buf, sizeof(buf));
+    return buf;
+}
 
+size_t intl_date(time_t when, char *buf, size_t size)
+{
+    static TimeCache cache = { -1 };
     if (when < 0)
         when = time(NULL);
-
-    struct tm *tmwhen = localtime(&when); 
-    strftime(out.edit(), 12, "%H:%M:%S", tmwhen);
-
-    return out;
+    return format_time(cache, "%Y-%m-%d", true, false, when, buf, size);
 }
 
 WvString intl_date(time_t when)
 {
-    WvString out;
-    out.setsize(16);
+    char buf[16];
+    intl_date(when, buf, sizeof(buf));
+    return buf;
+}
 
+size_t intl_datetime(time_t when, char *buf, size_t size)
+{
+    static TimeCache cache = { -1 };
     if (when < 0)
         when = time(NULL);
-
-    struct tm *tmwhen = localtime(&when); 
-    strftime(out.edit(), 16, "%Y-%m-%d", tmwhen);
-
-    return out;
+    return format_time(cache, "%Y-%m-%d %H:%M:%S", true, false, when, buf, size);
 }
 
 WvString intl_datetime(time_t when)
 {
-    WvString out;
-    out.setsize(24);
-
-    if (when < 0)
-        when = time(NULL);
-
-    struct tm *tmwhen = localtime(&when); 
-    strftime(out.edit(), 24, "%Y-%m-%d %H:%M:%S", tmwhen);
-
-    return out;
+    char buf[24];
+    intl_datetime(when, buf, sizeof(buf));
+    return buf;
 }
 
 
@@ -1198,12 +1553,7 @@ WvString intl_datetime(time_t when)
  */
 time_t intl_gmtoff(time_t t)
 {
-    struct tm *l = localtime(&t);
-    l->tm_isdst = 0;
-    time_t local = mktime(l);
-    time_t gmt   = mktime(gmtime(&t));
-    
-    return local-gmt;
+    return tz_span(t).gmtoff;
 }
 
 
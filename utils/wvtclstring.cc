@@ -142,6 +142,14 @@ WvString wvtcl_escape(WvStringParm s, const WvStringMask &nasties)
 }
 
 
+void wvtcl_escape(WvBuf &out, const char *s, const WvStringMask &nasties)
+{
+    size_t s_len = strlen(s);
+    size_t len = wvtcl_escape(NULL, s, s_len, nasties);
+    wvtcl_escape((char *)out.alloc(len), s, s_len, nasties);
+}
+
+
 static size_t wvtcl_unescape(char *dst, const char *s, size_t s_len,
         bool *verbatim = NULL)
 {
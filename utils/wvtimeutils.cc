@@ -6,6 +6,7 @@
  */
 #include "wvtimeutils.h"
 #include <limits.h>
+#include <time.h>
 #ifndef _MSC_VER
 #include <unistd.h>
 #include <utime.h>
@@ -36,6 +37,17 @@ WvTime wvtime()
 }
 
 
+WvTime wvmonotime()
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+	return WvTime(ts.tv_sec, ts.tv_nsec / 1000);
+#endif
+    return wvtime();
+}
+
+
 WvTime msecadd(const WvTime &a, time_t msec)
 {
     WvTime b;
@@ -11,6 +11,7 @@ OBJFIXME=\
 	utils/wvsubprocqueue.o \
 	utils/wvsystem.o \
 	utils/wvregex.o \
+	utils/wvfastregex.o \
 	utils/wvglob.o \
 	utils/wvglobdiriter.o \
 	utils/wvsubproc.o \
@@ -30,6 +31,8 @@ OBJSKIP=$(OBJREPLACED) $(OBJFIXME) \
 	utils/wvfork.o \
 	utils/wvmagiccircle.o \
 	utils/wvshmzone.o \
+	utils/wvshmlogring.o \
+	utils/wvmmapbuf.o \
 	streams/wvprociter.o \
 	\
 	streams/wvlockdev.o \
@@ -37,7 +40,13 @@ OBJSKIP=$(OBJREPLACED) $(OBJFIXME) \
 	streams/wvmagicloopback.o \
 	streams/wvmodem.o \
 	streams/wvsyslog.o \
+	streams/wvbinlogfile.o \
+	streams/wvshmlog.o \
 	streams/wvsubprocqueuestream.o \
+	streams/wvworkpool.o \
+	\
+	crypto/wvasynccrypto.o \
+	crypto/wvx509batch.o \
 	\
 	ipstreams/wvipraw.o \
 	ipstreams/wvunixdgsocket.o \
@@ -78,14 +87,19 @@ TOBJSKIP=$(TOBJFIXME) \
 	utils/t/strcrypt.t.o \
 	utils/t/wvondiskhash.t.o \
 	utils/t/wvregex.t.o \
+	utils/t/wvfastregex.t.o \
 	utils/t/wvglob.t.o \
 	utils/t/wvglobdiriter.t.o \
+	utils/t/wvshmlogring.t.o \
+	utils/t/wvmmapbuf.t.o \
 	streams/t/wvprociter.t.o \
 	\
 	streams/t/wvmagicloopback.t.o \
 	streams/t/wvlogrotator.t.o \
 	streams/t/wvsubprocqueuestream.t.o \
+	streams/t/wvworkpool.t.o \
 	streams/t/wvlockfile.t.o \
+	streams/t/wvbinlogfile.t.o \
 	\
 	ipstreams/t/wvunixdgsocket.t.o \
 	ipstreams/t/wvunixsocket.t.o \